@@ -1,4 +1,7 @@
+parallel
 pitchtime,4.0,5,1.0
+spinup,100
+join
 shoot,100
 wait,0.2
 shoot,100
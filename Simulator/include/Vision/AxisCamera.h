@@ -0,0 +1,57 @@
+#ifndef AXISCAMERA_H_
+#define AXISCAMERA_H_
+
+#include "Vision2009/VisionAPI.h"
+
+class AxisCameraParams {
+public:
+	enum WhiteBalance_t {
+		kWhiteBalance_Automatic,
+		kWhiteBalance_Hold,
+		kWhiteBalance_FixedOutdoor1,
+		kWhiteBalance_FixedOutdoor2,
+		kWhiteBalance_FixedIndoor,
+		kWhiteBalance_FixedFlourescent1,
+		kWhiteBalance_FixedFlourescent2
+	};
+	enum Exposure_t {
+		kExposure_Automatic,
+		kExposure_Hold,
+		kExposure_FlickerFree50Hz,
+		kExposure_FlickerFree60Hz
+	};
+	enum Resolution_t {
+		kResolution_640x480,
+		kResolution_640x360,
+		kResolution_320x240,
+		kResolution_160x120
+	};
+};
+
+/**
+ * \class AxisCamera
+ * \brief Camera that produces frames at the configured rate in virtual time.
+ *
+ * The simulator has no scene to render, so no frame is ever fresh.
+ * IsFreshImage() waits for one frame period, which lets a task that
+ * polls the camera run in lockstep with the robot loop.
+ */
+class AxisCamera : public AxisCameraParams {
+public:
+	static AxisCamera & GetInstance(const char * camera_ip = "10.0.94.11");
+	bool IsFreshImage();
+	int GetImage(ColorImage * image);
+	void WriteBrightness(int brightness);
+	void WriteColorLevel(int color_level);
+	void WriteCompression(int compression);
+	void WriteExposureControl(Exposure_t exposure);
+	void WriteMaxFPS(int frames_per_second);
+	void WriteResolution(Resolution_t resolution);
+	void WriteWhiteBalance(WhiteBalance_t white_balance);
+private:
+	AxisCamera();
+	int frames_per_second_;
+	Resolution_t resolution_;
+};
+
+#endif
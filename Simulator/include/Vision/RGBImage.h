@@ -0,0 +1,16 @@
+#ifndef RGBIMAGE_H_
+#define RGBIMAGE_H_
+
+#include "Vision2009/VisionAPI.h"
+
+/**
+ * \class RGBImage
+ * \brief Color image with red, green and blue planes.
+ */
+class RGBImage : public ColorImage {
+public:
+	RGBImage();
+	virtual ~RGBImage();
+};
+
+#endif
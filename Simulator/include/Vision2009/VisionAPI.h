@@ -0,0 +1,175 @@
+#ifndef VISIONAPI_H_
+#define VISIONAPI_H_
+
+/**
+ * \file VisionAPI.h
+ * \brief Stand-in for the parts of the NI Vision and WPILib vision classes the robot code uses.
+ *
+ * Only used by the simulator.  Images hold real pixels, but the processing
+ * functions only do enough for the robot code to run.
+ */
+
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+using namespace std;
+
+// NI Vision types
+typedef enum ImageType_enum {
+	IMAQ_IMAGE_U8 = 0,
+	IMAQ_IMAGE_RGB = 4
+} ImageType;
+
+typedef enum ColorMode_enum {
+	IMAQ_RGB = 0,
+	IMAQ_HSL = 1,
+	IMAQ_HSV = 2
+} ColorMode;
+
+typedef enum SizeType_enum {
+	IMAQ_KEEP_LARGE = 0,
+	IMAQ_KEEP_SMALL = 1
+} SizeType;
+
+struct Rect {
+	int top;
+	int left;
+	int height;
+	int width;
+};
+
+struct Range {
+	int minValue;
+	int maxValue;
+};
+
+/**
+ * Pixel of an RGB image, in the byte order NI Vision uses.
+ */
+struct RGBValue {
+	unsigned char B;
+	unsigned char G;
+	unsigned char R;
+	unsigned char alpha;
+};
+
+/**
+ * An image.  Pixels are 1 byte for IMAQ_IMAGE_U8 and 4 bytes for IMAQ_IMAGE_RGB.
+ */
+struct Image {
+	ImageType type;
+	int width;
+	int height;
+	int pixel_size;
+	unsigned char * pixels;
+};
+
+struct ImageInfo {
+	int imageType;
+	void * imageStart;
+	int xRes;
+	int yRes;
+	int pixelsPerLine;
+	int border;
+	int xOffset;
+	int yOffset;
+};
+
+struct StructuringElement;
+
+struct ParticleAnalysisReport {
+	int imageHeight;
+	int imageWidth;
+	double imageTimestamp;
+	int particleIndex;
+	int center_mass_x;
+	int center_mass_y;
+	double center_mass_x_normalized;
+	double center_mass_y_normalized;
+	double particleArea;
+	Rect boundingRect;
+	double particleToImagePercent;
+	double particleQuality;
+};
+
+// NI Vision functions
+Image * imaqCreateImage(ImageType type, int border_size);
+int imaqDispose(void * object);
+int imaqGetImageSize(const Image * image, int * width, int * height);
+int imaqSetImageSize(Image * image, int width, int height);
+int imaqGetImageInfo(const Image * image, ImageInfo * info);
+int imaqDuplicate(Image * destination, const Image * source);
+int imaqColorThreshold(Image * destination, const Image * source, int replace_value, ColorMode mode,
+		const Range * plane1_range, const Range * plane2_range, const Range * plane3_range);
+int imaqSizeFilter(Image * destination, Image * source, int connectivity8, int erosions, SizeType keep_size,
+		const StructuringElement * structuring_element);
+int imaqConvexHull(Image * destination, Image * source, int connectivity8);
+int imaqCountParticles(Image * image, int connectivity8, int * particle_count);
+
+/**
+ * \class Threshold
+ * \brief Color plane ranges for thresholding an image.
+ */
+class Threshold {
+public:
+	int plane1Low;
+	int plane1High;
+	int plane2Low;
+	int plane2High;
+	int plane3Low;
+	int plane3High;
+	Threshold(int plane1_low, int plane1_high, int plane2_low, int plane2_high, int plane3_low, int plane3_high)
+		: plane1Low(plane1_low), plane1High(plane1_high), plane2Low(plane2_low),
+		plane2High(plane2_high), plane3Low(plane3_low), plane3High(plane3_high) {}
+};
+
+class ImageBase {
+public:
+	explicit ImageBase(ImageType type);
+	virtual ~ImageBase();
+	Image * GetImaqImage();
+	int GetWidth();
+	int GetHeight();
+	virtual void Write(const char * file_name);
+protected:
+	Image * image_;
+};
+
+class MonoImage : public ImageBase {
+public:
+	MonoImage();
+	virtual ~MonoImage();
+};
+
+/**
+ * \class BinaryImage
+ * \brief Image where each pixel is 0 or 1.
+ */
+class BinaryImage : public MonoImage {
+public:
+	BinaryImage();
+	virtual ~BinaryImage();
+	int GetNumberParticles();
+	BinaryImage * RemoveSmallObjects(bool connectivity8, int erosions);
+	BinaryImage * ConvexHull(bool connectivity8);
+	void GetParticleAnalysisReport(int particle_number, ParticleAnalysisReport * report);
+	vector<ParticleAnalysisReport> * GetOrderedParticleAnalysisReports();
+};
+
+/**
+ * \class ColorImage
+ * \brief Image with three color planes.
+ */
+class ColorImage : public ImageBase {
+public:
+	explicit ColorImage(ImageType type);
+	virtual ~ColorImage();
+	BinaryImage * ThresholdRGB(Threshold &threshold);
+	BinaryImage * ThresholdHSL(Threshold &threshold);
+	BinaryImage * ThresholdHSV(Threshold &threshold);
+private:
+	BinaryImage * ComputeThreshold(ColorMode mode, Threshold &threshold);
+};
+
+#endif
@@ -0,0 +1,352 @@
+#ifndef WPILIB_H_
+#define WPILIB_H_
+
+/**
+ * \file WPILib.h
+ * \brief Stand-in for the parts of WPILib and VxWorks the robot code uses.
+ *
+ * Only used by the simulator.  The classes keep the WPILib interfaces, but
+ * motor outputs and sensor values go through SimulatedHardware, time comes
+ * from SimulatedClock, and tasks are run in lockstep with the robot loop.
+ */
+
+#include <algorithm>
+#include <exception>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// VxWorks types
+typedef unsigned char UINT8;
+typedef unsigned short UINT16;
+typedef unsigned int UINT32;
+typedef unsigned long long UINT64;
+typedef short INT16;
+typedef int INT32;
+typedef long long INT64;
+typedef int STATUS;
+typedef int (*FUNCPTR)(...);
+typedef struct simulated_semaphore * SEM_ID;
+
+#define OK 0
+#define ERROR (-1)
+#define WAIT_FOREVER (-1)
+#define SEM_Q_PRIORITY 0x1
+#define SEM_DELETE_SAFE 0x4
+#define SEM_INVERSION_SAFE 0x8
+
+// VxWorks functions
+SEM_ID semMCreate(int options);
+STATUS semTake(SEM_ID semaphore, int timeout);
+STATUS semGive(SEM_ID semaphore);
+STATUS semDelete(SEM_ID semaphore);
+STATUS taskDelay(int ticks);
+int sysClkRateGet();
+
+/**
+ * \class Synchronized
+ * \brief Holds a semaphore for the life of the object.
+ */
+class Synchronized {
+public:
+	explicit Synchronized(SEM_ID semaphore);
+	virtual ~Synchronized();
+private:
+	SEM_ID semaphore_;
+};
+
+#define CRITICAL_REGION(s) { Synchronized _sync(s);
+#define END_REGION }
+
+// Timing
+UINT32 GetFPGATime();
+void Wait(double seconds);
+
+/**
+ * \class Timer
+ * \brief Measures virtual time.
+ */
+class Timer {
+public:
+	Timer();
+	virtual ~Timer();
+	double Get();
+	void Reset();
+	void Start();
+	void Stop();
+private:
+	double start_time_;
+	double accumulated_time_;
+	bool running_;
+};
+
+struct simulated_task;
+
+/**
+ * \class Task
+ * \brief Runs a function in its own thread, in lockstep with the robot loop.
+ */
+class Task {
+public:
+	static const UINT32 kDefaultPriority = 101;
+
+	Task(const char * name, FUNCPTR function, INT32 priority = kDefaultPriority, UINT32 stack_size = 20000);
+	virtual ~Task();
+	bool Start(intptr_t arg0 = 0, intptr_t arg1 = 0, intptr_t arg2 = 0, intptr_t arg3 = 0, intptr_t arg4 = 0,
+			intptr_t arg5 = 0, intptr_t arg6 = 0, intptr_t arg7 = 0, intptr_t arg8 = 0, intptr_t arg9 = 0);
+	bool Restart();
+	bool Stop();
+	bool Verify();
+private:
+	const char * name_;
+	FUNCPTR function_;
+	intptr_t argument_;
+	simulated_task * task_;
+};
+
+// Motor controllers
+class SpeedController {
+public:
+	virtual ~SpeedController() {}
+	virtual void Set(float speed, UINT8 sync_group = 0) = 0;
+	virtual float Get() = 0;
+};
+
+/**
+ * \class Jaguar
+ * \brief Motor controller whose output is read by the plant model.
+ */
+class Jaguar : public SpeedController {
+public:
+	explicit Jaguar(UINT32 channel);
+	Jaguar(UINT8 slot, UINT32 channel);
+	virtual ~Jaguar();
+	virtual void Set(float speed, UINT8 sync_group = 0);
+	virtual float Get();
+	void SetExpiration(double timeout);
+	void SetSafetyEnabled(bool enabled);
+private:
+	int slot_;
+	int channel_;
+};
+
+/**
+ * \class RobotDrive
+ * \brief Two motor drive with the WPILib arcade and tank drive math.
+ */
+class RobotDrive {
+public:
+	enum MotorType {
+		kFrontLeftMotor = 0,
+		kFrontRightMotor = 1,
+		kRearLeftMotor = 2,
+		kRearRightMotor = 3
+	};
+
+	RobotDrive(SpeedController * left_motor, SpeedController * right_motor);
+	virtual ~RobotDrive();
+	void ArcadeDrive(float move_value, float rotate_value, bool squared_inputs = true);
+	void TankDrive(float left_value, float right_value, bool squared_inputs = true);
+	void SetInvertedMotor(MotorType motor, bool inverted);
+	void SetExpiration(double timeout);
+	void SetSafetyEnabled(bool enabled);
+private:
+	void SetLeftRightMotorOutputs(float left_output, float right_output);
+	SpeedController * left_motor_;
+	SpeedController * right_motor_;
+	int inverted_motors_[4];
+};
+
+// Sensors
+class CounterBase {
+public:
+	enum EncodingType {
+		k1X,
+		k2X,
+		k4X
+	};
+};
+
+/**
+ * \class Encoder
+ * \brief Quadrature encoder whose count is set by the plant model.
+ */
+class Encoder {
+public:
+	Encoder(UINT32 a_channel, UINT32 b_channel, bool reverse_direction = false,
+			CounterBase::EncodingType encoding_type = CounterBase::k4X);
+	Encoder(UINT8 a_slot, UINT32 a_channel, UINT8 b_slot, UINT32 b_channel, bool reverse_direction = false,
+			CounterBase::EncodingType encoding_type = CounterBase::k4X);
+	virtual ~Encoder();
+	INT32 Get();
+	void Reset();
+	void Start();
+	void Stop();
+private:
+	int slot_;
+	int channel_;
+	bool reverse_direction_;
+	INT32 offset_;
+};
+
+/**
+ * \class Gyro
+ * \brief Gyro whose angle is set by the plant model.
+ */
+class Gyro {
+public:
+	explicit Gyro(UINT32 channel);
+	virtual ~Gyro();
+	float GetAngle();
+	void Reset();
+	void SetSensitivity(float volts_per_degree_per_second);
+private:
+	int channel_;
+	float offset_;
+};
+
+/**
+ * \class ADXL345_I2C
+ * \brief Accelerometer whose reading is set by the plant model.
+ */
+class ADXL345_I2C {
+public:
+	enum DataFormat_Range {
+		kRange_2G = 0x00,
+		kRange_4G = 0x01,
+		kRange_8G = 0x02,
+		kRange_16G = 0x03
+	};
+	enum Axes {
+		kAxis_X = 0x00,
+		kAxis_Y = 0x02,
+		kAxis_Z = 0x04
+	};
+
+	ADXL345_I2C(UINT8 slot, DataFormat_Range range = kRange_2G);
+	virtual ~ADXL345_I2C();
+	double GetAcceleration(Axes axis);
+private:
+	int slot_;
+};
+
+// Pneumatics
+class Compressor {
+public:
+	Compressor(UINT32 pressure_switch_channel, UINT32 relay_channel);
+	virtual ~Compressor();
+	bool Enabled();
+	void Start();
+	void Stop();
+private:
+	bool enabled_;
+};
+
+class Solenoid {
+public:
+	explicit Solenoid(UINT32 channel);
+	virtual ~Solenoid();
+	bool Get();
+	void Set(bool on);
+private:
+	int channel_;
+};
+
+// Driver station
+/**
+ * \class Joystick
+ * \brief Controller whose axes and buttons are set by the simulator.
+ */
+class Joystick {
+public:
+	Joystick(UINT32 port, UINT32 number_of_axes, UINT32 number_of_buttons);
+	virtual ~Joystick();
+	float GetRawAxis(UINT32 axis);
+	bool GetRawButton(UINT32 button);
+private:
+	int port_;
+};
+
+class DriverStationLCD {
+public:
+	enum Line {
+		kMain_Line6 = 0,
+		kUser_Line1 = 0,
+		kUser_Line2 = 1,
+		kUser_Line3 = 2,
+		kUser_Line4 = 3,
+		kUser_Line5 = 4,
+		kUser_Line6 = 5
+	};
+	static const int kNumLines = 6;
+	static const int kLineLength = 21;
+
+	static DriverStationLCD * GetInstance();
+	void Clear();
+	const char * GetLine(int line);
+	void PrintfLine(Line line, const char * format, ...);
+	void UpdateLCD();
+private:
+	DriverStationLCD();
+	char lines_[kNumLines][kLineLength + 1];
+};
+
+// Robot base classes
+class Watchdog {
+public:
+	Watchdog();
+	bool GetEnabled();
+	void SetEnabled(bool enabled);
+private:
+	bool enabled_;
+};
+
+class RobotBase {
+public:
+	RobotBase();
+	virtual ~RobotBase();
+	Watchdog & GetWatchdog();
+	virtual void StartCompetition() = 0;
+private:
+	Watchdog watchdog_;
+};
+
+/**
+ * \class IterativeRobot
+ * \brief Robot base class.  The simulator calls the mode functions itself.
+ */
+class IterativeRobot : public RobotBase {
+public:
+	IterativeRobot();
+	virtual ~IterativeRobot();
+	double GetPeriod();
+	void SetPeriod(double period);
+	virtual void StartCompetition();
+	virtual void RobotInit() {}
+	virtual void DisabledInit() {}
+	virtual void AutonomousInit() {}
+	virtual void TeleopInit() {}
+	virtual void DisabledPeriodic() {}
+	virtual void AutonomousPeriodic() {}
+	virtual void TeleopPeriodic() {}
+private:
+	double period_;
+};
+
+/**
+ * \brief Create the robot object.  Defined by START_ROBOT_CLASS.
+ *
+ * \return the new robot.
+ */
+RobotBase * SimulatorCreateRobot();
+
+#define START_ROBOT_CLASS(_ClassName_) \
+	RobotBase * SimulatorCreateRobot() { return new _ClassName_(); }
+
+#include "Vision2009/VisionAPI.h"
+#include "Vision/AxisCamera.h"
+
+#endif
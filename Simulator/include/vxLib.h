@@ -0,0 +1,15 @@
+#ifndef VXLIB_H_
+#define VXLIB_H_
+
+/**
+ * \file vxLib.h
+ * \brief Stand-in for the VxWorks architecture functions the robot code uses.
+ *
+ * Only used by the simulator.
+ */
+
+#include "WPILib.h"
+
+void vxTimeBaseGet(UINT32 * upper, UINT32 * lower);
+
+#endif
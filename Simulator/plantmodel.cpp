@@ -0,0 +1,166 @@
+#include <math.h>
+#include "WPILib.h"
+#include "../Source/parameters.h"
+#include "plantmodel.h"
+#include "simulatedhardware.h"
+
+/**
+ * \def GRAVITY
+ * \brief Acceleration due to gravity in feet per second squared.
+ */
+#define GRAVITY 32.174
+
+/**
+ * \def PI
+ * \brief Pi.
+ */
+#define PI 3.14159265358979
+
+/**
+ * \brief Create the plant at rest at the origin, with the default wiring.
+*/
+PlantModel::PlantModel() {
+	drive_top_speed_ = 12.0;
+	drive_time_constant_ = 0.15;
+	track_width_ = 2.0;
+	pitch_counts_per_second_ = 2500.0;
+	pitch_minimum_count_ = 0.0;
+	pitch_maximum_count_ = 5000.0;
+	flywheel_time_constant_ = 0.5;
+	winch_counts_per_second_ = 1000.0;
+
+	memset(&state_, 0, sizeof(state_));
+
+	left_motor_slot_ = -1;
+	left_motor_channel_ = -1;
+	right_motor_slot_ = -1;
+	right_motor_channel_ = -1;
+	gyro_channel_ = -1;
+	accelerometer_slot_ = -1;
+	accelerometer_axis_ = 0;
+	pitch_motor_slot_ = -1;
+	pitch_motor_channel_ = -1;
+	pitch_encoder_slot_ = SimulatedHardware::kDefaultSlot;
+	pitch_encoder_channel_ = -1;
+	shooter_motor_slot_ = -1;
+	shooter_motor_channel_ = -1;
+	winch_motor_slot_ = -1;
+	winch_motor_channel_ = -1;
+	winch_encoder_slot_ = -1;
+	winch_encoder_channel_ = -1;
+}
+
+/**
+ * \brief Find the robot's devices in the parameter files in the current directory.
+ *
+ * The optional "simulator.par" file can change the plant constants.
+ *
+ * \return true if the drive train parameters were read.
+*/
+bool PlantModel::LoadParameters() {
+	Parameters drive_train("drivetrain.par");
+	bool drive_train_read = drive_train.file_opened_ && drive_train.ReadValues();
+	drive_train.Close();
+	if (drive_train_read) {
+		drive_train.GetValue("LEFT_MOTOR_SLOT", &left_motor_slot_);
+		drive_train.GetValue("LEFT_MOTOR_CHANNEL", &left_motor_channel_);
+		drive_train.GetValue("RIGHT_MOTOR_SLOT", &right_motor_slot_);
+		drive_train.GetValue("RIGHT_MOTOR_CHANNEL", &right_motor_channel_);
+		drive_train.GetValue("GYRO_CHANNEL", &gyro_channel_);
+		drive_train.GetValue("ACCELEROMETER_SLOT", &accelerometer_slot_);
+		drive_train.GetValue("ACCELEROMETER_AXIS", &accelerometer_axis_);
+	}
+
+	Parameters shooter("shooter.par");
+	if (shooter.file_opened_ && shooter.ReadValues()) {
+		// The shooter creates its encoder with channels only, so it's on the default slot
+		shooter.GetValue("PITCH_MOTOR_SLOT", &pitch_motor_slot_);
+		shooter.GetValue("PITCH_MOTOR_CHANNEL", &pitch_motor_channel_);
+		shooter.GetValue("ENCODER_A_CHANNEL", &pitch_encoder_channel_);
+		shooter.GetValue("SHOOTER_MOTOR_SLOT", &shooter_motor_slot_);
+		shooter.GetValue("SHOOTER_MOTOR_CHANNEL", &shooter_motor_channel_);
+	}
+	shooter.Close();
+
+	Parameters climber("climber.par");
+	if (climber.file_opened_ && climber.ReadValues()) {
+		climber.GetValue("MOTOR_SLOT", &winch_motor_slot_);
+		climber.GetValue("MOTOR_CHANNEL", &winch_motor_channel_);
+		climber.GetValue("ENCODER_A_SLOT", &winch_encoder_slot_);
+		climber.GetValue("ENCODER_A_CHANNEL", &winch_encoder_channel_);
+	}
+	climber.Close();
+
+	Parameters plant("simulator.par");
+	if (plant.file_opened_ && plant.ReadValues()) {
+		plant.GetValue("DRIVE_TOP_SPEED", &drive_top_speed_);
+		plant.GetValue("DRIVE_TIME_CONSTANT", &drive_time_constant_);
+		plant.GetValue("TRACK_WIDTH", &track_width_);
+		plant.GetValue("PITCH_COUNTS_PER_SECOND", &pitch_counts_per_second_);
+		plant.GetValue("PITCH_MINIMUM_COUNT", &pitch_minimum_count_);
+		plant.GetValue("PITCH_MAXIMUM_COUNT", &pitch_maximum_count_);
+		plant.GetValue("FLYWHEEL_TIME_CONSTANT", &flywheel_time_constant_);
+		plant.GetValue("WINCH_COUNTS_PER_SECOND", &winch_counts_per_second_);
+	}
+	plant.Close();
+
+	return drive_train_read;
+}
+
+/**
+ * \brief Move the plant forward in time and update the sensors.
+ *
+ * \param step the amount of time in seconds.
+*/
+void PlantModel::Step(double step) {
+	// Drive train
+	// With the motors inverted as in drivetrain.par, the left motor drives forward
+	// with positive output and the right motor with negative output
+	state_.left_output = SimulatedHardware::GetMotorOutput(left_motor_slot_, left_motor_channel_);
+	state_.right_output = SimulatedHardware::GetMotorOutput(right_motor_slot_, right_motor_channel_);
+	double left_target = state_.left_output * drive_top_speed_;
+	double right_target = -state_.right_output * drive_top_speed_;
+	double drive_ratio = 1.0 - exp(-step / drive_time_constant_);
+	double previous_speed = (state_.left_speed + state_.right_speed) / 2.0;
+	state_.left_speed += (left_target - state_.left_speed) * drive_ratio;
+	state_.right_speed += (right_target - state_.right_speed) * drive_ratio;
+	double speed = (state_.left_speed + state_.right_speed) / 2.0;
+	double turn_rate = (state_.left_speed - state_.right_speed) / track_width_;
+
+	state_.heading += turn_rate * step * 180.0 / PI;
+	double heading = state_.heading * PI / 180.0;
+	state_.x += speed * sin(heading) * step;
+	state_.y += speed * cos(heading) * step;
+	state_.distance += speed * step;
+	state_.acceleration = ((speed - previous_speed) / step) / GRAVITY;
+
+	// Shooter pitch, between the hard stops
+	double pitch_output = SimulatedHardware::GetMotorOutput(pitch_motor_slot_, pitch_motor_channel_);
+	state_.pitch_count += pitch_output * pitch_counts_per_second_ * step;
+	state_.pitch_count = std::max(pitch_minimum_count_, std::min(pitch_maximum_count_, state_.pitch_count));
+
+	// Shooter wheel
+	double flywheel_output = SimulatedHardware::GetMotorOutput(shooter_motor_slot_, shooter_motor_channel_);
+	state_.flywheel_speed += (flywheel_output - state_.flywheel_speed) * (1.0 - exp(-step / flywheel_time_constant_));
+
+	// Climber winch
+	double winch_output = SimulatedHardware::GetMotorOutput(winch_motor_slot_, winch_motor_channel_);
+	state_.winch_count += winch_output * winch_counts_per_second_ * step;
+
+	state_.time += step;
+
+	// Update the sensors
+	SimulatedHardware::SetGyroAngle(gyro_channel_, (float) state_.heading);
+	SimulatedHardware::SetAcceleration(accelerometer_slot_, accelerometer_axis_, state_.acceleration);
+	SimulatedHardware::SetEncoderCount(pitch_encoder_slot_, pitch_encoder_channel_, (int) floor(state_.pitch_count));
+	SimulatedHardware::SetEncoderCount(winch_encoder_slot_, winch_encoder_channel_, (int) floor(state_.winch_count));
+}
+
+/**
+ * \brief Get the current state of the robot.
+ *
+ * \return the plant state.
+*/
+const plant_state & PlantModel::GetState() {
+	return state_;
+}
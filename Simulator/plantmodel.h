@@ -0,0 +1,73 @@
+#ifndef PLANTMODEL_H_
+#define PLANTMODEL_H_
+
+/**
+ * Data structure to store the state of the simulated robot.
+ */
+struct plant_state {
+	double time;				///< virtual time in seconds
+	double left_output;			///< left drive motor controller output
+	double right_output;		///< right drive motor controller output
+	double left_speed;			///< left side speed in feet per second, positive is forward
+	double right_speed;			///< right side speed in feet per second, positive is forward
+	double heading;				///< heading in degrees, positive is clockwise
+	double x;					///< position across the field in feet
+	double y;					///< position along the field in feet, positive is the starting forward direction
+	double distance;			///< total distance driven in feet, negative when driving backward
+	double acceleration;		///< forward acceleration in g
+	double pitch_count;			///< shooter pitch encoder count
+	double flywheel_speed;		///< shooter wheel speed as a fraction of its top speed
+	double winch_count;			///< climber winch encoder count
+};
+
+/**
+ * \class PlantModel
+ * \brief Simple physical models of the drive train, shooter pitch, shooter wheel and climber winch.
+ *
+ * Reads motor outputs from SimulatedHardware and writes back the gyro,
+ * accelerometer and encoder values.  The devices are found using the
+ * slots and channels in the robot's parameter files.  Each motor is a
+ * first order lag to a top speed.
+ */
+class PlantModel {
+
+public:
+	// Public methods
+	PlantModel();
+	bool LoadParameters();
+	void Step(double step);
+	const plant_state & GetState();
+
+private:
+	// Private parameters
+	double drive_top_speed_;			///< drive speed in feet per second at full output
+	double drive_time_constant_;		///< seconds for the drive to reach 63% of a speed change
+	double track_width_;				///< distance between the left and right wheels in feet
+	double pitch_counts_per_second_;	///< pitch encoder counts per second at full output
+	double pitch_minimum_count_;		///< pitch encoder count at the lower hard stop
+	double pitch_maximum_count_;		///< pitch encoder count at the upper hard stop
+	double flywheel_time_constant_;		///< seconds for the shooter wheel to reach 63% of a speed change
+	double winch_counts_per_second_;	///< winch encoder counts per second at full output
+
+	// Private member variables
+	plant_state state_;					///< current state of the robot
+	int left_motor_slot_;				///< slot of the left drive motor controller
+	int left_motor_channel_;			///< channel of the left drive motor controller
+	int right_motor_slot_;				///< slot of the right drive motor controller
+	int right_motor_channel_;			///< channel of the right drive motor controller
+	int gyro_channel_;					///< channel of the gyro
+	int accelerometer_slot_;			///< slot of the accelerometer
+	int accelerometer_axis_;			///< accelerometer axis that points forward
+	int pitch_motor_slot_;				///< slot of the pitch motor controller
+	int pitch_motor_channel_;			///< channel of the pitch motor controller
+	int pitch_encoder_slot_;			///< slot of the pitch encoder
+	int pitch_encoder_channel_;			///< A channel of the pitch encoder
+	int shooter_motor_slot_;			///< slot of the shooter wheel motor controller
+	int shooter_motor_channel_;			///< channel of the shooter wheel motor controller
+	int winch_motor_slot_;				///< slot of the winch motor controller
+	int winch_motor_channel_;			///< channel of the winch motor controller
+	int winch_encoder_slot_;			///< slot of the winch encoder
+	int winch_encoder_channel_;			///< A channel of the winch encoder
+};
+
+#endif
@@ -0,0 +1,367 @@
+#include <pthread.h>
+#include <time.h>
+#include <vxLib.h>
+#include "WPILib.h"
+#include "simulatedclock.h"
+
+/**
+ * Data structure to store the scheduling state of a simulated task.
+ */
+struct simulated_task {
+	pthread_t thread;	///< thread the task function runs in
+	FUNCPTR function;	///< task function
+	intptr_t argument;	///< argument passed to the task function
+	double wake_time;	///< virtual time when the task should run next
+	bool finished;		///< true when the task returned or was stopped
+};
+
+/**
+ * Data structure to store a simulated VxWorks semaphore.
+ */
+struct simulated_semaphore {
+	pthread_mutex_t mutex;	///< recursive mutex, like a VxWorks mutual exclusion semaphore
+};
+
+static pthread_mutex_t s_scheduler_mutex = PTHREAD_MUTEX_INITIALIZER;	///< protects the scheduler state
+static pthread_cond_t s_scheduler_changed = PTHREAD_COND_INITIALIZER;	///< signalled when the running thread changes
+static pthread_t s_main_thread = pthread_self();						///< the thread that runs main()
+static std::vector<simulated_task *> s_tasks;							///< every task that was started
+static simulated_task * s_running_task = NULL;							///< the task that is running, NULL for the main thread
+static double s_time = 0.0;												///< the current virtual time in seconds
+static void (*s_step_function)(double time, double step) = NULL;		///< called to move the plant forward
+static double s_step = 0.001;											///< the largest step the plant is moved forward at a time
+
+/**
+ * \brief Wait until a task is given control by the main thread.
+ *
+ * Must be called with the scheduler mutex held.
+ *
+ * \param task the task waiting to run.
+*/
+static void WaitForTurn(simulated_task * task) {
+	while (s_running_task != task) {
+		pthread_cond_wait(&s_scheduler_changed, &s_scheduler_mutex);
+	}
+}
+
+/**
+ * \brief Runs a task function in its thread once it's given control.
+ *
+ * \param argument the task to run.
+ * \return NULL.
+*/
+static void * RunTask(void * argument) {
+	simulated_task * task = (simulated_task *) argument;
+
+	pthread_mutex_lock(&s_scheduler_mutex);
+	WaitForTurn(task);
+	pthread_mutex_unlock(&s_scheduler_mutex);
+
+	((int (*)(void *)) task->function)((void *) task->argument);
+
+	// Give control back to the main thread for good
+	pthread_mutex_lock(&s_scheduler_mutex);
+	task->finished = true;
+	s_running_task = NULL;
+	pthread_cond_broadcast(&s_scheduler_changed);
+	pthread_mutex_unlock(&s_scheduler_mutex);
+	return NULL;
+}
+
+/**
+ * \brief Get the current virtual time.
+ *
+ * \return the time in seconds since the simulator started.
+*/
+double SimulatedClock::GetTime() {
+	return s_time;
+}
+
+/**
+ * \brief Set the function used to move the plant forward in time.
+ *
+ * \param step_function called with the time at the start of the step and the step size.
+ * \param step the largest step size in seconds.
+*/
+void SimulatedClock::SetStepFunction(void (*step_function)(double time, double step), double step) {
+	s_step_function = step_function;
+	if (step > 0.0)
+		s_step = step;
+}
+
+/**
+ * \brief Check if the caller is running in a task thread.
+ *
+ * \return true if called from a task, false if called from the main thread.
+*/
+bool SimulatedClock::IsTaskThread() {
+	return !pthread_equal(pthread_self(), s_main_thread);
+}
+
+/**
+ * \brief Move virtual time forward from the main thread.
+ *
+ * The plant is moved forward in steps, and tasks run whenever their wake up
+ * time is reached.
+ *
+ * \param seconds the amount of time to move forward.
+*/
+void SimulatedClock::Advance(double seconds) {
+	double end_time = s_time + seconds;
+	while (s_time < end_time) {
+		double step = std::min(s_step, end_time - s_time);
+		RunTasksUntil(s_time + step);
+		if (s_step_function != NULL)
+			s_step_function(s_time, step);
+		s_time += step;
+	}
+	RunTasksUntil(s_time);
+}
+
+/**
+ * \brief Wait in a task thread until virtual time moves forward.
+ *
+ * Gives control back to the main thread until the wake up time is reached.
+ *
+ * \param seconds the amount of time to wait.
+*/
+void SimulatedClock::Sleep(double seconds) {
+	pthread_mutex_lock(&s_scheduler_mutex);
+	simulated_task * task = s_running_task;
+	if (task != NULL) {
+		task->wake_time = s_time + std::max(seconds, 0.0);
+		s_running_task = NULL;
+		pthread_cond_broadcast(&s_scheduler_changed);
+		WaitForTurn(task);
+	}
+	pthread_mutex_unlock(&s_scheduler_mutex);
+}
+
+/**
+ * \brief Run each task whose wake up time is reached, in wake up order.
+ *
+ * \param time run tasks that wake up at or before this time.
+*/
+void SimulatedClock::RunTasksUntil(double time) {
+	pthread_mutex_lock(&s_scheduler_mutex);
+	while (true) {
+		// Find the task that should wake up first, oldest task first if they're the same
+		simulated_task * next_task = NULL;
+		for (unsigned int i = 0; i < s_tasks.size(); i++) {
+			simulated_task * task = s_tasks[i];
+			if (!task->finished && task->wake_time <= time &&
+					(next_task == NULL || task->wake_time < next_task->wake_time)) {
+				next_task = task;
+			}
+		}
+		if (next_task == NULL)
+			break;
+
+		// Give it control until it waits or returns
+		s_running_task = next_task;
+		pthread_cond_broadcast(&s_scheduler_changed);
+		while (s_running_task != NULL) {
+			pthread_cond_wait(&s_scheduler_changed, &s_scheduler_mutex);
+		}
+	}
+	pthread_mutex_unlock(&s_scheduler_mutex);
+}
+
+/**
+ * \brief Get the FPGA time.
+ *
+ * \return the virtual time in microseconds.
+*/
+UINT32 GetFPGATime() {
+	return (UINT32) (SimulatedClock::GetTime() * 1000000.0 + 0.5);
+}
+
+/**
+ * \brief Wait for virtual time to pass.
+ *
+ * In the main thread this moves time forward.  In a task it lets the other
+ * threads run until the time has passed.
+ *
+ * \param seconds the amount of time to wait.
+*/
+void Wait(double seconds) {
+	if (SimulatedClock::IsTaskThread())
+		SimulatedClock::Sleep(seconds);
+	else
+		SimulatedClock::Advance(seconds);
+}
+
+STATUS taskDelay(int ticks) {
+	Wait((double) ticks / sysClkRateGet());
+	return OK;
+}
+
+int sysClkRateGet() {
+	return 60;
+}
+
+/**
+ * \brief Read a time base that counts at the cRIO's rate.
+ *
+ * Unlike the rest of the clock this is real time, so the loop timer
+ * measures how long the robot code takes to run on this computer.
+ *
+ * \param upper filled with the upper 32 bits of the count.
+ * \param lower filled with the lower 32 bits of the count.
+*/
+void vxTimeBaseGet(UINT32 * upper, UINT32 * lower) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	UINT64 ticks = (UINT64) now.tv_sec * 33000000ULL + (UINT64) now.tv_nsec * 33 / 1000;
+	*upper = (UINT32) (ticks >> 32);
+	*lower = (UINT32) ticks;
+}
+
+SEM_ID semMCreate(int options) {
+	simulated_semaphore * semaphore = new simulated_semaphore;
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&semaphore->mutex, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+	return semaphore;
+}
+
+STATUS semTake(SEM_ID semaphore, int timeout) {
+	if (semaphore == NULL)
+		return ERROR;
+	return pthread_mutex_lock(&semaphore->mutex) == 0 ? OK : ERROR;
+}
+
+STATUS semGive(SEM_ID semaphore) {
+	if (semaphore == NULL)
+		return ERROR;
+	return pthread_mutex_unlock(&semaphore->mutex) == 0 ? OK : ERROR;
+}
+
+STATUS semDelete(SEM_ID semaphore) {
+	if (semaphore == NULL)
+		return ERROR;
+	pthread_mutex_destroy(&semaphore->mutex);
+	delete semaphore;
+	return OK;
+}
+
+Synchronized::Synchronized(SEM_ID semaphore) {
+	semaphore_ = semaphore;
+	semTake(semaphore_, WAIT_FOREVER);
+}
+
+Synchronized::~Synchronized() {
+	semGive(semaphore_);
+}
+
+Timer::Timer() {
+	start_time_ = 0.0;
+	accumulated_time_ = 0.0;
+	running_ = false;
+}
+
+Timer::~Timer() {
+}
+
+double Timer::Get() {
+	if (running_)
+		return accumulated_time_ + SimulatedClock::GetTime() - start_time_;
+	return accumulated_time_;
+}
+
+void Timer::Reset() {
+	accumulated_time_ = 0.0;
+	start_time_ = SimulatedClock::GetTime();
+}
+
+void Timer::Start() {
+	if (!running_) {
+		start_time_ = SimulatedClock::GetTime();
+		running_ = true;
+	}
+}
+
+void Timer::Stop() {
+	if (running_) {
+		accumulated_time_ = Get();
+		running_ = false;
+	}
+}
+
+Task::Task(const char * name, FUNCPTR function, INT32 priority, UINT32 stack_size) {
+	name_ = name;
+	function_ = function;
+	argument_ = 0;
+	task_ = NULL;
+}
+
+/**
+ * \brief Stop the task.
+ *
+ * A task thread that is waiting is left blocked until the program exits.
+*/
+Task::~Task() {
+	Stop();
+}
+
+/**
+ * \brief Start the task function in a new thread.
+ *
+ * The task first runs the next time the main thread moves time forward.
+ * Unlike WPILib the arguments are pointer sized, so the robot code can
+ * pass a pointer on a computer with 64 bit pointers.
+ *
+ * \param arg0 the argument passed to the task function, usually a pointer.
+ * \return true if the thread was created.
+*/
+bool Task::Start(intptr_t arg0, intptr_t arg1, intptr_t arg2, intptr_t arg3, intptr_t arg4,
+		intptr_t arg5, intptr_t arg6, intptr_t arg7, intptr_t arg8, intptr_t arg9) {
+	if (Verify())
+		return false;
+
+	simulated_task * task = new simulated_task;
+	task->function = function_;
+	task->argument = arg0;
+	task->wake_time = SimulatedClock::GetTime();
+	task->finished = false;
+
+	pthread_mutex_lock(&s_scheduler_mutex);
+	if (pthread_create(&task->thread, NULL, RunTask, task) != 0) {
+		pthread_mutex_unlock(&s_scheduler_mutex);
+		delete task;
+		return false;
+	}
+	pthread_detach(task->thread);
+	s_tasks.push_back(task);
+	pthread_mutex_unlock(&s_scheduler_mutex);
+
+	argument_ = arg0;
+	task_ = task;
+	return true;
+}
+
+bool Task::Restart() {
+	Stop();
+	return Start(argument_);
+}
+
+/**
+ * \brief Stop scheduling the task.
+ *
+ * \return true if the task was running.
+*/
+bool Task::Stop() {
+	if (!Verify())
+		return false;
+	pthread_mutex_lock(&s_scheduler_mutex);
+	task_->finished = true;
+	pthread_mutex_unlock(&s_scheduler_mutex);
+	task_ = NULL;
+	return true;
+}
+
+bool Task::Verify() {
+	return task_ != NULL && !task_->finished;
+}
@@ -0,0 +1,29 @@
+#ifndef SIMULATEDCLOCK_H_
+#define SIMULATEDCLOCK_H_
+
+/**
+ * \class SimulatedClock
+ * \brief Virtual time for the simulator, and lockstep scheduling of the robot's tasks.
+ *
+ * Only the main thread moves time forward, using Advance().  Each task
+ * started with Task::Start() runs in its own thread, but only one thread
+ * runs at a time: a task runs when its wake up time is reached and gives
+ * control back when it calls Wait() or returns.  Because of this, a run
+ * gives the same results every time, no matter how fast the computer is.
+ */
+class SimulatedClock {
+
+public:
+	// Public methods
+	static double GetTime();
+	static void Advance(double seconds);
+	static void SetStepFunction(void (*step_function)(double time, double step), double step);
+	static bool IsTaskThread();
+	static void Sleep(double seconds);
+
+private:
+	// Private methods
+	static void RunTasksUntil(double time);
+};
+
+#endif
@@ -0,0 +1,405 @@
+#include <map>
+#include <math.h>
+#include <stdarg.h>
+#include "WPILib.h"
+#include "simulatedhardware.h"
+
+/**
+ * \def DeviceKey(slot, channel)
+ * \brief Combines a slot and channel into one key for the device maps.
+ */
+#define DeviceKey(slot, channel)	((slot) * 1000 + (channel))
+
+static std::map<int, float> s_motor_outputs;		///< motor controller outputs by slot and channel
+static std::map<int, int> s_encoder_counts;			///< encoder counts by slot and A channel
+static std::map<int, float> s_gyro_angles;			///< gyro angles by channel
+static std::map<int, double> s_accelerations;		///< accelerations by slot and axis
+static std::map<int, bool> s_solenoids;				///< solenoid states by channel
+static std::map<int, float> s_joystick_axes;		///< joystick axes by port and axis
+static std::map<int, bool> s_joystick_buttons;		///< joystick buttons by port and button
+
+/**
+ * \brief Look up a value in a device map.
+ *
+ * \param values the device map.
+ * \param key the device key.
+ * \return the value, or 0 if the device hasn't been set.
+*/
+template <class T>
+static T GetDeviceValue(const std::map<int, T> &values, int key) {
+	typename std::map<int, T>::const_iterator it = values.find(key);
+	if (it == values.end())
+		return T();
+	return it->second;
+}
+
+float SimulatedHardware::GetMotorOutput(int slot, int channel) {
+	return GetDeviceValue(s_motor_outputs, DeviceKey(slot, channel));
+}
+
+void SimulatedHardware::SetMotorOutput(int slot, int channel, float output) {
+	s_motor_outputs[DeviceKey(slot, channel)] = output;
+}
+
+int SimulatedHardware::GetEncoderCount(int slot, int channel) {
+	return GetDeviceValue(s_encoder_counts, DeviceKey(slot, channel));
+}
+
+void SimulatedHardware::SetEncoderCount(int slot, int channel, int count) {
+	s_encoder_counts[DeviceKey(slot, channel)] = count;
+}
+
+float SimulatedHardware::GetGyroAngle(int channel) {
+	return GetDeviceValue(s_gyro_angles, channel);
+}
+
+void SimulatedHardware::SetGyroAngle(int channel, float angle) {
+	s_gyro_angles[channel] = angle;
+}
+
+double SimulatedHardware::GetAcceleration(int slot, int axis) {
+	return GetDeviceValue(s_accelerations, DeviceKey(slot, axis));
+}
+
+void SimulatedHardware::SetAcceleration(int slot, int axis, double acceleration) {
+	s_accelerations[DeviceKey(slot, axis)] = acceleration;
+}
+
+bool SimulatedHardware::GetSolenoid(int channel) {
+	return GetDeviceValue(s_solenoids, channel);
+}
+
+void SimulatedHardware::SetSolenoid(int channel, bool on) {
+	s_solenoids[channel] = on;
+}
+
+float SimulatedHardware::GetJoystickAxis(int port, int axis) {
+	return GetDeviceValue(s_joystick_axes, DeviceKey(port, axis));
+}
+
+void SimulatedHardware::SetJoystickAxis(int port, int axis, float value) {
+	s_joystick_axes[DeviceKey(port, axis)] = value;
+}
+
+bool SimulatedHardware::GetJoystickButton(int port, int button) {
+	return GetDeviceValue(s_joystick_buttons, DeviceKey(port, button));
+}
+
+void SimulatedHardware::SetJoystickButton(int port, int button, bool pressed) {
+	s_joystick_buttons[DeviceKey(port, button)] = pressed;
+}
+
+// Motor controllers
+Jaguar::Jaguar(UINT32 channel) {
+	slot_ = SimulatedHardware::kDefaultSlot;
+	channel_ = channel;
+	SimulatedHardware::SetMotorOutput(slot_, channel_, 0.0);
+}
+
+Jaguar::Jaguar(UINT8 slot, UINT32 channel) {
+	slot_ = slot;
+	channel_ = channel;
+	SimulatedHardware::SetMotorOutput(slot_, channel_, 0.0);
+}
+
+Jaguar::~Jaguar() {
+	SimulatedHardware::SetMotorOutput(slot_, channel_, 0.0);
+}
+
+void Jaguar::Set(float speed, UINT8 sync_group) {
+	SimulatedHardware::SetMotorOutput(slot_, channel_, std::max(-1.0f, std::min(1.0f, speed)));
+}
+
+float Jaguar::Get() {
+	return SimulatedHardware::GetMotorOutput(slot_, channel_);
+}
+
+void Jaguar::SetExpiration(double timeout) {
+}
+
+void Jaguar::SetSafetyEnabled(bool enabled) {
+}
+
+RobotDrive::RobotDrive(SpeedController * left_motor, SpeedController * right_motor) {
+	left_motor_ = left_motor;
+	right_motor_ = right_motor;
+	for (int i = 0; i < 4; i++) {
+		inverted_motors_[i] = 1;
+	}
+	SetLeftRightMotorOutputs(0.0, 0.0);
+}
+
+RobotDrive::~RobotDrive() {
+}
+
+/**
+ * \brief Drive with one value for speed and one for rotation, using the WPILib math.
+ *
+ * \param move_value the forward speed.
+ * \param rotate_value the rotation speed.
+ * \param squared_inputs true to square the inputs for finer control at low speeds.
+*/
+void RobotDrive::ArcadeDrive(float move_value, float rotate_value, bool squared_inputs) {
+	float left_output;
+	float right_output;
+
+	move_value = std::max(-1.0f, std::min(1.0f, move_value));
+	rotate_value = std::max(-1.0f, std::min(1.0f, rotate_value));
+	if (squared_inputs) {
+		move_value = move_value >= 0.0 ? move_value * move_value : -(move_value * move_value);
+		rotate_value = rotate_value >= 0.0 ? rotate_value * rotate_value : -(rotate_value * rotate_value);
+	}
+
+	if (move_value > 0.0) {
+		if (rotate_value > 0.0) {
+			left_output = move_value - rotate_value;
+			right_output = std::max(move_value, rotate_value);
+		}
+		else {
+			left_output = std::max(move_value, -rotate_value);
+			right_output = move_value + rotate_value;
+		}
+	}
+	else {
+		if (rotate_value > 0.0) {
+			left_output = -std::max(-move_value, rotate_value);
+			right_output = move_value + rotate_value;
+		}
+		else {
+			left_output = move_value - rotate_value;
+			right_output = -std::max(-move_value, -rotate_value);
+		}
+	}
+	SetLeftRightMotorOutputs(left_output, right_output);
+}
+
+void RobotDrive::TankDrive(float left_value, float right_value, bool squared_inputs) {
+	left_value = std::max(-1.0f, std::min(1.0f, left_value));
+	right_value = std::max(-1.0f, std::min(1.0f, right_value));
+	if (squared_inputs) {
+		left_value = left_value >= 0.0 ? left_value * left_value : -(left_value * left_value);
+		right_value = right_value >= 0.0 ? right_value * right_value : -(right_value * right_value);
+	}
+	SetLeftRightMotorOutputs(left_value, right_value);
+}
+
+void RobotDrive::SetInvertedMotor(MotorType motor, bool inverted) {
+	inverted_motors_[motor] = inverted ? -1 : 1;
+}
+
+void RobotDrive::SetExpiration(double timeout) {
+}
+
+void RobotDrive::SetSafetyEnabled(bool enabled) {
+}
+
+/**
+ * \brief Set the motors, the right one reversed, like a two motor WPILib RobotDrive.
+ *
+ * \param left_output the left motor output.
+ * \param right_output the right motor output.
+*/
+void RobotDrive::SetLeftRightMotorOutputs(float left_output, float right_output) {
+	if (left_motor_ != NULL)
+		left_motor_->Set(left_output * inverted_motors_[kRearLeftMotor]);
+	if (right_motor_ != NULL)
+		right_motor_->Set(-right_output * inverted_motors_[kRearRightMotor]);
+}
+
+// Sensors
+Encoder::Encoder(UINT32 a_channel, UINT32 b_channel, bool reverse_direction, CounterBase::EncodingType encoding_type) {
+	slot_ = SimulatedHardware::kDefaultSlot;
+	channel_ = a_channel;
+	reverse_direction_ = reverse_direction;
+	offset_ = 0;
+}
+
+Encoder::Encoder(UINT8 a_slot, UINT32 a_channel, UINT8 b_slot, UINT32 b_channel, bool reverse_direction,
+		CounterBase::EncodingType encoding_type) {
+	slot_ = a_slot;
+	channel_ = a_channel;
+	reverse_direction_ = reverse_direction;
+	offset_ = 0;
+}
+
+Encoder::~Encoder() {
+}
+
+INT32 Encoder::Get() {
+	INT32 count = SimulatedHardware::GetEncoderCount(slot_, channel_) - offset_;
+	return reverse_direction_ ? -count : count;
+}
+
+void Encoder::Reset() {
+	offset_ = SimulatedHardware::GetEncoderCount(slot_, channel_);
+}
+
+void Encoder::Start() {
+}
+
+void Encoder::Stop() {
+}
+
+Gyro::Gyro(UINT32 channel) {
+	channel_ = channel;
+	offset_ = 0.0;
+}
+
+Gyro::~Gyro() {
+}
+
+float Gyro::GetAngle() {
+	return SimulatedHardware::GetGyroAngle(channel_) - offset_;
+}
+
+void Gyro::Reset() {
+	offset_ = SimulatedHardware::GetGyroAngle(channel_);
+}
+
+void Gyro::SetSensitivity(float volts_per_degree_per_second) {
+}
+
+ADXL345_I2C::ADXL345_I2C(UINT8 slot, DataFormat_Range range) {
+	slot_ = slot;
+}
+
+ADXL345_I2C::~ADXL345_I2C() {
+}
+
+double ADXL345_I2C::GetAcceleration(Axes axis) {
+	return SimulatedHardware::GetAcceleration(slot_, axis);
+}
+
+// Pneumatics
+Compressor::Compressor(UINT32 pressure_switch_channel, UINT32 relay_channel) {
+	enabled_ = false;
+}
+
+Compressor::~Compressor() {
+}
+
+bool Compressor::Enabled() {
+	return enabled_;
+}
+
+void Compressor::Start() {
+	enabled_ = true;
+}
+
+void Compressor::Stop() {
+	enabled_ = false;
+}
+
+Solenoid::Solenoid(UINT32 channel) {
+	channel_ = channel;
+}
+
+Solenoid::~Solenoid() {
+}
+
+bool Solenoid::Get() {
+	return SimulatedHardware::GetSolenoid(channel_);
+}
+
+void Solenoid::Set(bool on) {
+	SimulatedHardware::SetSolenoid(channel_, on);
+}
+
+// Driver station
+Joystick::Joystick(UINT32 port, UINT32 number_of_axes, UINT32 number_of_buttons) {
+	port_ = port;
+}
+
+Joystick::~Joystick() {
+}
+
+float Joystick::GetRawAxis(UINT32 axis) {
+	return SimulatedHardware::GetJoystickAxis(port_, axis);
+}
+
+bool Joystick::GetRawButton(UINT32 button) {
+	return SimulatedHardware::GetJoystickButton(port_, button);
+}
+
+DriverStationLCD::DriverStationLCD() {
+	Clear();
+}
+
+DriverStationLCD * DriverStationLCD::GetInstance() {
+	static DriverStationLCD instance;
+	return &instance;
+}
+
+void DriverStationLCD::Clear() {
+	for (int i = 0; i < kNumLines; i++) {
+		memset(lines_[i], ' ', kLineLength);
+		lines_[i][kLineLength] = 0;
+	}
+}
+
+/**
+ * \brief Get the text shown on a line of the display.
+ *
+ * \param line the line number, 0 to 5.
+ * \return the text, padded with spaces.
+*/
+const char * DriverStationLCD::GetLine(int line) {
+	if (line < 0 || line >= kNumLines)
+		return "";
+	return lines_[line];
+}
+
+void DriverStationLCD::PrintfLine(Line line, const char * format, ...) {
+	char text[256];
+	va_list arguments;
+	va_start(arguments, format);
+	vsnprintf(text, sizeof(text), format, arguments);
+	va_end(arguments);
+
+	memset(lines_[line], ' ', kLineLength);
+	memcpy(lines_[line], text, std::min((int) strlen(text), kLineLength));
+}
+
+void DriverStationLCD::UpdateLCD() {
+}
+
+// Robot base classes
+Watchdog::Watchdog() {
+	enabled_ = true;
+}
+
+bool Watchdog::GetEnabled() {
+	return enabled_;
+}
+
+void Watchdog::SetEnabled(bool enabled) {
+	enabled_ = enabled;
+}
+
+RobotBase::RobotBase() {
+}
+
+RobotBase::~RobotBase() {
+}
+
+Watchdog & RobotBase::GetWatchdog() {
+	return watchdog_;
+}
+
+IterativeRobot::IterativeRobot() {
+	period_ = 0.0;
+}
+
+IterativeRobot::~IterativeRobot() {
+}
+
+double IterativeRobot::GetPeriod() {
+	return period_;
+}
+
+void IterativeRobot::SetPeriod(double period) {
+	period_ = period;
+}
+
+void IterativeRobot::StartCompetition() {
+}
@@ -0,0 +1,35 @@
+#ifndef SIMULATEDHARDWARE_H_
+#define SIMULATEDHARDWARE_H_
+
+/**
+ * \class SimulatedHardware
+ * \brief Connects the stand-in WPILib devices to the plant model and the simulator.
+ *
+ * Devices are found by the same slot and channel numbers the robot code
+ * reads from its parameter files.  Motor controllers write their outputs
+ * here, and the plant model writes the sensor values the robot code reads.
+ */
+class SimulatedHardware {
+
+public:
+	// Public methods
+	static float GetMotorOutput(int slot, int channel);
+	static void SetMotorOutput(int slot, int channel, float output);
+	static int GetEncoderCount(int slot, int channel);
+	static void SetEncoderCount(int slot, int channel, int count);
+	static float GetGyroAngle(int channel);
+	static void SetGyroAngle(int channel, float angle);
+	static double GetAcceleration(int slot, int axis);
+	static void SetAcceleration(int slot, int axis, double acceleration);
+	static bool GetSolenoid(int channel);
+	static void SetSolenoid(int channel, bool on);
+	static float GetJoystickAxis(int port, int axis);
+	static void SetJoystickAxis(int port, int axis, float value);
+	static bool GetJoystickButton(int port, int button);
+	static void SetJoystickButton(int port, int button, bool pressed);
+
+	// Public constants
+	static const int kDefaultSlot = 1;	///< slot used by devices created with only a channel
+};
+
+#endif
@@ -0,0 +1,327 @@
+#include "WPILib.h"
+#include "Vision/RGBImage.h"
+
+/**
+ * \brief Find the hue, saturation and value or lightness of a pixel, each scaled to 0-255.
+ *
+ * \param pixel the RGB pixel.
+ * \param mode IMAQ_HSL or IMAQ_HSV.
+ * \param planes filled with the three plane values.
+*/
+static void ConvertPixel(const RGBValue &pixel, ColorMode mode, int * planes) {
+	int maximum = std::max(pixel.R, std::max(pixel.G, pixel.B));
+	int minimum = std::min(pixel.R, std::min(pixel.G, pixel.B));
+	int delta = maximum - minimum;
+
+	// Hue
+	int hue = 0;
+	if (delta > 0) {
+		if (maximum == pixel.R)
+			hue = (43 * (pixel.G - pixel.B)) / delta;
+		else if (maximum == pixel.G)
+			hue = 85 + (43 * (pixel.B - pixel.R)) / delta;
+		else
+			hue = 171 + (43 * (pixel.R - pixel.G)) / delta;
+		if (hue < 0)
+			hue += 256;
+	}
+	planes[0] = hue;
+
+	if (mode == IMAQ_HSV) {
+		planes[1] = maximum == 0 ? 0 : (255 * delta) / maximum;
+		planes[2] = maximum;
+	}
+	else {
+		int sum = maximum + minimum;
+		planes[2] = sum / 2;
+		if (delta == 0)
+			planes[1] = 0;
+		else if (sum <= 255)
+			planes[1] = (255 * delta) / sum;
+		else
+			planes[1] = (255 * delta) / (510 - sum);
+	}
+}
+
+Image * imaqCreateImage(ImageType type, int border_size) {
+	Image * image = new Image;
+	image->type = type;
+	image->width = 0;
+	image->height = 0;
+	image->pixel_size = (type == IMAQ_IMAGE_RGB) ? 4 : 1;
+	image->pixels = NULL;
+	return image;
+}
+
+int imaqDispose(void * object) {
+	Image * image = (Image *) object;
+	if (image == NULL)
+		return 0;
+	delete [] image->pixels;
+	delete image;
+	return 1;
+}
+
+int imaqGetImageSize(const Image * image, int * width, int * height) {
+	if (image == NULL)
+		return 0;
+	if (width != NULL)
+		*width = image->width;
+	if (height != NULL)
+		*height = image->height;
+	return 1;
+}
+
+int imaqSetImageSize(Image * image, int width, int height) {
+	if (image == NULL || width < 0 || height < 0)
+		return 0;
+	delete [] image->pixels;
+	image->width = width;
+	image->height = height;
+	image->pixels = new unsigned char[width * height * image->pixel_size];
+	memset(image->pixels, 0, width * height * image->pixel_size);
+	return 1;
+}
+
+int imaqGetImageInfo(const Image * image, ImageInfo * info) {
+	if (image == NULL || info == NULL)
+		return 0;
+	memset(info, 0, sizeof(ImageInfo));
+	info->imageType = image->type;
+	info->imageStart = image->pixels;
+	info->xRes = image->width;
+	info->yRes = image->height;
+	info->pixelsPerLine = image->width;
+	return 1;
+}
+
+int imaqDuplicate(Image * destination, const Image * source) {
+	if (destination == NULL || source == NULL)
+		return 0;
+	destination->type = source->type;
+	if (destination->pixel_size != source->pixel_size || destination->width != source->width ||
+			destination->height != source->height) {
+		destination->pixel_size = source->pixel_size;
+		imaqSetImageSize(destination, source->width, source->height);
+	}
+	memcpy(destination->pixels, source->pixels, source->width * source->height * source->pixel_size);
+	return 1;
+}
+
+/**
+ * \brief Set each pixel inside all three plane ranges to the replace value, and the others to 0.
+*/
+int imaqColorThreshold(Image * destination, const Image * source, int replace_value, ColorMode mode,
+		const Range * plane1_range, const Range * plane2_range, const Range * plane3_range) {
+	if (destination == NULL || source == NULL || source->type != IMAQ_IMAGE_RGB)
+		return 0;
+	if (destination->width != source->width || destination->height != source->height)
+		imaqSetImageSize(destination, source->width, source->height);
+
+	int pixel_count = source->width * source->height;
+	unsigned char * output = destination->pixels;
+	const RGBValue * pixels = (const RGBValue *) source->pixels;
+	for (int i = 0; i < pixel_count; i++) {
+		int planes[3];
+		if (mode == IMAQ_RGB) {
+			planes[0] = pixels[i].R;
+			planes[1] = pixels[i].G;
+			planes[2] = pixels[i].B;
+		}
+		else {
+			ConvertPixel(pixels[i], mode, planes);
+		}
+		output[i] = (planes[0] >= plane1_range->minValue && planes[0] <= plane1_range->maxValue &&
+				planes[1] >= plane2_range->minValue && planes[1] <= plane2_range->maxValue &&
+				planes[2] >= plane3_range->minValue && planes[2] <= plane3_range->maxValue) ? replace_value : 0;
+	}
+	return 1;
+}
+
+/**
+ * \brief Copy the image.  The simulator doesn't remove particles.
+*/
+int imaqSizeFilter(Image * destination, Image * source, int connectivity8, int erosions, SizeType keep_size,
+		const StructuringElement * structuring_element) {
+	if (destination == NULL || source == NULL)
+		return 0;
+	if (destination != source) {
+		if (destination->width != source->width || destination->height != source->height)
+			imaqSetImageSize(destination, source->width, source->height);
+		memcpy(destination->pixels, source->pixels, source->width * source->height);
+	}
+	return 1;
+}
+
+/**
+ * \brief Copy the image.  The simulator doesn't fill particles.
+*/
+int imaqConvexHull(Image * destination, Image * source, int connectivity8) {
+	return imaqSizeFilter(destination, source, connectivity8, 0, IMAQ_KEEP_LARGE, NULL);
+}
+
+/**
+ * \brief Count the particles.  The simulator doesn't analyze particles, so there are none.
+*/
+int imaqCountParticles(Image * image, int connectivity8, int * particle_count) {
+	if (image == NULL || particle_count == NULL)
+		return 0;
+	*particle_count = 0;
+	return 1;
+}
+
+ImageBase::ImageBase(ImageType type) {
+	image_ = imaqCreateImage(type, 0);
+}
+
+ImageBase::~ImageBase() {
+	imaqDispose(image_);
+}
+
+Image * ImageBase::GetImaqImage() {
+	return image_;
+}
+
+int ImageBase::GetWidth() {
+	return image_->width;
+}
+
+int ImageBase::GetHeight() {
+	return image_->height;
+}
+
+void ImageBase::Write(const char * file_name) {
+}
+
+MonoImage::MonoImage() : ImageBase(IMAQ_IMAGE_U8) {
+}
+
+MonoImage::~MonoImage() {
+}
+
+BinaryImage::BinaryImage() {
+}
+
+BinaryImage::~BinaryImage() {
+}
+
+int BinaryImage::GetNumberParticles() {
+	return 0;
+}
+
+BinaryImage * BinaryImage::RemoveSmallObjects(bool connectivity8, int erosions) {
+	BinaryImage * result = new BinaryImage();
+	imaqSizeFilter(result->image_, image_, connectivity8, erosions, IMAQ_KEEP_LARGE, NULL);
+	return result;
+}
+
+BinaryImage * BinaryImage::ConvexHull(bool connectivity8) {
+	BinaryImage * result = new BinaryImage();
+	imaqConvexHull(result->image_, image_, connectivity8);
+	return result;
+}
+
+void BinaryImage::GetParticleAnalysisReport(int particle_number, ParticleAnalysisReport * report) {
+	if (report != NULL)
+		memset(report, 0, sizeof(ParticleAnalysisReport));
+}
+
+/**
+ * \brief Get the particle reports.
+ *
+ * The simulator doesn't analyze particles, so the list is always empty.
+ *
+ * \return a new, empty list of reports.
+*/
+vector<ParticleAnalysisReport> * BinaryImage::GetOrderedParticleAnalysisReports() {
+	return new vector<ParticleAnalysisReport>();
+}
+
+ColorImage::ColorImage(ImageType type) : ImageBase(type) {
+}
+
+ColorImage::~ColorImage() {
+}
+
+BinaryImage * ColorImage::ThresholdRGB(Threshold &threshold) {
+	return ComputeThreshold(IMAQ_RGB, threshold);
+}
+
+BinaryImage * ColorImage::ThresholdHSL(Threshold &threshold) {
+	return ComputeThreshold(IMAQ_HSL, threshold);
+}
+
+BinaryImage * ColorImage::ThresholdHSV(Threshold &threshold) {
+	return ComputeThreshold(IMAQ_HSV, threshold);
+}
+
+/**
+ * \brief Make a binary image of the threshold using imaqColorThreshold().
+ *
+ * \param mode the color planes to compare.
+ * \param threshold the plane ranges.
+ * \return the new binary image.
+*/
+BinaryImage * ColorImage::ComputeThreshold(ColorMode mode, Threshold &threshold) {
+	Range plane1_range = {threshold.plane1Low, threshold.plane1High};
+	Range plane2_range = {threshold.plane2Low, threshold.plane2High};
+	Range plane3_range = {threshold.plane3Low, threshold.plane3High};
+	BinaryImage * result = new BinaryImage();
+	imaqColorThreshold(result->GetImaqImage(), image_, 1, mode, &plane1_range, &plane2_range, &plane3_range);
+	return result;
+}
+
+RGBImage::RGBImage() : ColorImage(IMAQ_IMAGE_RGB) {
+}
+
+RGBImage::~RGBImage() {
+}
+
+AxisCamera::AxisCamera() {
+	frames_per_second_ = 10;
+	resolution_ = kResolution_320x240;
+}
+
+AxisCamera & AxisCamera::GetInstance(const char * camera_ip) {
+	static AxisCamera instance;
+	return instance;
+}
+
+/**
+ * \brief Wait for the next frame.
+ *
+ * There is no scene to render, so the frame is never fresh.
+ *
+ * \return false.
+*/
+bool AxisCamera::IsFreshImage() {
+	Wait(1.0 / std::max(frames_per_second_, 1));
+	return false;
+}
+
+int AxisCamera::GetImage(ColorImage * image) {
+	return 0;
+}
+
+void AxisCamera::WriteBrightness(int brightness) {
+}
+
+void AxisCamera::WriteColorLevel(int color_level) {
+}
+
+void AxisCamera::WriteCompression(int compression) {
+}
+
+void AxisCamera::WriteExposureControl(Exposure_t exposure) {
+}
+
+void AxisCamera::WriteMaxFPS(int frames_per_second) {
+	frames_per_second_ = frames_per_second;
+}
+
+void AxisCamera::WriteResolution(Resolution_t resolution) {
+	resolution_ = resolution;
+}
+
+void AxisCamera::WriteWhiteBalance(WhiteBalance_t white_balance) {
+}
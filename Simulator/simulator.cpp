@@ -0,0 +1,375 @@
+/**
+ * Host simulator for the TechnoJays robot program.
+ *
+ * Runs the robot class through disabled, autonomous and teleop on a virtual
+ * clock, with the motors driving a simple plant model that updates the
+ * sensors.  The robot's background tasks run in lockstep with the main
+ * loop, so every run with the same inputs gives the same trace.  The real
+ * time spent in each periodic call is measured and reported.
+ *
+ * Build: make -C Simulator
+ * Usage: simulator [-s script.as] [-p parameter_dir] [-c script_dir] [-r run_dir]
+ *                  [-d disabled_seconds] [-a autonomous_seconds] [-t teleop_seconds]
+ *                  [-j port,axis,value] [-o trace.csv]
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include "WPILib.h"
+#include "plantmodel.h"
+#include "simulatedclock.h"
+#include "simulatedhardware.h"
+
+/**
+ * \def PLANT_STEP
+ * \brief The largest step in seconds used to move the plant forward.
+ */
+#define PLANT_STEP 0.001
+
+/**
+ * \def DEFAULT_PERIOD
+ * \brief The periodic rate in seconds used when the robot syncs with the DriverStation.
+ */
+#define DEFAULT_PERIOD 0.02
+
+/**
+ * \def PARAMETER_FILE_COUNT
+ * \brief The number of parameter files copied to the run directory.
+ */
+#define PARAMETER_FILE_COUNT 7
+
+static const char * kParameterFiles[PARAMETER_FILE_COUNT] = {
+	"climber.par",
+	"drivetrain.par",
+	"feeder.par",
+	"shooter.par",
+	"targeting.par",
+	"technojays.par",
+	"userinterface.par"
+};
+
+/**
+ * Data structure to store the real time spent in each periodic call of a mode.
+ */
+struct mode_timing {
+	const char * name;					///< name of the robot mode
+	std::vector<double> loop_times;		///< real time of each periodic call in microseconds
+	double virtual_time;				///< virtual time spent in the mode in seconds
+	double real_time;					///< real time spent in the mode in seconds
+};
+
+static PlantModel * s_plant = NULL;		///< plant moved forward by the virtual clock
+static FILE * s_trace = NULL;			///< trace file written after each plant step
+
+/**
+ * \brief Get the real time.
+ *
+ * \return the monotonic clock in seconds.
+*/
+static double GetRealTime() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+/**
+ * \brief Move the plant forward and write a line to the trace.
+ *
+ * \param time the virtual time at the start of the step.
+ * \param step the size of the step in seconds.
+*/
+static void StepPlant(double time, double step) {
+	s_plant->Step(step);
+	if (s_trace != NULL) {
+		const plant_state &state = s_plant->GetState();
+		fprintf(s_trace, "%.3f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", state.time,
+				state.left_output, state.right_output,
+				state.left_speed, state.right_speed, state.heading, state.x, state.y, state.distance,
+				state.acceleration, state.pitch_count, state.flywheel_speed);
+	}
+}
+
+/**
+ * \brief Copy a file.
+ *
+ * \param source the file to copy.
+ * \param destination the new file.
+ * \return true if the whole file was copied.
+*/
+static bool CopyFile(const char * source, const char * destination) {
+	FILE * input = fopen(source, "rb");
+	if (input == NULL)
+		return false;
+	FILE * output = fopen(destination, "wb");
+	if (output == NULL) {
+		fclose(input);
+		return false;
+	}
+
+	char buffer[4096];
+	size_t count;
+	bool copied = true;
+	while ((count = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+		if (fwrite(buffer, 1, count, output) != count) {
+			copied = false;
+			break;
+		}
+	}
+	fclose(input);
+	fclose(output);
+	return copied;
+}
+
+/**
+ * \brief Create the run directory with the parameter files and the script.
+ *
+ * The robot runs the first script it finds, so only the chosen script is copied.
+ *
+ * \param run_directory the directory the robot runs in.
+ * \param parameter_directory the directory with the parameter files.
+ * \param script_directory the directory with the script.
+ * \param script the script file name, or NULL for no script.
+ * \return true if the directory is ready.
+*/
+static bool PrepareRunDirectory(const char * run_directory, const char * parameter_directory,
+		const char * script_directory, const char * script) {
+	char source[512];
+	char destination[512];
+
+	if (mkdir(run_directory, 0755) != 0 && errno != EEXIST) {
+		fprintf(stderr, "Unable to create %s\n", run_directory);
+		return false;
+	}
+
+	// Remove the files from a previous run so the robot only sees this run's script
+	std::vector<std::string> old_files;
+	DIR * directory = opendir(run_directory);
+	if (directory != NULL) {
+		struct dirent * entry;
+		while ((entry = readdir(directory)) != NULL) {
+			const char * extension = strrchr(entry->d_name, '.');
+			if (extension != NULL && (strcmp(extension, ".as") == 0 || strcmp(extension, ".par") == 0 ||
+					strcmp(extension, ".log") == 0)) {
+				old_files.push_back(entry->d_name);
+			}
+		}
+		closedir(directory);
+	}
+	for (unsigned int i = 0; i < old_files.size(); i++) {
+		sprintf(destination, "%s/%s", run_directory, old_files[i].c_str());
+		remove(destination);
+	}
+
+	for (int i = 0; i < PARAMETER_FILE_COUNT; i++) {
+		sprintf(source, "%s/%s", parameter_directory, kParameterFiles[i]);
+		sprintf(destination, "%s/%s", run_directory, kParameterFiles[i]);
+		if (!CopyFile(source, destination)) {
+			fprintf(stderr, "Unable to copy %s\n", source);
+			return false;
+		}
+	}
+
+	// Copy the optional plant constants
+	sprintf(source, "%s/simulator.par", parameter_directory);
+	sprintf(destination, "%s/simulator.par", run_directory);
+	CopyFile(source, destination);
+
+	if (script != NULL) {
+		sprintf(source, "%s/%s", script_directory, script);
+		sprintf(destination, "%s/%s", run_directory, script);
+		if (!CopyFile(source, destination)) {
+			fprintf(stderr, "Unable to copy %s\n", source);
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * \brief Run the periodic function of a mode on the virtual clock.
+ *
+ * \param robot the robot.
+ * \param periodic the mode's periodic function.
+ * \param seconds the amount of virtual time to run.
+ * \param timing filled with the real time of each periodic call.
+*/
+static void RunMode(IterativeRobot * robot, void (IterativeRobot::*periodic)(), double seconds,
+		mode_timing &timing) {
+	double period = robot->GetPeriod() > 0.0 ? robot->GetPeriod() : DEFAULT_PERIOD;
+	int loops = (int) (seconds / period + 0.5);
+	double start_time = SimulatedClock::GetTime();
+	double real_start_time = GetRealTime();
+
+	for (int i = 0; i < loops; i++) {
+		double loop_start_time = GetRealTime();
+		(robot->*periodic)();
+		timing.loop_times.push_back((GetRealTime() - loop_start_time) * 1000000.0);
+		SimulatedClock::Advance(period);
+	}
+
+	timing.virtual_time += SimulatedClock::GetTime() - start_time;
+	timing.real_time += GetRealTime() - real_start_time;
+}
+
+/**
+ * \brief Print the loop timing of a mode.
+ *
+ * \param timing the mode's timing.
+*/
+static void PrintTiming(mode_timing &timing) {
+	if (timing.loop_times.empty())
+		return;
+
+	std::vector<double> &times = timing.loop_times;
+	double total = 0.0;
+	for (unsigned int i = 0; i < times.size(); i++) {
+		total += times[i];
+	}
+	std::sort(times.begin(), times.end());
+	printf("%-10s %6u %9.1f %9.1f %9.1f %9.1f %9.1fx\n", timing.name, (unsigned int) times.size(),
+			total / times.size(), times[times.size() / 2], times[(times.size() * 99) / 100],
+			times[times.size() - 1], timing.real_time > 0.0 ? timing.virtual_time / timing.real_time : 0.0);
+}
+
+/**
+ * \brief Print the usage message.
+*/
+static void PrintUsage() {
+	fprintf(stderr, "Usage: simulator [-s script.as] [-p parameter_dir] [-c script_dir] [-r run_dir]\n");
+	fprintf(stderr, "                 [-d disabled_seconds] [-a autonomous_seconds] [-t teleop_seconds]\n");
+	fprintf(stderr, "                 [-j port,axis,value] [-o trace.csv]\n");
+}
+
+int main(int argc, char * argv[]) {
+	const char * script = NULL;
+	const char * parameter_directory = "../ParameterFiles";
+	const char * script_directory = "../AutoScriptFiles";
+	const char * run_directory = "simrun";
+	const char * trace_file = NULL;
+	double disabled_seconds = 1.0;
+	double autonomous_seconds = 15.0;
+	double teleop_seconds = 0.0;
+	int option;
+
+	while ((option = getopt(argc, argv, "s:p:c:r:d:a:t:j:o:")) != -1) {
+		switch (option) {
+			case 's':
+				script = optarg;
+				break;
+			case 'p':
+				parameter_directory = optarg;
+				break;
+			case 'c':
+				script_directory = optarg;
+				break;
+			case 'r':
+				run_directory = optarg;
+				break;
+			case 'd':
+				disabled_seconds = atof(optarg);
+				break;
+			case 'a':
+				autonomous_seconds = atof(optarg);
+				break;
+			case 't':
+				teleop_seconds = atof(optarg);
+				break;
+			case 'j': {
+				int port;
+				int axis;
+				float value;
+				if (sscanf(optarg, "%d,%d,%f", &port, &axis, &value) != 3) {
+					PrintUsage();
+					return 1;
+				}
+				SimulatedHardware::SetJoystickAxis(port, axis, value);
+				break;
+			}
+			case 'o':
+				trace_file = optarg;
+				break;
+			default:
+				PrintUsage();
+				return 1;
+		}
+	}
+
+	// The trace is opened before changing directories so it's relative to where the simulator was started
+	if (trace_file != NULL) {
+		s_trace = fopen(trace_file, "w");
+		if (s_trace == NULL) {
+			fprintf(stderr, "Unable to open %s\n", trace_file);
+			return 1;
+		}
+		fprintf(s_trace, "time,left_motor,right_motor,left_speed,right_speed,heading,x,y,distance,acceleration,"
+				"pitch_count,flywheel_speed\n");
+	}
+
+	if (!PrepareRunDirectory(run_directory, parameter_directory, script_directory, script))
+		return 1;
+	if (chdir(run_directory) != 0) {
+		fprintf(stderr, "Unable to change to %s\n", run_directory);
+		return 1;
+	}
+
+	s_plant = new PlantModel();
+	if (!s_plant->LoadParameters())
+		fprintf(stderr, "Unable to read drivetrain.par, the drive train isn't simulated\n");
+	SimulatedClock::SetStepFunction(StepPlant, PLANT_STEP);
+
+	IterativeRobot * robot = (IterativeRobot *) SimulatorCreateRobot();
+	mode_timing disabled_timing;
+	mode_timing autonomous_timing;
+	mode_timing teleop_timing;
+	disabled_timing.name = "disabled";
+	disabled_timing.virtual_time = 0.0;
+	disabled_timing.real_time = 0.0;
+	autonomous_timing.name = "autonomous";
+	autonomous_timing.virtual_time = 0.0;
+	autonomous_timing.real_time = 0.0;
+	teleop_timing.name = "teleop";
+	teleop_timing.virtual_time = 0.0;
+	teleop_timing.real_time = 0.0;
+
+	double real_start_time = GetRealTime();
+	robot->RobotInit();
+	robot->DisabledInit();
+	RunMode(robot, &IterativeRobot::DisabledPeriodic, disabled_seconds, disabled_timing);
+	if (autonomous_seconds > 0.0) {
+		robot->AutonomousInit();
+		RunMode(robot, &IterativeRobot::AutonomousPeriodic, autonomous_seconds, autonomous_timing);
+	}
+	if (teleop_seconds > 0.0) {
+		robot->TeleopInit();
+		RunMode(robot, &IterativeRobot::TeleopPeriodic, teleop_seconds, teleop_timing);
+	}
+	robot->DisabledInit();
+	RunMode(robot, &IterativeRobot::DisabledPeriodic, disabled_seconds, disabled_timing);
+	double real_time = GetRealTime() - real_start_time;
+
+	// Report the real time spent in the periodic calls
+	printf("Simulated %.3f s in %.3f s (%.1fx real time)\n", SimulatedClock::GetTime(), real_time,
+			real_time > 0.0 ? SimulatedClock::GetTime() / real_time : 0.0);
+	printf("%-10s %6s %9s %9s %9s %9s %10s\n", "mode", "loops", "avg us", "p50 us", "p99 us", "max us", "speed");
+	PrintTiming(disabled_timing);
+	PrintTiming(autonomous_timing);
+	PrintTiming(teleop_timing);
+
+	// Report where the robot ended up
+	const plant_state &state = s_plant->GetState();
+	printf("Final state: x %.2f ft, y %.2f ft, heading %.1f deg, distance %.2f ft, pitch count %.0f, flywheel %.2f\n",
+			state.x, state.y, state.heading, state.distance, state.pitch_count, state.flywheel_speed);
+	printf("LCD:\n");
+	for (int i = 0; i < DriverStationLCD::kNumLines; i++) {
+		printf("  |%s|\n", DriverStationLCD::GetInstance()->GetLine(i));
+	}
+
+	delete robot;
+	if (s_trace != NULL)
+		fclose(s_trace);
+	delete s_plant;
+	return 0;
+}
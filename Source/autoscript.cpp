@@ -1,7 +1,53 @@
 #include "autoscript.h"
+#include "readfile.h"
+#include <ctype.h>
 #include <dirent.h>
+#include <stdlib.h>
 #include <string.h>
 
+/**
+ * \def AUTOSCRIPT_MAX_PARAMS
+ * \brief The most parameters an autoscript command can have.
+ */
+#define AUTOSCRIPT_MAX_PARAMS 5
+
+/**
+ * Data structure to describe an autoscript command as written in a script file.
+ */
+struct autoscript_definition {
+	const char * name;	///< command name as written in the script file
+	int opcode;			///< compiled command
+	int param_count;	///< number of parameters the command needs
+	int resources;		///< AutoScript::Resource flags for the parts of the robot the command uses
+};
+
+/**
+ * The autoscript commands and the number of parameters each needs.
+ */
+static const autoscript_definition kAutoScriptDefinitions[] = {
+	{ "end", AutoScript::kEnd, 0, AutoScript::kNoResource },
+	{ "wait", AutoScript::kWait, 1, AutoScript::kTimerResource },
+	{ "adjustheading", AutoScript::kAdjustHeading, 2, AutoScript::kDriveResource },
+	{ "drivedistance", AutoScript::kDriveDistance, 2, AutoScript::kDriveResource },
+	{ "drivetime", AutoScript::kDriveTime, 3, AutoScript::kDriveResource },
+	{ "turnheading", AutoScript::kTurnHeading, 2, AutoScript::kDriveResource },
+	{ "turntime", AutoScript::kTurnTime, 3, AutoScript::kDriveResource },
+	{ "pitchposition", AutoScript::kPitchPosition, 2, AutoScript::kPitchResource },
+	{ "pitchtime", AutoScript::kPitchTime, 3, AutoScript::kPitchResource },
+	{ "pitchangle", AutoScript::kPitchAngle, 2, AutoScript::kPitchResource },
+	{ "shoot", AutoScript::kShoot, 1, AutoScript::kFlywheelResource },
+	{ "rapidfire", AutoScript::kRapidFire, 0, AutoScript::kFlywheelResource },
+	{ "findtarget", AutoScript::kFindTarget, 1, AutoScript::kDriveResource | AutoScript::kPitchResource },
+	{ "spinup", AutoScript::kSpinUp, 1, AutoScript::kFlywheelResource },
+	{ "parallel", AutoScript::kParallel, 0, AutoScript::kNoResource },
+	{ "join", AutoScript::kJoin, 0, AutoScript::kNoResource }
+};
+
+/**
+ * \def AUTOSCRIPT_DEFINITIONS
+ * \brief The number of autoscript commands.
+ */
+#define AUTOSCRIPT_DEFINITIONS ((int) (sizeof(kAutoScriptDefinitions) / sizeof(kAutoScriptDefinitions[0])))
 
 /**
  * \brief Open a script file with the mode "r" to read auto commands.
@@ -23,10 +69,10 @@ AutoScript::AutoScript() {
 }
 
 /**
- * \brief Deletes the file object.
+ * \brief Closes the file if it's still open.
 */
 AutoScript::~AutoScript() {
-	SafeDelete(file_);
+	Close();
 }
 
 /**
@@ -41,7 +87,7 @@ bool AutoScript::Open(const char * path) {
 		return false;
 	}
 	
-	if ((file_ = fopen(path, "r")) <= 0) {
+	if ((file_ = fopen(path, "r")) == NULL) {
 		/*printf("Error opening file = %s\n", strerror(errno));
 		printf("file = %s\n", path);*/
 		file_opened_ = false;
@@ -59,85 +105,206 @@ bool AutoScript::Open(const char * path) {
 void AutoScript::Close() {
 	if (file_ != NULL) {
 		fclose(file_);
+		file_ = NULL;
 		file_opened_ = false;
 	}
 }
 
 /**
- * \brief Read all autoscript commands from the file.
+ * \brief Read and compile all autoscript commands from the file.
  *
- * Reads the entire autoscript file formatted as a comma separated value (CSV) file.
- * The commands are stored as structs in a vector.
+ * Reads the entire autoscript file formatted as a comma separated value (CSV) file
+ * into memory at once, and splits each line into tokens in place.
+ * Each command name is looked up once and stored as an opcode with its parameters,
+ * so the commands don't need to be compared as strings while running.
+ * Blank lines are skipped, and lines can be any length.
  *
- * \return true if successful.
+ * Commands between "parallel" and "join" lines form a group that runs at the
+ * same time.  Each command in a group must use different parts of the robot.
+ *
+ * Lines with an unknown command, the wrong number of parameters, or a parameter
+ * that isn't a number are left out of the script and described in GetErrors(),
+ * as are commands that can't be added to their parallel group.
+ *
+ * \return true if the file was read and every line compiled.
 */
 bool AutoScript::ReadScript() {
-	char buffer[256] = {0};		///< buffer for file reading
-	char c[255] = {0};			///< command string buffer
-	float p1, p2, p3, p4, p5;	///< command parameter values
-	char *current_token;		///< string token pointer
-	int param_index = 0;		///< number of parameters parsed per line
+	std::vector<char> buffer;				///< contents of the file
+	float p[AUTOSCRIPT_MAX_PARAMS];			///< command parameter values
+	char error[128];						///< description of a line that didn't compile
+	int param_index = 0;					///< number of tokens parsed per line
+	int line = 0;							///< current line number in the file
+	int group_line = 0;						///< line number of the open parallel group, 0 if none
+	int group_size = 0;						///< number of commands in the open parallel group
+	int group_resources = 0;				///< parts of the robot used by the open parallel group
 
 	// Clear out any old script data
 	autoscript_commands.clear();
 	command_iterator = autoscript_commands.begin();
+	errors_.clear();
 	
-	if (file_opened_ && file_ != NULL) {
-		// Loop while there's data to read
-		while (fgets(buffer, 255, file_) != NULL) {
-			// Reset temporary variables
-			c[0] = 0;
-			p1 = -9999;
-			p2 = -9999;
-			p3 = -9999;
-			p4 = -9999;
-			p5 = -9999;
-			
-			// Split the current line by commas
-			current_token = strtok(buffer, " ,");
-			param_index = 0;
-			while (current_token != NULL) {
-				// Store each parameter one at a time into the temporary variables
-				switch(param_index) {
-					case 0:
-						sscanf(current_token, "%s", c);
-						CharArrayToLower(current_token);
-						break;
-					case 1:
-						sscanf(current_token, "%f", &p1);
-						break;
-					case 2:
-						sscanf(current_token, "%f", &p2);
-						break;
-					case 3:
-						sscanf(current_token, "%f", &p3);
-						break;
-					case 4:
-						sscanf(current_token, "%f", &p4);
-						break;
-					case 5:
-						sscanf(current_token, "%f", &p5);
-						break;
-					default:
-						break;
+	if (!file_opened_ || file_ == NULL || !ReadFile(file_, buffer)) {
+		return false;
+	}
+
+	// The last character of the buffer is a null terminator added after the file contents
+	char * current = &buffer[0];
+	char * end = current + buffer.size() - 1;
+
+	// Loop through each line of the file
+	while (current < end) {
+		char * line_end = (char *) memchr(current, '\n', end - current);
+		if (line_end == NULL) {
+			line_end = end;
+		}
+		*line_end = 0;
+		line++;
+
+		// Reset temporary variables
+		char * c = NULL;
+		bool numbers_valid = true;
+		for (int i = 0; i < AUTOSCRIPT_MAX_PARAMS; i++) {
+			p[i] = 0;
+		}
+
+		// Split the current line by commas and whitespace
+		param_index = 0;
+		while (current < line_end) {
+			while (current < line_end && (*current == ',' || isspace((unsigned char) *current))) {
+				current++;
+			}
+			if (current == line_end) {
+				break;
+			}
+			char * token = current;
+			while (current < line_end && *current != ',' && !isspace((unsigned char) *current)) {
+				current++;
+			}
+			*current = 0;
+
+			// Store each token one at a time into the temporary variables
+			if (param_index == 0) {
+				c = token;
+				for (char * letter = c; *letter; letter++) {
+					*letter = tolower((unsigned char) *letter);
 				}
-				current_token = strtok(NULL, " ,");
-				param_index++;
 			}
-			// If we read some parameters, store the command into the vector
-			if (param_index > 0) {
-				autoscript_command current_command(c, p1, p2, p3, p4, p5);
-				autoscript_commands.push_back(current_command);
+			else if (param_index <= AUTOSCRIPT_MAX_PARAMS) {
+				char * number_end = token;
+				p[param_index - 1] = (float) strtod(token, &number_end);
+				if (number_end == token || *number_end != 0) {
+					numbers_valid = false;
+				}
 			}
+			current++;
+			param_index++;
 		}
+		current = line_end + 1;
 
-		// Create an iterator to the vector for later use
-		command_iterator = autoscript_commands.begin();		
-		return true;
+		// Skip blank lines
+		if (param_index == 0) {
+			continue;
+		}
+
+		// Look up the command and check its parameters
+		const autoscript_definition * definition = NULL;
+		for (int i = 0; i < AUTOSCRIPT_DEFINITIONS; i++) {
+			if (strcmp(c, kAutoScriptDefinitions[i].name) == 0) {
+				definition = &kAutoScriptDefinitions[i];
+				break;
+			}
+		}
+		if (definition == NULL) {
+			sprintf(error, "line %d: unknown command %.32s", line, c);
+			errors_.push_back(error);
+			continue;
+		}
+		if (param_index - 1 != definition->param_count) {
+			sprintf(error, "line %d: %s needs %d parameters, found %d", line,
+				definition->name, definition->param_count, param_index - 1);
+			errors_.push_back(error);
+			continue;
+		}
+		if (!numbers_valid) {
+			sprintf(error, "line %d: %s has a parameter that is not a number", line,
+				definition->name);
+			errors_.push_back(error);
+			continue;
+		}
+
+		// Check that the command fits in the open parallel group
+		if (definition->opcode == kParallel) {
+			if (group_line != 0) {
+				sprintf(error, "line %d: parallel inside the parallel group from line %d", line, group_line);
+				errors_.push_back(error);
+				continue;
+			}
+			group_line = line;
+			group_size = 0;
+			group_resources = kNoResource;
+		}
+		else if (definition->opcode == kJoin) {
+			if (group_line == 0) {
+				sprintf(error, "line %d: join without parallel", line);
+				errors_.push_back(error);
+				continue;
+			}
+			group_line = 0;
+			if (group_size == 0) {
+				// Leave out empty groups
+				sprintf(error, "line %d: empty parallel group", line);
+				errors_.push_back(error);
+				autoscript_commands.pop_back();
+				continue;
+			}
+		}
+		else if (group_line != 0) {
+			if (definition->opcode == kEnd) {
+				// Close the group before the end of the script
+				sprintf(error, "line %d: parallel group from line %d has no join", line, group_line);
+				errors_.push_back(error);
+				if (group_size == 0)
+					autoscript_commands.pop_back();
+				else
+					autoscript_commands.push_back(autoscript_command(kJoin));
+				group_line = 0;
+			}
+			else if (group_size >= kMaxGroupCommands) {
+				sprintf(error, "line %d: more than %d commands in a parallel group", line, kMaxGroupCommands);
+				errors_.push_back(error);
+				continue;
+			}
+			else if ((group_resources & definition->resources) != 0) {
+				sprintf(error, "line %d: %s uses the same part of the robot as another command in the group",
+					line, definition->name);
+				errors_.push_back(error);
+				continue;
+			}
+			else {
+				group_size++;
+				group_resources |= definition->resources;
+			}
+		}
+
+		// Store the compiled command into the vector
+		autoscript_command current_command((unsigned char) definition->opcode,
+			(unsigned char) definition->param_count, p);
+		autoscript_commands.push_back(current_command);
 	}
-	else {
-		return false;
+
+	// Close a group that's still open at the end of the file
+	if (group_line != 0) {
+		sprintf(error, "line %d: parallel group from line %d has no join", line, group_line);
+		errors_.push_back(error);
+		if (group_size == 0)
+			autoscript_commands.pop_back();
+		else
+			autoscript_commands.push_back(autoscript_command(kJoin));
 	}
+
+	// Create an iterator to the vector for later use
+	command_iterator = autoscript_commands.begin();		
+	return errors_.empty();
 }
 
 /**
@@ -165,7 +332,8 @@ int AutoScript::GetAvailableScripts(std::vector<std::string> &files) {
 		extension_ptr=strrchr(dirp->d_name,'.');
 		if (extension_ptr != NULL) {
 			ext[0] = 0;
-			strncpy(ext, extension_ptr+1, sizeof(ext));
+			strncpy(ext, extension_ptr+1, sizeof(ext) - 1);
+			ext[sizeof(ext) - 1] = 0;
 			if (strlen(ext) > 0 && strncmp(ext, "as", 10) == 0) {
 				files.push_back(std::string(dirp->d_name));
 				file_count_++;
@@ -194,7 +362,7 @@ autoscript_command AutoScript::GetNextCommand() {
 	}
 	// Otherwise return an 'end' command
 	else {
-		autoscript_command end_command("end", -9999, -9999, -9999, -9999, -9999);
+		autoscript_command end_command(kEnd);
 		return end_command;
 	}
 }
@@ -214,7 +382,31 @@ autoscript_command AutoScript::GetCommand(unsigned int command_index) {
 	}
 	// Otherwise return an 'invalid' command
 	else {
-		autoscript_command end_command("invalid", -9999, -9999, -9999, -9999, -9999);
-		return end_command;
+		autoscript_command invalid_command(kInvalid);
+		return invalid_command;
+	}
+}
+
+/**
+ * \brief Get the lines that couldn't be compiled by the last ReadScript().
+ *
+ * \return a description of each line that was left out of the script.
+*/
+const std::vector<std::string> & AutoScript::GetErrors() {
+	return errors_;
+}
+
+/**
+ * \brief Get the name of a command as written in a script file.
+ *
+ * \param opcode the compiled command.
+ * \return the command name, or "invalid" if the opcode is unknown.
+*/
+const char * AutoScript::GetCommandName(int opcode) {
+	for (int i = 0; i < AUTOSCRIPT_DEFINITIONS; i++) {
+		if (kAutoScriptDefinitions[i].opcode == opcode) {
+			return kAutoScriptDefinitions[i].name;
+		}
 	}
+	return "invalid";
 }
@@ -8,19 +8,25 @@
 #include "common.h"
 
 /**
- * Data structure to store the information for an autoscript command.
+ * Data structure to store a compiled autoscript command.
+ *
+ * The command name is replaced by an AutoScript::Opcode when the script is
+ * read, and only the parameters the command uses are set.
  */
 struct autoscript_command {
-	char command[255];	///< auto command
-	float param1;		///< auto command parameter 1
+	unsigned char opcode;		///< auto command, one of AutoScript::Opcode
+	unsigned char param_count;	///< number of parameters used by the command
+	float param1;				///< auto command parameter 1
 	float param2;
 	float param3;
 	float param4;
 	float param5;
-	autoscript_command(char *c, float p1, float p2, float p3, float p4, float p5):
-		param1(p1), param2(p2), param3(p3), param4(p4), param5(p5) {strncpy(command, c, 254);}
+	autoscript_command(unsigned char op, unsigned char count, const float * params):
+		opcode(op), param_count(count), param1(params[0]), param2(params[1]), param3(params[2]), param4(params[3]), param5(params[4]) {}
+	autoscript_command(unsigned char op):
+		opcode(op), param_count(0), param1(0), param2(0), param3(0), param4(0), param5(0) {}
 	autoscript_command():
-		param1(-9999), param2(-9999), param3(-9999), param4(-9999), param5(-9999) {command[0]=0;}
+		opcode(0), param_count(0), param1(0), param2(0), param3(0), param4(0), param5(0) {}
 };
 
 /**
@@ -33,6 +39,46 @@ struct autoscript_command {
 class AutoScript {
 
 public:
+	/**
+	 * \brief The compiled autoscript commands.
+	 */
+	enum Opcode {
+		kInvalid,
+		kEnd,
+		kWait,
+		kAdjustHeading,
+		kDriveDistance,
+		kDriveTime,
+		kTurnHeading,
+		kTurnTime,
+		kPitchPosition,
+		kPitchTime,
+		kPitchAngle,
+		kShoot,
+		kRapidFire,
+		kFindTarget,
+		kSpinUp,
+		kParallel,
+		kJoin
+	};
+	
+	/**
+	 * \brief The parts of the robot a command uses.
+	 *
+	 * Commands in a parallel group can't use the same part.
+	 */
+	enum Resource {
+		kNoResource = 0,
+		kDriveResource = 1,		///< drive train motors and timer
+		kPitchResource = 2,		///< shooter pitch motor and timer
+		kFlywheelResource = 4,	///< shooter wheel, feeder and the auto shoot timer
+		kTimerResource = 8		///< robot timer used by wait
+	};
+	
+	// Public constants
+	static const int kMaxGroupCommands = 4;	///< the most commands that can run at the same time in a parallel group
+	
+	
 	// Public methods
 	AutoScript();
 	AutoScript(const char * path);
@@ -43,6 +89,8 @@ public:
 	int GetAvailableScripts(std::vector<std::string> &files);
 	autoscript_command GetNextCommand();
 	autoscript_command GetCommand(unsigned int command_index);
+	const std::vector<std::string> & GetErrors();
+	static const char * GetCommandName(int opcode);
 
 	// Public member variables
 	bool file_opened_;	///< true if the file is open
@@ -54,6 +102,7 @@ private:
 	// Private members variables
 	std::vector<autoscript_command> autoscript_commands;		///< stores the command structures
 	std::vector<autoscript_command>::iterator command_iterator;	///< iterator for the command vector
+	std::vector<std::string> errors_;							///< describes each line that couldn't be compiled
 };
 
 #endif
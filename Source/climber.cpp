@@ -2,7 +2,10 @@
 #include "WPILib.h"
 #include "climber.h"
 #include "datalog.h"
+#include "feedbackcontroller.h"
 #include "parameters.h"
+#include "parameterwatcher.h"
+#include "sensorsampler.h"
 
 /**
  * \brief Create and initialize a climber.
@@ -32,7 +35,7 @@ Climber::Climber(bool logging_enabled) {
  *
  * \param parameters climber parameter file path and name.
 */
-Climber::Climber(char * parameters) {
+Climber::Climber(const char * parameters) {
 	Initialize(parameters, false);
 }
 
@@ -45,7 +48,7 @@ Climber::Climber(char * parameters) {
  * \param parameters climber parameter file path and name.
  * \param logging_enabled true if logging is enabled.
 */
-Climber::Climber(char * parameters, bool logging_enabled) {
+Climber::Climber(const char * parameters, bool logging_enabled) {
 	Initialize(parameters, logging_enabled);
 }
 
@@ -56,9 +59,12 @@ Climber::~Climber() {
 	if (log_ != NULL) {
 		log_->Close();
 	}
+	SetSensorSampler(NULL);
 	SafeDelete(controller_);
 	SafeDelete(encoder_);
 	SafeDelete(timer_);
+	SafeDelete(feedback_timer_);
+	SafeDelete(feedback_);
 	SafeDelete(log_);
 	SafeDelete(parameters_);
 }
@@ -71,7 +77,7 @@ Climber::~Climber() {
  * \param parameters climber parameter file path and name.
  * \param logging_enabled true if logging is enabled.
 */
-void Climber::Initialize(char * parameters, bool logging_enabled) {
+void Climber::Initialize(const char * parameters, bool logging_enabled) {
 	// Initialize public member variables
 	encoder_enabled_ = false;
 	climber_enabled_ = false;
@@ -80,32 +86,23 @@ void Climber::Initialize(char * parameters, bool logging_enabled) {
 	controller_ = NULL;
 	encoder_ = NULL;
 	timer_ = NULL;
+	feedback_timer_ = NULL;
+	feedback_ = NULL;
+	sensor_sampler_ = NULL;
 	log_ = NULL;
 	parameters_ = NULL;
 	
 	// Initialize private parameters
+	int binding_count = 0;
+	const parameter_binding<Climber> * bindings = GetParameterBindings(&binding_count);
+	Parameters::SetDefaults(this, bindings, binding_count);
 	invert_multiplier_ = 0.0;
-	normal_up_speed_ratio_ = 1.0;
-	normal_down_speed_ratio_ = 1.0;
-	turbo_up_speed_ratio_ = 1.0;
-	turbo_down_speed_ratio_ = 1.0;
-	auto_far_speed_ratio_ = 1.0;
-	auto_medium_speed_ratio_ = 1.0;
-	auto_near_speed_ratio_ = 1.0;
-	auto_medium_encoder_threshold_ = 50;
-	auto_far_encoder_threshold_ = 100;
-	auto_medium_time_threshold_ = 0.5;
-	auto_far_time_threshold_ = 1.0;
-	encoder_threshold_ = 10;
-	up_direction_ = 1.0;
-	down_direction_ = -1.0;
-	time_threshold_ = 0.1;
-	encoder_max_limit_ = -1;
-	encoder_min_limit_ = -1;
 
 	// Initialize private member variables
 	encoder_count_ = 0;
 	log_enabled_ = false;
+	encoder_count_channel_ = -1;
+	encoder_sample_channel_ = -1;
 	robot_state_ = kDisabled;
 	
 	// Create a new data log object
@@ -114,6 +111,8 @@ void Climber::Initialize(char * parameters, bool logging_enabled) {
 	// Enable logging if specified
 	if (log_ != NULL && log_->file_opened_) {
 		log_enabled_ = logging_enabled;
+		// Register the values logged every loop so they don't need string work
+		encoder_count_channel_ = log_->RegisterChannel("Encoder count");
 	}
 	else {
 		log_enabled_ = false;
@@ -121,13 +120,94 @@ void Climber::Initialize(char * parameters, bool logging_enabled) {
 
 	// Create a timer object
 	timer_ = new Timer();
+
+	// Create the feedback controller and the timer it measures its updates with
+	feedback_ = new FeedbackController();
+	feedback_timer_ = new Timer();
+	if (feedback_timer_ != NULL) {
+		feedback_timer_->Start();
+	}
 	
 	// Attempt to read the parameters file
-	strncpy(parameters_file_, parameters, sizeof(parameters_file_));
+	strncpy(parameters_file_, parameters, sizeof(parameters_file_) - 1);
+	parameters_file_[sizeof(parameters_file_) - 1] = 0;
 	
 	LoadParameters();
 }
 
+/**
+ * \brief Get the table of parameters that are copied straight into member variables.
+ *
+ * Each entry has the parameter name, the member variable, the default value,
+ * and the minimum and maximum values allowed in the file.
+ *
+ * \param count set to the number of bindings in the table.
+ * \return the table of parameter bindings.
+*/
+const parameter_binding<Climber> * Climber::GetParameterBindings(int * count) {
+	static const parameter_binding<Climber> bindings[] = {
+		IntParameter(Climber, "ENCODER_THRESHOLD", encoder_threshold_, 10, 0, 100000),
+		FloatParameter(Climber, "NORMAL_UP_SPEED_RATIO", normal_up_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Climber, "NORMAL_DOWN_SPEED_RATIO", normal_down_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Climber, "TURBO_UP_SPEED_RATIO", turbo_up_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Climber, "TURBO_DOWN_SPEED_RATIO", turbo_down_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Climber, "AUTO_FAR_SPEED_RATIO", auto_far_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Climber, "AUTO_MEDIUM_SPEED_RATIO", auto_medium_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Climber, "AUTO_NEAR_SPEED_RATIO", auto_near_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Climber, "UP_DIRECTION", up_direction_, 1.0, -1.0, 1.0),
+		FloatParameter(Climber, "DOWN_DIRECTION", down_direction_, -1.0, -1.0, 1.0),
+		DoubleParameter(Climber, "TIME_THRESHOLD", time_threshold_, 0.1, 0.0, 60.0),
+		IntParameter(Climber, "ENCODER_MAX_LIMIT", encoder_max_limit_, -1, -100000, 100000),
+		IntParameter(Climber, "ENCODER_MIN_LIMIT", encoder_min_limit_, -1, -100000, 100000),
+		IntParameter(Climber, "AUTO_MEDIUM_ENCODER_THRESHOLD", auto_medium_encoder_threshold_, 50, 0, 100000),
+		IntParameter(Climber, "AUTO_FAR_ENCODER_THRESHOLD", auto_far_encoder_threshold_, 100, 0, 100000),
+		FloatParameter(Climber, "AUTO_MEDIUM_TIME_THRESHOLD", auto_medium_time_threshold_, 0.5, 0.0, 60.0),
+		FloatParameter(Climber, "AUTO_FAR_TIME_THRESHOLD", auto_far_time_threshold_, 1.0, 0.0, 60.0),
+		IntParameter(Climber, "FEEDBACK_ENABLED", feedback_enabled_, 0, 0, 1),
+		FloatParameter(Climber, "PROPORTIONAL_GAIN", proportional_gain_, 0.02, 0.0, 1.0),
+		FloatParameter(Climber, "INTEGRAL_GAIN", integral_gain_, 0.005, 0.0, 1.0),
+		FloatParameter(Climber, "DERIVATIVE_GAIN", derivative_gain_, 0.002, 0.0, 1.0),
+		FloatParameter(Climber, "FEEDFORWARD_GAIN", feedforward_gain_, 0.0, 0.0, 1.0),
+		FloatParameter(Climber, "STATIC_FEEDFORWARD", static_feedforward_, 0.15, 0.0, 1.0),
+		FloatParameter(Climber, "MAXIMUM_OUTPUT_CHANGE", maximum_output_change_, 8.0, 0.0, 100.0),
+		FloatParameter(Climber, "SETTLE_RATE", settle_rate_, 50.0, 0.0, 100000.0),
+		DoubleParameter(Climber, "SETTLE_TIME", settle_time_, 0.1, 0.0, 10.0)
+	};
+	*count = sizeof(bindings) / sizeof(bindings[0]);
+	return bindings;
+}
+
+/**
+ * \brief Copies the tuning values from newly read parameters into the member variables.
+ *
+ * Used to pick up changes to the parameter file while the robot is running.
+ * Only the tuning values are changed, the hardware is not recreated.
+ *
+ * \param parameters the newly read parameters.  This object takes ownership of them.
+ * \param reload_log where the reload is reported, or NULL to not report it.  The
+ * watcher writes it to its log in the background, so this doesn't wait on the file.
+ * \return true if every tuning value was found and in range.
+*/
+bool Climber::ReloadParameters(Parameters * parameters, ParameterWatcher * reload_log) {
+	if (parameters == NULL) {
+		return false;
+	}
+
+	if (reload_log != NULL) {
+		reload_log->WriteLine("Climber parameters reloaded\n");
+	}
+
+	// Copy the tuning values into the bound member variables
+	int binding_count = 0;
+	const parameter_binding<Climber> * bindings = GetParameterBindings(&binding_count);
+	int problems = parameters->Bind(this, bindings, binding_count, reload_log);
+
+	// Keep the new parameters so GetValue calls see the same values
+	SafeDelete(parameters_);
+	parameters_ = parameters;
+	return problems == 0;
+}
+
 /**
  * \brief Loads the parameter file into memory, copies the values into local/member variables,
  * and creates and initializes objects using those values.
@@ -146,6 +226,10 @@ bool Climber::LoadParameters() {
 	float motor_safety_timeout = 2.0;
 	bool parameters_read = false;	// This should default to false
 	
+	// Stop sampling the old encoder before it's deleted
+	SensorSampler * sensor_sampler = sensor_sampler_;
+	SetSensorSampler(NULL);
+
 	// Close and delete old objects
 	SafeDelete(parameters_);
 	SafeDelete(encoder_);
@@ -167,6 +251,10 @@ bool Climber::LoadParameters() {
 
 	// Set climber variables based on the parameters file
 	if (parameters_read) {
+		// Copy the tuning values into the bound member variables
+		int binding_count = 0;
+		const parameter_binding<Climber> * bindings = GetParameterBindings(&binding_count);
+		parameters_->Bind(this, bindings, binding_count, log_enabled_ ? log_ : NULL);
 		parameters_->GetValue("MOTOR_SLOT", &motor_slot);
 		parameters_->GetValue("MOTOR_CHANNEL", &motor_channel);
 		parameters_->GetValue("ENCODER_A_SLOT", &encoder_a_slot);
@@ -175,25 +263,8 @@ bool Climber::LoadParameters() {
 		parameters_->GetValue("ENCODER_B_CHANNEL", &encoder_b_channel);
 		parameters_->GetValue("ENCODER_REVERSE", &encoder_reverse);
 		parameters_->GetValue("ENCODER_TYPE", &encoder_type);
-		parameters_->GetValue("ENCODER_THRESHOLD", &encoder_threshold_);
 		parameters_->GetValue("MOTOR_SAFETY_TIMEOUT", &motor_safety_timeout);
 		parameters_->GetValue("INVERT_CONTROLS", &invert_controls);		
-		parameters_->GetValue("NORMAL_UP_SPEED_RATIO", &normal_up_speed_ratio_);
-		parameters_->GetValue("NORMAL_DOWN_SPEED_RATIO", &normal_down_speed_ratio_);
-		parameters_->GetValue("TURBO_UP_SPEED_RATIO", &turbo_up_speed_ratio_);
-		parameters_->GetValue("TURBO_DOWN_SPEED_RATIO", &turbo_down_speed_ratio_);
-		parameters_->GetValue("AUTO_FAR_SPEED_RATIO", &auto_far_speed_ratio_);
-		parameters_->GetValue("AUTO_MEDIUM_SPEED_RATIO", &auto_medium_speed_ratio_);
-		parameters_->GetValue("AUTO_NEAR_SPEED_RATIO", &auto_near_speed_ratio_);
-		parameters_->GetValue("UP_DIRECTION", &up_direction_);
-		parameters_->GetValue("DOWN_DIRECTION", &down_direction_);
-		parameters_->GetValue("TIME_THRESHOLD", &time_threshold_);
-		parameters_->GetValue("ENCODER_MAX_LIMIT", &encoder_max_limit_);
-		parameters_->GetValue("ENCODER_MIN_LIMIT", &encoder_min_limit_);
-		parameters_->GetValue("AUTO_MEDIUM_ENCODER_THRESHOLD", &auto_medium_encoder_threshold_);
-		parameters_->GetValue("AUTO_FAR_ENCODER_THRESHOLD", &auto_far_encoder_threshold_);
-		parameters_->GetValue("AUTO_MEDIUM_TIME_THRESHOLD", &auto_medium_time_threshold_);
-		parameters_->GetValue("AUTO_FAR_TIME_THRESHOLD", &auto_far_time_threshold_);
 	}
 
 	// Check if the encoder is present/enabled
@@ -207,6 +278,7 @@ bool Climber::LoadParameters() {
 	else {
 		encoder_enabled_ = false;
 	}
+	SetSensorSampler(sensor_sampler);
 		
 	// Check if the motor is present/enabled
 	if (motor_slot > 0 && motor_channel > 0) {
@@ -252,7 +324,28 @@ bool Climber::LoadParameters() {
 */
 void Climber::ReadSensors() {
 	if (encoder_enabled_) {
-		encoder_count_ = encoder_->Get();
+		// Use the sensor sampler's latest reading if there is one
+		sensor_sample sample;
+		if (sensor_sampler_ != NULL && sensor_sampler_->GetLatest(encoder_sample_channel_, &sample))
+			encoder_count_ = (int) sample.value;
+		else
+			encoder_count_ = encoder_->Get();
+	}
+}
+
+/**
+ * \brief Read the encoder with a sensor sampler instead of in ReadSensors().
+ *
+ * \param sampler the sensor sampler, or NULL to read the encoder in ReadSensors().
+*/
+void Climber::SetSensorSampler(SensorSampler * sampler) {
+	if (sensor_sampler_ != NULL) {
+		sensor_sampler_->Remove(encoder_sample_channel_);
+	}
+	encoder_sample_channel_ = -1;
+	sensor_sampler_ = sampler;
+	if (sensor_sampler_ != NULL && encoder_enabled_) {
+		encoder_sample_channel_ = sensor_sampler_->AddEncoder(encoder_);
 	}
 }
 
@@ -278,6 +371,11 @@ void Climber::SetRobotState(ProgramState state) {
 	if (timer_ != NULL) {
 		timer_->Stop();
 	}
+
+	// Start any feedback controlled movement over
+	if (feedback_ != NULL) {
+		feedback_->Reset();
+	}
 	
 	if (state == kDisabled) {
 		if (climber_enabled_)
@@ -309,7 +407,7 @@ void Climber::GetCurrentState(char * output_buffer) {
 void Climber::LogCurrentState() {
 	if (log_ != NULL) {
 		if (encoder_enabled_)
-			log_->WriteValue("Encoder count", encoder_count_, true);
+			log_->WriteChannel(encoder_count_channel_, encoder_count_, true);
 	}
 }
 
@@ -356,6 +454,11 @@ bool Climber::Set(int encoder_count, float speed) {
 		}
 	}
 
+	// Move with the feedback controller if it's enabled
+	if (feedback_enabled_ && feedback_ != NULL && feedback_timer_ != NULL) {
+		return Control(encoder_count, speed);
+	}
+
 	// Check to see if we've reached the proper height
 	if (abs(encoder_count - encoder_count_) <= encoder_threshold_) {
 		controller_->Set(0, 0);
@@ -393,6 +496,37 @@ bool Climber::Set(int encoder_count, float speed) {
 	}
 }
 
+/**
+ * \brief Moves the robot climber toward a position using the feedback controller.
+ *
+ * The encoder limits must already have been checked.
+ *
+ * \param encoder_count desired position in encoder counts.
+ * \param speed largest motor speed ratio.
+ * \return true when the climber has settled at the desired position.
+*/
+bool Climber::Control(int encoder_count, float speed) {
+	// Pick up any changes to the parameters
+	feedback_->SetGains(proportional_gain_, integral_gain_, derivative_gain_, feedforward_gain_, static_feedforward_);
+	feedback_->SetOutputLimits(speed, maximum_output_change_);
+	feedback_->SetTolerance(encoder_threshold_, settle_rate_, settle_time_);
+
+	// Positive output moves toward more encoder counts, which is up
+	float output = feedback_->Calculate(encoder_count, 0.0, encoder_count_, feedback_timer_->Get());
+	if (feedback_->IsSettled()) {
+		controller_->Set(0, 0);
+		feedback_->Reset();
+		return true;
+	}
+	if (output > 0.0) {
+		controller_->Set(up_direction_ * output, 0);
+	}
+	else {
+		controller_->Set(-down_direction_ * output, 0);
+	}
+	return false;
+}
+
 /**
  * \brief Sets the robot climber to a position provided by the argument.
  *
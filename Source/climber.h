@@ -6,9 +6,13 @@
 // Forward class definitions
 class DataLog;
 class Encoder;
+class FeedbackController;
 class Jaguar;
 class Parameters;
+class ParameterWatcher;
+class SensorSampler;
 class Timer;
+template <class T> struct parameter_binding;
 
 /**
  * \class Climber
@@ -23,11 +27,13 @@ public:
 	// Public methods
 	Climber();
 	Climber(bool logging_enabled);
-	Climber(char * parameters);
-	Climber(char * parameters, bool logging_enabled);
+	Climber(const char * parameters);
+	Climber(const char * parameters, bool logging_enabled);
 	~Climber();
 	bool LoadParameters();
+	bool ReloadParameters(Parameters * parameters, ParameterWatcher * reload_log);
 	void ReadSensors();
+	void SetSensorSampler(SensorSampler * sampler);
 	void ResetAndStartTimer();
 	void SetRobotState(ProgramState state);
 	void GetCurrentState(char * output_buffer);
@@ -44,7 +50,9 @@ public:
 
 private:
 	// Private methods
-	void Initialize(char * parameters, bool logging_enabled);
+	void Initialize(const char * parameters, bool logging_enabled);
+	static const parameter_binding<Climber> * GetParameterBindings(int * count);
+	bool Control(int encoder_count, float speed);
 
 	// Private member objects
 	Jaguar *controller_;		///< motor controller used to move the climber
@@ -52,6 +60,9 @@ private:
 	DataLog *log_;				///< log object used to log data or status comments to a file
 	Parameters *parameters_;	///< parameters object used to load climber parameters from a file
 	Timer *timer_;				///< timer object used for timed autonomous functions
+	Timer *feedback_timer_;		///< timer object used to measure the time between feedback controller updates
+	FeedbackController *feedback_;	///< works out the motor speed in Set() when FEEDBACK_ENABLED is set
+	SensorSampler *sensor_sampler_;	///< reads the encoder at a fixed rate in a separate task, NULL to read it in ReadSensors()
 	
 	// Private parameters
 	float normal_up_speed_ratio_;		///< upward movement speed ratio (percentage) used during 'normal' mode
@@ -72,10 +83,21 @@ private:
 	double time_threshold_;				///< time in seconds for autonomous functions to decide when the climber is 'close enough' to the timed movement
 	float auto_medium_time_threshold_;	///< time threshold between near and medium for autonomous functions
 	float auto_far_time_threshold_;		///< time threshold between medium and far for autonomous functions
+	int feedback_enabled_;				///< 1 to move the climber to a position with the feedback controller instead of the speed ratios
+	float proportional_gain_;			///< motor speed for each encoder count from the set point
+	float integral_gain_;				///< motor speed for each encoder count from the set point held for a second
+	float derivative_gain_;				///< motor speed taken away for each encoder count per second the climber is moving
+	float feedforward_gain_;			///< motor speed for each encoder count per second the set point is moving
+	float static_feedforward_;			///< motor speed added toward the set point to overcome friction
+	float maximum_output_change_;		///< largest change in the motor speed each second, 0 for no limit
+	float settle_rate_;					///< largest climber speed in encoder counts per second at which it has settled
+	double settle_time_;				///< time in seconds the climber must stay within the thresholds to have settled
 
 	// Private member variables
 	int encoder_count_;			///< current number of encoder counts for the climber
 	bool log_enabled_;			///< true if logging is enabled
+	int encoder_count_channel_;	///< log channel for the encoder count
+	int encoder_sample_channel_;	///< sensor sampler channel of the encoder, -1 if it isn't sampled
 	char parameters_file_[25];	///< path and filename of the parameter file to read
 	ProgramState robot_state_;	///< current state of the robot obtained from the field
 };
@@ -2,6 +2,9 @@
 #define COMMON_H_
 
 #include <ctype.h>
+#ifdef SIMULATION
+#include <stdint.h>
+#endif
 
 // Macros to delete pointers
 #define SafeDelete(pointer) if((pointer))\
@@ -14,6 +17,46 @@
 { for (unsigned int i=0; i<sizeof(arraypointer); i++) {\
 	if (arraypointer[i]) arraypointer[i]=tolower(arraypointer[i]);}}
 
+// Macro to keep memory writes from being reordered across it
+// Used by the lock-free buffers that are shared between tasks
+#if defined(__PPC__) || defined(__ppc__)
+#define MemoryBarrier() __asm__ __volatile__ ("sync" : : : "memory")
+#else
+#define MemoryBarrier() __asm__ __volatile__ ("" : : : "memory")
+#endif
+
+// Function to replace a value shared between tasks in one step, returning the old value
+// Memory writes aren't reordered across it, like MemoryBarrier()
+inline int AtomicExchange(volatile int * target, int value) {
+#if defined(__PPC__) || defined(__ppc__)
+	int previous;
+	__asm__ __volatile__ (
+		"sync\n"
+		"1:	lwarx %0,0,%2\n"
+		"	stwcx. %3,0,%2\n"
+		"	bne- 1b\n"
+		"	isync"
+		: "=&r" (previous), "+m" (*target)
+		: "r" (target), "r" (value)
+		: "cc", "memory");
+	return previous;
+#else
+	__sync_synchronize();
+	int previous = __sync_lock_test_and_set(target, value);
+	__sync_synchronize();
+	return previous;
+#endif
+}
+
+// Integer type a pointer is passed to a task function in, through Task::Start()
+// The robot's Task::Start() takes UINT32s, which are pointer sized there, but the
+// simulator runs on computers with 64 bit pointers
+#ifdef SIMULATION
+typedef intptr_t TaskArgument;
+#else
+typedef unsigned int TaskArgument;
+#endif
+
 // General directional enum
 enum Direction {
 	kLeft,
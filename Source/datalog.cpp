@@ -7,14 +7,22 @@
  */
 #define GetMsecTime()           (GetFPGATime()/1000)
 
+/**
+ * \def WRITER_PERIOD
+ * \brief The time in seconds the writer task waits between writing blocks of records.
+ */
+#define WRITER_PERIOD 0.1
+
+// Format used by logs that are opened without specifying one
+DataLog::LogFormat DataLog::s_default_format_ = DataLog::kText;
+
 /**
  * \brief Open a file with the mode "a+" for logging.
  *
  * \param path the path and filename of the log to open/create.
 */
 DataLog::DataLog(const char * path) {
-	file_ = NULL;
-	file_opened_ = false;
+	Initialize();
 	DataLog::Open(path);
 }
 
@@ -25,27 +33,66 @@ DataLog::DataLog(const char * path) {
  * \param mode the file access mode.
 */
 DataLog::DataLog(const char * path, const char * mode) {
-	file_ = NULL;
-	file_opened_ = false;
+	Initialize();
 	DataLog::Open(path, mode);
 }
 
+/**
+ * \brief Open a file with the mode "w" and the specified format for logging.
+ *
+ * \param path the path and filename of the log to open/create.
+ * \param format the format to write the log in.
+*/
+DataLog::DataLog(const char * path, LogFormat format) {
+	Initialize();
+	DataLog::Open(path, "w", format);
+}
+
 /**
  * \brief Open the default file "datalog.txt" with the mode "w" for logging.
 */
 DataLog::DataLog() {
-	file_ = NULL;
-	file_opened_ = false;
+	Initialize();
 	DataLog::Open("datalog.txt", "w");
 }
 
 /**
- * \brief Delete the file object.
+ * \brief Stop the writer task and delete the file object.
 */
 DataLog::~DataLog() {
+	Close();
+	SafeDelete(writer_task_);
+	SafeDeleteArray(ring_);
 	SafeDelete(file_);
 }
 
+/**
+ * \brief Initialize the member variables to a closed log.
+*/
+void DataLog::Initialize() {
+	file_ = NULL;
+	file_opened_ = false;
+	writer_task_ = NULL;
+	format_ = kText;
+	ring_ = NULL;
+	ring_head_ = 0;
+	ring_tail_ = 0;
+	writer_running_ = false;
+	dropped_records_ = 0;
+	channel_count_ = 0;
+}
+
+/**
+ * \brief Set the format used by logs that are opened without specifying one.
+ *
+ * Only affects logs that are opened after the call.
+ *
+ * \param format the format to write new logs in.
+*/
+void DataLog::SetDefaultFormat(LogFormat format) {
+	s_default_format_ = format;
+}
+
 /**
  * \brief Open a file with the mode "w".
  *
@@ -53,20 +100,7 @@ DataLog::~DataLog() {
  * \return true if successful.
 */
 bool DataLog::Open(const char * path) {
-	if (path == NULL) {
-        file_opened_ = false;
-		return false;
-	}
-	
-	file_ = fopen(path, "w");
-	if (file_ != NULL) {
-        file_opened_ = true;
-		return true;
-	}
-	else {
-        file_opened_ = false;
-		return false;
-	}
+	return DataLog::Open(path, "w", s_default_format_);
 }
 
 /**
@@ -77,29 +111,79 @@ bool DataLog::Open(const char * path) {
  * \return true if successful.
 */
 bool DataLog::Open(const char * path, const char * mode) {
+	return DataLog::Open(path, mode, s_default_format_);
+}
+
+/**
+ * \brief Open a file with the specified mode and format.
+ *
+ * In binary mode the ring buffer is allocated here, so nothing is allocated
+ * while values are being logged.
+ *
+ * \param path the path and filename of the file to open/create.
+ * \param mode the file access mode.
+ * \param format the format to write the log in.
+ * \return true if successful.
+*/
+bool DataLog::Open(const char * path, const char * mode, LogFormat format) {
 	if ((path == NULL) || (mode == NULL)) {
         file_opened_ = false;
 		return false;
 	}
 
 	file_ = fopen(path, mode);
-	if (file_ != NULL) {
-        file_opened_ = true;
-		return true;
-	}
-	else {
+	if (file_ == NULL) {
         file_opened_ = false;
 		return false;
 	}
 
+	format_ = format;
+	channel_count_ = 0;
+	if (format_ == kBinary) {
+		// Allocate the ring buffer
+		if (ring_ == NULL) {
+			ring_ = new datalog_record[kRingSize];
+		}
+		ring_head_ = 0;
+		ring_tail_ = 0;
+		WriteHeader();
+
+		// Start the task that writes the records to the file
+		if (writer_task_ == NULL) {
+			writer_task_ = new Task("datalog", (FUNCPTR) s_WriterTask, Task::kDefaultPriority + 20);
+		}
+		writer_running_ = true;
+		if (!writer_task_->Start((TaskArgument) this)) {
+			writer_running_ = false;
+			format_ = kText;
+		}
+	}
+
+	file_opened_ = true;
+	return true;
 }
 
 /**
  * \brief Close the file.
+ *
+ * In binary mode the writer task is stopped, and any records still in the
+ * ring buffer are written before the file is closed.
 */
 void DataLog::Close() {
 	if (file_ != NULL) {
+		if (format_ == kBinary) {
+			// Ask the writer task to finish and give it time to exit on its own
+			writer_running_ = false;
+			for (int i = 0; i < 50 && writer_task_ != NULL && writer_task_->Verify(); i++) {
+				Wait(WRITER_PERIOD / 10.0);
+			}
+			if (writer_task_ != NULL && writer_task_->Verify()) {
+				writer_task_->Stop();
+			}
+			DrainRecords();
+		}
 		fclose(file_);
+		file_ = NULL;
 		file_opened_ = false;
 	}
 }
@@ -114,6 +198,11 @@ void DataLog::Close() {
 */
 void DataLog::WriteLine(const char * line, bool timestamp) {
 	if (file_opened_ && file_ != NULL) {
+		if (format_ == kBinary) {
+			if (line != NULL)
+				PushText(kNoChannel, kLineRecord, line, timestamp);
+			return;
+		}
 		if (timestamp) {
 			UINT32 time = GetMsecTime();
 			fprintf(file_, "[%d] ", time);
@@ -134,6 +223,17 @@ void DataLog::WriteLine(const char * line, bool timestamp) {
 */
 void DataLog::WriteValue(const char * parameter, const char * value, bool timestamp) {
 	if (file_opened_ && (file_ != NULL) && (parameter != NULL) && (value != NULL)) {
+		if (format_ == kBinary) {
+			int channel = GetChannel(parameter);
+			if (channel < 0)
+				return;
+			if (!NameChannel(channel)) {
+				dropped_records_++;
+				return;
+			}
+			PushText((unsigned short) channel, kStringRecord, value, timestamp);
+			return;
+		}
 		if (timestamp) {
 			UINT32 time = GetMsecTime();
 			fprintf(file_, "[%d] ", time);
@@ -152,13 +252,17 @@ void DataLog::WriteValue(const char * parameter, const char * value, bool timest
 */
 void DataLog::WriteValue(const char * parameter, int value, bool timestamp) {
 	if (file_opened_ && (file_ != NULL) && (parameter != NULL)) {
+		if (format_ == kBinary) {
+			WriteChannel(GetChannel(parameter), value, timestamp);
+			return;
+		}
 		if (timestamp) {
 			UINT32 time = GetMsecTime();
 			fprintf(file_, "[%d] ", time);
 		}
 		fprintf(file_, "%s = %d\n", parameter, value);
 		fflush(file_);
-	}	
+	}
 }
 
 /**
@@ -170,13 +274,17 @@ void DataLog::WriteValue(const char * parameter, int value, bool timestamp) {
 */
 void DataLog::WriteValue(const char * parameter, float value, bool timestamp) {
 	if (file_opened_ && (file_ != NULL) && (parameter != NULL)) {
+		if (format_ == kBinary) {
+			WriteChannel(GetChannel(parameter), value, timestamp);
+			return;
+		}
 		if (timestamp) {
 			UINT32 time = GetMsecTime();
 			fprintf(file_, "[%d] ", time);
 		}
 		fprintf(file_, "%s = %f\n", parameter, value);
 		fflush(file_);
-	}		
+	}
 }
 
 /**
@@ -188,11 +296,328 @@ void DataLog::WriteValue(const char * parameter, float value, bool timestamp) {
 */
 void DataLog::WriteValue(const char * parameter, double value, bool timestamp) {
 	if (file_opened_ && (file_ != NULL) && (parameter != NULL)) {
+		if (format_ == kBinary) {
+			WriteChannel(GetChannel(parameter), value, timestamp);
+			return;
+		}
 		if (timestamp) {
 			UINT32 time = GetMsecTime();
 			fprintf(file_, "[%d] ", time);
 		}
 		fprintf(file_, "%s = %f\n", parameter, value);
 		fflush(file_);
-	}	
+	}
+}
+
+/**
+ * \brief Register a parameter name and get a channel handle for it.
+ *
+ * Call this once when the log is opened, then pass the handle to WriteChannel
+ * so logging a value doesn't need any string work.  In binary mode the name is
+ * written to the log once, right after the header.
+ *
+ * \param parameter the label/name of the parameter.
+ * \return the channel handle, or -1 if the log isn't open or there are too many channels.
+*/
+int DataLog::RegisterChannel(const char * parameter) {
+	if (file_opened_ && (file_ != NULL) && (parameter != NULL)) {
+		return GetChannel(parameter);
+	}
+	return -1;
+}
+
+/**
+ * \brief Write a channel/value (int) pair to the log file.
+ *
+ * \param channel the channel handle returned by RegisterChannel.
+ * \param value the value of the parameter.
+ * \param timestamp true if a timestamp should be prepended to the line.
+*/
+void DataLog::WriteChannel(int channel, int value, bool timestamp) {
+	if (file_opened_ && (file_ != NULL) && (channel >= 0) && (channel < channel_count_)) {
+		if (format_ == kBinary) {
+			if (!NameChannel(channel)) {
+				dropped_records_++;
+				return;
+			}
+			datalog_record record;
+			record.time = GetMsecTime();
+			record.channel = (unsigned short) channel;
+			record.type = kIntRecord;
+			record.flags = timestamp ? kTimestampFlag : 0;
+			record.value.int_value = value;
+			PushRecord(record);
+			return;
+		}
+		if (timestamp) {
+			UINT32 time = GetMsecTime();
+			fprintf(file_, "[%d] ", time);
+		}
+		fprintf(file_, "%s = %d\n", channel_names_[channel], value);
+		fflush(file_);
+	}
+}
+
+/**
+ * \brief Write a channel/value (float) pair to the log file.
+ *
+ * \param channel the channel handle returned by RegisterChannel.
+ * \param value the value of the parameter.
+ * \param timestamp true if a timestamp should be prepended to the line.
+*/
+void DataLog::WriteChannel(int channel, float value, bool timestamp) {
+	if (file_opened_ && (file_ != NULL) && (channel >= 0) && (channel < channel_count_)) {
+		if (format_ == kBinary) {
+			if (!NameChannel(channel)) {
+				dropped_records_++;
+				return;
+			}
+			datalog_record record;
+			record.time = GetMsecTime();
+			record.channel = (unsigned short) channel;
+			record.type = kFloatRecord;
+			record.flags = timestamp ? kTimestampFlag : 0;
+			record.value.float_value = value;
+			PushRecord(record);
+			return;
+		}
+		if (timestamp) {
+			UINT32 time = GetMsecTime();
+			fprintf(file_, "[%d] ", time);
+		}
+		fprintf(file_, "%s = %f\n", channel_names_[channel], value);
+		fflush(file_);
+	}
+}
+
+/**
+ * \brief Write a channel/value (double) pair to the log file.
+ *
+ * \param channel the channel handle returned by RegisterChannel.
+ * \param value the value of the parameter.
+ * \param timestamp true if a timestamp should be prepended to the line.
+*/
+void DataLog::WriteChannel(int channel, double value, bool timestamp) {
+	if (file_opened_ && (file_ != NULL) && (channel >= 0) && (channel < channel_count_)) {
+		if (format_ == kBinary) {
+			if (!NameChannel(channel)) {
+				dropped_records_++;
+				return;
+			}
+			datalog_record record;
+			record.time = GetMsecTime();
+			record.channel = (unsigned short) channel;
+			record.type = kDoubleRecord;
+			record.flags = timestamp ? kTimestampFlag : 0;
+			record.value.double_value = value;
+			PushRecord(record);
+			return;
+		}
+		if (timestamp) {
+			UINT32 time = GetMsecTime();
+			fprintf(file_, "[%d] ", time);
+		}
+		fprintf(file_, "%s = %f\n", channel_names_[channel], value);
+		fflush(file_);
+	}
+}
+
+/**
+ * \brief Get the number of binary records that were dropped because the ring buffer was full.
+ *
+ * \return the number of dropped records.
+*/
+unsigned int DataLog::GetDroppedRecords() {
+	return dropped_records_;
+}
+
+/**
+ * \brief Write the binary log file header.
+*/
+void DataLog::WriteHeader() {
+	datalog_header header;
+	memset(&header, 0, sizeof(header));
+	strncpy(header.magic, "TJLOG", sizeof(header.magic));
+	header.byte_order = 0x01020304;
+	header.version = 1;
+	header.record_size = sizeof(datalog_record);
+	fwrite(&header, sizeof(header), 1, file_);
+	fflush(file_);
+}
+
+/**
+ * \brief Get the channel index of a parameter name, adding it to the log if it's new.
+ *
+ * In binary mode the name of a new channel is written to the log once, and every
+ * record after that only stores the channel index.
+ *
+ * \param parameter the label/name of the parameter.
+ * \return the channel index, or -1 if there's no room for another channel.
+*/
+int DataLog::GetChannel(const char * parameter) {
+	// Callers almost always pass the same string literal, so check the pointers first
+	// The name is still compared, since a caller may reuse a buffer for different names
+	for (int i = 0; i < channel_count_; i++) {
+		if (channel_pointers_[i] == parameter && strncmp(channel_names_[i], parameter, kMaxChannelName - 1) == 0)
+			return i;
+	}
+	for (int i = 0; i < channel_count_; i++) {
+		if (strncmp(channel_names_[i], parameter, kMaxChannelName - 1) == 0) {
+			channel_pointers_[i] = parameter;
+			return i;
+		}
+	}
+
+	// Add a new channel and write its name to the log
+	if (channel_count_ >= kMaxChannels) {
+		dropped_records_++;
+		return -1;
+	}
+	int channel = channel_count_;
+	strncpy(channel_names_[channel], parameter, kMaxChannelName - 1);
+	channel_names_[channel][kMaxChannelName - 1] = 0;
+	channel_pointers_[channel] = parameter;
+	channel_named_[channel] = false;
+	channel_count_++;
+	if (format_ == kBinary)
+		NameChannel(channel);
+	return channel;
+}
+
+/**
+ * \brief Make sure a channel's name is in the log before any of its values.
+ *
+ * If the ring buffer was full when the channel was added, its name record
+ * was dropped, so it is written again before the channel's next value.
+ *
+ * \param channel the channel index.
+ * \return true if the name is in the ring buffer, false if it was dropped again.
+*/
+bool DataLog::NameChannel(int channel) {
+	if (!channel_named_[channel]) {
+		channel_named_[channel] = PushText((unsigned short) channel, kChannelRecord, channel_names_[channel], false);
+	}
+	return channel_named_[channel];
+}
+
+/**
+ * \brief Add a record to the ring buffer.
+ *
+ * Never blocks.  If the writer task has fallen behind and the ring buffer is
+ * full, the record is dropped and counted.
+ *
+ * \param record the record to add.
+ * \return true if the record was added.
+*/
+bool DataLog::PushRecord(const datalog_record &record) {
+	unsigned int head = ring_head_;
+	if ((head - ring_tail_) >= kRingSize) {
+		dropped_records_++;
+		return false;
+	}
+	ring_[head & (kRingSize - 1)] = record;
+	// Make sure the record is stored before the writer task can see it
+	MemoryBarrier();
+	ring_head_ = head + 1;
+	return true;
+}
+
+/**
+ * \brief Add text to the ring buffer, split across as many records as needed.
+ *
+ * \param channel the channel the text belongs to.
+ * \param type the type of record.
+ * \param text the null terminated text.
+ * \param timestamp true if a timestamp should be prepended to the line.
+ * \return true if all the records were added.
+*/
+bool DataLog::PushText(unsigned short channel, unsigned char type, const char * text, bool timestamp) {
+	const unsigned int chunk_size = sizeof(((datalog_record *) 0)->value.text);
+	unsigned int length = strlen(text);
+	unsigned int record_count = (length / chunk_size) + 1;
+
+	// Only add the text if all of it fits, so the log never has partial text
+	if ((kRingSize - (ring_head_ - ring_tail_)) < record_count) {
+		dropped_records_ += record_count;
+		return false;
+	}
+
+	datalog_record record;
+	record.time = GetMsecTime();
+	record.channel = channel;
+	record.type = type;
+	for (unsigned int i = 0; i < record_count; i++) {
+		unsigned int remaining = length - (i * chunk_size);
+		memset(record.value.text, 0, chunk_size);
+		if (remaining > chunk_size) {
+			memcpy(record.value.text, text + (i * chunk_size), chunk_size);
+		}
+		else {
+			memcpy(record.value.text, text + (i * chunk_size), remaining);
+		}
+		record.flags = (timestamp ? kTimestampFlag : 0) | ((i + 1) < record_count ? kContinuedFlag : 0);
+		PushRecord(record);
+	}
+	return true;
+}
+
+/**
+ * \brief Write all the records currently in the ring buffer to the file.
+ *
+ * The records are written straight out of the ring buffer, in at most two blocks.
+*/
+void DataLog::DrainRecords() {
+	if (ring_ == NULL || file_ == NULL)
+		return;
+
+	unsigned int tail = ring_tail_;
+	unsigned int head = ring_head_;
+	// Make sure the records are read after the head that published them
+	MemoryBarrier();
+	if (tail == head)
+		return;
+
+	while (tail != head) {
+		unsigned int index = tail & (kRingSize - 1);
+		unsigned int count = head - tail;
+		// Stop at the end of the buffer, the rest is written from the start on the next pass
+		if ((index + count) > kRingSize)
+			count = kRingSize - index;
+		fwrite(&ring_[index], sizeof(datalog_record), count, file_);
+		tail += count;
+	}
+	fflush(file_);
+
+	// Only release the space once the records have been written
+	MemoryBarrier();
+	ring_tail_ = tail;
+}
+
+/**
+ * \brief Static interface for the WriterTask function.
+ *
+ * This function is used so that the actual task function doesn't need
+ * to be static.
+ *
+ * \param this_pointer a pointer to this object.
+ * \return the result of the spawned task.
+*/
+int DataLog::s_WriterTask(DataLog *this_pointer) {
+	return this_pointer->WriterTask();
+}
+
+/**
+ * \brief Writes the binary records to the file in the background.
+ *
+ * Runs at a lower priority than the robot task, so writing to the file
+ * never delays the periodic loops.
+ *
+ * \return 0 when the log is closed.
+*/
+int DataLog::WriterTask() {
+	while (writer_running_) {
+		DrainRecords();
+		Wait(WRITER_PERIOD);
+	}
+	return 0;
 }
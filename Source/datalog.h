@@ -4,35 +4,142 @@
 #include <stdio.h>
 #include "common.h"
 
+// Forward class definitions
+class Task;
+
+/**
+ * Data structure at the start of a binary log file.
+ *
+ * The header is the same size as a record, so a reader can step through
+ * the file in fixed size blocks even when a log is appended to.
+ */
+struct datalog_header {
+	char magic[8];				///< "TJLOG" file identifier
+	unsigned int byte_order;	///< 0x01020304 written in the byte order of the robot
+	unsigned int version;		///< version of the record format
+	unsigned int record_size;	///< size of each record in bytes
+	unsigned int reserved[3];	///< pads the header to the size of a record
+};
+
+/**
+ * Data structure to store a single fixed size record of a binary log file.
+ */
+struct datalog_record {
+	unsigned int time;			///< processor time in milliseconds when the value was written
+	unsigned short channel;		///< index of the channel (parameter name) the value belongs to
+	unsigned char type;			///< type of the value stored in the record
+	unsigned char flags;		///< timestamp and text continuation flags
+	union {
+		int int_value;			///< value of an integer record
+		float float_value;		///< value of a float record
+		double double_value;	///< value of a double record
+		char text[24];			///< text of a line, string value or channel name
+	} value;
+};
+
 /**
  * \class DataLog
  * \brief Writes log messages to a text file.
- * 
+ *
  * Automatically formats and writes various types of log messages to a log file.
+ * In binary mode the messages are stored as fixed size records in a ring buffer,
+ * and a background task writes them to the file in blocks.
  */
 class DataLog {
 
-public:	
+public:
+	/**
+	 * \enum LogFormat
+	 * \brief An enumeration of the formats a log file can be written in.
+	 */
+	enum LogFormat {
+		kText,		///< every value is formatted and written to the file immediately
+		kBinary		///< values are queued as binary records and written by a background task
+	};
+
+	/**
+	 * \enum RecordType
+	 * \brief An enumeration of the types of records in a binary log file.
+	 */
+	enum RecordType {
+		kLineRecord,		///< a line of text
+		kChannelRecord,		///< the name of a channel
+		kStringRecord,		///< a text value
+		kIntRecord,			///< an integer value
+		kFloatRecord,		///< a float value
+		kDoubleRecord		///< a double value
+	};
+
+	/**
+	 * \enum RecordFlags
+	 * \brief Bit flags stored with each record of a binary log file.
+	 */
+	enum RecordFlags {
+		kTimestampFlag = 0x01,	///< the line should be printed with a timestamp
+		kContinuedFlag = 0x02	///< the text continues in the next record
+	};
+
 	// Public methods
 	DataLog(const char * path);
 	DataLog(const char * path, const char * mode);
+	DataLog(const char * path, LogFormat format);
 	DataLog();
 	~DataLog();
+	static void SetDefaultFormat(LogFormat format);
 	bool Open(const char * path);
 	bool Open(const char * path, const char * mode);
+	bool Open(const char * path, const char * mode, LogFormat format);
 	void Close();
 	void WriteLine(const char * line, bool timestamp=false);
 	void WriteValue(const char * parameter, const char * value, bool timestamp=false);
 	void WriteValue(const char * parameter, int value, bool timestamp=false);
 	void WriteValue(const char * parameter, float value, bool timestamp=false);
 	void WriteValue(const char * parameter, double value, bool timestamp=false);
+	int RegisterChannel(const char * parameter);
+	void WriteChannel(int channel, int value, bool timestamp=false);
+	void WriteChannel(int channel, float value, bool timestamp=false);
+	void WriteChannel(int channel, double value, bool timestamp=false);
+	unsigned int GetDroppedRecords();
 
 	// Public member variables
 	bool file_opened_;	///< true if the output file is open
 
+	// Public constants
+	static const unsigned short kNoChannel = 0xFFFF;	///< channel of records that don't belong to a channel
+
 private:
+	// Private constants
+	static const unsigned int kRingSize = 1024;		///< number of records in the ring buffer, must be a power of 2
+	static const int kMaxChannels = 64;				///< maximum number of channels in a binary log
+	static const int kMaxChannelName = 48;			///< maximum length of a channel name
+
+	// Private methods
+	static int s_WriterTask(DataLog *this_pointer);
+	int WriterTask();
+	void Initialize();
+	void WriteHeader();
+	int GetChannel(const char * parameter);
+	bool NameChannel(int channel);
+	bool PushRecord(const datalog_record &record);
+	bool PushText(unsigned short channel, unsigned char type, const char * text, bool timestamp);
+	void DrainRecords();
+
 	// Private member objects
-	FILE *file_;	///< the file to write log data to
+	FILE *file_;			///< the file to write log data to
+	Task *writer_task_;		///< task object used to write the binary records to the file in the background
+
+	// Private member variables
+	LogFormat format_;								///< the format of the currently open file
+	datalog_record *ring_;							///< preallocated ring buffer of records waiting to be written
+	volatile unsigned int ring_head_;				///< count of records added to the ring buffer, only changed by the logging task
+	volatile unsigned int ring_tail_;				///< count of records written to the file, only changed by the writer task
+	volatile bool writer_running_;					///< true while the writer task should keep running
+	unsigned int dropped_records_;					///< number of records dropped because the ring buffer was full
+	const char * channel_pointers_[kMaxChannels];	///< last name pointer used for each channel, so a channel is usually found with one string compare
+	char channel_names_[kMaxChannels][kMaxChannelName];	///< names of the channels registered with the log
+	bool channel_named_[kMaxChannels];				///< true once a channel's name is in the ring buffer, false if it was dropped and must be written again
+	int channel_count_;								///< number of channels registered with the log
+	static LogFormat s_default_format_;				///< format used when a log is opened without specifying one
 };
 
 #endif
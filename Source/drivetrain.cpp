@@ -2,7 +2,14 @@
 #include "WPILib.h"
 #include "drivetrain.h"
 #include "datalog.h"
+#include "feedbackcontroller.h"
 #include "parameters.h"
+#include "parameterwatcher.h"
+#include "looptimer.h"
+#include "motionprofile.h"
+#include "odometry.h"
+#include "sensorsampler.h"
+#include "slewratelimiter.h"
 
 /**
  * \def PI
@@ -64,8 +71,18 @@ DriveTrain::~DriveTrain() {
 		log_->Close();
 	}
 	
+	// Stop the odometry and sampling before the sensors they read are deleted
+	SafeDelete(odometry_);
+	SetSensorSampler(NULL);
 	SafeDelete(timer_);
-	SafeDelete(acceleration_timer_);
+	SafeDelete(feedback_timer_);
+	SafeDelete(drive_feedback_);
+	SafeDelete(turn_feedback_);
+	SafeDelete(profile_);
+	SafeDelete(linear_limiter_);
+	SafeDelete(turn_limiter_);
+	SafeDelete(left_limiter_);
+	SafeDelete(right_limiter_);
 	SafeDelete(log_);
 	SafeDelete(parameters_);
 	SafeDelete(accelerometer_);
@@ -95,54 +112,42 @@ void DriveTrain::Initialize(const char * parameters, bool logging_enabled) {
 	gyro_ = NULL;
 	accelerometer_ = NULL;
 	timer_ = NULL;
-	acceleration_timer_ = NULL;
+	feedback_timer_ = NULL;
+	drive_feedback_ = NULL;
+	turn_feedback_ = NULL;
+	profile_ = NULL;
+	linear_limiter_ = NULL;
+	turn_limiter_ = NULL;
+	left_limiter_ = NULL;
+	right_limiter_ = NULL;
+	odometry_ = NULL;
+	sensor_sampler_ = NULL;
 	log_ = NULL;
 	parameters_ = NULL;
 
 	
 	// Initialize private parameters
+	int binding_count = 0;
+	const parameter_binding<DriveTrain> * bindings = GetParameterBindings(&binding_count);
+	Parameters::SetDefaults(this, bindings, binding_count);
 	invert_multiplier_ = 0.0;
-	normal_linear_speed_ratio_ = 1.0;
-	turbo_linear_speed_ratio_ = 1.0;
-	normal_turning_speed_ratio_ = 1.0;
-	turbo_turning_speed_ratio_ = 1.0;
-	auto_far_linear_speed_ratio_ = 1.0;
-	auto_medium_linear_speed_ratio_ = 1.0;
-	auto_near_linear_speed_ratio_ = 1.0;
-	auto_far_turning_speed_ratio_ = 1.0;
-	auto_medium_turning_speed_ratio_ = 1.0;
-	auto_near_turning_speed_ratio_ = 1.0;
-	auto_medium_time_threshold_ = 0.5;
-	auto_far_time_threshold_ = 1.0;
-	auto_medium_distance_threshold_ = 2.0;
-	auto_far_distance_threshold_ = 5.0;
-	auto_medium_heading_threshold_ = 15.0;
-	auto_far_heading_threshold_ = 25.0;
-	distance_threshold_ = 0.5;
-	heading_threshold_ = 3.0;
-	time_threshold_ = 0.1;
-	forward_direction_ = 1.0;
-	backward_direction_ = -1.0;
-	left_direction_ = -1.0;
-	right_direction_ = 1.0;
-	left_motor_inverted_ = 0;
-	right_motor_inverted_ = 0;
-	accelerometer_axis_ = 0;
-	maximum_linear_speed_change_ = 0.0;
-	maximum_turn_speed_change_ = 0.0;
-	linear_filter_constant_ = 0.0;
-	turn_filter_constant_ = 0.0;
 	
 	// Initialize private member variables
 	acceleration_ = 0.0;
 	gyro_angle_ = 0.0;
+	heading_history_count_ = 0;
+	heading_history_next_ = 0;
 	initial_heading_ = 0.0;
 	adjustment_in_progress_ = false;
+	profile_active_ = false;
+	profile_start_time_ = 0.0;
 	distance_traveled_ = 0.0;
 	log_enabled_ = false;
+	gyro_angle_channel_ = -1;
+	acceleration_channel_ = -1;
+	distance_traveled_channel_ = -1;
+	gyro_sample_channel_ = -1;
 	robot_state_ = kDisabled;
-	previous_linear_speed_ = 0.0;
-	previous_turn_speed_ = 0.0;
 
 		
 	// Create a new data log object
@@ -151,6 +156,10 @@ void DriveTrain::Initialize(const char * parameters, bool logging_enabled) {
 	// Enable logging if specified
 	if (log_ != NULL && log_->file_opened_) {
 		log_enabled_ = logging_enabled;
+		// Register the values logged every loop so they don't need string work
+		gyro_angle_channel_ = log_->RegisterChannel("Gyro angle");
+		acceleration_channel_ = log_->RegisterChannel("Acceleration");
+		distance_traveled_channel_ = log_->RegisterChannel("Distance traveled");
 	}
 	else {
 		log_enabled_ = false;
@@ -159,12 +168,143 @@ void DriveTrain::Initialize(const char * parameters, bool logging_enabled) {
 	// Create a timer object
 	timer_ = new Timer();
 
+	// Create the feedback controllers, the motion profile they follow and the timer they measure their updates with
+	drive_feedback_ = new FeedbackController();
+	turn_feedback_ = new FeedbackController();
+	profile_ = new MotionProfile();
+	feedback_timer_ = new Timer();
+	if (feedback_timer_ != NULL) {
+		feedback_timer_->Start();
+	}
+
+	// Create the slew rate limiters that smooth manual driving, which also measure their updates with the feedback timer
+	linear_limiter_ = new SlewRateLimiter();
+	turn_limiter_ = new SlewRateLimiter();
+	left_limiter_ = new SlewRateLimiter();
+	right_limiter_ = new SlewRateLimiter();
+
+	// Create the odometry, which is started once the sensors are created
+	odometry_ = new Odometry();
+
 	// Attempt to read the parameters file
-	strncpy(parameters_file_, parameters, sizeof(parameters_file_));
+	strncpy(parameters_file_, parameters, sizeof(parameters_file_) - 1);
+	parameters_file_[sizeof(parameters_file_) - 1] = 0;
 
 	LoadParameters();
 }
 
+/**
+ * \brief Get the table of parameters that are copied straight into member variables.
+ *
+ * Each entry has the parameter name, the member variable, the default value,
+ * and the minimum and maximum values allowed in the file.
+ *
+ * \param count set to the number of bindings in the table.
+ * \return the table of parameter bindings.
+*/
+const parameter_binding<DriveTrain> * DriveTrain::GetParameterBindings(int * count) {
+	static const parameter_binding<DriveTrain> bindings[] = {
+		IntParameter(DriveTrain, "LEFT_MOTOR_INVERTED", left_motor_inverted_, 0, 0, 1),
+		IntParameter(DriveTrain, "RIGHT_MOTOR_INVERTED", right_motor_inverted_, 0, 0, 1),
+		IntParameter(DriveTrain, "ACCELEROMETER_AXIS", accelerometer_axis_, 0, 0, 4),
+		IntParameter(DriveTrain, "ODOMETRY_RATE", odometry_rate_, 200, 1, 1000),
+		FloatParameter(DriveTrain, "FORWARD_DIRECTION", forward_direction_, 1.0, -1.0, 1.0),
+		FloatParameter(DriveTrain, "BACKWARD_DIRECTION", backward_direction_, -1.0, -1.0, 1.0),
+		FloatParameter(DriveTrain, "LEFT_DIRECTION", left_direction_, -1.0, -1.0, 1.0),
+		FloatParameter(DriveTrain, "RIGHT_DIRECTION", right_direction_, 1.0, -1.0, 1.0),
+		FloatParameter(DriveTrain, "NORMAL_LINEAR_SPEED_RATIO", normal_linear_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "TURBO_LINEAR_SPEED_RATIO", turbo_linear_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "NORMAL_TURNING_SPEED_RATIO", normal_turning_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "TURBO_TURNING_SPEED_RATIO", turbo_turning_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "AUTO_FAR_LINEAR_SPEED_RATIO", auto_far_linear_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "AUTO_MEDIUM_LINEAR_SPEED_RATIO", auto_medium_linear_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "AUTO_NEAR_LINEAR_SPEED_RATIO", auto_near_linear_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "AUTO_FAR_TURNING_SPEED_RATIO", auto_far_turning_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "AUTO_MEDIUM_TURNING_SPEED_RATIO", auto_medium_turning_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "AUTO_NEAR_TURNING_SPEED_RATIO", auto_near_turning_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "DISTANCE_THRESHOLD", distance_threshold_, 0.5, 0.0, 100.0),
+		FloatParameter(DriveTrain, "HEADING_THRESHOLD", heading_threshold_, 3.0, 0.0, 180.0),
+		DoubleParameter(DriveTrain, "TIME_THRESHOLD", time_threshold_, 0.1, 0.0, 60.0),
+		FloatParameter(DriveTrain, "AUTO_MEDIUM_TIME_THRESHOLD", auto_medium_time_threshold_, 0.5, 0.0, 60.0),
+		FloatParameter(DriveTrain, "AUTO_FAR_TIME_THRESHOLD", auto_far_time_threshold_, 1.0, 0.0, 60.0),
+		FloatParameter(DriveTrain, "AUTO_MEDIUM_DISTANCE_THRESHOLD", auto_medium_distance_threshold_, 2.0, 0.0, 100.0),
+		FloatParameter(DriveTrain, "AUTO_FAR_DISTANCE_THRESHOLD", auto_far_distance_threshold_, 5.0, 0.0, 100.0),
+		FloatParameter(DriveTrain, "AUTO_MEDIUM_HEADING_THRESHOLD", auto_medium_heading_threshold_, 15.0, 0.0, 180.0),
+		FloatParameter(DriveTrain, "AUTO_FAR_HEADING_THRESHOLD", auto_far_heading_threshold_, 25.0, 0.0, 180.0),
+		FloatParameter(DriveTrain, "LINEAR_SLEW_RATE", linear_slew_rate_, 20.0, 0.0, 1000.0),
+		FloatParameter(DriveTrain, "LINEAR_SLEW_JERK", linear_slew_jerk_, 0.0, 0.0, 100000.0),
+		FloatParameter(DriveTrain, "TURN_SLEW_RATE", turn_slew_rate_, 20.0, 0.0, 1000.0),
+		FloatParameter(DriveTrain, "TURN_SLEW_JERK", turn_slew_jerk_, 0.0, 0.0, 100000.0),
+		FloatParameter(DriveTrain, "LINEAR_FILTER_CONSTANT", linear_filter_constant_, 0.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "TURN_FILTER_CONSTANT", turn_filter_constant_, 0.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "ODOMETRY_ACCELERATION_NOISE", odometry_acceleration_noise_, 0.05, 0.0, 10.0),
+		FloatParameter(DriveTrain, "ODOMETRY_BIAS_DRIFT", odometry_bias_drift_, 0.001, 0.0, 1.0),
+		FloatParameter(DriveTrain, "ODOMETRY_STILL_TIME", odometry_still_time_, 0.5, 0.0, 10.0),
+		FloatParameter(DriveTrain, "ODOMETRY_STILL_ACCELERATION", odometry_still_acceleration_, 0.3, 0.0, 10.0),
+		FloatParameter(DriveTrain, "ODOMETRY_STILL_TURN_RATE", odometry_still_turn_rate_, 2.0, 0.0, 360.0),
+		IntParameter(DriveTrain, "TURN_FEEDBACK_ENABLED", turn_feedback_enabled_, 0, 0, 1),
+		FloatParameter(DriveTrain, "TURN_PROPORTIONAL_GAIN", turn_proportional_gain_, 0.017, 0.0, 1.0),
+		FloatParameter(DriveTrain, "TURN_INTEGRAL_GAIN", turn_integral_gain_, 0.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "TURN_DERIVATIVE_GAIN", turn_derivative_gain_, 0.0026, 0.0, 1.0),
+		FloatParameter(DriveTrain, "TURN_FEEDFORWARD_GAIN", turn_feedforward_gain_, 0.0015, 0.0, 1.0),
+		FloatParameter(DriveTrain, "TURN_STATIC_FEEDFORWARD", turn_static_feedforward_, 0.05, 0.0, 1.0),
+		FloatParameter(DriveTrain, "TURN_MAXIMUM_OUTPUT_CHANGE", turn_maximum_output_change_, 8.0, 0.0, 100.0),
+		FloatParameter(DriveTrain, "TURN_SETTLE_RATE", turn_settle_rate_, 5.0, 0.0, 360.0),
+		DoubleParameter(DriveTrain, "TURN_SETTLE_TIME", turn_settle_time_, 0.1, 0.0, 10.0),
+		IntParameter(DriveTrain, "TURN_PROFILE_ENABLED", turn_profile_enabled_, 0, 0, 1),
+		FloatParameter(DriveTrain, "TURN_MAXIMUM_VELOCITY", turn_maximum_velocity_, 180.0, 0.0, 10000.0),
+		FloatParameter(DriveTrain, "TURN_MAXIMUM_ACCELERATION", turn_maximum_acceleration_, 720.0, 0.0, 100000.0),
+		IntParameter(DriveTrain, "DRIVE_PROFILE_ENABLED", drive_profile_enabled_, 0, 0, 1),
+		FloatParameter(DriveTrain, "DRIVE_MAXIMUM_VELOCITY", drive_maximum_velocity_, 2.0, 0.0, 100.0),
+		FloatParameter(DriveTrain, "DRIVE_MAXIMUM_ACCELERATION", drive_maximum_acceleration_, 3.0, 0.0, 1000.0),
+		FloatParameter(DriveTrain, "DRIVE_PROPORTIONAL_GAIN", drive_proportional_gain_, 1.0, 0.0, 100.0),
+		FloatParameter(DriveTrain, "DRIVE_INTEGRAL_GAIN", drive_integral_gain_, 0.0, 0.0, 100.0),
+		FloatParameter(DriveTrain, "DRIVE_DERIVATIVE_GAIN", drive_derivative_gain_, 0.0, 0.0, 100.0),
+		FloatParameter(DriveTrain, "DRIVE_FEEDFORWARD_GAIN", drive_feedforward_gain_, 0.27, 0.0, 100.0),
+		FloatParameter(DriveTrain, "DRIVE_STATIC_FEEDFORWARD", drive_static_feedforward_, 0.0, 0.0, 1.0),
+		FloatParameter(DriveTrain, "DRIVE_MAXIMUM_OUTPUT_CHANGE", drive_maximum_output_change_, 0.0, 0.0, 100.0),
+		FloatParameter(DriveTrain, "DRIVE_SETTLE_RATE", drive_settle_rate_, 0.1, 0.0, 100.0),
+		DoubleParameter(DriveTrain, "DRIVE_SETTLE_TIME", drive_settle_time_, 0.1, 0.0, 10.0)
+	};
+	*count = sizeof(bindings) / sizeof(bindings[0]);
+	return bindings;
+}
+
+/**
+ * \brief Copies the tuning values from newly read parameters into the member variables.
+ *
+ * Used to pick up changes to the parameter file while the robot is running.
+ * Only the tuning values are changed, the hardware is not recreated.
+ *
+ * \param parameters the newly read parameters.  This object takes ownership of them.
+ * \param reload_log where the reload is reported, or NULL to not report it.  The
+ * watcher writes it to its log in the background, so this doesn't wait on the file.
+ * \return true if every tuning value was found and in range.
+*/
+bool DriveTrain::ReloadParameters(Parameters * parameters, ParameterWatcher * reload_log) {
+	if (parameters == NULL) {
+		return false;
+	}
+
+	if (reload_log != NULL) {
+		reload_log->WriteLine("DriveTrain parameters reloaded\n");
+	}
+
+	// Copy the tuning values into the bound member variables
+	int binding_count = 0;
+	const parameter_binding<DriveTrain> * bindings = GetParameterBindings(&binding_count);
+	int problems = parameters->Bind(this, bindings, binding_count, reload_log);
+	if (odometry_ != NULL) {
+		odometry_->SetFilter(odometry_rate_, odometry_acceleration_noise_, odometry_bias_drift_, odometry_still_time_,
+				odometry_still_acceleration_, odometry_still_turn_rate_);
+	}
+
+	// Keep the new parameters so GetValue calls see the same values
+	SafeDelete(parameters_);
+	parameters_ = parameters;
+	return problems == 0;
+}
+
 /**
  * \brief Loads the parameter file into memory, copies the values into local/member variables,
  * and creates and initializes objects using those values.
@@ -185,13 +325,19 @@ bool DriveTrain::LoadParameters() {
 
 
 	
+	// Stop the odometry and sampling before the sensors they read are deleted
+	if (odometry_ != NULL) {
+		odometry_->Stop();
+	}
+	SensorSampler * sensor_sampler = sensor_sampler_;
+	SetSensorSampler(NULL);
+
 	// Close and delete old objects
 	SafeDelete(parameters_);
 	SafeDelete(robot_drive_);
 	SafeDelete(left_controller_);
 	SafeDelete(right_controller_);
 	SafeDelete(accelerometer_);
-	SafeDelete(acceleration_timer_);
 	SafeDelete(gyro_);
 
 	
@@ -211,46 +357,20 @@ bool DriveTrain::LoadParameters() {
 	
 	// Set arm variables based on the parameters file
 	if (parameters_read) {
+		// Copy the tuning values into the bound member variables
+		int binding_count = 0;
+		const parameter_binding<DriveTrain> * bindings = GetParameterBindings(&binding_count);
+		parameters_->Bind(this, bindings, binding_count, log_enabled_ ? log_ : NULL);
 		parameters_->GetValue("LEFT_MOTOR_SLOT", &left_motor_slot);
 		parameters_->GetValue("LEFT_MOTOR_CHANNEL", &left_motor_channel);
-		parameters_->GetValue("LEFT_MOTOR_INVERTED", &left_motor_inverted_);
 		parameters_->GetValue("RIGHT_MOTOR_SLOT", &right_motor_slot);
 		parameters_->GetValue("RIGHT_MOTOR_CHANNEL", &right_motor_channel);
-		parameters_->GetValue("RIGHT_MOTOR_INVERTED", &right_motor_inverted_);
 		parameters_->GetValue("MOTOR_SAFETY_TIMEOUT", &motor_safety_timeout);
 		parameters_->GetValue("ACCELEROMETER_SLOT", &accelerometer_slot);
 		parameters_->GetValue("ACCELEROMETER_RANGE", &accelerometer_range);
-		parameters_->GetValue("ACCELEROMETER_AXIS", &accelerometer_axis_);
 		parameters_->GetValue("GYRO_CHANNEL", &gyro_channel);
 		parameters_->GetValue("GYRO_SENSITIVITY", &gyro_sensitivity);
 		parameters_->GetValue("INVERT_CONTROLS", &invert_controls);		
-		parameters_->GetValue("FORWARD_DIRECTION", &forward_direction_);
-		parameters_->GetValue("BACKWARD_DIRECTION", &backward_direction_);
-		parameters_->GetValue("LEFT_DIRECTION", &left_direction_);
-		parameters_->GetValue("RIGHT_DIRECTION", &right_direction_);
-		parameters_->GetValue("NORMAL_LINEAR_SPEED_RATIO", &normal_linear_speed_ratio_);
-		parameters_->GetValue("TURBO_LINEAR_SPEED_RATIO", &turbo_linear_speed_ratio_);
-		parameters_->GetValue("NORMAL_TURNING_SPEED_RATIO", &normal_turning_speed_ratio_);
-		parameters_->GetValue("TURBO_TURNING_SPEED_RATIO", &turbo_turning_speed_ratio_);
-		parameters_->GetValue("AUTO_FAR_LINEAR_SPEED_RATIO", &auto_far_linear_speed_ratio_);
-		parameters_->GetValue("AUTO_MEDIUM_LINEAR_SPEED_RATIO", &auto_medium_linear_speed_ratio_);
-		parameters_->GetValue("AUTO_NEAR_LINEAR_SPEED_RATIO", &auto_near_linear_speed_ratio_);
-		parameters_->GetValue("AUTO_FAR_TURNING_SPEED_RATIO", &auto_far_turning_speed_ratio_);
-		parameters_->GetValue("AUTO_MEDIUM_TURNING_SPEED_RATIO", &auto_medium_turning_speed_ratio_);
-		parameters_->GetValue("AUTO_NEAR_TURNING_SPEED_RATIO", &auto_near_turning_speed_ratio_);
-		parameters_->GetValue("DISTANCE_THRESHOLD", &distance_threshold_);
-		parameters_->GetValue("HEADING_THRESHOLD", &heading_threshold_);
-		parameters_->GetValue("TIME_THRESHOLD", &time_threshold_);
-		parameters_->GetValue("AUTO_MEDIUM_TIME_THRESHOLD", &auto_medium_time_threshold_);
-		parameters_->GetValue("AUTO_FAR_TIME_THRESHOLD", &auto_far_time_threshold_);
-		parameters_->GetValue("AUTO_MEDIUM_DISTANCE_THRESHOLD", &auto_medium_distance_threshold_);
-		parameters_->GetValue("AUTO_FAR_DISTANCE_THRESHOLD", &auto_far_distance_threshold_);
-		parameters_->GetValue("AUTO_MEDIUM_HEADING_THRESHOLD", &auto_medium_heading_threshold_);
-		parameters_->GetValue("AUTO_FAR_HEADING_THRESHOLD", &auto_far_heading_threshold_);
-		parameters_->GetValue("MAXIMUM_LINEAR_SPEED_CHANGE", &maximum_linear_speed_change_);
-		parameters_->GetValue("MAXIMUM_TURN_SPEED_CHANGE", &maximum_turn_speed_change_);
-		parameters_->GetValue("LINEAR_FILTER_CONSTANT", &linear_filter_constant_);
-		parameters_->GetValue("TURN_FILTER_CONSTANT", &turn_filter_constant_);
 	}
 
 	// Check if the accelerometer is present/enabled
@@ -258,7 +378,6 @@ bool DriveTrain::LoadParameters() {
 		accelerometer_ = new ADXL345_I2C(accelerometer_slot, (ADXL345_I2C::DataFormat_Range) accelerometer_range);
 		if (accelerometer_ != NULL) {
 			accelerometer_enabled_ = true;
-			acceleration_timer_ = new Timer();
 		}
 	}
 	else {
@@ -276,6 +395,7 @@ bool DriveTrain::LoadParameters() {
 	else {
 		gyro_enabled_ = false;
 	}
+	SetSensorSampler(sensor_sampler);
 	
 	// Create motor controller objects
 	if (left_motor_slot > 0 && left_motor_channel > 0)
@@ -290,6 +410,14 @@ bool DriveTrain::LoadParameters() {
 		robot_drive_->SetSafetyEnabled(true);
 	}
 	
+	// Track the distance traveled from the accelerometer and gyro
+	if (accelerometer_enabled_ && odometry_ != NULL) {
+		odometry_->SetFilter(odometry_rate_, odometry_acceleration_noise_, odometry_bias_drift_, odometry_still_time_,
+				odometry_still_acceleration_, odometry_still_turn_rate_);
+		odometry_->Start(accelerometer_, accelerometer_axis_, gyro_, left_controller_, right_controller_);
+	}
+	distance_traveled_ = 0.0;
+	
 	// Invert motors if specified
 	if (left_motor_inverted_ && robot_drive_ != NULL) {
 		robot_drive_->SetInvertedMotor(RobotDrive::kRearLeftMotor, true);
@@ -328,36 +456,93 @@ bool DriveTrain::LoadParameters() {
  * \brief Read and store current sensor values.
 */
 void DriveTrain::ReadSensors() {
-	double loop_time = 0.0;
-	
 	if (gyro_enabled_) {
-		gyro_angle_ = gyro_->GetAngle();
+		// Use the sensor sampler's latest reading if there is one, with the time it was read
+		sensor_sample gyro_sample;
+		if (sensor_sampler_ != NULL && sensor_sampler_->GetLatest(gyro_sample_channel_, &gyro_sample)) {
+			gyro_angle_ = (float) gyro_sample.value;
+		}
+		else {
+			gyro_angle_ = gyro_->GetAngle();
+			gyro_sample.timestamp = LoopTimer::GetTimestamp();
+		}
+
+		// Keep a history of headings, to look up where the robot was pointing when a camera image was taken
+		heading_sample &sample = heading_history_[heading_history_next_];
+		sample.timestamp = gyro_sample.timestamp;
+		sample.heading = gyro_angle_;
+		heading_history_next_ = (heading_history_next_ + 1) % kHeadingHistorySize;
+		if (heading_history_count_ < kHeadingHistorySize)
+			heading_history_count_++;
 	}
 
-	// Get the acceleration, and pseudo-double-integrate accel to get distance by multiplying by time^2 
+	// Get the acceleration and distance from the odometry, which integrates the accelerometer at a fixed rate
+	// Until it has read the sensors since the last reset, the distance stays at zero
 	if (accelerometer_enabled_) {
-		acceleration_ = accelerometer_->GetAcceleration((ADXL345_I2C::Axes) accelerometer_axis_);
-		if (acceleration_timer_ != NULL) {
-			loop_time = acceleration_timer_->Get();
-			acceleration_timer_->Reset();
-			distance_traveled_ += (acceleration_ * loop_time * loop_time);
+		odometry_pose pose;
+		if (odometry_->GetPose(&pose)) {
+			acceleration_ = pose.acceleration;
+			distance_traveled_ = pose.distance;
 		}
 	}
 }
 
+/**
+ * \brief Read the gyro with a sensor sampler instead of in ReadSensors().
+ *
+ * \param sampler the sensor sampler, or NULL to read the gyro in ReadSensors().
+*/
+void DriveTrain::SetSensorSampler(SensorSampler * sampler) {
+	if (sensor_sampler_ != NULL) {
+		sensor_sampler_->Remove(gyro_sample_channel_);
+	}
+	gyro_sample_channel_ = -1;
+	sensor_sampler_ = sampler;
+	if (sensor_sampler_ != NULL && gyro_enabled_) {
+		gyro_sample_channel_ = sensor_sampler_->AddGyro(gyro_);
+	}
+}
+
 /**
  * \brief Reset sensors
 */
 void DriveTrain::ResetSensors() {	
 	if (gyro_enabled_) {
 		gyro_->Reset();
+		if (sensor_sampler_ != NULL) {
+			sensor_sampler_->DiscardSamples(gyro_sample_channel_);
+		}
+
+		// Keep the heading history relative to the new zero heading
+		for (int i = 0; i < heading_history_count_; i++) {
+			heading_history_[i].heading -= gyro_angle_;
+		}
+		gyro_angle_ = 0.0;
 	}
+	ResetDistance();
+	ResetProfile();
+}
+
+/**
+ * \brief Start measuring the distance traveled from zero again.
+*/
+void DriveTrain::ResetDistance() {
 	if (accelerometer_enabled_) {
-		acceleration_timer_->Reset();
+		odometry_->Reset();
 		distance_traveled_ = 0.0;
 	}
 }
 
+/**
+ * \brief Plan a new motion profile on the next call to Drive() or Turn().
+ *
+ * Called at the start of each distance or heading movement, so the profile
+ * is planned once from where the robot is then and followed in time.
+*/
+void DriveTrain::ResetProfile() {
+	profile_active_ = false;
+}
+
 /**
  * \brief Resets and restarts the timer for time based movement.
 */
@@ -380,16 +565,32 @@ void DriveTrain::SetRobotState(ProgramState state) {
 	if (timer_ != NULL) {
 		timer_->Stop();
 	}
+
+	// Start any feedback controlled movement over
+	if (drive_feedback_ != NULL) {
+		drive_feedback_->Reset();
+	}
+	if (turn_feedback_ != NULL) {
+		turn_feedback_->Reset();
+	}
+	ResetProfile();
+
+	// Start manual driving from a stop
+	if (linear_limiter_ != NULL) {
+		linear_limiter_->Reset(0.0);
+	}
+	if (turn_limiter_ != NULL) {
+		turn_limiter_->Reset(0.0);
+	}
+	if (left_limiter_ != NULL) {
+		left_limiter_->Reset(0.0);
+	}
+	if (right_limiter_ != NULL) {
+		right_limiter_->Reset(0.0);
+	}
 	
 	// On state change, reset distance traveled
-	if (accelerometer_enabled_) {
-		if (acceleration_timer_ != NULL) {
-			acceleration_timer_->Stop();
-			acceleration_timer_->Reset();
-			acceleration_timer_->Start();
-		}
-		distance_traveled_ = 0.0;
-	}
+	ResetDistance();
 	
 	if (state == kDisabled) {
 		robot_drive_->SetSafetyEnabled(true);
@@ -417,10 +618,10 @@ void DriveTrain::GetCurrentState(char * output_buffer) {
 void DriveTrain::LogCurrentState() {
 	if (log_ != NULL) {
 		if (gyro_enabled_)
-			log_->WriteValue("Gyro angle", gyro_angle_, true);
+			log_->WriteChannel(gyro_angle_channel_, gyro_angle_, true);
 		if (accelerometer_enabled_) {
-			log_->WriteValue("Acceleration", acceleration_, true);
-			log_->WriteValue("Distance traveled", distance_traveled_, true);
+			log_->WriteChannel(acceleration_channel_, acceleration_, true);
+			log_->WriteChannel(distance_traveled_channel_, distance_traveled_, true);
 		}
 	}
 }
@@ -458,6 +659,15 @@ bool DriveTrain::AdjustHeading(float adjustment, float speed) {
 		initial_heading_ = gyro_angle_;
 		adjustment_in_progress_ = true;
 	}
+
+	// Turn with the feedback controller if it's enabled
+	if (turn_feedback_enabled_ && turn_feedback_ != NULL && feedback_timer_ != NULL) {
+		if (ControlTurn(initial_heading_ + adjustment, speed)) {
+			adjustment_in_progress_ = false;
+			return true;
+		}
+		return false;
+	}
 	
 	float angle_remaining = 0.0;
 	float turn_direction = 0.0;
@@ -500,6 +710,8 @@ bool DriveTrain::AdjustHeading(float adjustment, float speed) {
 /**
  * \brief Drives forward/backward a distance provided by the argument.
  *
+ * The distance is measured from the last call to ResetDistance().
+ *
  * \param directional_length the distance in meters.
  * \param speed motor speed ratio.
  * \return true when the desired position has been reached.
@@ -509,6 +721,11 @@ bool DriveTrain::Drive(double directional_length, float speed) {
 	if (robot_drive_ == NULL || !accelerometer_enabled_) {
 		return true;
 	}
+
+	// Follow a motion profile with the feedback controller if it's enabled
+	if (drive_profile_enabled_ && drive_feedback_ != NULL && profile_ != NULL && feedback_timer_ != NULL) {
+		return ControlDrive(directional_length, speed);
+	}
 	
 	double distance_left = 0.0;
 	float direction_multiplier = 0.0;
@@ -630,36 +847,21 @@ void DriveTrain::Drive(float directional_speed, float directional_turn, bool tur
 		turn = normal_turning_speed_ratio_ * directional_turn;
 	}
 	
-	// Make sure the requested speed isn't too much of a change from the last request
+	// Make sure the requested speed isn't changing too fast
 	// This is to prevent tipping or jerky movement
 	// E.g., Going from Full reverse to full forward
-	// If the difference in the requested speed is greater than the threshold,
-	// throttle the request to only be 1 * maximum change from the previous value
-	if (fabs(linear - previous_linear_speed_) > maximum_linear_speed_change_) {
-		if ((linear - previous_linear_speed_) < 0)
-			linear = previous_linear_speed_ - maximum_linear_speed_change_;
-		else
-			linear = previous_linear_speed_ + maximum_linear_speed_change_;
-	}
-	if (fabs(turn - previous_turn_speed_) > maximum_turn_speed_change_) {
-		if ((turn - previous_turn_speed_) < 0)
-			turn = previous_turn_speed_ - maximum_turn_speed_change_;
-		else
-			turn = previous_turn_speed_ + maximum_turn_speed_change_;
+	// The limit is on the change each second rather than each call, so the
+	// robot speeds up the same however often the periodic loop runs
+	if (linear_limiter_ != NULL && turn_limiter_ != NULL && feedback_timer_ != NULL) {
+		double time = feedback_timer_->Get();
+		linear_limiter_->SetLimits(linear_slew_rate_, linear_slew_jerk_);
+		turn_limiter_->SetLimits(turn_slew_rate_, turn_slew_jerk_);
+		linear = linear_limiter_->Calculate(linear, time);
+		turn = turn_limiter_->Calculate(turn, time);
 	}
 
-	// Other method of smoothing acceleration
-	// Uses a simple LPF
-	// New speed = target speed - K * (target speed - current speed)
-	// Where K should be about 0.8? (higher = slower rate of change)
-	//linear = linear - linear_filter_constant_ * (linear - previous_linear_speed_);
-	//turn = turn - turn_filter_constant_ * (turn - previous_turn_speed_);
-	
 	robot_drive_->ArcadeDrive(linear, turn, false);
 	//robot_drive_->Drive(linear, turn);
-	
-	previous_linear_speed_ = linear;
-	previous_turn_speed_ = turn;
 }
 
 /**
@@ -687,6 +889,15 @@ void DriveTrain::TankDrive(float left_stick, float right_stick, bool turbo) {
 		left = normal_linear_speed_ratio_ * left_stick;
 		right = normal_linear_speed_ratio_ * right_stick;
 	}
+
+	// Limit how fast each side's speed changes each second, as Drive() does
+	if (left_limiter_ != NULL && right_limiter_ != NULL && feedback_timer_ != NULL) {
+		double time = feedback_timer_->Get();
+		left_limiter_->SetLimits(linear_slew_rate_, linear_slew_jerk_);
+		right_limiter_->SetLimits(linear_slew_rate_, linear_slew_jerk_);
+		left = left_limiter_->Calculate(left, time);
+		right = right_limiter_->Calculate(right, time);
+	}
 		
 	robot_drive_->TankDrive(left, right, false);	
 }
@@ -704,6 +915,11 @@ bool DriveTrain::Turn(float heading, float speed) {
 		return true;
 	}
 	
+	// Turn with the feedback controller if it's enabled
+	if (turn_feedback_enabled_ && turn_feedback_ != NULL && feedback_timer_ != NULL) {
+		return ControlTurn(heading, speed);
+	}
+
 	float angle_remaining = 0.0;
 	float turn_direction = 0.0;
 			
@@ -741,6 +957,102 @@ bool DriveTrain::Turn(float heading, float speed) {
 	}	
 }
 
+/**
+ * \brief Drives forward/backward a distance by following a motion profile with the feedback controller.
+ *
+ * The profile is planned on the first call after ResetProfile(), from the
+ * distance traveled then, and followed by the time since.  The distance is
+ * measured from the last call to ResetDistance().
+ *
+ * \param directional_length the distance in meters.
+ * \param speed the largest motor speed ratio, which also scales the profile's maximum velocity.
+ * \return true when the profile has finished and the robot has settled at the distance.
+*/
+bool DriveTrain::ControlDrive(double directional_length, float speed) {
+	// Pick up any changes to the parameters
+	drive_feedback_->SetGains(drive_proportional_gain_, drive_integral_gain_, drive_derivative_gain_,
+			drive_feedforward_gain_, drive_static_feedforward_);
+	drive_feedback_->SetOutputLimits(speed, drive_maximum_output_change_);
+	drive_feedback_->SetTolerance(distance_threshold_, drive_settle_rate_, drive_settle_time_);
+
+	// Plan the profile the first time through
+	double time = feedback_timer_->Get();
+	double length = fabs(directional_length);
+	if (!profile_active_ || profile_->GetEnd() != length) {
+		profile_->Generate(fabs(distance_traveled_), length, drive_maximum_velocity_ * speed,
+				drive_maximum_acceleration_);
+		profile_start_time_ = time;
+		profile_active_ = true;
+	}
+	motion_setpoint setpoint;
+	profile_->GetSetpoint(time - profile_start_time_, &setpoint);
+
+	// Positive output drives further in the requested direction
+	float output = drive_feedback_->Calculate(setpoint.position, setpoint.velocity, fabs(distance_traveled_), time);
+	if (time - profile_start_time_ >= profile_->GetDuration() && drive_feedback_->IsSettled()) {
+		robot_drive_->ArcadeDrive(0.0, 0.0, false);
+		drive_feedback_->Reset();
+		profile_active_ = false;
+		return true;
+	}
+	if (directional_length > 0) {
+		robot_drive_->ArcadeDrive(forward_direction_ * output, 0.0, false);
+	}
+	else {
+		robot_drive_->ArcadeDrive(backward_direction_ * output, 0.0, false);
+	}
+	return false;
+}
+
+/**
+ * \brief Turns left/right toward a heading using the feedback controller.
+ *
+ * With TURN_PROFILE_ENABLED set, the controller follows a motion profile
+ * planned on the first call after ResetProfile(), as ControlDrive() does.
+ *
+ * \param heading the desired heading in degrees.
+ * \param speed the largest motor speed ratio, which also scales the profile's maximum velocity.
+ * \return true when any profile has finished and the robot has settled at the heading.
+*/
+bool DriveTrain::ControlTurn(float heading, float speed) {
+	// Pick up any changes to the parameters
+	turn_feedback_->SetGains(turn_proportional_gain_, turn_integral_gain_, turn_derivative_gain_,
+			turn_feedforward_gain_, turn_static_feedforward_);
+	turn_feedback_->SetOutputLimits(speed, turn_maximum_output_change_);
+	turn_feedback_->SetTolerance(heading_threshold_, turn_settle_rate_, turn_settle_time_);
+
+	// Follow a motion profile to the heading if it's enabled, planned from the heading when the turn started
+	double time = feedback_timer_->Get();
+	motion_setpoint setpoint;
+	setpoint.position = heading;
+	bool profile_finished = true;
+	if (turn_profile_enabled_ && profile_ != NULL) {
+		if (!profile_active_ || profile_->GetEnd() != heading) {
+			profile_->Generate(gyro_angle_, heading, turn_maximum_velocity_ * speed, turn_maximum_acceleration_);
+			profile_start_time_ = time;
+			profile_active_ = true;
+		}
+		profile_->GetSetpoint(time - profile_start_time_, &setpoint);
+		profile_finished = time - profile_start_time_ >= profile_->GetDuration();
+	}
+
+	// Positive output turns toward a larger heading, which is right
+	float output = turn_feedback_->Calculate(setpoint.position, setpoint.velocity, gyro_angle_, time);
+	if (profile_finished && turn_feedback_->IsSettled()) {
+		robot_drive_->ArcadeDrive(0.0, 0.0, false);
+		turn_feedback_->Reset();
+		profile_active_ = false;
+		return true;
+	}
+	if (output > 0.0) {
+		robot_drive_->ArcadeDrive(0.0, right_direction_ * output, false);
+	}
+	else {
+		robot_drive_->ArcadeDrive(0.0, -left_direction_ * output, false);
+	}
+	return false;
+}
+
 /**
  * \brief Turns left/right for a time duration provided by the argument.
  *
@@ -805,3 +1117,35 @@ bool DriveTrain::Turn(double time, Direction direction, float speed) {
 float DriveTrain::GetHeading() {
 	return gyro_angle_;
 }
+
+/**
+ * \brief Returns the heading of the robot at an earlier time.
+ *
+ * Interpolates between the headings read by ReadSensors() before and after
+ * the time.  Times outside the history get the oldest or newest heading.
+ *
+ * \param timestamp the time in nanoseconds from LoopTimer::GetTimestamp().
+ * \return the robot heading in degrees at that time.
+*/
+float DriveTrain::GetHeadingAt(UINT64 timestamp) {
+	if (heading_history_count_ == 0) {
+		return gyro_angle_;
+	}
+
+	// Search back from the newest heading for the first one read before the time
+	int newer = -1;
+	for (int i = 1; i <= heading_history_count_; i++) {
+		int index = (heading_history_next_ - i + kHeadingHistorySize) % kHeadingHistorySize;
+		const heading_sample &sample = heading_history_[index];
+		if (sample.timestamp <= timestamp) {
+			if (newer < 0 || heading_history_[newer].timestamp == sample.timestamp) {
+				return sample.heading;
+			}
+			const heading_sample &next = heading_history_[newer];
+			float fraction = (float) (timestamp - sample.timestamp) / (float) (next.timestamp - sample.timestamp);
+			return sample.heading + (next.heading - sample.heading) * fraction;
+		}
+		newer = index;
+	}
+	return heading_history_[newer].heading;
+}
@@ -6,11 +6,18 @@
 // Forward class definitions
 class ADXL345_I2C;
 class DataLog;
+class FeedbackController;
 class Gyro;
 class Jaguar;
+class MotionProfile;
+class Odometry;
 class Parameters;
+class ParameterWatcher;
 class RobotDrive;
+class SensorSampler;
+class SlewRateLimiter;
 class Timer;
+template <class T> struct parameter_binding;
 
 
 /**
@@ -29,8 +36,12 @@ public:
 	DriveTrain(const char * parameters, bool logging_enabled);
 	~DriveTrain();
 	bool LoadParameters();
+	bool ReloadParameters(Parameters * parameters, ParameterWatcher * reload_log);
 	void ReadSensors();
+	void SetSensorSampler(SensorSampler * sampler);
 	void ResetSensors();
+	void ResetDistance();
+	void ResetProfile();
 	void ResetAndStartTimer();
 	void SetRobotState(ProgramState state);
 	void GetCurrentState(char * output_buffer);
@@ -44,14 +55,30 @@ public:
 	bool Turn(float heading, float speed);										// Turning via gyro
 	bool Turn(double time, Direction direction, float speed);					// Turning via time
 	float GetHeading();
+	float GetHeadingAt(UINT64 timestamp);
 
 	// Public member variables
 	bool accelerometer_enabled_;	///< true if the accelerometer is present and initialized
 	bool gyro_enabled_;				///< true if the gyro is present and initialized
 
 private:
+	// Private constants
+	static const int kHeadingHistorySize = 64;	///< number of headings kept, a little over a second of loops
+
+	/**
+	 * \struct heading_sample
+	 * \brief A heading and when it was read.
+	 */
+	struct heading_sample {
+		UINT64 timestamp;	///< time in nanoseconds from LoopTimer::GetTimestamp()
+		float heading;		///< heading in degrees
+	};
+
 	// Private methods
 	void Initialize(const char * parameters, bool logging_enabled);
+	static const parameter_binding<DriveTrain> * GetParameterBindings(int * count);
+	bool ControlDrive(double directional_length, float speed);
+	bool ControlTurn(float heading, float speed);
 		
 	// Private member objects
 	Jaguar *left_controller_;				///< motor controller used to move the left wheels
@@ -61,8 +88,17 @@ private:
 	Gyro *gyro_;							///< gyro used to track robot's current heading in degrees
 	DataLog *log_;							///< log object used to log data or status comments to a file
 	Parameters *parameters_;				///< parameters object used to load drive train parameters from a file
-	Timer *acceleration_timer_;				///< timer object used to calculate distance traveled using the accelerometer
+	Odometry *odometry_;					///< reads the accelerometer and gyro in a separate task to track the distance traveled
+	SensorSampler *sensor_sampler_;			///< reads the gyro at a fixed rate in a separate task, NULL to read it in ReadSensors()
 	Timer *timer_;							///< timer object used for timed autonomous functions
+	Timer *feedback_timer_;					///< timer object used to measure the time between feedback controller and slew rate limiter updates
+	FeedbackController *drive_feedback_;	///< works out the linear speed in Drive() when DRIVE_PROFILE_ENABLED is set
+	FeedbackController *turn_feedback_;		///< works out the turning speed in Turn() and AdjustHeading() when TURN_FEEDBACK_ENABLED is set
+	MotionProfile *profile_;				///< profile of the distance or heading being followed by Drive() or Turn()
+	SlewRateLimiter *linear_limiter_;		///< limits how fast the linear speed changes in Drive()
+	SlewRateLimiter *turn_limiter_;			///< limits how fast the turning speed changes in Drive()
+	SlewRateLimiter *left_limiter_;			///< limits how fast the left speed changes in TankDrive()
+	SlewRateLimiter *right_limiter_;		///< limits how fast the right speed changes in TankDrive()
 
 	// Private parameters
 	float normal_linear_speed_ratio_;		///< linear movement speed ratio (percentage) used during 'normal' mode
@@ -84,8 +120,10 @@ private:
 	int right_motor_inverted_;				///< specifies if the right motor controller should invert the movement direction of the motor
 	float linear_filter_constant_;			///< low pass filter constant used to smooth accelerations in linear movement
 	float turn_filter_constant_;			///< low pass filter constant used to smooth accelerations in turning movement
-	float maximum_linear_speed_change_;		///< maximum amount of change allowed in motor speed used to smooth accelerations during linear movement
-	float maximum_turn_speed_change_;		///< maximum amount of change allowed in motor speed used to smooth accelerations during turning movement
+	float linear_slew_rate_;				///< largest change in linear motor speed each second when driving manually, 0 for no limit
+	float linear_slew_jerk_;				///< largest change each second in how fast the linear motor speed is changing, 0 for no limit
+	float turn_slew_rate_;					///< largest change in turning motor speed each second when driving manually, 0 for no limit
+	float turn_slew_jerk_;					///< largest change each second in how fast the turning motor speed is changing, 0 for no limit
 	double time_threshold_;					///< time in seconds for autonomous functions to decide when the robot is 'close enough' to the timed movement
 	float auto_medium_time_threshold_;		///< time threshold between near and medium for autonomous functions
 	float auto_far_time_threshold_;			///< time threshold between medium and far for autonomous functions
@@ -96,16 +134,52 @@ private:
 	float auto_medium_heading_threshold_;	///< heading threshold between near and medium for autonomous functions
 	float auto_far_heading_threshold_;		///< heading threshold between medium and far for autonomous functions
 	int accelerometer_axis_;				///< accelerometer axis to use for linear distance calculations
+	int odometry_rate_;						///< number of times per second the odometry reads the accelerometer and gyro
+	float odometry_acceleration_noise_;		///< standard deviation in meters per second squared of each accelerometer reading
+	float odometry_bias_drift_;				///< how fast the accelerometer bias can change, in meters per second squared per square root of a second
+	float odometry_still_time_;				///< time in seconds the motors must be off before the robot can be standing still
+	float odometry_still_acceleration_;		///< largest acceleration in meters per second squared while standing still
+	float odometry_still_turn_rate_;		///< largest turn rate in degrees per second while standing still
+	int turn_feedback_enabled_;				///< 1 to turn to a heading with the feedback controller instead of the speed ratios
+	float turn_proportional_gain_;			///< turning speed for each degree from the set point
+	float turn_integral_gain_;				///< turning speed for each degree from the set point held for a second
+	float turn_derivative_gain_;			///< turning speed taken away for each degree per second the robot is turning
+	float turn_feedforward_gain_;			///< turning speed for each degree per second the set point is moving
+	float turn_static_feedforward_;			///< turning speed added toward the set point to overcome friction
+	float turn_maximum_output_change_;		///< largest change in the turning speed each second, 0 for no limit
+	float turn_settle_rate_;				///< largest turn rate in degrees per second at which the robot has settled
+	double turn_settle_time_;				///< time in seconds the heading must stay within the thresholds to have settled
+	int turn_profile_enabled_;				///< 1 to have the turn feedback controller follow a motion profile to the heading
+	float turn_maximum_velocity_;			///< fastest turn rate in degrees per second of the turn motion profile, at a speed of 1
+	float turn_maximum_acceleration_;		///< fastest change in turn rate in degrees per second squared of the turn motion profile
+	int drive_profile_enabled_;				///< 1 to drive a distance by following a motion profile with the feedback controller instead of the speed ratios
+	float drive_maximum_velocity_;			///< fastest speed in meters per second of the drive motion profile, at a speed of 1
+	float drive_maximum_acceleration_;		///< fastest change in speed in meters per second squared of the drive motion profile
+	float drive_proportional_gain_;			///< linear speed for each meter from the set point
+	float drive_integral_gain_;				///< linear speed for each meter from the set point held for a second
+	float drive_derivative_gain_;			///< linear speed taken away for each meter per second the robot is moving
+	float drive_feedforward_gain_;			///< linear speed for each meter per second the set point is moving
+	float drive_static_feedforward_;		///< linear speed added toward the set point to overcome friction
+	float drive_maximum_output_change_;		///< largest change in the linear speed each second, 0 for no limit
+	float drive_settle_rate_;				///< largest speed in meters per second at which the robot has settled
+	double drive_settle_time_;				///< time in seconds the distance must stay within the thresholds to have settled
 
 	// Private member variables
-	double acceleration_;			///< current acceleration of the specified axis
-	double distance_traveled_;		///< current distance traveled by the robot
+	double acceleration_;			///< current acceleration of the specified axis in meters per second squared, without the bias
+	double distance_traveled_;		///< current distance traveled by the robot in meters
 	float gyro_angle_;				///< current heading
 	float initial_heading_;			///< stores the initial heading of the robot when a heading adjustment is requested
-	float previous_linear_speed_;	///< stores the last known linear motor speed of the robot
-	float previous_turn_speed_;		///< stores the last known turning motor speed of the robot
 	bool adjustment_in_progress_;	///< true if a heading adjustment is in progress, false if it is a new request
+	bool profile_active_;			///< true if profile_ is being followed, false if the next Drive() or Turn() plans a new one
+	double profile_start_time_;		///< time on feedback_timer_ when profile_ was planned
 	bool log_enabled_;				///< true if logging is enabled
+	int gyro_angle_channel_;		///< log channel for the heading
+	int acceleration_channel_;		///< log channel for the acceleration
+	int distance_traveled_channel_;	///< log channel for the distance traveled
+	int gyro_sample_channel_;		///< sensor sampler channel of the gyro, -1 if it isn't sampled
+	heading_sample heading_history_[kHeadingHistorySize];	///< ring buffer of the headings read by ReadSensors()
+	int heading_history_count_;		///< number of headings in heading_history_
+	int heading_history_next_;		///< index in heading_history_ the next heading is written to
 	char parameters_file_[25];		///< path and filename of the parameter file to read
 	ProgramState robot_state_;		///< current state of the robot obtained from the field
 };
@@ -0,0 +1,174 @@
+#include <math.h>
+#include "feedbackcontroller.h"
+
+/**
+ * \def RESTART_STEP
+ * \brief Time in seconds between calls to Calculate() after which the controller starts over.
+ *
+ * A gap this long means the last movement was abandoned, so its integral and
+ * output are of no use to the next one.
+ */
+#define RESTART_STEP 0.25
+
+/**
+ * \brief Create the controller with no gains, so the output is always 0.
+*/
+FeedbackController::FeedbackController() {
+	SetGains(0.0, 0.0, 0.0, 0.0, 0.0);
+	SetOutputLimits(1.0, 0.0);
+	SetTolerance(0.0, 0.0, 0.0);
+	Reset();
+}
+
+/**
+ * \brief Nothing to clean up.
+*/
+FeedbackController::~FeedbackController() {
+}
+
+/**
+ * \brief Set how the output is worked out from the error.
+ *
+ * \param proportional output for each unit of error.
+ * \param integral output for each unit of error held for a second.
+ * \param derivative output taken away for each unit per second the measurement is moving.
+ * \param feedforward output for each unit per second the set point is moving.
+ * \param static_feedforward output added in the direction of the error while outside the tolerance.
+*/
+void FeedbackController::SetGains(float proportional, float integral, float derivative, float feedforward,
+		float static_feedforward) {
+	proportional_gain_ = proportional;
+	integral_gain_ = integral;
+	derivative_gain_ = derivative;
+	feedforward_gain_ = feedforward;
+	static_feedforward_ = static_feedforward;
+}
+
+/**
+ * \brief Set the limits on the output.
+ *
+ * \param maximum_output largest output in either direction.
+ * \param maximum_output_change largest change in the output each second, 0 for no limit.
+*/
+void FeedbackController::SetOutputLimits(float maximum_output, float maximum_output_change) {
+	maximum_output_ = fabs(maximum_output);
+	maximum_output_change_ = maximum_output_change;
+}
+
+/**
+ * \brief Set when the mechanism is taken to have reached the set point.
+ *
+ * \param tolerance largest error at which the mechanism can be settled.
+ * \param rate_tolerance largest rate of change of the measurement, in units per second, at which it can be settled.
+ * \param settle_time time in seconds both must stay within the tolerances.
+*/
+void FeedbackController::SetTolerance(float tolerance, float rate_tolerance, double settle_time) {
+	tolerance_ = tolerance;
+	rate_tolerance_ = rate_tolerance;
+	settle_time_ = settle_time;
+}
+
+/**
+ * \brief Start over, such as when a movement is finished.
+ *
+ * The next Calculate() starts with no integral, and with the output
+ * changing from 0.
+*/
+void FeedbackController::Reset() {
+	running_ = false;
+	previous_time_ = 0.0;
+	previous_measurement_ = 0.0;
+	integral_ = 0.0;
+	output_ = 0.0;
+	error_ = 0.0;
+	measurement_rate_ = 0.0;
+	settled_time_ = 0.0;
+}
+
+/**
+ * \brief Work out the output for the latest measurement.
+ *
+ * \param setpoint where the mechanism should be.
+ * \param setpoint_rate how fast the set point is moving, in units per second.
+ * \param measurement where the mechanism is.
+ * \param time the current time in seconds, from a clock that keeps running between calls.
+ * \return the output, within the output limits.
+*/
+float FeedbackController::Calculate(float setpoint, float setpoint_rate, float measurement, double time) {
+	double step = time - previous_time_;
+	error_ = setpoint - measurement;
+
+	// Start over on the first call, or if the last movement was abandoned
+	if (!running_ || step <= 0.0 || step > RESTART_STEP) {
+		running_ = true;
+		integral_ = 0.0;
+		output_ = 0.0;
+		measurement_rate_ = 0.0;
+		settled_time_ = 0.0;
+		step = 0.0;
+	}
+	else {
+		measurement_rate_ = (measurement - previous_measurement_) / step;
+	}
+	previous_time_ = time;
+	previous_measurement_ = measurement;
+
+	// Everything but the integral
+	float output = proportional_gain_ * error_ - derivative_gain_ * measurement_rate_ + feedforward_gain_ * setpoint_rate;
+	if (fabs(error_) > tolerance_) {
+		output += error_ > 0.0 ? static_feedforward_ : -static_feedforward_;
+	}
+
+	// Only integrate if it won't push the output further past its limit
+	float integral = integral_ + error_ * step;
+	float unlimited = output + integral_gain_ * integral;
+	if ((unlimited <= maximum_output_ || error_ < 0.0) && (unlimited >= -maximum_output_ || error_ > 0.0)) {
+		integral_ = integral;
+	}
+	output += integral_gain_ * integral_;
+
+	// Limit the size of the output, then how fast it changes
+	if (output > maximum_output_) {
+		output = maximum_output_;
+	}
+	else if (output < -maximum_output_) {
+		output = -maximum_output_;
+	}
+	if (maximum_output_change_ > 0.0) {
+		float maximum_change = maximum_output_change_ * step;
+		if (output > output_ + maximum_change) {
+			output = output_ + maximum_change;
+		}
+		else if (output < output_ - maximum_change) {
+			output = output_ - maximum_change;
+		}
+	}
+	output_ = output;
+
+	// Settled once the error and rate have stayed small for long enough
+	if (fabs(error_) <= tolerance_ && fabs(measurement_rate_) <= rate_tolerance_) {
+		settled_time_ += step;
+	}
+	else {
+		settled_time_ = 0.0;
+	}
+	return output_;
+}
+
+/**
+ * \brief Check if the mechanism has reached the set point and stayed there.
+ *
+ * \return true if the error and its rate have stayed within the tolerances for the settle time.
+*/
+bool FeedbackController::IsSettled() {
+	return running_ && fabs(error_) <= tolerance_ && settled_time_ >= settle_time_;
+}
+
+/**
+ * \brief Get the error at the last Calculate().
+ *
+ * \return the set point less the measurement.
+*/
+float FeedbackController::GetError() {
+	return error_;
+}
@@ -0,0 +1,62 @@
+#ifndef FEEDBACKCONTROLLER_H_
+#define FEEDBACKCONTROLLER_H_
+
+/**
+ * \class FeedbackController
+ * \brief Works out a motor output to move a mechanism to a set point and hold it there.
+ *
+ * The output is the sum of a proportional, integral and derivative term on
+ * the error, a feedforward term on how fast the set point is moving, and a
+ * static feedforward term that overcomes friction in the direction of the
+ * error.  The derivative is taken on the measurement rather than the error,
+ * so moving the set point doesn't kick the output.  The integral stops
+ * growing while the output is at its limit and the error would push it
+ * further, so it doesn't wind up while the mechanism is catching up.  The
+ * output is limited in size, and in how fast it can change.
+ *
+ * Calculate() is called once each periodic loop with the time, and the
+ * integral and derivative use the time that actually passed.  The
+ * mechanism has settled once the error and its rate of change have stayed
+ * within the tolerances for the settle time.  Nothing here uses WPILib, so
+ * the controller can be run against a simulated plant on the development
+ * computer.
+ */
+class FeedbackController {
+
+public:
+	// Public methods
+	FeedbackController();
+	~FeedbackController();
+	void SetGains(float proportional, float integral, float derivative, float feedforward, float static_feedforward);
+	void SetOutputLimits(float maximum_output, float maximum_output_change);
+	void SetTolerance(float tolerance, float rate_tolerance, double settle_time);
+	void Reset();
+	float Calculate(float setpoint, float setpoint_rate, float measurement, double time);
+	bool IsSettled();
+	float GetError();
+
+private:
+	// Private parameters
+	float proportional_gain_;		///< output for each unit of error
+	float integral_gain_;			///< output for each unit of error held for a second
+	float derivative_gain_;			///< output for each unit per second the measurement is moving, taken away from the output
+	float feedforward_gain_;		///< output for each unit per second the set point is moving
+	float static_feedforward_;		///< output added in the direction of the error to overcome friction, while outside the tolerance
+	float maximum_output_;			///< largest output in either direction
+	float maximum_output_change_;	///< largest change in the output each second, 0 for no limit
+	float tolerance_;				///< largest error at which the mechanism can be settled
+	float rate_tolerance_;			///< largest rate of change of the measurement, in units per second, at which the mechanism can be settled
+	double settle_time_;			///< time in seconds the error must stay within the tolerances to be settled
+
+	// Private member variables
+	bool running_;					///< false until Calculate() is called after a Reset()
+	double previous_time_;			///< time passed to the last Calculate()
+	float previous_measurement_;	///< measurement passed to the last Calculate()
+	float integral_;				///< sum of the error multiplied by the time it was held
+	float output_;					///< output returned by the last Calculate()
+	float error_;					///< set point less the measurement at the last Calculate()
+	float measurement_rate_;		///< rate of change of the measurement in units per second at the last Calculate()
+	double settled_time_;			///< time in seconds the error has stayed within the tolerances
+};
+
+#endif
@@ -32,7 +32,7 @@ Feeder::Feeder(bool logging_enabled) {
  *
  * \param parameters feeder parameter file path and name.
 */
-Feeder::Feeder(char * parameters) {
+Feeder::Feeder(const char * parameters) {
 	Initialize(parameters, false);
 }
 
@@ -45,7 +45,7 @@ Feeder::Feeder(char * parameters) {
  * \param parameters feeder parameter file path and name.
  * \param logging_enabled true if logging is enabled.
 */
-Feeder::Feeder(char * parameters, bool logging_enabled) {
+Feeder::Feeder(const char * parameters, bool logging_enabled) {
 	Initialize(parameters, logging_enabled);
 }
 
@@ -70,7 +70,7 @@ Feeder::~Feeder() {
  * \param parameters feeder parameter file path and name.
  * \param logging_enabled true if logging is enabled.
 */
-void Feeder::Initialize(char * parameters, bool logging_enabled) {
+void Feeder::Initialize(const char * parameters, bool logging_enabled) {
 	// Initialize public member variables
 	feeder_enabled_ = false;
 	compressor_enabled_ = false;
@@ -100,7 +100,8 @@ void Feeder::Initialize(char * parameters, bool logging_enabled) {
 	}
 	
 	// Attempt to read the parameters file
-	strncpy(parameters_file_, parameters, sizeof(parameters_file_));
+	strncpy(parameters_file_, parameters, sizeof(parameters_file_) - 1);
+	parameters_file_[sizeof(parameters_file_) - 1] = 0;
 
 	LoadParameters();
 }
@@ -21,8 +21,8 @@ public:
 	// Public methods
 	Feeder();
 	Feeder(bool logging_enabled);
-	Feeder(char * parameters);
-	Feeder(char * parameters, bool logging_enabled);
+	Feeder(const char * parameters);
+	Feeder(const char * parameters, bool logging_enabled);
 	~Feeder();
 	bool LoadParameters();
 	void SetRobotState(ProgramState state);
@@ -36,7 +36,7 @@ public:
 
 private:
 	// Private methods
-	void Initialize(char * parameters, bool logging_enabled);
+	void Initialize(const char * parameters, bool logging_enabled);
 
 	// Private member objects
 	Compressor *compressor_;		///< compressor object to control the compressor
@@ -0,0 +1,303 @@
+#include <string.h>
+#include "common.h"
+#include "framerecording.h"
+
+/**
+ * \def FRAMERECORDING_VERSION
+ * \brief The version of the frame format written.
+ */
+#define FRAMERECORDING_VERSION 1
+
+/**
+ * \brief Create the recording with no file open.
+*/
+FrameRecording::FrameRecording() {
+	file_ = NULL;
+	file_opened_ = false;
+	swap_ = false;
+	planes_ = NULL;
+	compressed_ = NULL;
+	buffer_pixels_ = 0;
+}
+
+/**
+ * \brief Close the file and delete the buffers.
+*/
+FrameRecording::~FrameRecording() {
+	Close();
+	SafeDeleteArray(planes_);
+	SafeDeleteArray(compressed_);
+}
+
+/**
+ * \brief Create a new recording file, replacing any file with the same name.
+ *
+ * \param path the path and filename of the file.
+ * \return true if successful.
+*/
+bool FrameRecording::OpenForWrite(const char * path) {
+	Close();
+	file_ = fopen(path, "wb");
+	if (file_ == NULL) {
+		return false;
+	}
+
+	framerecording_header header;
+	memset(&header, 0, sizeof(header));
+	strncpy(header.magic, "TJFRAME", sizeof(header.magic));
+	header.byte_order = 0x01020304;
+	header.version = FRAMERECORDING_VERSION;
+	if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+		Close();
+		return false;
+	}
+	file_opened_ = true;
+	return true;
+}
+
+/**
+ * \brief Open a recording file to read its frames.
+ *
+ * \param path the path and filename of the file.
+ * \return true if successful and the file is a frame recording.
+*/
+bool FrameRecording::OpenForRead(const char * path) {
+	Close();
+	file_ = fopen(path, "rb");
+	if (file_ == NULL) {
+		return false;
+	}
+
+	framerecording_header header;
+	if (fread(&header, sizeof(header), 1, file_) != 1 || strncmp(header.magic, "TJFRAME", sizeof(header.magic)) != 0) {
+		Close();
+		return false;
+	}
+	swap_ = (header.byte_order != 0x01020304);
+	if (swap_) {
+		SwapBytes(&header.byte_order, sizeof(header.byte_order));
+		SwapBytes(&header.version, sizeof(header.version));
+	}
+	if (header.byte_order != 0x01020304 || header.version != FRAMERECORDING_VERSION) {
+		Close();
+		return false;
+	}
+	file_opened_ = true;
+	return true;
+}
+
+/**
+ * \brief Close the file.
+*/
+void FrameRecording::Close() {
+	if (file_ != NULL) {
+		fclose(file_);
+		file_ = NULL;
+	}
+	file_opened_ = false;
+}
+
+/**
+ * \brief Compress a frame and add it to the file.
+ *
+ * \param pixels the first pixel of the frame, 4 bytes each in blue, green, red, alpha order.
+ * \param width the width of the frame in pixels.
+ * \param height the height of the frame in pixels.
+ * \param pixels_per_line the distance in pixels from the start of one line to the next.
+ * \param capture_timestamp the time in nanoseconds when the frame was taken.
+ * \return true if successful.
+*/
+bool FrameRecording::WriteFrame(const unsigned char * pixels, int width, int height, int pixels_per_line,
+		unsigned long long capture_timestamp) {
+	if (!file_opened_ || pixels == NULL || width <= 0 || height <= 0 || !AllocateBuffers(width * height)) {
+		return false;
+	}
+
+	// Split the frame into planes, dropping the alpha byte
+	int pixel_count = width * height;
+	for (int y = 0; y < height; y++) {
+		const unsigned char * line = pixels + y * pixels_per_line * 4;
+		for (int x = 0; x < width; x++) {
+			int index = y * width + x;
+			planes_[index] = line[x * 4];
+			planes_[pixel_count + index] = line[x * 4 + 1];
+			planes_[pixel_count * 2 + index] = line[x * 4 + 2];
+		}
+	}
+
+	framerecording_frame frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.capture_timestamp = capture_timestamp;
+	frame.width = width;
+	frame.height = height;
+	frame.compressed_size = PackBits(planes_, pixel_count * 3, compressed_);
+	if (fwrite(&frame, sizeof(frame), 1, file_) != 1 ||
+			fwrite(compressed_, 1, frame.compressed_size, file_) != frame.compressed_size) {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * \brief Read the next frame from the file.
+ *
+ * \param pixels the buffer to fill, 4 bytes per pixel in blue, green, red, alpha order, one line after another.
+ * \param maximum_pixels the number of pixels the buffer has room for.
+ * \param width set to the width of the frame in pixels.
+ * \param height set to the height of the frame in pixels.
+ * \param capture_timestamp set to the time in nanoseconds when the frame was taken.
+ * \return true if a frame was read, false at the end of the file or if the frame is damaged or too large.
+*/
+bool FrameRecording::ReadFrame(unsigned char * pixels, int maximum_pixels, int * width, int * height,
+		unsigned long long * capture_timestamp) {
+	framerecording_frame frame;
+	if (!file_opened_ || pixels == NULL || fread(&frame, sizeof(frame), 1, file_) != 1) {
+		return false;
+	}
+	if (swap_) {
+		SwapBytes(&frame.capture_timestamp, sizeof(frame.capture_timestamp));
+		SwapBytes(&frame.width, sizeof(frame.width));
+		SwapBytes(&frame.height, sizeof(frame.height));
+		SwapBytes(&frame.compressed_size, sizeof(frame.compressed_size));
+	}
+
+	int pixel_count = frame.width * frame.height;
+	if (frame.width == 0 || frame.height == 0 || frame.width > 32767 || frame.height > 32767 ||
+			pixel_count > maximum_pixels || !AllocateBuffers(pixel_count) ||
+			(int) frame.compressed_size > PackBitsBound(pixel_count * 3) ||
+			fread(compressed_, 1, frame.compressed_size, file_) != frame.compressed_size ||
+			UnpackBits(compressed_, frame.compressed_size, planes_, pixel_count * 3) != pixel_count * 3) {
+		return false;
+	}
+
+	// Put the planes back together
+	for (int i = 0; i < pixel_count; i++) {
+		pixels[i * 4] = planes_[i];
+		pixels[i * 4 + 1] = planes_[pixel_count + i];
+		pixels[i * 4 + 2] = planes_[pixel_count * 2 + i];
+		pixels[i * 4 + 3] = 0;
+	}
+	*width = frame.width;
+	*height = frame.height;
+	*capture_timestamp = frame.capture_timestamp;
+	return true;
+}
+
+/**
+ * \brief Compress data with PackBits.
+ *
+ * Each block starts with a count byte.  0 to 127 means that many plus one
+ * bytes follow as they are.  129 to 255 means the next byte is repeated 257
+ * minus the count times.
+ *
+ * \param input the data to compress.
+ * \param length the number of bytes of data.
+ * \param output the buffer for the compressed data, with room for PackBitsBound(length) bytes.
+ * \return the number of bytes of compressed data.
+*/
+int FrameRecording::PackBits(const unsigned char * input, int length, unsigned char * output) {
+	int output_length = 0;
+	int i = 0;
+	while (i < length) {
+		// Repeat runs of 3 or more bytes
+		int run = 1;
+		while (i + run < length && run < 128 && input[i + run] == input[i])
+			run++;
+		if (run >= 3) {
+			output[output_length++] = (unsigned char) (257 - run);
+			output[output_length++] = input[i];
+			i += run;
+			continue;
+		}
+
+		// Copy everything else up to the next run
+		int start = i;
+		while (i < length && i - start < 128 &&
+				!(i + 2 < length && input[i] == input[i + 1] && input[i] == input[i + 2]))
+			i++;
+		output[output_length++] = (unsigned char) (i - start - 1);
+		memcpy(output + output_length, input + start, i - start);
+		output_length += i - start;
+	}
+	return output_length;
+}
+
+/**
+ * \brief Decompress data compressed with PackBits.
+ *
+ * \param input the compressed data.
+ * \param input_length the number of bytes of compressed data.
+ * \param output the buffer for the data.
+ * \param length the number of bytes the buffer has room for.
+ * \return the number of bytes of data, or -1 if the compressed data is damaged or too long.
+*/
+int FrameRecording::UnpackBits(const unsigned char * input, int input_length, unsigned char * output, int length) {
+	int output_length = 0;
+	int i = 0;
+	while (i < input_length) {
+		int count = input[i++];
+		if (count < 128) {
+			count++;
+			if (i + count > input_length || output_length + count > length)
+				return -1;
+			memcpy(output + output_length, input + i, count);
+			i += count;
+			output_length += count;
+		}
+		else if (count > 128) {
+			count = 257 - count;
+			if (i >= input_length || output_length + count > length)
+				return -1;
+			memset(output + output_length, input[i++], count);
+			output_length += count;
+		}
+	}
+	return output_length;
+}
+
+/**
+ * \brief Get the most bytes PackBits() can produce.
+ *
+ * \param length the number of bytes of data.
+ * \return the size of the buffer needed for the compressed data.
+*/
+int FrameRecording::PackBitsBound(int length) {
+	return length + (length + 127) / 128;
+}
+
+/**
+ * \brief Make sure the buffers have room for a frame.
+ *
+ * \param pixel_count the number of pixels in the frame.
+ * \return true if successful.
+*/
+bool FrameRecording::AllocateBuffers(int pixel_count) {
+	if (pixel_count <= buffer_pixels_) {
+		return true;
+	}
+	SafeDeleteArray(planes_);
+	SafeDeleteArray(compressed_);
+	buffer_pixels_ = 0;
+	planes_ = new unsigned char[pixel_count * 3];
+	compressed_ = new unsigned char[PackBitsBound(pixel_count * 3)];
+	if (planes_ == NULL || compressed_ == NULL) {
+		return false;
+	}
+	buffer_pixels_ = pixel_count;
+	return true;
+}
+
+/**
+ * \brief Reverse the byte order of a value in place.
+ *
+ * \param data pointer to the value.
+ * \param size size of the value in bytes.
+*/
+void FrameRecording::SwapBytes(void * data, unsigned int size) {
+	unsigned char * bytes = (unsigned char *) data;
+	for (unsigned int i = 0; i < size / 2; i++) {
+		unsigned char temp = bytes[i];
+		bytes[i] = bytes[size - 1 - i];
+		bytes[size - 1 - i] = temp;
+	}
+}
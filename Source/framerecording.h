@@ -0,0 +1,73 @@
+#ifndef FRAMERECORDING_H_
+#define FRAMERECORDING_H_
+
+#include <stdio.h>
+
+/**
+ * Data structure at the start of a frame recording file.
+ */
+struct framerecording_header {
+	char magic[8];				///< "TJFRAME" file identifier
+	unsigned int byte_order;	///< 0x01020304 written in the byte order of the robot
+	unsigned int version;		///< version of the frame format
+};
+
+/**
+ * Data structure before each frame of a frame recording file.
+ *
+ * The frame follows as the blue, green and red planes one after another,
+ * together compressed with PackBits.
+ */
+struct framerecording_frame {
+	unsigned long long capture_timestamp;	///< time in nanoseconds from LoopTimer::GetTimestamp() when the frame was taken
+	unsigned int width;						///< width of the frame in pixels
+	unsigned int height;					///< height of the frame in pixels
+	unsigned int compressed_size;			///< number of bytes of compressed frame data that follow
+	unsigned int reserved;					///< pads the structure to a multiple of 8 bytes
+};
+
+/**
+ * \class FrameRecording
+ * \brief Writes camera frames to a file, or reads them back.
+ *
+ * Frames are stored without the alpha byte, one color plane at a time,
+ * since each plane of an image of mostly dark background compresses well
+ * with PackBits.  Like the binary DataLog format, values are written in
+ * the byte order of the computer writing them and the reader swaps them if
+ * needed.  The buffers are created for the first frame and only replaced
+ * when a larger frame comes along.
+ */
+class FrameRecording {
+
+public:
+	// Public methods
+	FrameRecording();
+	~FrameRecording();
+	bool OpenForWrite(const char * path);
+	bool OpenForRead(const char * path);
+	void Close();
+	bool WriteFrame(const unsigned char * pixels, int width, int height, int pixels_per_line,
+			unsigned long long capture_timestamp);
+	bool ReadFrame(unsigned char * pixels, int maximum_pixels, int * width, int * height,
+			unsigned long long * capture_timestamp);
+	static int PackBits(const unsigned char * input, int length, unsigned char * output);
+	static int UnpackBits(const unsigned char * input, int input_length, unsigned char * output, int length);
+	static int PackBitsBound(int length);
+
+	// Public member variables
+	bool file_opened_;			///< true if the file was opened successfully
+
+private:
+	// Private methods
+	bool AllocateBuffers(int pixel_count);
+	static void SwapBytes(void * data, unsigned int size);
+
+	// Private member variables
+	FILE *file_;				///< file being written or read
+	bool swap_;					///< true if the file being read has the other byte order
+	unsigned char *planes_;		///< one frame as separate color planes
+	unsigned char *compressed_;	///< one compressed frame
+	int buffer_pixels_;			///< number of pixels the buffers have room for
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <string.h>
+#include <vxLib.h>
+#include "WPILib.h"
+#include "datalog.h"
+#include "looptimer.h"
+
+/**
+ * \def TIME_BASE_FREQUENCY
+ * \brief The rate in Hz of the processor time base.
+ *
+ * The cRIO's PowerPC time base runs at a quarter of its 132 MHz bus clock.
+ */
+#define TIME_BASE_FREQUENCY 33000000
+
+/**
+ * \brief Create the loop timer with no probes.
+*/
+LoopTimer::LoopTimer() {
+	for (int i = 0; i < kMaxProbes; i++) {
+		names_[i][0] = 0;
+		budgets_[i] = 0;
+	}
+	probe_count_ = 0;
+	Reset();
+}
+
+/**
+ * \brief Nothing to clean up, all storage is part of the object.
+*/
+LoopTimer::~LoopTimer() {
+}
+
+/**
+ * \brief Get the current time from the processor time base.
+ *
+ * \return the time in nanoseconds since the processor started.
+*/
+UINT64 LoopTimer::GetTimestamp() {
+	UINT64 ticks = GetTicks();
+	return (ticks / TIME_BASE_FREQUENCY) * 1000000000ULL +
+			((ticks % TIME_BASE_FREQUENCY) * 1000000000ULL) / TIME_BASE_FREQUENCY;
+}
+
+/**
+ * \brief Add a probe.
+ *
+ * \param name the name used for the probe in the summary.
+ * \return the probe index to pass to the other functions, or -1 if no more probes can be added.
+*/
+int LoopTimer::RegisterProbe(const char * name) {
+	if (name == NULL || probe_count_ >= kMaxProbes) {
+		return -1;
+	}
+
+	int probe = probe_count_;
+	strncpy(names_[probe], name, kMaxName - 1);
+	names_[probe][kMaxName - 1] = 0;
+	probe_count_++;
+	return probe;
+}
+
+/**
+ * \brief Set how long a probe is allowed to take before it counts as an overrun.
+ *
+ * \param probe the probe index.
+ * \param seconds the time allowed, 0 for no limit.
+*/
+void LoopTimer::SetBudget(int probe, double seconds) {
+	if (probe < 0 || probe >= probe_count_) {
+		return;
+	}
+	budgets_[probe] = seconds > 0.0 ? (UINT32) (std::min(seconds, 4.0) * 1000000000.0) : 0;
+}
+
+/**
+ * \brief Start timing a probe.
+ *
+ * \param probe the probe index.
+*/
+void LoopTimer::Start(int probe) {
+	if (probe < 0 || probe >= probe_count_) {
+		return;
+	}
+	start_ticks_[probe] = GetTicks();
+}
+
+/**
+ * \brief Stop timing a probe and add the time to its histogram.
+ *
+ * \param probe the probe index.
+ * \return true if the probe took longer than its budget.
+*/
+bool LoopTimer::Stop(int probe) {
+	if (probe < 0 || probe >= probe_count_ || start_ticks_[probe] == 0) {
+		return false;
+	}
+
+	UINT64 ticks = GetTicks() - start_ticks_[probe];
+	start_ticks_[probe] = 0;
+	UINT64 nanoseconds = (ticks * 1000000ULL) / (TIME_BASE_FREQUENCY / 1000);
+	return AddSample(probe, nanoseconds > 0xFFFFFFFFULL ? 0xFFFFFFFF : (UINT32) nanoseconds);
+}
+
+/**
+ * \brief Add a time measured some other way to a probe's histogram.
+ *
+ * \param probe the probe index.
+ * \param nanoseconds the time.
+ * \return true if the time is longer than the probe's budget.
+*/
+bool LoopTimer::AddSample(int probe, UINT32 nanoseconds) {
+	if (probe < 0 || probe >= probe_count_) {
+		return false;
+	}
+
+	last_times_[probe] = nanoseconds;
+	if (nanoseconds > maximum_times_[probe])
+		maximum_times_[probe] = nanoseconds;
+	total_times_[probe] += nanoseconds;
+	counts_[probe]++;
+	buckets_[probe][GetBucket(nanoseconds)]++;
+
+	if (budgets_[probe] > 0 && nanoseconds > budgets_[probe]) {
+		overruns_[probe]++;
+		// Keep the details for the summary instead of logging them in the loop
+		if (overrun_list_count_ < kMaxOverruns) {
+			overrun_list_[overrun_list_count_].probe = probe;
+			overrun_list_[overrun_list_count_].nanoseconds = nanoseconds;
+			overrun_list_[overrun_list_count_].time = GetFPGATime() / 1000;
+			overrun_list_count_++;
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+ * \brief Get the time of the last sample of a probe.
+ *
+ * \param probe the probe index.
+ * \return the time in nanoseconds.
+*/
+UINT32 LoopTimer::GetLastTime(int probe) {
+	if (probe < 0 || probe >= probe_count_) {
+		return 0;
+	}
+	return last_times_[probe];
+}
+
+/**
+ * \brief Get a percentile of the times of a probe.
+ *
+ * The result is the upper limit of the histogram bucket the percentile
+ * falls in, so it's up to 25% above the actual time.
+ *
+ * \param probe the probe index.
+ * \param percentile the fraction of samples at or below the result, 0.5 for the median.
+ * \return the time in nanoseconds, or 0 if there are no samples.
+*/
+UINT32 LoopTimer::GetPercentile(int probe, double percentile) {
+	if (probe < 0 || probe >= probe_count_ || counts_[probe] == 0) {
+		return 0;
+	}
+
+	UINT32 rank = (UINT32) (percentile * counts_[probe] + 0.999999);
+	if (rank < 1)
+		rank = 1;
+	UINT32 samples = 0;
+	for (int i = 0; i < kBucketCount; i++) {
+		samples += buckets_[probe][i];
+		if (samples >= rank) {
+			return std::min(GetBucketLimit(i), maximum_times_[probe]);
+		}
+	}
+	return maximum_times_[probe];
+}
+
+/**
+ * \brief Write the statistics of each probe to a log, then clear them.
+ *
+ * The first kMaxOverruns overruns are listed after the statistics.  Call
+ * it outside of the periodic loops, such as when the mode changes.
+ *
+ * \param log the log to write to.
+*/
+void LoopTimer::WriteSummary(DataLog * log) {
+	char line[160];
+
+	if (log != NULL) {
+		for (int i = 0; i < probe_count_; i++) {
+			if (counts_[i] == 0)
+				continue;
+			sprintf(line, "Loop timing %s: count %u, avg %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us, overruns %u\n",
+					names_[i], counts_[i], (double) total_times_[i] / counts_[i] / 1000.0,
+					GetPercentile(i, 0.5) / 1000.0, GetPercentile(i, 0.99) / 1000.0,
+					maximum_times_[i] / 1000.0, overruns_[i]);
+			log->WriteLine(line);
+		}
+		for (int i = 0; i < overrun_list_count_; i++) {
+			const loop_overrun &overrun = overrun_list_[i];
+			sprintf(line, "Loop overrun %s: %.1f us at %u ms\n", names_[overrun.probe],
+					overrun.nanoseconds / 1000.0, overrun.time);
+			log->WriteLine(line);
+		}
+	}
+	Reset();
+}
+
+/**
+ * \brief Clear the statistics of every probe.
+*/
+void LoopTimer::Reset() {
+	for (int i = 0; i < kMaxProbes; i++) {
+		start_ticks_[i] = 0;
+		last_times_[i] = 0;
+		maximum_times_[i] = 0;
+		total_times_[i] = 0;
+		counts_[i] = 0;
+		overruns_[i] = 0;
+		memset(buckets_[i], 0, sizeof(buckets_[i]));
+	}
+	overrun_list_count_ = 0;
+}
+
+/**
+ * \brief Read the processor time base.
+ *
+ * \return the number of time base ticks since the processor started.
+*/
+UINT64 LoopTimer::GetTicks() {
+	UINT32 upper = 0;
+	UINT32 lower = 0;
+	vxTimeBaseGet(&upper, &lower);
+	return ((UINT64) upper << 32) | lower;
+}
+
+/**
+ * \brief Find the histogram bucket for a time.
+ *
+ * Times under 4 ns get their own bucket.  Above that, each power of two
+ * is split into four buckets using the two bits below the highest set bit.
+ *
+ * \param nanoseconds the time.
+ * \return the bucket index.
+*/
+int LoopTimer::GetBucket(UINT32 nanoseconds) {
+	if (nanoseconds < kBucketsPerOctave) {
+		return nanoseconds;
+	}
+	int octave = 31 - __builtin_clz(nanoseconds);
+	int sub_bucket = (nanoseconds >> (octave - 2)) & (kBucketsPerOctave - 1);
+	return octave * kBucketsPerOctave + sub_bucket;
+}
+
+/**
+ * \brief Find the longest time that goes in a histogram bucket.
+ *
+ * \param bucket the bucket index.
+ * \return the time in nanoseconds.
+*/
+UINT32 LoopTimer::GetBucketLimit(int bucket) {
+	if (bucket < kBucketsPerOctave) {
+		return bucket;
+	}
+	int octave = bucket / kBucketsPerOctave;
+	int sub_bucket = bucket % kBucketsPerOctave;
+	return (UINT32) ((((UINT64) (kBucketsPerOctave + sub_bucket + 1)) << (octave - 2)) - 1);
+}
+
+/**
+ * \brief Start timing a probe.
+ *
+ * \param loop_timer the loop timer the probe belongs to.
+ * \param probe the probe index.
+*/
+LoopTimerProbe::LoopTimerProbe(LoopTimer * loop_timer, int probe) {
+	loop_timer_ = loop_timer;
+	probe_ = probe;
+	if (loop_timer_ != NULL)
+		loop_timer_->Start(probe_);
+}
+
+/**
+ * \brief Stop timing the probe.
+*/
+LoopTimerProbe::~LoopTimerProbe() {
+	if (loop_timer_ != NULL)
+		loop_timer_->Stop(probe_);
+}
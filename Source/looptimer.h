@@ -0,0 +1,96 @@
+#ifndef LOOPTIMER_H_
+#define LOOPTIMER_H_
+
+#include "WPILib.h"
+#include "common.h"
+
+// Forward class definitions
+class DataLog;
+
+/**
+ * \class LoopTimer
+ * \brief Measures how long parts of the periodic loops take.
+ *
+ * Each timed part of the loop is a probe, registered once by name.  The
+ * time spent in a probe is read from the processor time base in
+ * nanoseconds and added to a histogram with four buckets per power of
+ * two, so the median, 99th percentile and maximum can be reported without
+ * storing every sample.  All storage is allocated when the object is
+ * created, so timing a probe never allocates memory or writes to a file.
+ * Overruns are kept with the statistics and listed in the summary.
+ */
+class LoopTimer {
+
+public:
+	// Public methods
+	LoopTimer();
+	~LoopTimer();
+	static UINT64 GetTimestamp();
+	int RegisterProbe(const char * name);
+	void SetBudget(int probe, double seconds);
+	void Start(int probe);
+	bool Stop(int probe);
+	bool AddSample(int probe, UINT32 nanoseconds);
+	UINT32 GetLastTime(int probe);
+	UINT32 GetPercentile(int probe, double percentile);
+	void WriteSummary(DataLog * log);
+	void Reset();
+
+private:
+	// Private constants
+	static const int kMaxProbes = 16;			///< maximum number of probes that can be registered
+	static const int kMaxName = 24;				///< maximum length of a probe name
+	static const int kBucketsPerOctave = 4;		///< number of histogram buckets for each power of two
+	static const int kBucketCount = 128;		///< number of histogram buckets, enough for times up to 4 seconds
+	static const int kMaxOverruns = 32;			///< number of overruns kept to be listed in the summary
+
+	/**
+	 * \struct loop_overrun
+	 * \brief A sample that went over its probe's budget, kept until the summary is written.
+	 */
+	struct loop_overrun {
+		int probe;				///< index of the probe
+		UINT32 nanoseconds;		///< time of the sample
+		UINT32 time;			///< time in milliseconds when the sample was added, as in the log's timestamps
+	};
+
+	// Private methods
+	static UINT64 GetTicks();
+	static int GetBucket(UINT32 nanoseconds);
+	static UINT32 GetBucketLimit(int bucket);
+
+	// Private member variables
+	char names_[kMaxProbes][kMaxName];			///< name of each probe
+	UINT64 start_ticks_[kMaxProbes];			///< time base value when each probe was started, 0 if it isn't running
+	UINT32 budgets_[kMaxProbes];				///< time in nanoseconds each probe should finish within, 0 for no limit
+	UINT32 last_times_[kMaxProbes];				///< time in nanoseconds of the last sample of each probe
+	UINT32 maximum_times_[kMaxProbes];			///< longest time in nanoseconds of each probe
+	UINT64 total_times_[kMaxProbes];			///< total time in nanoseconds of each probe, used for the average
+	UINT32 counts_[kMaxProbes];					///< number of samples of each probe
+	UINT32 overruns_[kMaxProbes];				///< number of samples of each probe that went over its budget
+	UINT32 buckets_[kMaxProbes][kBucketCount];	///< histogram of the times of each probe
+	loop_overrun overrun_list_[kMaxOverruns];	///< the first overruns since the statistics were cleared
+	int overrun_list_count_;					///< number of overruns in overrun_list_
+	int probe_count_;							///< number of probes registered
+};
+
+/**
+ * \class LoopTimerProbe
+ * \brief Times a probe from where it's declared to the end of the enclosing scope.
+ */
+class LoopTimerProbe {
+
+public:
+	// Public methods
+	LoopTimerProbe(LoopTimer * loop_timer, int probe);
+	~LoopTimerProbe();
+
+private:
+	// Private member objects
+	LoopTimer *loop_timer_;		///< loop timer the probe belongs to, NULL to not time anything
+
+	// Private member variables
+	int probe_;					///< index of the probe being timed
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include <math.h>
+#include "motionprofile.h"
+
+/**
+ * \brief Create an empty profile, which stays at 0.
+*/
+MotionProfile::MotionProfile() {
+	Generate(0.0, 0.0, 0.0, 0.0);
+}
+
+/**
+ * \brief Nothing to clean up.
+*/
+MotionProfile::~MotionProfile() {
+}
+
+/**
+ * \brief Plan a move.
+ *
+ * If the maximum velocity or acceleration isn't positive, the move has no
+ * duration and the set point jumps straight to the end.
+ *
+ * \param start position at the start of the move.
+ * \param end position at the end of the move.
+ * \param maximum_velocity fastest speed in units per second.
+ * \param maximum_acceleration fastest change in speed in units per second squared.
+*/
+void MotionProfile::Generate(double start, double end, double maximum_velocity, double maximum_acceleration) {
+	start_ = start;
+	end_ = end;
+	direction_ = end >= start ? 1.0 : -1.0;
+	acceleration_ = 0.0;
+	peak_velocity_ = 0.0;
+	acceleration_time_ = 0.0;
+	cruise_time_ = 0.0;
+	duration_ = 0.0;
+	double distance = fabs(end - start);
+	if (maximum_velocity <= 0.0 || maximum_acceleration <= 0.0 || distance == 0.0) {
+		return;
+	}
+
+	acceleration_ = maximum_acceleration;
+	if (maximum_velocity * maximum_velocity / maximum_acceleration >= distance) {
+		// Too short to reach the maximum velocity, so speed up for half the distance and slow down for the rest
+		acceleration_time_ = sqrt(distance / maximum_acceleration);
+		peak_velocity_ = maximum_acceleration * acceleration_time_;
+	}
+	else {
+		acceleration_time_ = maximum_velocity / maximum_acceleration;
+		peak_velocity_ = maximum_velocity;
+		cruise_time_ = (distance - peak_velocity_ * acceleration_time_) / peak_velocity_;
+	}
+	duration_ = 2.0 * acceleration_time_ + cruise_time_;
+}
+
+/**
+ * \brief Get where the profile is at a time since the start of the move.
+ *
+ * \param time time in seconds since the start.  Before the start is the start, after the end is the end.
+ * \param setpoint set to the position, velocity and acceleration at that time.
+*/
+void MotionProfile::GetSetpoint(double time, motion_setpoint * setpoint) {
+	double distance = 0.0;
+	double velocity = 0.0;
+	double acceleration = 0.0;
+	if (time >= duration_) {
+		distance = fabs(end_ - start_);
+	}
+	else if (time <= 0.0) {
+		distance = 0.0;
+	}
+	else if (time < acceleration_time_) {
+		// Speeding up
+		acceleration = acceleration_;
+		velocity = acceleration_ * time;
+		distance = 0.5 * acceleration_ * time * time;
+	}
+	else if (time < acceleration_time_ + cruise_time_) {
+		// Cruising
+		velocity = peak_velocity_;
+		distance = 0.5 * peak_velocity_ * acceleration_time_ + peak_velocity_ * (time - acceleration_time_);
+	}
+	else {
+		// Slowing down, worked out back from the end
+		double time_left = duration_ - time;
+		acceleration = -acceleration_;
+		velocity = acceleration_ * time_left;
+		distance = fabs(end_ - start_) - 0.5 * acceleration_ * time_left * time_left;
+	}
+	setpoint->position = start_ + direction_ * distance;
+	setpoint->velocity = direction_ * velocity;
+	setpoint->acceleration = direction_ * acceleration;
+}
+
+/**
+ * \brief Get how long the move takes.
+ *
+ * \return the time in seconds from the start to the end.
+*/
+double MotionProfile::GetDuration() {
+	return duration_;
+}
+
+/**
+ * \brief Get where the move ends.
+ *
+ * \return the position at the end.
+*/
+double MotionProfile::GetEnd() {
+	return end_;
+}
@@ -0,0 +1,52 @@
+#ifndef MOTIONPROFILE_H_
+#define MOTIONPROFILE_H_
+
+/**
+ * \struct motion_setpoint
+ * \brief Where a mechanism following a motion profile should be at a point in time.
+ */
+struct motion_setpoint {
+	double position;		///< position in the profile's units
+	double velocity;		///< velocity in units per second
+	double acceleration;	///< acceleration in units per second squared
+
+	motion_setpoint():
+		position(0.0), velocity(0.0), acceleration(0.0) {}
+};
+
+/**
+ * \class MotionProfile
+ * \brief Plans a move from one position to another within a maximum velocity and acceleration.
+ *
+ * The move speeds up at the maximum acceleration, cruises at the maximum
+ * velocity and slows down at the maximum acceleration, a trapezoid of
+ * velocity over time.  A move too short to reach the maximum velocity is a
+ * triangle instead.  The phase times are worked out once by Generate(), and
+ * GetSetpoint() gives the position, velocity and acceleration at any time
+ * since the start, so a mechanism following the profile takes the same time
+ * however often it is updated.
+ */
+class MotionProfile {
+
+public:
+	// Public methods
+	MotionProfile();
+	~MotionProfile();
+	void Generate(double start, double end, double maximum_velocity, double maximum_acceleration);
+	void GetSetpoint(double time, motion_setpoint * setpoint);
+	double GetDuration();
+	double GetEnd();
+
+private:
+	// Private member variables
+	double start_;				///< position at the start of the move
+	double end_;				///< position at the end of the move
+	double direction_;			///< 1 if the move is toward larger positions, -1 if not
+	double acceleration_;		///< acceleration in units per second squared while speeding up and slowing down
+	double peak_velocity_;		///< fastest speed in units per second, the maximum velocity unless the move is too short
+	double acceleration_time_;	///< time in seconds spent speeding up, and again slowing down
+	double cruise_time_;		///< time in seconds spent at the peak velocity
+	double duration_;			///< time in seconds of the whole move
+};
+
+#endif
@@ -0,0 +1,336 @@
+#include <math.h>
+#include "WPILib.h"
+#include "odometry.h"
+#include "looptimer.h"
+
+/**
+ * \def GRAVITY
+ * \brief Acceleration due to gravity in meters per second squared, to convert the accelerometer's g.
+ */
+#define GRAVITY 9.80665
+
+/**
+ * \def STILL_VELOCITY_NOISE
+ * \brief Standard deviation in meters per second of the zero velocity used while the robot is still.
+ */
+#define STILL_VELOCITY_NOISE 0.01
+
+/**
+ * \def INITIAL_BIAS_ERROR
+ * \brief Standard deviation in meters per second squared of the bias when the filter starts.
+ */
+#define INITIAL_BIAS_ERROR 0.5
+
+/**
+ * \brief Create the odometry, with the task stopped.
+*/
+Odometry::Odometry()
+	: odometry_task_("odometry", (FUNCPTR) s_OdometryTask)
+{
+	accelerometer_ = NULL;
+	gyro_ = NULL;
+	left_motor_ = NULL;
+	right_motor_ = NULL;
+	sample_timer_ = new Timer();
+	axis_ = 0;
+	settings_semaphore_ = semMCreate(SEM_Q_PRIORITY | SEM_INVERSION_SAFE | SEM_DELETE_SAFE);
+	SetFilter(200, 0.05, 0.001, 0.5, 0.3, 2.0);
+	settings_ = new_settings_;
+	reset_count_ = 0;
+	resets_handled_ = 0;
+	motors_off_time_ = 0.0;
+	ResetFilter();
+}
+
+/**
+ * \brief Stop the task.  The sensors belong to the caller and aren't deleted.
+*/
+Odometry::~Odometry() {
+	Stop();
+	SafeDelete(sample_timer_);
+	semDelete(settings_semaphore_);
+}
+
+/**
+ * \brief Start reading the sensors in a separate task.
+ *
+ * The filter starts again from zero.  The sensors must not be deleted
+ * until Stop() is called.
+ *
+ * \param accelerometer the accelerometer.
+ * \param axis the ADXL345_I2C Axis pointing forward.
+ * \param gyro the gyro, or NULL if there isn't one.
+ * \param left_motor the left drive motor controller, or NULL.
+ * \param right_motor the right drive motor controller, or NULL.
+ * \return true if the task was started.
+*/
+bool Odometry::Start(ADXL345_I2C * accelerometer, int axis, Gyro * gyro, SpeedController * left_motor,
+		SpeedController * right_motor) {
+	Stop();
+	if (accelerometer == NULL) {
+		return false;
+	}
+
+	accelerometer_ = accelerometer;
+	axis_ = axis;
+	gyro_ = gyro;
+	left_motor_ = left_motor;
+	right_motor_ = right_motor;
+
+	// Poses published before now belong to the old filter
+	reset_count_++;
+	resets_handled_ = reset_count_;
+	motors_off_time_ = 0.0;
+	ResetFilter();
+
+	return odometry_task_.Start((TaskArgument) this);
+}
+
+/**
+ * \brief Stop reading the sensors.
+ *
+ * \return true if the task was running.
+*/
+bool Odometry::Stop() {
+	if (odometry_task_.Verify()) {
+		return odometry_task_.Stop();
+	}
+	return false;
+}
+
+/**
+ * \brief Set how often the sensors are read and how the filter treats them.
+ *
+ * Safe to call while the task is running.  The task uses the new
+ * settings from its next reading.
+ *
+ * \param sample_rate number of times per second the sensors are read.
+ * \param acceleration_noise standard deviation in meters per second squared of each acceleration reading.
+ * \param bias_drift how fast the bias can change, in meters per second squared per square root of a second.
+ * \param still_time time in seconds the motors must be off before the robot can be still.
+ * \param still_acceleration largest acceleration in meters per second squared, without the bias, while still.
+ * \param still_turn_rate largest turn rate in degrees per second while still.
+*/
+void Odometry::SetFilter(int sample_rate, double acceleration_noise, double bias_drift, double still_time,
+		double still_acceleration, float still_turn_rate) {
+	CRITICAL_REGION(settings_semaphore_)
+		new_settings_.sample_rate = sample_rate > 0 ? sample_rate : 1;
+		new_settings_.acceleration_noise = acceleration_noise;
+		new_settings_.bias_drift = bias_drift;
+		new_settings_.still_time = still_time;
+		new_settings_.still_acceleration = still_acceleration;
+		new_settings_.still_turn_rate = still_turn_rate;
+	END_REGION
+}
+
+/**
+ * \brief Start measuring the distance from zero again.
+ *
+ * The velocity and bias are kept.  GetPose() returns false until the task
+ * has read the sensors since the reset.
+*/
+void Odometry::Reset() {
+	reset_count_++;
+}
+
+/**
+ * \brief Get the latest pose.  Only one task may call this.
+ *
+ * \param pose set to the latest pose.
+ * \return true if successful, false if the sensors haven't been read since the last reset.
+*/
+bool Odometry::GetPose(odometry_pose * pose) {
+	const odometry_pose * latest = poses_.GetLatest();
+	if (latest->timestamp == 0 || latest->reset_count != reset_count_) {
+		return false;
+	}
+	*pose = *latest;
+	return true;
+}
+
+/**
+ * \brief Static interface for the OdometryTask function.
+ *
+ * Static interface that will cause an instantiation if necessary.
+ * This function is used so that the actual task function doesn't need
+ * to be static.
+ *
+ * \param this_pointer a pointer to this object.
+ * \return the result of the spawned task.
+*/
+int Odometry::s_OdometryTask(Odometry *this_pointer) {
+	return this_pointer->OdometryTask();
+}
+
+/**
+ * \brief Reads the sensors at a fixed rate and publishes the pose.
+ *
+ * Each acceleration is averaged with the one before, so the filter
+ * integrates with the trapezoid rule.  The time between readings is
+ * measured with a timer, so a late reading is integrated over the time
+ * that actually passed.
+ *
+ * \return 0 on success (but the task should never finish on it's own).
+*/
+int Odometry::OdometryTask() {
+	bool first_sample = true;
+	double previous_time = 0.0;
+	double next_time = 0.0;
+	double previous_acceleration = 0.0;
+	float previous_heading = 0.0;
+	sample_timer_->Reset();
+	sample_timer_->Start();
+
+	// Loop repeatedly
+	while (true) {
+		// Pick up any settings changed since the last reading
+		CRITICAL_REGION(settings_semaphore_)
+			settings_ = new_settings_;
+		END_REGION
+
+		double time = sample_timer_->Get();
+		UINT64 timestamp = LoopTimer::GetTimestamp();
+		double acceleration = accelerometer_->GetAcceleration((ADXL345_I2C::Axes) axis_) * GRAVITY;
+		float heading = gyro_ != NULL ? gyro_->GetAngle() : 0.0;
+		bool motors_off = (left_motor_ == NULL || left_motor_->Get() == 0.0) &&
+				(right_motor_ == NULL || right_motor_->Get() == 0.0);
+
+		// Start the distance from zero, keeping what's known about the velocity and bias
+		int reset_count = reset_count_;
+		if (resets_handled_ != reset_count) {
+			state_[0] = 0.0;
+			for (int i = 0; i < 3; i++) {
+				covariance_[0][i] = 0.0;
+				covariance_[i][0] = 0.0;
+			}
+			resets_handled_ = reset_count;
+		}
+
+		bool still = false;
+		if (!first_sample && time > previous_time) {
+			double step = time - previous_time;
+			Predict((acceleration + previous_acceleration) / 2.0, step);
+
+			// The robot can't be moving if the motors have been off for a while and nothing is changing
+			motors_off_time_ = motors_off ? motors_off_time_ + step : 0.0;
+			float turn_rate = fabs(heading - previous_heading) / step;
+			still = motors_off_time_ >= settings_.still_time &&
+					fabs(acceleration - state_[2]) <= settings_.still_acceleration && turn_rate <= settings_.still_turn_rate;
+			if (still) {
+				CorrectStill();
+			}
+		}
+		first_sample = false;
+		previous_time = time;
+		previous_acceleration = acceleration;
+		previous_heading = heading;
+
+		// Share the new pose
+		odometry_pose * pose = poses_.GetBack();
+		pose->timestamp = timestamp;
+		pose->reset_count = reset_count;
+		pose->distance = state_[0];
+		pose->velocity = state_[1];
+		pose->acceleration = acceleration - state_[2];
+		pose->bias = state_[2];
+		pose->heading = heading;
+		pose->still = still;
+		poses_.Publish();
+
+		// Wait for the next reading, without letting the time taken here add up
+		next_time += 1.0 / settings_.sample_rate;
+		double now = sample_timer_->Get();
+		if (next_time > now) {
+			Wait(next_time - now);
+		}
+		else {
+			// Too far behind to catch up, so start again from now
+			next_time = now;
+			Wait(0.0);
+		}
+	}
+	return 0;
+}
+
+/**
+ * \brief Start the filter at rest, with the bias unknown.
+*/
+void Odometry::ResetFilter() {
+	for (int i = 0; i < 3; i++) {
+		state_[i] = 0.0;
+		for (int j = 0; j < 3; j++) {
+			covariance_[i][j] = 0.0;
+		}
+	}
+	covariance_[2][2] = INITIAL_BIAS_ERROR * INITIAL_BIAS_ERROR;
+}
+
+/**
+ * \brief Move the filter forward by one reading.
+ *
+ * The acceleration, less the bias, is taken to be constant over the step.
+ *
+ * \param acceleration the measured acceleration in meters per second squared.
+ * \param step the time in seconds since the last reading.
+*/
+void Odometry::Predict(double acceleration, double step) {
+	double half_step_squared = 0.5 * step * step;
+	double corrected = acceleration - state_[2];
+	state_[0] += state_[1] * step + corrected * half_step_squared;
+	state_[1] += corrected * step;
+
+	// How each new state depends on the old one
+	double transition[3][3] = {
+		{1.0, step, -half_step_squared},
+		{0.0, 1.0, -step},
+		{0.0, 0.0, 1.0}
+	};
+	double product[3][3];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			product[i][j] = 0.0;
+			for (int k = 0; k < 3; k++) {
+				product[i][j] += transition[i][k] * covariance_[k][j];
+			}
+		}
+	}
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			covariance_[i][j] = 0.0;
+			for (int k = 0; k < 3; k++) {
+				covariance_[i][j] += product[i][k] * transition[j][k];
+			}
+		}
+	}
+
+	// Noise in the acceleration reading spreads into the distance and velocity, and the bias wanders
+	double noise[2] = {half_step_squared, step};
+	double acceleration_variance = settings_.acceleration_noise * settings_.acceleration_noise;
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 2; j++) {
+			covariance_[i][j] += noise[i] * noise[j] * acceleration_variance;
+		}
+	}
+	covariance_[2][2] += settings_.bias_drift * settings_.bias_drift * step;
+}
+
+/**
+ * \brief Correct the filter with a velocity of zero, while the robot is still.
+*/
+void Odometry::CorrectStill() {
+	double innovation_variance = covariance_[1][1] + STILL_VELOCITY_NOISE * STILL_VELOCITY_NOISE;
+	double gain[3];
+	double velocity_row[3];
+	for (int i = 0; i < 3; i++) {
+		gain[i] = covariance_[i][1] / innovation_variance;
+		velocity_row[i] = covariance_[1][i];
+	}
+
+	double innovation = -state_[1];
+	for (int i = 0; i < 3; i++) {
+		state_[i] += gain[i] * innovation;
+		for (int j = 0; j < 3; j++) {
+			covariance_[i][j] -= gain[i] * velocity_row[j];
+		}
+	}
+}
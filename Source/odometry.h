@@ -0,0 +1,100 @@
+#ifndef ODOMETRY_H_
+#define ODOMETRY_H_
+
+#include "WPILib.h"
+#include "common.h"
+#include "triplebuffer.h"
+
+/**
+ * \struct odometry_pose
+ * \brief Where the robot is, worked out from the accelerometer and gyro.
+ */
+struct odometry_pose {
+	UINT64 timestamp;		///< time in nanoseconds from LoopTimer::GetTimestamp() when the sensors were read
+	int reset_count;		///< number of calls to Odometry::Reset() before the sensors were read
+	double distance;		///< distance in meters along the accelerometer axis since the last reset
+	double velocity;		///< velocity in meters per second along the accelerometer axis
+	double acceleration;	///< acceleration in meters per second squared, without the bias
+	double bias;			///< estimated accelerometer bias in meters per second squared
+	float heading;			///< heading in degrees
+	bool still;				///< true if the robot was found to be standing still
+
+	odometry_pose():
+		timestamp(0), reset_count(0), distance(0.0), velocity(0.0), acceleration(0.0), bias(0.0), heading(0.0),
+		still(false) {}
+};
+
+/**
+ * \class Odometry
+ * \brief Tracks how far the robot has driven using the accelerometer and gyro.
+ *
+ * The sensors are read at a fixed rate in a separate task, so the distance
+ * doesn't depend on how long the periodic loop takes.  The acceleration is
+ * integrated into velocity and distance by a Kalman filter that also
+ * estimates the accelerometer's bias.  Whenever the motors have been off
+ * for a while and the sensors are quiet, the robot is taken to be standing
+ * still, and the filter is told the velocity is zero.  That corrects the
+ * velocity, the bias and, through their errors, the distance.  The latest
+ * pose is published through a triple buffer for the periodic loop.
+ * SetFilter() can be called while the task is running; the task picks up
+ * the new settings under a semaphore before its next reading.
+ */
+class Odometry {
+
+public:
+	// Public methods
+	Odometry();
+	~Odometry();
+	bool Start(ADXL345_I2C * accelerometer, int axis, Gyro * gyro, SpeedController * left_motor,
+			SpeedController * right_motor);
+	bool Stop();
+	void SetFilter(int sample_rate, double acceleration_noise, double bias_drift, double still_time,
+			double still_acceleration, float still_turn_rate);
+	void Reset();
+	bool GetPose(odometry_pose * pose);
+
+private:
+	/**
+	 * \struct filter_settings
+	 * \brief How often the sensors are read and how the filter treats them.
+	 */
+	struct filter_settings {
+		int sample_rate;				///< number of times per second the sensors are read
+		double acceleration_noise;		///< standard deviation in meters per second squared of each acceleration reading
+		double bias_drift;				///< how fast the bias can change, in meters per second squared per square root of a second
+		double still_time;				///< time in seconds the motors must be off before the robot can be still
+		double still_acceleration;		///< largest acceleration in meters per second squared, without the bias, while still
+		float still_turn_rate;			///< largest turn rate in degrees per second while still
+	};
+
+	// Private methods
+	static int s_OdometryTask(Odometry *this_pointer);
+	int OdometryTask();
+	void ResetFilter();
+	void Predict(double acceleration, double step);
+	void CorrectStill();
+
+	// Private member objects
+	Task odometry_task_;							///< task object used to spawn the OdometryTask() function in a separate thread
+	TripleBuffer<odometry_pose> poses_;				///< poses passed from the OdometryTask() function to GetPose()
+	ADXL345_I2C *accelerometer_;					///< accelerometer read by the task, owned by the caller
+	Gyro *gyro_;									///< gyro read by the task, owned by the caller, NULL if there isn't one
+	SpeedController *left_motor_;					///< left drive motor controller, checked to see if the robot might be moving
+	SpeedController *right_motor_;					///< right drive motor controller, checked to see if the robot might be moving
+	Timer *sample_timer_;							///< timer object used to measure the time between sensor readings
+
+	// Private parameters
+	int axis_;						///< the ADXL345_I2C Axis to measure
+	filter_settings settings_;		///< the settings in use, only used by the task once it has started
+	filter_settings new_settings_;	///< the settings from SetFilter(), copied to settings_ by the task before each reading
+
+	// Private member variables
+	SEM_ID settings_semaphore_;		///< semaphore held while new_settings_ is being changed or copied
+	volatile int reset_count_;		///< number of calls to Reset(), only written by the caller's task
+	int resets_handled_;			///< number of resets the task has applied to the filter
+	double state_[3];				///< filter state: distance, velocity and bias
+	double covariance_[3][3];		///< filter covariance of the state
+	double motors_off_time_;		///< time in seconds the motors have been off
+};
+
+#endif
@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <stdlib.h>
 #include "parameters.h"
+#include "readfile.h"
 
 /**
  * \brief Open a file with the mode "r" to read program parameters.
@@ -21,10 +24,10 @@ Parameters::Parameters() {
 }
 
 /**
- * \brief Deletes the file object.
+ * \brief Closes the file if it's still open.
 */
 Parameters::~Parameters() {
-	SafeDelete(file_);
+	Close();
 }
 
 /**
@@ -39,7 +42,7 @@ bool Parameters::Open(const char * path) {
 		return false;
 	}
 	
-	if ((file_ = fopen(path, "r")) <= 0) {
+	if ((file_ = fopen(path, "r")) == NULL) {
 		/*printf("Error opening file = %s\n", strerror(errno));
 		printf("file = %s\n", path);*/
 		file_opened_ = false;
@@ -57,6 +60,7 @@ bool Parameters::Open(const char * path) {
 void Parameters::Close() {
 	if (file_ != NULL) {
 		fclose(file_);
+		file_ = NULL;
 		file_opened_ = false;
 	}
 }
@@ -64,88 +68,194 @@ void Parameters::Close() {
 /**
  * \brief Read all parameter/value pairs from the file.
  *
- * Reads the entire parameter file and searches for NAME = VALUE pairs.
- * The pairs are stored in map variables depending on the type of VALUE.
- * All pairs are read as float type, then read as string type if float failed.
+ * Reads the entire parameter file into memory at once and searches for
+ * NAME = VALUE pairs.  The names and text values are null terminated in place,
+ * so the file contents become the arena, and the pairs are sorted by name so
+ * lookups can binary search without allocating.
+ * Values that start with a number are read as float type, otherwise as string type.
+ * Anything after a '#' is a comment, and blank or comment lines are skipped.
+ * Lines can be any length.  If a name appears more than once, the last value read is kept.
  *
  * \return true if successful.
 */
 bool Parameters::ReadValues() {
-	char buffer[256] = {0};
-	char parameter[255] = {0};
-	char value_string[255] = {0};
-	char comment[255] = {0};
-	float value_float = 0.0;
-	int match_count = 0;
-
-	// Clear old value_string
-	number_parameters_.clear();
-	string_parameters_.clear();
+	unsigned int line = 0;
+	bool success = true;
+
+	// Clear old values
+	arena_.clear();
+	entries_.clear();
 	
-	if (file_opened_ && file_ != NULL) {
-		// Loop while there's data to read
-		while (fgets(buffer, 255, file_) != NULL) {
-			// Clear any previous values of the strings
-			comment[0]=0;
-			value_string[0]=0;
-			// Try to format the value as a number
-			// Also search for anything after the number as a comment
-			match_count = sscanf(buffer, "%s = %f %[^\n]", parameter, &value_float, comment);
-			// If at least a parameter name and value were found, store the name/number pair
-			if (match_count >= 2) {
-				number_parameters_[parameter] = value_float;
-				continue;
-			}
-			// Try to format the value as a string
-			// Also search for anything after a '#' as a comment
-			match_count = sscanf(buffer, "%s = %[^#\n] %[^\n]", parameter, value_string, comment);
-			// If at least a parameter name and value were found, store the name/string pair
-			if (match_count >= 2) {
-				// Remove any extra whitespace between the string value and the '#' if it exists
-				if (strlen(value_string) > 0 && value_string[strlen(value_string)-1] == ' ') {
-					value_string[strlen(value_string)-1] = 0;
-				}
-				string_parameters_[parameter] = value_string;
+	if (!file_opened_ || file_ == NULL) {
+		return false;
+	}
+	if (!ReadFile(file_, arena_)) {
+		return false;
+	}
+
+	// The last character of the arena is a null terminator added after the file contents
+	char * start = &arena_[0];
+	char * current = start;
+	char * end = start + arena_.size() - 1;
+
+	// Loop through each line of the file
+	while (current < end) {
+		char * line_end = (char *) memchr(current, '\n', end - current);
+		if (line_end == NULL) {
+			line_end = end;
+		}
+
+		// Skip leading whitespace, blank lines and comments
+		while (current < line_end && isspace((unsigned char) *current)) {
+			current++;
+		}
+		if (current == line_end || *current == '#') {
+			current = line_end + 1;
+			continue;
+		}
+
+		// Find the end of the parameter name and the '='
+		char * name = current;
+		while (current < line_end && !isspace((unsigned char) *current) && *current != '=') {
+			current++;
+		}
+		char * name_end = current;
+		while (current < line_end && isspace((unsigned char) *current)) {
+			current++;
+		}
+		if (current == line_end || *current != '=') {
+			// Could not match the line to the format, return an error
+			success = false;
+			break;
+		}
+		current++;
+		while (current < line_end && isspace((unsigned char) *current)) {
+			current++;
+		}
+
+		// The value ends at a comment or the end of the line, without any trailing whitespace
+		char * value = current;
+		char * value_end = current;
+		while (value_end < line_end && *value_end != '#') {
+			value_end++;
+		}
+		while (value_end > value && isspace((unsigned char) *(value_end - 1))) {
+			value_end--;
+		}
+		if (value_end == value) {
+			success = false;
+			break;
+		}
+
+		// Terminate the name and value in place
+		*name_end = 0;
+		*value_end = 0;
+
+		parameter_entry entry;
+		entry.line = line++;
+		entry.name = name - start;
+		entry.text = value - start;
+		// Try to format the value as a number, otherwise it's a string
+		char * number_end = value;
+		entry.number = (float) strtod(value, &number_end);
+		entry.is_number = (number_end != value);
+		entries_.push_back(entry);
+
+		current = line_end + 1;
+	}
+
+	// Sort the entries by name, and only keep the last value of each duplicate
+	if (!entries_.empty()) {
+		EntryCompare compare(&arena_[0]);
+		std::sort(entries_.begin(), entries_.end(), compare);
+		unsigned int count = 0;
+		for (unsigned int i = 0; i < entries_.size(); i++) {
+			if ((i + 1) < entries_.size() && entries_[i].is_number == entries_[i + 1].is_number &&
+					strcmp(&arena_[entries_[i].name], &arena_[entries_[i + 1].name]) == 0) {
 				continue;
 			}
-			// Could not match the line to any of the formats, return an error
-			else {
-				return false;
-			}
+			entries_[count++] = entries_[i];
 		}
-		return true;
+		entries_.resize(count);
 	}
-	else {
-		return false;
+
+	return success;
+}
+
+/**
+ * \brief Find the entry for a parameter name.
+ *
+ * \param parameter the name of the parameter.
+ * \param is_number true to find a numerical parameter, false to find a string parameter.
+ * \return the entry, or NULL if there's no match.
+*/
+const Parameters::parameter_entry * Parameters::Find(const char * parameter, bool is_number) {
+	if (parameter == NULL || entries_.empty()) {
+		return NULL;
+	}
+
+	// Binary search for the first entry with the name
+	std::vector<parameter_entry>::const_iterator entry = std::lower_bound(entries_.begin(),
+		entries_.end(), parameter, EntryCompare(&arena_[0]));
+
+	// A name can have both a numerical and a string entry, next to each other
+	for (; entry != entries_.end() && strcmp(&arena_[entry->name], parameter) == 0; ++entry) {
+		if (entry->is_number == is_number) {
+			return &(*entry);
+		}
 	}
+	return NULL;
+}
+
+/**
+ * \brief Order two entries by name, then type, then the line they were read from.
+ *
+ * \param a the first entry.
+ * \param b the second entry.
+ * \return true if a comes before b.
+*/
+bool Parameters::EntryCompare::operator()(const parameter_entry &a, const parameter_entry &b) const {
+	int result = strcmp(arena_ + a.name, arena_ + b.name);
+	if (result != 0) {
+		return result < 0;
+	}
+	if (a.is_number != b.is_number) {
+		return a.is_number;
+	}
+	return a.line < b.line;
+}
+
+/**
+ * \brief Check if an entry comes before a parameter name.
+ *
+ * \param a the entry.
+ * \param name the parameter name.
+ * \return true if the entry's name comes before the parameter name.
+*/
+bool Parameters::EntryCompare::operator()(const parameter_entry &a, const char * name) const {
+	return strcmp(arena_ + a.name, name) < 0;
 }
 
 /**
  * \brief Get the matching text for the specified parameter.
  *
  * Searches the text parameters that were read from the file for the parameter name
- * specified.  If a match is found, it returns the text value associated
- * with the parameter name.
+ * specified.  If a match is found, it copies the text value associated
+ * with the parameter name, including the null terminator.  Text that
+ * doesn't fit is cut off, still terminated, and false is returned.
  *
  * \param parameter the name of the parameter.
  * \param value pointer to a character array to store the string into.
+ * \param length the size of the character array.
  * \return true if successful.
 */
-bool Parameters::GetValue(const char * parameter, char * value) {
-	// Search for the parameter name in the list of parameters
-	string_parameters_iterator_ = string_parameters_.find(parameter);
-	// If the iterator is not set to the end, then we found a match
-	if (string_parameters_iterator_ != string_parameters_.end()) {
-		// Get the string corresponding to the parameter name
-		std::string temp_string = string_parameters_iterator_->second;
-		// Create a new empty character array
-		char * new_string = new char[temp_string.size() + 1];
-		new_string[temp_string.size()] = 0;
-		// Copy the string contents into the character array/pointer
-		memcpy(new_string, temp_string.c_str(), temp_string.size());
-		memcpy(value, new_string, strlen(new_string));
-		SafeDelete(new_string);
-		return true;
+bool Parameters::GetValue(const char * parameter, char * value, int length) {
+	const parameter_entry * entry = Find(parameter, false);
+	if (entry != NULL && value != NULL && length > 0) {
+		const char * text = &arena_[entry->text];
+		strncpy(value, text, length - 1);
+		value[length - 1] = 0;
+		return strlen(text) < (unsigned int) length;
 	}
 	// Otherwise, no match found
 	else {
@@ -165,11 +275,9 @@ bool Parameters::GetValue(const char * parameter, char * value) {
  * \return true if successful.
 */
 bool Parameters::GetValue(const char * parameter, int * value) {
-	// Search for the parameter name in the list of parameters
-	number_parameters_iterator_ = number_parameters_.find(parameter);
-	// If the iterator is not set to the end, then we found a match
-	if (number_parameters_iterator_ != number_parameters_.end()) {
-		*value = (int) number_parameters_iterator_->second;
+	const parameter_entry * entry = Find(parameter, true);
+	if (entry != NULL && value != NULL) {
+		*value = (int) entry->number;
 		return true;
 	}
 	// Otherwise, no match found
@@ -190,11 +298,9 @@ bool Parameters::GetValue(const char * parameter, int * value) {
  * \return true if successful.
 */
 bool Parameters::GetValue(const char * parameter, float * value) {
-	// Search for the parameter name in the list of parameters
-	number_parameters_iterator_ = number_parameters_.find(parameter);
-	// If the iterator is not set to the end, then we found a match
-	if (number_parameters_iterator_ != number_parameters_.end()) {
-		*value = (float) number_parameters_iterator_->second;
+	const parameter_entry * entry = Find(parameter, true);
+	if (entry != NULL && value != NULL) {
+		*value = (float) entry->number;
 		return true;
 	}
 	// Otherwise, no match found
@@ -215,11 +321,9 @@ bool Parameters::GetValue(const char * parameter, float * value) {
  * \return true if successful.
 */
 bool Parameters::GetValue(const char * parameter, double * value) {
-	// Search for the parameter name in the list of parameters
-	number_parameters_iterator_ = number_parameters_.find(parameter);
-	// If the iterator is not set to the end, then we found a match
-	if (number_parameters_iterator_ != number_parameters_.end()) {
-		*value = (double) number_parameters_iterator_->second;
+	const parameter_entry * entry = Find(parameter, true);
+	if (entry != NULL && value != NULL) {
+		*value = (double) entry->number;
 		return true;
 	}
 	// Otherwise, no match found
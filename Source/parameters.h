@@ -4,8 +4,49 @@
 #include <stdio.h>
 #include <string>
 #include <string.h>
-#include <map>
+#include <vector>
 #include "common.h"
+#include "datalog.h"
+
+/**
+ * \def IntParameter(type, name, member, default_value, minimum, maximum)
+ * \brief Binds a parameter name to an integer member variable of a class.
+ */
+#define IntParameter(type, name, member, default_value, minimum, maximum) \
+	{ name, &type::member, 0, 0, default_value, minimum, maximum }
+
+/**
+ * \def FloatParameter(type, name, member, default_value, minimum, maximum)
+ * \brief Binds a parameter name to a float member variable of a class.
+ */
+#define FloatParameter(type, name, member, default_value, minimum, maximum) \
+	{ name, 0, &type::member, 0, default_value, minimum, maximum }
+
+/**
+ * \def DoubleParameter(type, name, member, default_value, minimum, maximum)
+ * \brief Binds a parameter name to a double member variable of a class.
+ */
+#define DoubleParameter(type, name, member, default_value, minimum, maximum) \
+	{ name, 0, 0, &type::member, default_value, minimum, maximum }
+
+/**
+ * Data structure that binds a parameter name to a member variable of a class,
+ * along with the default value and the range of values allowed.
+ *
+ * Only one of the member pointers is set, depending on the type of the member.
+ * Tables of these are built with the IntParameter, FloatParameter and
+ * DoubleParameter macros.
+ */
+template <class T>
+struct parameter_binding {
+	const char * name;			///< name of the parameter in the file
+	int T::*int_member;			///< integer member variable to set
+	float T::*float_member;		///< float member variable to set
+	double T::*double_member;	///< double member variable to set
+	double default_value;		///< value of the member before the file is read
+	double minimum;				///< smallest value allowed in the file
+	double maximum;				///< largest value allowed in the file
+};
 
 /**
  * \class Parameters
@@ -24,35 +65,151 @@ public:
 	bool Open(const char * path);
 	void Close();
 	bool ReadValues();
-	bool GetValue(const char * parameter, char * value);
+	bool GetValue(const char * parameter, char * value, int length);
 	bool GetValue(const char * parameter, int * value);
 	bool GetValue(const char * parameter, float * value);
 	bool GetValue(const char * parameter, double * value);
+	template <class T>
+	static void SetDefaults(T * object, const parameter_binding<T> * bindings, int count);
+	template <class T, class L>
+	int Bind(T * object, const parameter_binding<T> * bindings, int count, L * log);
 
 	// Public member variables
 	bool file_opened_;	///< true if the file is open
 
 private:
-	// Private typedefs
 	/**
-	 * \typedef std::map<std::string, std::string>
-	 * \brief A map of name/value pairs for values that are strings.
+	 * Data structure to store the location of one name/value pair in the key arena.
 	 */
-	typedef std::map<std::string, std::string> StringMap;
+	struct parameter_entry {
+		unsigned int name;		///< offset of the parameter name in the arena
+		unsigned int text;		///< offset of the text value in the arena, for string parameters
+		float number;			///< value of a numerical parameter
+		bool is_number;			///< true if the parameter is numerical, false if it is a string
+		unsigned int line;		///< line the pair was read from, so the last duplicate wins
+	};
+
 	/**
-	 * \typedef std::map<std::string, float>
-	 * \brief A map of name/value pairs for values that are numbers.
+	 * \class EntryCompare
+	 * \brief Orders entries by name, then type, then line, for sorting and searching.
 	 */
-	typedef std::map<std::string, float> NumberMap;
+	class EntryCompare {
+	public:
+		EntryCompare(const char * arena) : arena_(arena) {}
+		bool operator()(const parameter_entry &a, const parameter_entry &b) const;
+		bool operator()(const parameter_entry &a, const char * name) const;
+	private:
+		const char * arena_;	///< the arena that the entry offsets point into
+	};
+
+	// Private methods
+	const parameter_entry * Find(const char * parameter, bool is_number);
 
 	// Private member objects
 	FILE *file_;	///< the file to read parameters from
 	
 	// Private members variables
-	StringMap string_parameters_;						///< contains parameters read from the file that are strings
-	StringMap::iterator string_parameters_iterator_;	///< iterator of string parameters
-	NumberMap number_parameters_;						///< contains parameters read from the file that are numerical
-	NumberMap::iterator number_parameters_iterator_;	///< iterator of numerical parameters
+	std::vector<char> arena_;					///< contents of the file, with every parameter name and text value null terminated in place
+	std::vector<parameter_entry> entries_;		///< one entry per parameter, sorted by name so it can be binary searched
 };
 
+/**
+ * \brief Set every bound member variable to its default value.
+ *
+ * \param object the object that owns the member variables.
+ * \param bindings the table of parameter bindings.
+ * \param count the number of bindings in the table.
+*/
+template <class T>
+void Parameters::SetDefaults(T * object, const parameter_binding<T> * bindings, int count) {
+	for (int i = 0; i < count; i++) {
+		if (bindings[i].int_member != 0)
+			object->*bindings[i].int_member = (int) bindings[i].default_value;
+		else if (bindings[i].float_member != 0)
+			object->*bindings[i].float_member = (float) bindings[i].default_value;
+		else if (bindings[i].double_member != 0)
+			object->*bindings[i].double_member = bindings[i].default_value;
+	}
+}
+
+/**
+ * \brief Copy the values read from the file into every bound member variable.
+ *
+ * Parameters that are missing from the file, or outside of their allowed
+ * range, keep their current value and are reported to the log.  Values that
+ * are different from the current value are also reported, so a reload shows
+ * exactly what changed.
+ *
+ * \param object the object that owns the member variables.
+ * \param bindings the table of parameter bindings.
+ * \param count the number of bindings in the table.
+ * \param log the log to report to, a DataLog or anything else with the same
+ * WriteLine(const char *) method, or NULL to not report.
+ * \return the number of parameters that were missing or out of range.
+*/
+template <class T, class L>
+int Parameters::Bind(T * object, const parameter_binding<T> * bindings, int count, L * log) {
+	char message[256] = {0};
+	int problems = 0;
+
+	for (int i = 0; i < count; i++) {
+		const parameter_binding<T> &binding = bindings[i];
+		double previous = 0.0;
+		double value = 0.0;
+
+		// Get the current value of the member variable
+		if (binding.int_member != 0)
+			previous = object->*binding.int_member;
+		else if (binding.float_member != 0)
+			previous = object->*binding.float_member;
+		else if (binding.double_member != 0)
+			previous = object->*binding.double_member;
+		else
+			continue;
+
+		if (!GetValue(binding.name, &value)) {
+			if (log != NULL) {
+				sprintf(message, "%.64s is missing, keeping %f\n", binding.name, previous);
+				log->WriteLine(message);
+			}
+			problems++;
+			continue;
+		}
+		if (value < binding.minimum || value > binding.maximum) {
+			if (log != NULL) {
+				sprintf(message, "%.64s = %f is out of range (%f to %f), keeping %f\n",
+					binding.name, value, binding.minimum, binding.maximum, previous);
+				log->WriteLine(message);
+			}
+			problems++;
+			continue;
+		}
+
+		// Store the value in the type of the member variable
+		bool changed = false;
+		if (binding.int_member != 0) {
+			object->*binding.int_member = (int) value;
+			value = object->*binding.int_member;
+			changed = value != previous;
+		}
+		else if (binding.float_member != 0) {
+			object->*binding.float_member = (float) value;
+			value = object->*binding.float_member;
+			changed = value != previous;
+		}
+		else {
+			object->*binding.double_member = value;
+			// The store only keeps a float, so compare at that precision
+			changed = value != (float) previous;
+		}
+
+		if (changed && log != NULL) {
+			sprintf(message, "%.64s changed from %f to %f\n", binding.name, previous, value);
+			log->WriteLine(message);
+		}
+	}
+
+	return problems;
+}
+
 #endif
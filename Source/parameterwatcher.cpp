@@ -0,0 +1,378 @@
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "WPILib.h"
+#include "datalog.h"
+#include "parameters.h"
+#include "parameterwatcher.h"
+
+/**
+ * \def WATCH_PERIOD
+ * \brief The time in seconds between checks of the watched files.
+ */
+#define WATCH_PERIOD 0.5
+
+/**
+ * \brief Create the watcher with no files.
+ *
+ * Add files using Watch(), then start the background task using Start().
+ * Logging is disabled.
+*/
+ParameterWatcher::ParameterWatcher()
+	: watch_task_("parameterwatcher", (FUNCPTR) s_WatchTask, Task::kDefaultPriority + 30) {
+	Initialize(false);
+}
+
+/**
+ * \brief Create the watcher with no files.
+ *
+ * Add files using Watch(), then start the background task using Start().
+ *
+ * \param logging_enabled true if logging is enabled.
+*/
+ParameterWatcher::ParameterWatcher(bool logging_enabled)
+	: watch_task_("parameterwatcher", (FUNCPTR) s_WatchTask, Task::kDefaultPriority + 30) {
+	Initialize(logging_enabled);
+}
+
+/**
+ * \brief Stop the background task and delete any parameters that weren't picked up.
+*/
+ParameterWatcher::~ParameterWatcher() {
+	Stop();
+	for (int i = 0; i < kMaxFiles; i++) {
+		Parameters *parameters = changed_parameters_[i];
+		SafeDelete(parameters);
+		changed_parameters_[i] = NULL;
+	}
+
+	// The task has stopped, so the lines it didn't get to can be written here
+	WriteLogMessages();
+	SafeDelete(log_);
+}
+
+/**
+ * \brief Initialize the ParameterWatcher object.
+ *
+ * \param logging_enabled true if logging is enabled.
+*/
+void ParameterWatcher::Initialize(bool logging_enabled) {
+	for (int i = 0; i < kMaxFiles; i++) {
+		changed_parameters_[i] = NULL;
+		paths_[i][0] = 0;
+		modified_times_[i] = 0;
+		file_sizes_[i] = 0;
+		reload_pending_[i] = false;
+	}
+	file_count_ = 0;
+	dropped_messages_ = 0;
+	reported_dropped_messages_ = 0;
+	watching_ = false;
+	log_ = NULL;
+	log_enabled_ = false;
+
+	// Create a new data log object, only written by the watch task once it's started
+	if (logging_enabled) {
+		log_ = new DataLog("parameterwatcher.log");
+		log_enabled_ = log_ != NULL && log_->file_opened_;
+	}
+}
+
+/**
+ * \brief Add a parameter file to the list of watched files.
+ *
+ * The current state of the file is remembered, so it's only reloaded after
+ * it changes.  Files must be added before the task is started.
+ *
+ * \param path the path and filename of the parameter file.
+ * \return the file index to pass to GetChangedParameters(), or -1 if it can't be watched.
+*/
+int ParameterWatcher::Watch(const char * path) {
+	if (path == NULL || watching_ || file_count_ >= kMaxFiles || strlen(path) >= (unsigned int) kMaxPath) {
+		return -1;
+	}
+
+	int file = file_count_;
+	strncpy(paths_[file], path, kMaxPath - 1);
+	paths_[file][kMaxPath - 1] = 0;
+	FileChanged(file);
+	file_count_++;
+	return file;
+}
+
+/**
+ * \brief Watch every file in the current directory with an extension.
+ *
+ * Files must be added before the task is started.
+ *
+ * \param extension the extension of the files, including the '.'.
+ * \return the number of files added.
+*/
+int ParameterWatcher::WatchDirectory(const char * extension) {
+	DIR *directory = NULL;
+	struct dirent *entry = NULL;
+	char message[128] = {0};
+	int added = 0;
+
+	if (extension == NULL || watching_) {
+		return 0;
+	}
+
+	// Open the current directory - '/' on the cRIO
+	directory = opendir(".");
+	if (directory == NULL) {
+		return 0;
+	}
+
+	while ((entry = readdir(directory)) != NULL) {
+		const char * file_extension = strrchr(entry->d_name, '.');
+		if (file_extension == NULL || strcmp(file_extension, extension) != 0 || Find(entry->d_name) >= 0) {
+			continue;
+		}
+		if (Watch(entry->d_name) >= 0) {
+			added++;
+		}
+		else if (log_enabled_) {
+			// The task isn't running yet, so this task can write to the log
+			sprintf(message, "%.64s can't be watched, it won't be reloaded\n", entry->d_name);
+			log_->WriteLine(message);
+		}
+	}
+
+	closedir(directory);
+	return added;
+}
+
+/**
+ * \brief Find a watched file.
+ *
+ * \param path the path and filename the file was added with.
+ * \return the file index to pass to GetChangedParameters(), or -1 if it's not watched.
+*/
+int ParameterWatcher::Find(const char * path) {
+	if (path == NULL) {
+		return -1;
+	}
+
+	for (int i = 0; i < file_count_; i++) {
+		if (strcmp(paths_[i], path) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * \brief Get the number of files being watched.
+ *
+ * \return the number of files, the file indexes are 0 to one less than this.
+*/
+int ParameterWatcher::GetFileCount() {
+	return file_count_;
+}
+
+/**
+ * \brief Get the path of a watched file.
+ *
+ * \param file the file index.
+ * \return the path and filename, or an empty string if the index isn't valid.
+*/
+const char * ParameterWatcher::GetPath(int file) {
+	if (file < 0 || file >= file_count_) {
+		return "";
+	}
+	return paths_[file];
+}
+
+/**
+ * \brief Start watching the files in the background.
+ *
+ * \return true if the task was started.
+*/
+bool ParameterWatcher::Start() {
+	if (watching_) {
+		return true;
+	}
+
+	watching_ = true;
+	if (!watch_task_.Start((TaskArgument) this)) {
+		watching_ = false;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * \brief Stop watching the files.
+ *
+ * \return true if the task is stopped.
+*/
+bool ParameterWatcher::Stop() {
+	bool stopped = true;
+
+	// Give the task time to exit on its own before stopping it
+	watching_ = false;
+	for (int i = 0; i < 20 && watch_task_.Verify(); i++) {
+		Wait(WATCH_PERIOD / 10.0);
+	}
+	if (watch_task_.Verify()) {
+		stopped = watch_task_.Stop();
+	}
+	return stopped;
+}
+
+/**
+ * \brief Get the newly read parameters of a file if it changed.
+ *
+ * Never blocks or reads the file, so it's safe to call from the periodic functions.
+ * The caller takes ownership of the returned object.
+ *
+ * \param file the file index returned by Watch().
+ * \return the new parameters, or NULL if the file hasn't changed.
+*/
+Parameters * ParameterWatcher::GetChangedParameters(int file) {
+	if (file < 0 || file >= file_count_) {
+		return NULL;
+	}
+
+	Parameters *parameters = changed_parameters_[file];
+	if (parameters != NULL) {
+		// Make sure the object is read before the mailbox is emptied
+		MemoryBarrier();
+		changed_parameters_[file] = NULL;
+	}
+	return parameters;
+}
+
+/**
+ * \brief Check if a file was modified since it was last checked.
+ *
+ * \param file the file index.
+ * \return true if the modification time or size changed.
+*/
+bool ParameterWatcher::FileChanged(int file) {
+	struct stat file_status;
+	if (stat(paths_[file], &file_status) != 0) {
+		return false;
+	}
+
+	long modified_time = (long) file_status.st_mtime;
+	long file_size = (long) file_status.st_size;
+	if (modified_time == modified_times_[file] && file_size == file_sizes_[file]) {
+		return false;
+	}
+	modified_times_[file] = modified_time;
+	file_sizes_[file] = file_size;
+	return true;
+}
+
+/**
+ * \brief Static interface for the WatchTask function.
+ *
+ * This function is used so that the actual task function doesn't need
+ * to be static.
+ *
+ * \param this_pointer a pointer to this object.
+ * \return the result of the spawned task.
+*/
+int ParameterWatcher::s_WatchTask(ParameterWatcher *this_pointer) {
+	return this_pointer->WatchTask();
+}
+
+/**
+ * \brief Queues a line for the watch task to write to the log.
+ *
+ * Never blocks or writes to the file, so it's safe to call from the
+ * periodic functions.  Only the robot task may call it.  If the queue is
+ * full the line is dropped and counted.  Has the same interface as
+ * DataLog::WriteLine(), so it can be passed to Parameters::Bind().
+ *
+ * \param line the line, including the carriage return.  Longer lines are cut short.
+*/
+void ParameterWatcher::WriteLine(const char * line) {
+	if (!log_enabled_ || line == NULL) {
+		return;
+	}
+
+	log_message message;
+	strncpy(message.text, line, kMaxLogMessage - 1);
+	message.text[kMaxLogMessage - 1] = 0;
+	if (strlen(line) >= (unsigned int) kMaxLogMessage) {
+		message.text[kMaxLogMessage - 2] = '\n';
+	}
+	if (!log_messages_.Push(message)) {
+		dropped_messages_++;
+	}
+}
+
+/**
+ * \brief Writes the lines queued by WriteLine() to the log.
+ *
+ * Only called by the watch task, or once it has stopped.
+*/
+void ParameterWatcher::WriteLogMessages() {
+	log_message message;
+	while (log_messages_.Pop(&message)) {
+		if (log_enabled_) {
+			log_->WriteLine(message.text);
+		}
+	}
+
+	unsigned int dropped = dropped_messages_;
+	if (dropped != reported_dropped_messages_ && log_enabled_) {
+		char text[64] = {0};
+		sprintf(text, "%u log lines dropped, the queue was full\n", dropped - reported_dropped_messages_);
+		log_->WriteLine(text);
+	}
+	reported_dropped_messages_ = dropped;
+}
+
+/**
+ * \brief Reads the watched files in the background when they change.
+ *
+ * A new Parameters object is only put in a file's mailbox when the mailbox is
+ * empty.  If the robot task hasn't picked up the last one yet, the reload
+ * waits until it has.  The lines queued by the robot task are written to
+ * the log each time around.
+ *
+ * \return 0 when the watcher is stopped.
+*/
+int ParameterWatcher::WatchTask() {
+	char message[128] = {0};
+
+	while (watching_) {
+		Wait(WATCH_PERIOD);
+		WriteLogMessages();
+
+		for (int i = 0; i < file_count_ && watching_; i++) {
+			if (FileChanged(i)) {
+				reload_pending_[i] = true;
+			}
+			if (!reload_pending_[i] || changed_parameters_[i] != NULL) {
+				continue;
+			}
+			reload_pending_[i] = false;
+
+			// Read and parse the file in this task, away from the periodic loops
+			Parameters *parameters = new Parameters(paths_[i]);
+			bool parameters_read = false;
+			if (parameters != NULL && parameters->file_opened_) {
+				parameters_read = parameters->ReadValues();
+				parameters->Close();
+			}
+			if (!parameters_read) {
+				if (log_enabled_) {
+					sprintf(message, "%.64s changed but couldn't be read\n", paths_[i]);
+					log_->WriteLine(message);
+				}
+				SafeDelete(parameters);
+				continue;
+			}
+
+			// Make sure the object is complete before it's put in the mailbox
+			MemoryBarrier();
+			changed_parameters_[i] = parameters;
+		}
+	}
+	return 0;
+}
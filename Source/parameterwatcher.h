@@ -0,0 +1,85 @@
+#ifndef PARAMETERWATCHER_H_
+#define PARAMETERWATCHER_H_
+
+#include "WPILib.h"
+#include "common.h"
+#include "spscqueue.h"
+
+// Forward class definitions
+class DataLog;
+class Parameters;
+
+/**
+ * \class ParameterWatcher
+ * \brief Reloads parameter files in the background when they change.
+ *
+ * A background task watches a list of parameter files.  When one changes,
+ * the task reads and parses it, and hands the new Parameters object to the
+ * robot task through a one slot mailbox per file.  The robot task picks up
+ * the new values between periodic iterations, so it never waits on file I/O.
+ * What the robot task reports about a reload is queued with WriteLine()
+ * and written to the log by the background task for the same reason.
+ */
+class ParameterWatcher {
+
+public:
+	// Public methods
+	ParameterWatcher();
+	ParameterWatcher(bool logging_enabled);
+	~ParameterWatcher();
+	int Watch(const char * path);
+	int WatchDirectory(const char * extension);
+	int Find(const char * path);
+	int GetFileCount();
+	const char * GetPath(int file);
+	bool Start();
+	bool Stop();
+	Parameters * GetChangedParameters(int file);
+	void WriteLine(const char * line);
+
+private:
+	// Private constants
+	static const int kMaxFiles = 8;			///< maximum number of files that can be watched
+	static const int kMaxPath = 64;			///< maximum length of the path of a watched file
+	static const int kMaxLogMessages = 64;	///< number of log lines the robot task can queue before the watch task writes them
+	static const int kMaxLogMessage = 128;	///< longest log line the robot task can queue, including the terminating null
+
+	/**
+	 * \struct log_message
+	 * \brief A line for the log, passed from the robot task to the watch task.
+	 *
+	 * Only the watch task writes to the log, since the log's ring buffer
+	 * only takes records from one task.
+	 */
+	struct log_message {
+		char text[kMaxLogMessage];	///< the line, including the carriage return
+
+		log_message() { text[0] = 0; }
+	};
+
+	// Private methods
+	static int s_WatchTask(ParameterWatcher *this_pointer);
+	int WatchTask();
+	void Initialize(bool logging_enabled);
+	bool FileChanged(int file);
+	void WriteLogMessages();
+
+	// Private member objects
+	Task watch_task_;								///< task object used to spawn the WatchTask() function in a separate thread
+	Parameters * volatile changed_parameters_[kMaxFiles];	///< mailbox of newly read parameters for each file, NULL when empty
+	SpscQueue<log_message, kMaxLogMessages> log_messages_;	///< log lines passed from WriteLine() to the watch task
+	DataLog *log_;									///< log object used to log the reloads to a file
+
+	// Private member variables
+	char paths_[kMaxFiles][kMaxPath];	///< path and filename of each watched file
+	long modified_times_[kMaxFiles];	///< last known modification time of each watched file
+	long file_sizes_[kMaxFiles];		///< last known size of each watched file
+	bool reload_pending_[kMaxFiles];	///< true if a file changed while its mailbox was still full
+	int file_count_;					///< number of files being watched
+	bool log_enabled_;					///< true if logging is enabled
+	volatile unsigned int dropped_messages_;	///< number of log lines dropped because the queue was full, only written by the robot task
+	unsigned int reported_dropped_messages_;	///< number of dropped log lines already reported, only used by the watch task
+	volatile bool watching_;			///< true while the watch task should keep running
+};
+
+#endif
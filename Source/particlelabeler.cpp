@@ -0,0 +1,311 @@
+#include <stdlib.h>
+#include <algorithm>
+#include "particlelabeler.h"
+
+/**
+ * \brief Create the labeler with no particles.
+*/
+ParticleLabeler::ParticleLabeler() {
+	run_count_ = 0;
+	label_count_ = 0;
+	particle_count_ = 0;
+	minimum_area_ = 1;
+	width_ = 0;
+	height_ = 0;
+	overflowed_ = false;
+}
+
+/**
+ * \brief Nothing to clean up, all storage is part of the object.
+*/
+ParticleLabeler::~ParticleLabeler() {
+}
+
+/**
+ * \brief Set the smallest particle that will be reported.
+ *
+ * \param minimum_area the number of pixels.
+*/
+void ParticleLabeler::SetMinimumArea(int minimum_area) {
+	minimum_area_ = minimum_area > 1 ? minimum_area : 1;
+}
+
+/**
+ * \brief Find and measure the particles in a mask.
+ *
+ * \param mask the first byte of the mask, 0 for background and anything else for a particle.
+ * \param width the width of the mask in pixels.
+ * \param height the height of the mask in pixels.
+ * \param pixels_per_line the distance in bytes from the start of one line to the next.
+ * \return true if successful, false if the mask isn't valid.
+*/
+bool ParticleLabeler::Label(const unsigned char * mask, int width, int height, int pixels_per_line) {
+	Rect region = {0, 0, height, width};
+	return Label(mask, width, height, pixels_per_line, region);
+}
+
+/**
+ * \brief Find and measure the particles in part of a mask.
+ *
+ * Pixels outside the region are ignored, so a particle that crosses its
+ * edge is cut off there.  The reports are still in the coordinates of the
+ * whole mask.  If the region has more runs or particles than can be
+ * stored, labeling stops at the end of the last line that fit, the
+ * particles found above it are reported, and Overflowed() returns true.
+ *
+ * \param mask the first byte of the mask, 0 for background and anything else for a particle.
+ * \param width the width of the mask in pixels.
+ * \param height the height of the mask in pixels.
+ * \param pixels_per_line the distance in bytes from the start of one line to the next.
+ * \param region the part of the mask to label.
+ * \return true if successful, false if the mask isn't valid.
+*/
+bool ParticleLabeler::Label(const unsigned char * mask, int width, int height, int pixels_per_line,
+		const Rect &region) {
+	run_count_ = 0;
+	label_count_ = 0;
+	particle_count_ = 0;
+	width_ = width;
+	height_ = height;
+	overflowed_ = false;
+	if (mask == NULL || width <= 0 || height <= 0 || width > 32767 || height > 32767) {
+		return false;
+	}
+
+	// Keep the region inside the mask
+	int left = std::max(region.left, 0);
+	int top = std::max(region.top, 0);
+	int right = std::min(region.left + region.width, width);
+	int bottom = std::min(region.top + region.height, height);
+
+	// The runs of the line above
+	int above_start = 0;
+	int above_end = 0;
+
+	for (int y = top; y < bottom && !overflowed_; y++) {
+		const unsigned char * line = mask + y * pixels_per_line;
+		int line_start = run_count_;
+		int above = above_start;
+		int x = left;
+
+		while (x < right) {
+			// Find the next run
+			while (x < right && line[x] == 0)
+				x++;
+			if (x >= right)
+				break;
+			int start = x;
+			while (x < right && line[x] != 0)
+				x++;
+			int end = x - 1;
+
+			if (run_count_ >= kMaxRuns) {
+				overflowed_ = true;
+				break;
+			}
+
+			// Skip the runs above that end before this one starts, they can't touch any later run either
+			while (above < above_end && runs_[above].end + 1 < start)
+				above++;
+
+			// Join every run above that touches this one, merging their particles
+			int label = -1;
+			for (int i = above; i < above_end && runs_[i].start <= end + 1; i++) {
+				int root = FindRoot(runs_[i].label);
+				if (label < 0) {
+					label = root;
+				}
+				else if (root != label) {
+					// The lower label is kept as the root
+					if (root < label) {
+						parents_[label] = root;
+						label = root;
+					}
+					else {
+						parents_[root] = label;
+					}
+				}
+			}
+
+			// Start a new particle if nothing above touches this run
+			if (label < 0) {
+				if (label_count_ >= kMaxLabels) {
+					overflowed_ = true;
+					break;
+				}
+				label = label_count_;
+				parents_[label] = label;
+				label_count_++;
+			}
+
+			run &new_run = runs_[run_count_];
+			new_run.y = y;
+			new_run.start = start;
+			new_run.end = end;
+			new_run.label = label;
+			run_count_++;
+		}
+
+		// Leave out the line that didn't fit, labels given out on it have no runs so aren't reported
+		if (overflowed_) {
+			run_count_ = line_start;
+		}
+		above_start = line_start;
+		above_end = run_count_;
+	}
+
+	Measure();
+	return true;
+}
+
+/**
+ * \brief Get the number of particles found by the last Label().
+ *
+ * \return the number of particles at least the minimum area.
+*/
+int ParticleLabeler::GetNumberParticles() {
+	return particle_count_;
+}
+
+/**
+ * \brief Get the measurements of a particle in the same form as NI Vision.
+ *
+ * \param particle_number the particle, from 0 to GetNumberParticles() - 1, in the order found from the top.
+ * \param report the report to fill.
+ * \return true if successful.
+*/
+bool ParticleLabeler::GetParticleAnalysisReport(int particle_number, ParticleAnalysisReport * report) {
+	if (report == NULL || particle_number < 0 || particle_number >= particle_count_) {
+		return false;
+	}
+
+	const particle &measured = particles_[particle_labels_[particle_number]];
+	report->imageWidth = width_;
+	report->imageHeight = height_;
+	report->imageTimestamp = 0.0;
+	report->particleIndex = particle_number;
+	report->center_mass_x = (int) (measured.sum_x / measured.area);
+	report->center_mass_y = (int) (measured.sum_y / measured.area);
+	report->center_mass_x_normalized = (measured.sum_x / measured.area - width_ / 2.0) / (width_ / 2.0);
+	report->center_mass_y_normalized = (measured.sum_y / measured.area - height_ / 2.0) / (height_ / 2.0);
+	report->particleArea = measured.area;
+	report->boundingRect.top = measured.top;
+	report->boundingRect.left = measured.left;
+	report->boundingRect.height = measured.bottom - measured.top + 1;
+	report->boundingRect.width = measured.right - measured.left + 1;
+	report->particleToImagePercent = (measured.area * 100.0) / ((double) width_ * height_);
+	report->particleQuality = (measured.area * 100.0) / measured.filled_area;
+	return true;
+}
+
+/**
+ * \brief Get the filled area of a particle.
+ *
+ * \param particle_number the particle, from 0 to GetNumberParticles() - 1.
+ * \return the number of pixels from the leftmost to the rightmost on every line of the particle.
+*/
+int ParticleLabeler::GetFilledArea(int particle_number) {
+	if (particle_number < 0 || particle_number >= particle_count_) {
+		return 0;
+	}
+	return particles_[particle_labels_[particle_number]].filled_area;
+}
+
+/**
+ * \brief Get the runs of pixels that make up a particle.
+ *
+ * \param particle_number the particle, from 0 to GetNumberParticles() - 1.
+ * \param runs each run is added as a rectangle one line high, in whole mask coordinates.
+*/
+void ParticleLabeler::GetRuns(int particle_number, std::vector<Rect> &runs) {
+	if (particle_number < 0 || particle_number >= particle_count_) {
+		return;
+	}
+	int root = particle_labels_[particle_number];
+	for (int i = 0; i < run_count_; i++) {
+		if (FindRoot(runs_[i].label) == root) {
+			Rect line = {runs_[i].y, runs_[i].start, 1, runs_[i].end - runs_[i].start + 1};
+			runs.push_back(line);
+		}
+	}
+}
+
+/**
+ * \brief Check if the last Label() stopped early.
+ *
+ * \return true if the mask had too many runs or particles, so lines below the particles reported weren't labeled.
+*/
+bool ParticleLabeler::Overflowed() {
+	return overflowed_;
+}
+
+/**
+ * \brief Find the label a label was merged into, shortening the path for next time.
+ *
+ * \param label the label.
+ * \return the root label.
+*/
+int ParticleLabeler::FindRoot(int label) {
+	int root = label;
+	while (parents_[root] != root)
+		root = parents_[root];
+	while (parents_[label] != root) {
+		int parent = parents_[label];
+		parents_[label] = root;
+		label = parent;
+	}
+	return root;
+}
+
+/**
+ * \brief Add up the measurements of each particle from its runs.
+*/
+void ParticleLabeler::Measure() {
+	for (int i = 0; i < label_count_; i++) {
+		particles_[i].area = 0;
+	}
+
+	// Runs are in line order, so each particle's runs on a line come together and left to right
+	for (int i = 0; i < run_count_; i++) {
+		const run &current = runs_[i];
+		particle &measured = particles_[FindRoot(current.label)];
+		int length = current.end - current.start + 1;
+
+		if (measured.area == 0) {
+			measured.filled_area = 0;
+			measured.left = current.start;
+			measured.right = current.end;
+			measured.top = current.y;
+			measured.bottom = current.y;
+			measured.sum_x = 0.0;
+			measured.sum_y = 0.0;
+			measured.line = current.y;
+			measured.line_left = current.start;
+		}
+		else if (measured.line != current.y) {
+			measured.filled_area += measured.line_right - measured.line_left + 1;
+			measured.line = current.y;
+			measured.line_left = current.start;
+		}
+		measured.line_right = current.end;
+
+		measured.area += length;
+		measured.left = std::min(measured.left, (int) current.start);
+		measured.right = std::max(measured.right, (int) current.end);
+		measured.bottom = current.y;
+		measured.sum_x += (current.start + current.end) * length / 2.0;
+		measured.sum_y += (double) current.y * length;
+	}
+
+	// Report the particles large enough, in order of their first run
+	for (int i = 0; i < label_count_; i++) {
+		if (parents_[i] != i || particles_[i].area == 0)
+			continue;
+		particle &measured = particles_[i];
+		measured.filled_area += measured.line_right - measured.line_left + 1;
+		if (measured.area >= minimum_area_) {
+			particle_labels_[particle_count_] = i;
+			particle_count_++;
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#ifndef PARTICLELABELER_H_
+#define PARTICLELABELER_H_
+
+#include <vector>
+#include "Vision2009/VisionAPI.h"
+
+/**
+ * \class ParticleLabeler
+ * \brief Finds the particles in a mask and measures them in one pass.
+ *
+ * Each line of the mask is split into runs of non-zero pixels.  A run that
+ * touches a run on the line above, including diagonally, joins its
+ * particle, and particles that turn out to be connected are merged.  Once
+ * the whole mask has been read, the area, bounding rectangle and center of
+ * mass of each particle are added up from its runs.  So is the filled area,
+ * which counts every pixel between the leftmost and rightmost pixel of the
+ * particle on each line, like the particle after a convex hull.  All
+ * storage is part of the object, so labeling never allocates memory.  A
+ * mask with more runs or particles than that is only labeled down to the
+ * last line that fits.
+ */
+class ParticleLabeler {
+
+public:
+	// Public methods
+	ParticleLabeler();
+	~ParticleLabeler();
+	void SetMinimumArea(int minimum_area);
+	bool Label(const unsigned char * mask, int width, int height, int pixels_per_line);
+	bool Label(const unsigned char * mask, int width, int height, int pixels_per_line, const Rect &region);
+	int GetNumberParticles();
+	bool GetParticleAnalysisReport(int particle_number, ParticleAnalysisReport * report);
+	int GetFilledArea(int particle_number);
+	void GetRuns(int particle_number, std::vector<Rect> &runs);
+	bool Overflowed();
+
+private:
+	// Private constants
+	static const int kMaxRuns = 16384;		///< maximum number of runs in a mask
+	static const int kMaxLabels = 2048;		///< maximum number of labels given out before merging
+
+	/**
+	 * \struct run
+	 * \brief A horizontal line of non-zero pixels.
+	 */
+	struct run {
+		short y;		///< line of the run
+		short start;	///< first pixel of the run
+		short end;		///< last pixel of the run
+		short label;	///< label given to the run, the particle is found by following it to its root
+	};
+
+	/**
+	 * \struct particle
+	 * \brief The measurements of a particle added up from its runs.
+	 */
+	struct particle {
+		int area;			///< number of pixels
+		int filled_area;	///< number of pixels from the leftmost to the rightmost on every line
+		int left;			///< leftmost pixel
+		int right;			///< rightmost pixel
+		int top;			///< top line
+		int bottom;			///< bottom line
+		double sum_x;		///< total of the x coordinates of every pixel
+		double sum_y;		///< total of the y coordinates of every pixel
+		int line;			///< line of the last run added
+		int line_left;		///< leftmost pixel on that line
+		int line_right;		///< rightmost pixel on that line
+	};
+
+	// Private methods
+	int FindRoot(int label);
+	void Measure();
+
+	// Private member variables
+	run runs_[kMaxRuns];					///< runs of the mask, in line order
+	short parents_[kMaxLabels];				///< label each label was merged into, itself for a root
+	particle particles_[kMaxLabels];		///< measurements of each root label
+	short particle_labels_[kMaxLabels];		///< root label of each particle reported
+	int run_count_;							///< number of runs in runs_
+	int label_count_;						///< number of labels given out
+	int particle_count_;					///< number of particles reported
+	int minimum_area_;						///< particles with fewer pixels are ignored
+	int width_;								///< width of the last mask labeled
+	int height_;							///< height of the last mask labeled
+	bool overflowed_;						///< true if the last mask had too many runs or particles to label all of it
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "readfile.h"
+
+/**
+ * \brief Read an entire file into a buffer with one read.
+ *
+ * A null terminator is added after the file contents.
+ *
+ * \param file the open file, read from the start.
+ * \param buffer the buffer to fill.
+ * \return true if successful.
+*/
+bool ReadFile(FILE * file, std::vector<char> &buffer) {
+	if (file == NULL) {
+		return false;
+	}
+
+	// Find the size of the file
+	if (fseek(file, 0, SEEK_END) != 0) {
+		return false;
+	}
+	long size = ftell(file);
+	if (size < 0) {
+		return false;
+	}
+	rewind(file);
+
+	buffer.resize(size + 1);
+	size_t read = 0;
+	if (size > 0) {
+		read = fread(&buffer[0], 1, size, file);
+	}
+	buffer.resize(read + 1);
+	buffer[read] = 0;
+	return true;
+}
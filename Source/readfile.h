@@ -0,0 +1,11 @@
+#ifndef READFILE_H_
+#define READFILE_H_
+
+#include <stdio.h>
+#include <vector>
+
+// Function to read an entire open file into a buffer with one read, used by
+// Parameters and AutoScript
+bool ReadFile(FILE * file, std::vector<char> &buffer);
+
+#endif
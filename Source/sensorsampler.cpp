@@ -0,0 +1,266 @@
+#include "WPILib.h"
+#include "sensorsampler.h"
+#include "looptimer.h"
+
+/**
+ * \brief Create the sampler with no sensors, with the task stopped.
+*/
+SensorSampler::SensorSampler()
+	: sample_task_("sensorsampler", (FUNCPTR) s_SampleTask)
+{
+	sample_timer_ = new Timer();
+	channels_semaphore_ = semMCreate(SEM_Q_PRIORITY | SEM_INVERSION_SAFE | SEM_DELETE_SAFE);
+	sample_rate_ = 500;
+}
+
+/**
+ * \brief Stop the task.  The sensors belong to the caller and aren't deleted.
+*/
+SensorSampler::~SensorSampler() {
+	Stop();
+	SafeDelete(sample_timer_);
+	semDelete(channels_semaphore_);
+}
+
+/**
+ * \brief Start reading the sensors in a separate task.
+ *
+ * \param sample_rate number of times per second the sensors are read.
+ * \return true if the task was started.
+*/
+bool SensorSampler::Start(int sample_rate) {
+	Stop();
+	if (sample_rate <= 0) {
+		return false;
+	}
+	sample_rate_ = sample_rate;
+	return sample_task_.Start((TaskArgument) this);
+}
+
+/**
+ * \brief Stop reading the sensors.  The readings already taken are kept.
+ *
+ * \return true if the task was running.
+*/
+bool SensorSampler::Stop() {
+	if (sample_task_.Verify()) {
+		return sample_task_.Stop();
+	}
+	return false;
+}
+
+/**
+ * \brief Read an encoder's count.
+ *
+ * \param encoder the encoder, which must stay until Remove() is called.
+ * \return the channel to get the readings from, or -1 if no more sensors can be added.
+*/
+int SensorSampler::AddEncoder(Encoder * encoder) {
+	return AddChannel(encoder, NULL);
+}
+
+/**
+ * \brief Read a gyro's angle.
+ *
+ * \param gyro the gyro, which must stay until Remove() is called.
+ * \return the channel to get the readings from, or -1 if no more sensors can be added.
+*/
+int SensorSampler::AddGyro(Gyro * gyro) {
+	return AddChannel(NULL, gyro);
+}
+
+/**
+ * \brief Stop reading a sensor, so it can be deleted.
+ *
+ * \param channel the channel returned when the sensor was added.
+*/
+void SensorSampler::Remove(int channel) {
+	if (channel < 0 || channel >= kMaxChannels) {
+		return;
+	}
+	CRITICAL_REGION(channels_semaphore_)
+		channels_[channel].encoder = NULL;
+		channels_[channel].gyro = NULL;
+	END_REGION
+}
+
+/**
+ * \brief Ignore the readings taken so far, such as after the sensor is reset.
+ *
+ * Until the next reading, the Get functions return false for the channel.
+ *
+ * \param channel the channel returned when the sensor was added.
+*/
+void SensorSampler::DiscardSamples(int channel) {
+	if (channel < 0 || channel >= kMaxChannels) {
+		return;
+	}
+	channels_[channel].discard_before = LoopTimer::GetTimestamp();
+}
+
+/**
+ * \brief Get the latest reading of a sensor.
+ *
+ * \param channel the channel returned when the sensor was added.
+ * \param sample set to the latest reading.
+ * \return true if successful, false if there are no readings.
+*/
+bool SensorSampler::GetLatest(int channel, sensor_sample * sample) {
+	return CopySamples(channel, sample, 1) == 1;
+}
+
+/**
+ * \brief Get the average of the latest readings of a sensor.
+ *
+ * \param channel the channel returned when the sensor was added.
+ * \param count the number of readings to average.  Fewer are used if there aren't that many.
+ * \param average set to the average.
+ * \return true if successful, false if there are no readings.
+*/
+bool SensorSampler::GetAverage(int channel, int count, double * average) {
+	sensor_sample samples[kHistorySize];
+	int copied = CopySamples(channel, samples, count);
+	if (copied == 0) {
+		return false;
+	}
+	double total = 0.0;
+	for (int i = 0; i < copied; i++) {
+		total += samples[i].value;
+	}
+	*average = total / copied;
+	return true;
+}
+
+/**
+ * \brief Static interface for the SampleTask function.
+ *
+ * Static interface that will cause an instantiation if necessary.
+ * This function is used so that the actual task function doesn't need
+ * to be static.
+ *
+ * \param this_pointer a pointer to this object.
+ * \return the result of the spawned task.
+*/
+int SensorSampler::s_SampleTask(SensorSampler *this_pointer) {
+	return this_pointer->SampleTask();
+}
+
+/**
+ * \brief Reads every sensor at a fixed rate.
+ *
+ * \return 0 on success (but the task should never finish on it's own).
+*/
+int SensorSampler::SampleTask() {
+	double next_time = 0.0;
+	sample_timer_->Reset();
+	sample_timer_->Start();
+
+	// Loop repeatedly
+	while (true) {
+		CRITICAL_REGION(channels_semaphore_)
+			for (int i = 0; i < kMaxChannels; i++) {
+				sensor_channel &channel = channels_[i];
+				if (channel.encoder == NULL && channel.gyro == NULL) {
+					continue;
+				}
+				sensor_sample &sample = channel.samples[channel.written % kHistorySize];
+				sample.timestamp = LoopTimer::GetTimestamp();
+				if (channel.encoder != NULL) {
+					sample.value = channel.encoder->Get();
+				}
+				else {
+					sample.value = channel.gyro->GetAngle();
+				}
+				// The reading must be written before the reading task can see it
+				MemoryBarrier();
+				channel.written = channel.written + 1;
+			}
+		END_REGION
+
+		// Wait for the next readings, without letting the time taken here add up
+		next_time += 1.0 / sample_rate_;
+		double now = sample_timer_->Get();
+		if (next_time > now) {
+			Wait(next_time - now);
+		}
+		else {
+			// Too far behind to catch up, so start again from now
+			next_time = now;
+			Wait(0.0);
+		}
+	}
+	return 0;
+}
+
+/**
+ * \brief Add a sensor to the first free channel.
+ *
+ * \param encoder the encoder, or NULL.
+ * \param gyro the gyro, or NULL.
+ * \return the channel, or -1 if there are no free channels.
+*/
+int SensorSampler::AddChannel(Encoder * encoder, Gyro * gyro) {
+	if (encoder == NULL && gyro == NULL) {
+		return -1;
+	}
+	int added = -1;
+	CRITICAL_REGION(channels_semaphore_)
+		for (int i = 0; i < kMaxChannels && added < 0; i++) {
+			sensor_channel &channel = channels_[i];
+			if (channel.encoder == NULL && channel.gyro == NULL) {
+				channel.encoder = encoder;
+				channel.gyro = gyro;
+				channel.discard_before = 0;
+				channel.written = 0;
+				added = i;
+			}
+		}
+	END_REGION
+	return added;
+}
+
+/**
+ * \brief Copy the latest readings of a sensor, newest first.
+ *
+ * Readings taken before the last DiscardSamples() aren't copied.  If the
+ * sampling task writes over any of the readings while they're being
+ * copied, they are copied again.
+ *
+ * \param channel the channel returned when the sensor was added.
+ * \param samples filled with the readings.
+ * \param count the most readings to copy.
+ * \return the number of readings copied.
+*/
+int SensorSampler::CopySamples(int channel, sensor_sample * samples, int count) {
+	if (channel < 0 || channel >= kMaxChannels || count <= 0) {
+		return 0;
+	}
+	sensor_channel &source = channels_[channel];
+	// The oldest reading kept is the next one written over
+	if (count > kHistorySize - 1) {
+		count = kHistorySize - 1;
+	}
+
+	for (int attempt = 0; attempt < 3; attempt++) {
+		UINT32 written = source.written;
+		// The readings must not be read before the sampling task has finished writing them
+		MemoryBarrier();
+		int copied = 0;
+		while (copied < count && (UINT32) copied < written) {
+			const sensor_sample &sample = source.samples[(written - 1 - copied) % kHistorySize];
+			if (sample.timestamp < source.discard_before) {
+				break;
+			}
+			samples[copied] = sample;
+			copied++;
+		}
+		MemoryBarrier();
+
+		// Reading n is overwritten by reading n + kHistorySize, which may be being written now
+		UINT32 now_written = source.written;
+		if (now_written - written < (UINT32) (kHistorySize - copied)) {
+			return copied;
+		}
+	}
+	return 0;
+}
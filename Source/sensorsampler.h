@@ -0,0 +1,83 @@
+#ifndef SENSORSAMPLER_H_
+#define SENSORSAMPLER_H_
+
+#include "WPILib.h"
+#include "common.h"
+
+/**
+ * \struct sensor_sample
+ * \brief A sensor reading and when it was read.
+ */
+struct sensor_sample {
+	UINT64 timestamp;	///< time in nanoseconds from LoopTimer::GetTimestamp()
+	double value;		///< encoder count or gyro angle in degrees
+
+	sensor_sample():
+		timestamp(0), value(0.0) {}
+};
+
+/**
+ * \class SensorSampler
+ * \brief Reads sensors at a fixed rate in a separate task.
+ *
+ * Each sensor added is a channel with its own ring buffer of timestamped
+ * readings.  The sampling task is the only writer of the ring buffers, and
+ * the task that added the sensors reads them without locking: it copies
+ * the readings it wants and then checks the sampling task hasn't written
+ * over them in the meantime.  The periodic loops get the latest reading,
+ * or an average of the recent readings, without waiting for the sensors.
+ * Adding and removing sensors is done under a semaphore, so the sampling
+ * task never reads a sensor that is being deleted.
+ */
+class SensorSampler {
+
+public:
+	// Public methods
+	SensorSampler();
+	~SensorSampler();
+	bool Start(int sample_rate);
+	bool Stop();
+	int AddEncoder(Encoder * encoder);
+	int AddGyro(Gyro * gyro);
+	void Remove(int channel);
+	void DiscardSamples(int channel);
+	bool GetLatest(int channel, sensor_sample * sample);
+	bool GetAverage(int channel, int count, double * average);
+
+private:
+	// Private constants
+	static const int kMaxChannels = 8;		///< maximum number of sensors that can be sampled
+	static const int kHistorySize = 256;	///< number of readings kept for each sensor, half a second at 500 Hz
+
+	/**
+	 * \struct sensor_channel
+	 * \brief A sensor and the ring buffer of its readings.
+	 */
+	struct sensor_channel {
+		Encoder *encoder;					///< encoder read by the channel, NULL if it isn't an encoder
+		Gyro *gyro;							///< gyro read by the channel, NULL if it isn't a gyro
+		UINT64 discard_before;				///< readings taken before this time are ignored, only used by the reading task
+		volatile UINT32 written;			///< number of readings written, only written by the sampling task
+		sensor_sample samples[kHistorySize];	///< the readings, reading n is at index n % kHistorySize
+
+		sensor_channel():
+			encoder(NULL), gyro(NULL), discard_before(0), written(0) {}
+	};
+
+	// Private methods
+	static int s_SampleTask(SensorSampler *this_pointer);
+	int SampleTask();
+	int AddChannel(Encoder * encoder, Gyro * gyro);
+	int CopySamples(int channel, sensor_sample * samples, int count);
+
+	// Private member objects
+	Task sample_task_;					///< task object used to spawn the SampleTask() function in a separate thread
+	Timer *sample_timer_;				///< timer object used to keep the readings at a fixed rate
+	SEM_ID channels_semaphore_;			///< semaphore held while the sensors are being read or changed
+
+	// Private member variables
+	sensor_channel channels_[kMaxChannels];	///< the sensors and their readings
+	int sample_rate_;					///< number of times per second the sensors are read
+};
+
+#endif
@@ -2,7 +2,10 @@
 #include "WPILib.h"
 #include "shooter.h"
 #include "datalog.h"
+#include "feedbackcontroller.h"
 #include "parameters.h"
+#include "parameterwatcher.h"
+#include "sensorsampler.h"
 
 /**
  * \brief Create and initialize a shooter.
@@ -32,7 +35,7 @@ Shooter::Shooter(bool logging_enabled) {
  *
  * \param parameters shooter parameter file path and name.
 */
-Shooter::Shooter(char * parameters) {
+Shooter::Shooter(const char * parameters) {
 	Initialize(parameters, false);
 }
 
@@ -45,7 +48,7 @@ Shooter::Shooter(char * parameters) {
  * \param parameters shooter parameter file path and name.
  * \param logging_enabled true if logging is enabled.
 */
-Shooter::Shooter(char * parameters, bool logging_enabled) {
+Shooter::Shooter(const char * parameters, bool logging_enabled) {
 	Initialize(parameters, logging_enabled);
 }
 
@@ -56,10 +59,13 @@ Shooter::~Shooter() {
 	if (log_ != NULL) {
 		log_->Close();
 	}
+	SetSensorSampler(NULL);
 	SafeDelete(shooter_controller_);
 	SafeDelete(pitch_controller_);
 	SafeDelete(encoder_);
 	SafeDelete(timer_);
+	SafeDelete(feedback_timer_);
+	SafeDelete(pitch_feedback_);
 	SafeDelete(log_);
 	SafeDelete(parameters_);
 }
@@ -72,7 +78,7 @@ Shooter::~Shooter() {
  * \param parameters shooter parameter file path and name.
  * \param logging_enabled true if logging is enabled.
 */
-void Shooter::Initialize(char * parameters, bool logging_enabled) {
+void Shooter::Initialize(const char * parameters, bool logging_enabled) {
 	// Initialize public member variables
 	encoder_enabled_ = false;
 	shooter_enabled_ = false;
@@ -83,38 +89,23 @@ void Shooter::Initialize(char * parameters, bool logging_enabled) {
 	pitch_controller_ = NULL;
 	encoder_ = NULL;
 	timer_ = NULL;
+	feedback_timer_ = NULL;
+	pitch_feedback_ = NULL;
+	sensor_sampler_ = NULL;
 	log_ = NULL;
 	parameters_ = NULL;
 
 	// Initialize private parameters
+	int binding_count = 0;
+	const parameter_binding<Shooter> * bindings = GetParameterBindings(&binding_count);
+	Parameters::SetDefaults(this, bindings, binding_count);
 	invert_multiplier_ = 0.0;
-	shooter_normal_speed_ratio_ = 1.0;
-	pitch_normal_speed_ratio_ = 1.0;
-	pitch_turbo_speed_ratio_ = 1.0;
-	auto_far_speed_ratio_ = 1.0;
-	auto_medium_speed_ratio_ = 1.0;
-	auto_near_speed_ratio_ = 1.0;	
-	auto_medium_encoder_threshold_ = 50;
-	auto_far_encoder_threshold_ = 100;
-	auto_medium_time_threshold_ = 0.5;
-	auto_far_time_threshold_ = 1.0;
-	encoder_threshold_ = 10;
-	pitch_up_direction_ = 1.0;
-	pitch_down_direction_ = -1.0;
-	shoot_forward_direction_ = 1.0;
-	shoot_backward_direction_ = -1.0;
-	time_threshold_ = 0.1;
-	encoder_max_limit_ = -1;
-	encoder_min_limit_ = -1;
-	shooter_min_power_speed_ = 0.4;
-	shooter_power_adjustment_ratio_ = 0.006;
-	angle_linear_fit_gradient_ = 1.0;
-	angle_linear_fit_constant_ = 0.0;
-	fulcrum_clear_encoder_count_ = 0;
 
 	// Initialize private member variables
 	encoder_count_ = 0;
 	log_enabled_ = false;
+	encoder_count_channel_ = -1;
+	encoder_sample_channel_ = -1;
 	robot_state_ = kDisabled;
 	ignore_encoder_limits_ = false;
 
@@ -124,6 +115,8 @@ void Shooter::Initialize(char * parameters, bool logging_enabled) {
 	// Enable logging if specified
 	if (log_ != NULL && log_->file_opened_) {
 		log_enabled_ = logging_enabled;
+		// Register the values logged every loop so they don't need string work
+		encoder_count_channel_ = log_->RegisterChannel("Encoder count");
 	}
 	else {
 		log_enabled_ = false;
@@ -131,13 +124,100 @@ void Shooter::Initialize(char * parameters, bool logging_enabled) {
 
 	// Create a timer object
 	timer_ = new Timer();
+
+	// Create the pitch feedback controller and the timer it measures its updates with
+	pitch_feedback_ = new FeedbackController();
+	feedback_timer_ = new Timer();
+	if (feedback_timer_ != NULL) {
+		feedback_timer_->Start();
+	}
 	
 	// Attempt to read the parameters file
-	strncpy(parameters_file_, parameters, sizeof(parameters_file_));
+	strncpy(parameters_file_, parameters, sizeof(parameters_file_) - 1);
+	parameters_file_[sizeof(parameters_file_) - 1] = 0;
 
 	LoadParameters();
 }
 
+/**
+ * \brief Get the table of parameters that are copied straight into member variables.
+ *
+ * Each entry has the parameter name, the member variable, the default value,
+ * and the minimum and maximum values allowed in the file.
+ *
+ * \param count set to the number of bindings in the table.
+ * \return the table of parameter bindings.
+*/
+const parameter_binding<Shooter> * Shooter::GetParameterBindings(int * count) {
+	static const parameter_binding<Shooter> bindings[] = {
+		IntParameter(Shooter, "ENCODER_THRESHOLD", encoder_threshold_, 10, 0, 100000),
+		FloatParameter(Shooter, "PITCH_UP_DIRECTION", pitch_up_direction_, 1.0, -1.0, 1.0),
+		FloatParameter(Shooter, "PITCH_DOWN_DIRECTION", pitch_down_direction_, -1.0, -1.0, 1.0),
+		FloatParameter(Shooter, "PITCH_NORMAL_SPEED_RATIO", pitch_normal_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Shooter, "PITCH_TURBO_SPEED_RATIO", pitch_turbo_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Shooter, "SHOOTER_NORMAL_SPEED_RATIO", shooter_normal_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Shooter, "AUTO_FAR_SPEED_RATIO", auto_far_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Shooter, "AUTO_MEDIUM_SPEED_RATIO", auto_medium_speed_ratio_, 1.0, 0.0, 1.0),
+		FloatParameter(Shooter, "AUTO_NEAR_SPEED_RATIO", auto_near_speed_ratio_, 1.0, 0.0, 1.0),
+		DoubleParameter(Shooter, "TIME_THRESHOLD", time_threshold_, 0.1, 0.0, 60.0),
+		IntParameter(Shooter, "AUTO_MEDIUM_ENCODER_THRESHOLD", auto_medium_encoder_threshold_, 50, 0, 100000),
+		IntParameter(Shooter, "AUTO_FAR_ENCODER_THRESHOLD", auto_far_encoder_threshold_, 100, 0, 100000),
+		FloatParameter(Shooter, "AUTO_MEDIUM_TIME_THRESHOLD", auto_medium_time_threshold_, 0.5, 0.0, 60.0),
+		FloatParameter(Shooter, "AUTO_FAR_TIME_THRESHOLD", auto_far_time_threshold_, 1.0, 0.0, 60.0),
+		IntParameter(Shooter, "ENCODER_MAX_LIMIT", encoder_max_limit_, -1, -100000, 100000),
+		IntParameter(Shooter, "ENCODER_MIN_LIMIT", encoder_min_limit_, -1, -100000, 100000),
+		FloatParameter(Shooter, "SHOOT_FORWARD_DIRECTION", shoot_forward_direction_, 1.0, -1.0, 1.0),
+		FloatParameter(Shooter, "SHOOT_BACKWARD_DIRECTION", shoot_backward_direction_, -1.0, -1.0, 1.0),
+		FloatParameter(Shooter, "SHOOTER_MIN_POWER_SPEED", shooter_min_power_speed_, 0.4, 0.0, 1.0),
+		FloatParameter(Shooter, "SHOOTER_POWER_ADJUSTMENT_RATIO", shooter_power_adjustment_ratio_, 0.006, 0.0, 1.0),
+		FloatParameter(Shooter, "ANGLE_LINEAR_FIT_GRADIENT", angle_linear_fit_gradient_, 1.0, -100000.0, 100000.0),
+		FloatParameter(Shooter, "ANGLE_LINEAR_FIT_CONSTANT", angle_linear_fit_constant_, 0.0, -100000.0, 100000.0),
+		IntParameter(Shooter, "FULCRUM_CLEAR_ENCODER_COUNT", fulcrum_clear_encoder_count_, 0, -100000, 100000),
+		IntParameter(Shooter, "PITCH_FEEDBACK_ENABLED", pitch_feedback_enabled_, 0, 0, 1),
+		FloatParameter(Shooter, "PITCH_PROPORTIONAL_GAIN", pitch_proportional_gain_, 0.005, 0.0, 1.0),
+		FloatParameter(Shooter, "PITCH_INTEGRAL_GAIN", pitch_integral_gain_, 0.0, 0.0, 1.0),
+		FloatParameter(Shooter, "PITCH_DERIVATIVE_GAIN", pitch_derivative_gain_, 0.00025, 0.0, 1.0),
+		FloatParameter(Shooter, "PITCH_FEEDFORWARD_GAIN", pitch_feedforward_gain_, 0.0, 0.0, 1.0),
+		FloatParameter(Shooter, "PITCH_STATIC_FEEDFORWARD", pitch_static_feedforward_, 0.1, 0.0, 1.0),
+		FloatParameter(Shooter, "PITCH_MAXIMUM_OUTPUT_CHANGE", pitch_maximum_output_change_, 8.0, 0.0, 100.0),
+		FloatParameter(Shooter, "PITCH_SETTLE_RATE", pitch_settle_rate_, 50.0, 0.0, 100000.0),
+		DoubleParameter(Shooter, "PITCH_SETTLE_TIME", pitch_settle_time_, 0.1, 0.0, 10.0)
+	};
+	*count = sizeof(bindings) / sizeof(bindings[0]);
+	return bindings;
+}
+
+/**
+ * \brief Copies the tuning values from newly read parameters into the member variables.
+ *
+ * Used to pick up changes to the parameter file while the robot is running.
+ * Only the tuning values are changed, the hardware is not recreated.
+ *
+ * \param parameters the newly read parameters.  This object takes ownership of them.
+ * \param reload_log where the reload is reported, or NULL to not report it.  The
+ * watcher writes it to its log in the background, so this doesn't wait on the file.
+ * \return true if every tuning value was found and in range.
+*/
+bool Shooter::ReloadParameters(Parameters * parameters, ParameterWatcher * reload_log) {
+	if (parameters == NULL) {
+		return false;
+	}
+
+	if (reload_log != NULL) {
+		reload_log->WriteLine("Shooter parameters reloaded\n");
+	}
+
+	// Copy the tuning values into the bound member variables
+	int binding_count = 0;
+	const parameter_binding<Shooter> * bindings = GetParameterBindings(&binding_count);
+	int problems = parameters->Bind(this, bindings, binding_count, reload_log);
+
+	// Keep the new parameters so GetValue calls see the same values
+	SafeDelete(parameters_);
+	parameters_ = parameters;
+	return problems == 0;
+}
+
 /**
  * \brief Loads the parameter file into memory, copies the values into local/member variables,
  * and creates and initializes objects using those values.
@@ -159,6 +239,10 @@ bool Shooter::LoadParameters() {
 	bool parameters_read = false;	// This should default to false
 
 	
+	// Stop sampling the old encoder before it's deleted
+	SensorSampler * sensor_sampler = sensor_sampler_;
+	SetSensorSampler(NULL);
+
 	// Close and delete old objects
 	SafeDelete(parameters_);
 	SafeDelete(encoder_);
@@ -181,6 +265,10 @@ bool Shooter::LoadParameters() {
 	
 	// Set shooter variables based on the parameters file
 	if (parameters_read) {
+		// Copy the tuning values into the bound member variables
+		int binding_count = 0;
+		const parameter_binding<Shooter> * bindings = GetParameterBindings(&binding_count);
+		parameters_->Bind(this, bindings, binding_count, log_enabled_ ? log_ : NULL);
 		parameters_->GetValue("SHOOTER_MOTOR_SLOT", &shooter_motor_slot);
 		parameters_->GetValue("SHOOTER_MOTOR_CHANNEL", &shooter_motor_channel);
 		parameters_->GetValue("PITCH_MOTOR_SLOT", &pitch_motor_slot);
@@ -191,31 +279,8 @@ bool Shooter::LoadParameters() {
 		parameters_->GetValue("ENCODER_B_CHANNEL", &encoder_b_channel);
 		parameters_->GetValue("ENCODER_REVERSE", &encoder_reverse);
 		parameters_->GetValue("ENCODER_TYPE", &encoder_type);
-		parameters_->GetValue("ENCODER_THRESHOLD", &encoder_threshold_);
 		parameters_->GetValue("MOTOR_SAFETY_TIMEOUT", &motor_safety_timeout);
 		parameters_->GetValue("INVERT_CONTROLS", &invert_controls);		
-		parameters_->GetValue("PITCH_UP_DIRECTION", &pitch_up_direction_);
-		parameters_->GetValue("PITCH_DOWN_DIRECTION", &pitch_down_direction_);
-		parameters_->GetValue("PITCH_NORMAL_SPEED_RATIO", &pitch_normal_speed_ratio_);
-		parameters_->GetValue("PITCH_TURBO_SPEED_RATIO", &pitch_turbo_speed_ratio_);
-		parameters_->GetValue("SHOOTER_NORMAL_SPEED_RATIO", &shooter_normal_speed_ratio_);
-		parameters_->GetValue("AUTO_FAR_SPEED_RATIO", &auto_far_speed_ratio_);
-		parameters_->GetValue("AUTO_MEDIUM_SPEED_RATIO", &auto_medium_speed_ratio_);
-		parameters_->GetValue("AUTO_NEAR_SPEED_RATIO", &auto_near_speed_ratio_);
-		parameters_->GetValue("TIME_THRESHOLD", &time_threshold_);
-		parameters_->GetValue("AUTO_MEDIUM_ENCODER_THRESHOLD", &auto_medium_encoder_threshold_);
-		parameters_->GetValue("AUTO_FAR_ENCODER_THRESHOLD", &auto_far_encoder_threshold_);
-		parameters_->GetValue("AUTO_MEDIUM_TIME_THRESHOLD", &auto_medium_time_threshold_);
-		parameters_->GetValue("AUTO_FAR_TIME_THRESHOLD", &auto_far_time_threshold_);
-		parameters_->GetValue("ENCODER_MAX_LIMIT", &encoder_max_limit_);
-		parameters_->GetValue("ENCODER_MIN_LIMIT", &encoder_min_limit_);
-		parameters_->GetValue("SHOOT_FORWARD_DIRECTION", &shoot_forward_direction_);
-		parameters_->GetValue("SHOOT_BACKWARD_DIRECTION", &shoot_backward_direction_);
-		parameters_->GetValue("SHOOTER_MIN_POWER_SPEED", &shooter_min_power_speed_);
-		parameters_->GetValue("SHOOTER_POWER_ADJUSTMENT_RATIO", &shooter_power_adjustment_ratio_);
-		parameters_->GetValue("ANGLE_LINEAR_FIT_GRADIENT", &angle_linear_fit_gradient_);
-		parameters_->GetValue("ANGLE_LINEAR_FIT_CONSTANT", &angle_linear_fit_constant_);
-		parameters_->GetValue("FULCRUM_CLEAR_ENCODER_COUNT", &fulcrum_clear_encoder_count_);
 	}
 
 	// Check if the encoder is present/enabled
@@ -230,6 +295,7 @@ bool Shooter::LoadParameters() {
 	else {
 		encoder_enabled_ = false;
 	}
+	SetSensorSampler(sensor_sampler);
 	
 	// Check if the pitch motor is present/enabled
 	if (pitch_motor_slot > 0 && pitch_motor_channel > 0) {
@@ -294,7 +360,28 @@ bool Shooter::LoadParameters() {
 */
 void Shooter::ReadSensors() {
 	if (encoder_enabled_) {
-		encoder_count_ = encoder_->Get();
+		// Use the sensor sampler's latest reading if there is one
+		sensor_sample sample;
+		if (sensor_sampler_ != NULL && sensor_sampler_->GetLatest(encoder_sample_channel_, &sample))
+			encoder_count_ = (int) sample.value;
+		else
+			encoder_count_ = encoder_->Get();
+	}
+}
+
+/**
+ * \brief Read the encoder with a sensor sampler instead of in ReadSensors().
+ *
+ * \param sampler the sensor sampler, or NULL to read the encoder in ReadSensors().
+*/
+void Shooter::SetSensorSampler(SensorSampler * sampler) {
+	if (sensor_sampler_ != NULL) {
+		sensor_sampler_->Remove(encoder_sample_channel_);
+	}
+	encoder_sample_channel_ = -1;
+	sensor_sampler_ = sampler;
+	if (sensor_sampler_ != NULL && encoder_enabled_) {
+		encoder_sample_channel_ = sensor_sampler_->AddEncoder(encoder_);
 	}
 }
 
@@ -321,6 +408,11 @@ void Shooter::SetRobotState(ProgramState state) {
 	if (timer_ != NULL) {
 		timer_->Stop();
 	}
+
+	// Start any feedback controlled movement over
+	if (pitch_feedback_ != NULL) {
+		pitch_feedback_->Reset();
+	}
 	
 	// Adjust motor safety checks depending on the robot state
 	if (state == kDisabled) {
@@ -359,7 +451,7 @@ void Shooter::GetCurrentState(char * output_buffer) {
 void Shooter::LogCurrentState() {
 	if (log_ != NULL) {
 		if (encoder_enabled_)
-			log_->WriteValue("Encoder count", encoder_count_, true);
+			log_->WriteChannel(encoder_count_channel_, encoder_count_, true);
 	}
 }
 
@@ -406,6 +498,11 @@ bool Shooter::SetPitch(int encoder_count, float speed) {
 		}
 	}
 
+	// Move with the feedback controller if it's enabled
+	if (pitch_feedback_enabled_ && pitch_feedback_ != NULL && feedback_timer_ != NULL) {
+		return ControlPitch(encoder_count, speed);
+	}
+
 	// Check to see if we've reached the proper height
 	if (abs(encoder_count - encoder_count_) <= encoder_threshold_) {
 		pitch_controller_->Set(0, 0);
@@ -551,6 +648,11 @@ bool Shooter::SetPitchAngle(float angle, float speed) {
 			return true;
 		}
 	}
+
+	// Move with the feedback controller if it's enabled
+	if (pitch_feedback_enabled_ && pitch_feedback_ != NULL && feedback_timer_ != NULL) {
+		return ControlPitch(encoder_count, speed);
+	}
 	
 	// Check to see if we've reached the proper height
 	if (abs(encoder_count - encoder_count_) <= encoder_threshold_) {
@@ -589,6 +691,38 @@ bool Shooter::SetPitchAngle(float angle, float speed) {
 	}
 }
 
+/**
+ * \brief Moves the shooter pitch toward a position using the feedback controller.
+ *
+ * The encoder limits must already have been checked.
+ *
+ * \param encoder_count desired position in encoder counts.
+ * \param speed largest motor speed ratio.
+ * \return true when the pitch has settled at the desired position.
+*/
+bool Shooter::ControlPitch(int encoder_count, float speed) {
+	// Pick up any changes to the parameters
+	pitch_feedback_->SetGains(pitch_proportional_gain_, pitch_integral_gain_, pitch_derivative_gain_,
+			pitch_feedforward_gain_, pitch_static_feedforward_);
+	pitch_feedback_->SetOutputLimits(speed, pitch_maximum_output_change_);
+	pitch_feedback_->SetTolerance(encoder_threshold_, pitch_settle_rate_, pitch_settle_time_);
+
+	// Positive output moves toward more encoder counts, which is down
+	float output = pitch_feedback_->Calculate(encoder_count, 0.0, encoder_count_, feedback_timer_->Get());
+	if (pitch_feedback_->IsSettled()) {
+		pitch_controller_->Set(0, 0);
+		pitch_feedback_->Reset();
+		return true;
+	}
+	if (output > 0.0) {
+		pitch_controller_->Set(pitch_down_direction_ * output, 0);
+	}
+	else {
+		pitch_controller_->Set(-pitch_up_direction_ * output, 0);
+	}
+	return false;
+}
+
 /**
  * \brief Moves the shooter pitch until commanded otherwise.
  *
@@ -6,9 +6,13 @@
 // Forward class definitions
 class DataLog;
 class Encoder;
+class FeedbackController;
 class Jaguar;
 class Parameters;
+class ParameterWatcher;
+class SensorSampler;
 class Timer;
+template <class T> struct parameter_binding;
 
 /**
  * \class Shooter
@@ -23,11 +27,13 @@ public:
 	// Public methods
 	Shooter();
 	Shooter(bool logging_enabled);
-	Shooter(char * parameters);
-	Shooter(char * parameters, bool logging_enabled);	
+	Shooter(const char * parameters);
+	Shooter(const char * parameters, bool logging_enabled);	
 	~Shooter();
 	bool LoadParameters();
+	bool ReloadParameters(Parameters * parameters, ParameterWatcher * reload_log);
 	void ReadSensors();
+	void SetSensorSampler(SensorSampler * sampler);
 	void ResetAndStartTimer();
 	void SetRobotState(ProgramState state);
 	void GetCurrentState(char * output_buffer);
@@ -49,7 +55,9 @@ public:
 
 private:
 	// Private methods
-	void Initialize(char * parameters, bool logging_enabled);
+	void Initialize(const char * parameters, bool logging_enabled);
+	static const parameter_binding<Shooter> * GetParameterBindings(int * count);
+	bool ControlPitch(int encoder_count, float speed);
 	
 	// Private member objects
 	Jaguar *pitch_controller_;		///< motor controller used to move the pitch
@@ -58,6 +66,9 @@ private:
 	DataLog *log_;					///< log object used to log data or status comments to a file
 	Parameters *parameters_;		///< parameters object used to load shooter parameters from a file
 	Timer *timer_;					///< timer object used for timed autonomous functions
+	Timer *feedback_timer_;			///< timer object used to measure the time between feedback controller updates
+	FeedbackController *pitch_feedback_;	///< works out the pitch motor speed in SetPitch() and SetPitchAngle() when PITCH_FEEDBACK_ENABLED is set
+	SensorSampler *sensor_sampler_;	///< reads the encoder at a fixed rate in a separate task, NULL to read it in ReadSensors()
 	
 	// Private parameters
 	float shooter_normal_speed_ratio_;		///< shooter movement speed ratio (percentage) used during 'normal' mode
@@ -84,10 +95,21 @@ private:
 	float angle_linear_fit_gradient_;		///< linear fit gradient used in converting an angle to encoder counts for setting the pitch
 	float angle_linear_fit_constant_;		///< linear fit constant used in converting an angle to encoder counts for setting the pitch
 	int fulcrum_clear_encoder_count_;		///< number of encoder counts when the fulcrum is clear for the winch to be used
+	int pitch_feedback_enabled_;			///< 1 to move the pitch to a position with the feedback controller instead of the speed ratios
+	float pitch_proportional_gain_;			///< pitch motor speed for each encoder count from the set point
+	float pitch_integral_gain_;				///< pitch motor speed for each encoder count from the set point held for a second
+	float pitch_derivative_gain_;			///< pitch motor speed taken away for each encoder count per second the pitch is moving
+	float pitch_feedforward_gain_;			///< pitch motor speed for each encoder count per second the set point is moving
+	float pitch_static_feedforward_;		///< pitch motor speed added toward the set point to overcome friction
+	float pitch_maximum_output_change_;		///< largest change in the pitch motor speed each second, 0 for no limit
+	float pitch_settle_rate_;				///< largest pitch speed in encoder counts per second at which it has settled
+	double pitch_settle_time_;				///< time in seconds the pitch must stay within the thresholds to have settled
 
 	// Private member variables
 	int encoder_count_;			///< current number of encoder counts for the pitch
 	bool log_enabled_;			///< true if logging is enabled
+	int encoder_count_channel_;	///< log channel for the encoder count
+	int encoder_sample_channel_;	///< sensor sampler channel of the encoder, -1 if it isn't sampled
 	char parameters_file_[25];	///< path and filename of the parameter file to read
 	ProgramState robot_state_;	///< current state of the robot obtained from the field
 	bool ignore_encoder_limits_;
@@ -0,0 +1,160 @@
+#include <math.h>
+#include "slewratelimiter.h"
+
+/**
+ * \def MAXIMUM_STEP
+ * \brief Longest time in seconds between calls to Calculate() that the value can change over.
+ *
+ * Keeps the value from jumping after a stalled loop.  Loops slower than
+ * this change the value more slowly than the maximum rate.
+ */
+#define MAXIMUM_STEP 0.1
+
+/**
+ * \def INTEGRATION_STEP
+ * \brief Time in seconds the value is moved over at a time.
+ *
+ * Each call moves the value in steps of this length, so loops whose period
+ * is a multiple of it give exactly the same values.
+ */
+#define INTEGRATION_STEP 0.001
+
+/**
+ * \def TIME_TOLERANCE
+ * \brief Rounding in seconds allowed when working out whether another step fits before the current time.
+ */
+#define TIME_TOLERANCE 0.000001
+
+/**
+ * \brief Create the limiter at 0, with no limits.
+*/
+SlewRateLimiter::SlewRateLimiter() {
+	SetLimits(0.0, 0.0);
+	Reset(0.0);
+}
+
+/**
+ * \brief Nothing to clean up.
+*/
+SlewRateLimiter::~SlewRateLimiter() {
+}
+
+/**
+ * \brief Set how fast the value can change.
+ *
+ * \param maximum_rate largest change in the value each second, 0 for no limit.
+ * \param maximum_rate_change largest change in the rate each second, 0 for no limit.
+*/
+void SlewRateLimiter::SetLimits(float maximum_rate, float maximum_rate_change) {
+	maximum_rate_ = maximum_rate;
+	maximum_rate_change_ = maximum_rate_change;
+}
+
+/**
+ * \brief Set the value, not changing.
+ *
+ * The next Calculate() doesn't change the value, since there is no time
+ * since the last call to measure.
+ *
+ * \param value the value.
+*/
+void SlewRateLimiter::Reset(float value) {
+	running_ = false;
+	integrated_time_ = 0.0;
+	target_ = value;
+	value_ = value;
+	rate_ = 0.0;
+}
+
+/**
+ * \brief Move the value toward the value wanted, within the limits.
+ *
+ * The target is taken to have been wanted since the last call, so the
+ * value starts moving toward a new target in the same call.
+ *
+ * \param target the value wanted.
+ * \param time the current time in seconds, from a clock that keeps running between calls.
+ * \return the new value.
+*/
+float SlewRateLimiter::Calculate(float target, double time) {
+	// Without limits, go straight to the target
+	if (maximum_rate_ <= 0.0 && maximum_rate_change_ <= 0.0) {
+		running_ = true;
+		integrated_time_ = time;
+		target_ = target;
+		value_ = target;
+		rate_ = 0.0;
+		return target;
+	}
+
+	// Start measuring time from the first call
+	if (!running_) {
+		running_ = true;
+		integrated_time_ = time;
+	}
+	else if (time - integrated_time_ > MAXIMUM_STEP) {
+		integrated_time_ = time - MAXIMUM_STEP;
+	}
+
+	// Move toward the current target up to the current time
+	target_ = target;
+	while (integrated_time_ + INTEGRATION_STEP <= time + TIME_TOLERANCE) {
+		Step();
+		integrated_time_ += INTEGRATION_STEP;
+	}
+	return (float) value_;
+}
+
+/**
+ * \brief Get the value returned by the last Calculate().
+ *
+ * \return the value.
+*/
+float SlewRateLimiter::GetValue() {
+	return (float) value_;
+}
+
+/**
+ * \brief Move the value toward the target over one INTEGRATION_STEP, within the limits.
+*/
+void SlewRateLimiter::Step() {
+	// The rate that reaches the target in this step, within the maximum rate
+	double error = target_ - value_;
+	double rate = error / INTEGRATION_STEP;
+	if (maximum_rate_ > 0.0) {
+		if (rate > maximum_rate_) {
+			rate = maximum_rate_;
+		}
+		else if (rate < -maximum_rate_) {
+			rate = -maximum_rate_;
+		}
+	}
+
+	if (maximum_rate_change_ > 0.0) {
+		// Start slowing down early enough to stop at the target
+		double stopping_rate = sqrt(2.0 * maximum_rate_change_ * fabs(error));
+		if (rate > stopping_rate) {
+			rate = stopping_rate;
+		}
+		else if (rate < -stopping_rate) {
+			rate = -stopping_rate;
+		}
+
+		// Change the rate gradually
+		double maximum_change = maximum_rate_change_ * INTEGRATION_STEP;
+		if (rate > rate_ + maximum_change) {
+			rate = rate_ + maximum_change;
+		}
+		else if (rate < rate_ - maximum_change) {
+			rate = rate_ - maximum_change;
+		}
+	}
+
+	// Move, stopping at the target rather than passing it
+	value_ += rate * INTEGRATION_STEP;
+	rate_ = rate;
+	if ((error >= 0.0 && value_ > target_) || (error <= 0.0 && value_ < target_)) {
+		value_ = target_;
+		rate_ = 0.0;
+	}
+}
@@ -0,0 +1,48 @@
+#ifndef SLEWRATELIMITER_H_
+#define SLEWRATELIMITER_H_
+
+/**
+ * \class SlewRateLimiter
+ * \brief Limits how fast a value, such as a motor speed, can change over time.
+ *
+ * Calculate() is called once each periodic loop with the value wanted and
+ * the time.  Over the time that actually passed since the last call, the
+ * value moves toward the value wanted now, in fixed steps of
+ * INTEGRATION_STEP and by no more than the maximum rate.  So a new value
+ * wanted moves the value in the same loop, and the path over time only
+ * depends on how often the loop runs by what one loop period can change
+ * it.  With a maximum rate change (jerk) set, the rate itself builds up
+ * and dies away gradually, and starts dying away early enough to stop at
+ * the value wanted without passing it.  A long gap between calls, such as
+ * a stalled loop, only counts as MAXIMUM_STEP, so the value can't jump.
+ * Nothing here uses WPILib, so the limiter can be checked on the
+ * development computer.
+ */
+class SlewRateLimiter {
+
+public:
+	// Public methods
+	SlewRateLimiter();
+	~SlewRateLimiter();
+	void SetLimits(float maximum_rate, float maximum_rate_change);
+	void Reset(float value);
+	float Calculate(float target, double time);
+	float GetValue();
+
+private:
+	// Private methods
+	void Step();
+
+	// Private parameters
+	float maximum_rate_;		///< largest change in the value each second, 0 for no limit
+	float maximum_rate_change_;	///< largest change in the rate each second, 0 for no limit
+
+	// Private member variables
+	bool running_;				///< false until Calculate() is called after a Reset()
+	double integrated_time_;	///< time the value has been moved up to
+	float target_;				///< target passed to the last Calculate(), which the value moves toward
+	double value_;				///< value returned by the last Calculate()
+	double rate_;				///< rate the value changed at in the last Calculate(), in units per second
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef SPSCQUEUE_H_
+#define SPSCQUEUE_H_
+
+#include "common.h"
+
+/**
+ * \class SpscQueue
+ * \brief A fixed size first in, first out queue between two tasks, without locking.
+ *
+ * One task pushes values and one task pops them.  Each index is only
+ * written by one of the tasks, so neither ever waits for the other; a push
+ * to a full queue or a pop from an empty one fails straight away and the
+ * caller decides whether to try again later.  Values come out in the order
+ * they were pushed.
+ */
+template <class T, int N> class SpscQueue {
+
+public:
+	// Public methods
+	SpscQueue();
+	~SpscQueue();
+	bool Push(const T &value);
+	bool Pop(T * value);
+	bool IsEmpty();
+	void Clear();
+
+private:
+	// Private constants
+	static const int kSlots = N + 1;	///< one slot is always empty, so a full queue can be told apart from an empty one
+
+	// Private member variables
+	T values_[kSlots];			///< the values in the queue
+	volatile int head_;			///< index of the next value to pop, only written by the popping task
+	volatile int tail_;			///< index of the next slot to push into, only written by the pushing task
+};
+
+/**
+ * \brief Create an empty queue.
+*/
+template <class T, int N> SpscQueue<T, N>::SpscQueue() {
+	head_ = 0;
+	tail_ = 0;
+}
+
+/**
+ * \brief Nothing to clean up, the values are part of the object.
+*/
+template <class T, int N> SpscQueue<T, N>::~SpscQueue() {
+}
+
+/**
+ * \brief Add a value to the end of the queue.  Pushing task only.
+ *
+ * \param value the value to add.
+ * \return true if successful, false if the queue is full.
+*/
+template <class T, int N> bool SpscQueue<T, N>::Push(const T &value) {
+	int tail = tail_;
+	int next = tail + 1 == kSlots ? 0 : tail + 1;
+	if (next == head_) {
+		return false;
+	}
+	values_[tail] = value;
+	// The value must be written before the popping task can see it
+	MemoryBarrier();
+	tail_ = next;
+	return true;
+}
+
+/**
+ * \brief Remove the value at the front of the queue.  Popping task only.
+ *
+ * \param value set to the value removed.
+ * \return true if successful, false if the queue is empty.
+*/
+template <class T, int N> bool SpscQueue<T, N>::Pop(T * value) {
+	int head = head_;
+	if (head == tail_) {
+		return false;
+	}
+	// The value must not be read before the pushing task has finished writing it
+	MemoryBarrier();
+	*value = values_[head];
+	MemoryBarrier();
+	head_ = head + 1 == kSlots ? 0 : head + 1;
+	return true;
+}
+
+/**
+ * \brief Check if there is anything to pop.
+ *
+ * \return true if the queue is empty.
+*/
+template <class T, int N> bool SpscQueue<T, N>::IsEmpty() {
+	return head_ == tail_;
+}
+
+/**
+ * \brief Empty the queue.  Only call while neither task is using it.
+*/
+template <class T, int N> void SpscQueue<T, N>::Clear() {
+	head_ = 0;
+	tail_ = 0;
+}
+
+#endif
@@ -4,6 +4,11 @@
 #include "targeting.h"
 #include "parameters.h"
 #include "datalog.h"
+#include "thresholdkernel.h"
+#include "visionpipeline.h"
+#include "framerecording.h"
+#include "thresholdtuner.h"
+#include "looptimer.h"
 
 /**
  * \def GetMsecTime()
@@ -17,13 +22,26 @@
  */
 #define PI 3.141592653
 
+/**
+ * \def STAGE_WAIT
+ * \brief The time in seconds a search task waits before checking again when it has nothing to do.
+ */
+#define STAGE_WAIT 0.005
+
+/**
+ * \def LABEL_OVERFLOW_LOG_INTERVAL
+ * \brief After the first, regions with too many particles to label are only logged once in this many.
+ */
+#define LABEL_OVERFLOW_LOG_INTERVAL 30
+
 /**
  * \brief Create and initialize the targeting system.
  *
  * Use the default parameter file "targeting.par" and logging is disabled.
 */
 Targeting::Targeting()
-	: find_targets_task_("findtargets", (FUNCPTR) s_FindTargetsTask)
+	: find_targets_task_("findtargets", (FUNCPTR) s_FindTargetsTask),
+	  acquire_frames_task_("acquireframes", (FUNCPTR) s_AcquireFramesTask)
 {
 	Initialize("targeting.par", false);
 }
@@ -37,7 +55,8 @@ Targeting::Targeting()
  * \param logging_enabled true if logging is enabled.
 */
 Targeting::Targeting(bool logging_enabled)
-	: find_targets_task_("findtargets", (FUNCPTR) s_FindTargetsTask)
+	: find_targets_task_("findtargets", (FUNCPTR) s_FindTargetsTask),
+	  acquire_frames_task_("acquireframes", (FUNCPTR) s_AcquireFramesTask)
 {
 
 	Initialize("targeting.par", logging_enabled);
@@ -51,7 +70,8 @@ Targeting::Targeting(bool logging_enabled)
  * \param parameters targeting parameter file path and name.
 */
 Targeting::Targeting(const char * parameters)
-	: find_targets_task_("findtargets", (FUNCPTR) s_FindTargetsTask)
+	: find_targets_task_("findtargets", (FUNCPTR) s_FindTargetsTask),
+	  acquire_frames_task_("acquireframes", (FUNCPTR) s_AcquireFramesTask)
 {
 
 	Initialize(parameters, false);
@@ -67,7 +87,8 @@ Targeting::Targeting(const char * parameters)
  * \param logging_enabled true if logging is enabled.
 */
 Targeting::Targeting(const char * parameters, bool logging_enabled)
-	: find_targets_task_("findtargets", (FUNCPTR) s_FindTargetsTask)
+	: find_targets_task_("findtargets", (FUNCPTR) s_FindTargetsTask),
+	  acquire_frames_task_("acquireframes", (FUNCPTR) s_AcquireFramesTask)
 {
 
 	Initialize(parameters, logging_enabled);
@@ -82,10 +103,19 @@ Targeting::~Targeting() {
 	}
 	SafeDelete(log_);
 	SafeDelete(parameters_);
+	if (acquire_frames_task_.Verify()) {
+		acquire_frames_task_.Stop();
+	}
 	if (find_targets_task_.Verify()) {
 		find_targets_task_.Stop();
 	}
-	SafeDelete(particle_report_);
+	for (int i = 0; i < kFrameSlots; i++) {
+		SafeDelete(frames_[i].image);
+	}
+	SafeDelete(mask_image_);
+	SafeDelete(vision_pipeline_);
+	SafeDelete(threshold_tuner_);
+	SafeDelete(frame_recording_);
 }
 
 /**
@@ -105,12 +135,17 @@ void Targeting::Initialize(const char * parameters, bool logging_enabled) {
 	// Initialize private member objects
 	log_ = NULL;
 	parameters_ = NULL;
-	CRITICAL_REGION(find_targets_semaphore_)
-		particle_report_ = NULL;
-	END_REGION
+	for (int i = 0; i < kFrameSlots; i++) {
+		frames_[i].image = NULL;
+	}
+	mask_image_ = NULL;
+	vision_pipeline_ = new VisionPipeline();
+	threshold_tuner_ = new ThresholdTuner();
+	frame_recording_ = NULL;
 	
 	// Initialize private parameters
 	camera_view_angle_ = 43.5;
+	camera_latency_ = 0.0;
 	camera_resolution_ = 2;
 	frames_per_second_ = 5;
 	color_level_ = 50;
@@ -128,6 +163,16 @@ void Targeting::Initialize(const char * parameters, bool logging_enabled) {
 	threshold_plane_2_high_ = 255;
 	threshold_plane_3_low_ = 0;
 	threshold_plane_3_high_ = 50;
+	threshold_kernel_enabled_ = 0;
+	record_frames_ = 0;
+	threshold_tuning_ = 0;
+	threshold_tuning_limit_ = 20;
+	threshold_tuning_step_ = 2;
+	threshold_tuning_margin_ = 4;
+	threshold_tuning_samples_ = 5000;
+	particle_minimum_area_ = 30;
+	tracking_full_scan_interval_ = 0;
+	tracking_padding_ = 10;
 	particle_filter_filled_minimum_ = 35;
 	particle_filter_filled_maximum_ = 65;
 	target_rectangle_ratio_minimum_ = 1.0;
@@ -145,6 +190,14 @@ void Targeting::Initialize(const char * parameters, bool logging_enabled) {
 	camera_horizontal_width_in_pixels_ = 0;
 	camera_vertical_height_in_pixels_ = 0;
 	robot_state_ = kDisabled;
+	robot_heading_ = 0.0;
+	tracking_heading_ = 0.0;
+	frames_since_full_scan_ = 0;
+	ready_frame_ = -1;
+	acquire_frame_ = -1;
+	reported_label_overflows_ = 0;
+	frames_recorded_ = 0;
+	geometry_table_width_ = 0;
 	
 	// Create a new data log object
 	log_ = new DataLog("targeting.log");
@@ -158,7 +211,8 @@ void Targeting::Initialize(const char * parameters, bool logging_enabled) {
 	}
 	
 	// Attempt to read the parameters file
-	strncpy(parameters_file_, parameters, sizeof(parameters_file_));
+	strncpy(parameters_file_, parameters, sizeof(parameters_file_) - 1);
+	parameters_file_[sizeof(parameters_file_) - 1] = 0;
 
 	LoadParameters();
 }
@@ -192,6 +246,7 @@ bool Targeting::LoadParameters() {
 	// Set targeting variables based on the parameters file
 	if (parameters_read) {
 		parameters_->GetValue("CAMERA_VIEW_ANGLE", &camera_view_angle_);
+		parameters_->GetValue("CAMERA_LATENCY", &camera_latency_);
 		parameters_->GetValue("CAMERA_PRESENT", &camera_present);
 		parameters_->GetValue("CAMERA_RESOLUTION", &camera_resolution_);
 		parameters_->GetValue("FRAMES_PER_SECOND", &frames_per_second_);
@@ -210,6 +265,16 @@ bool Targeting::LoadParameters() {
 		parameters_->GetValue("THRESHOLD_PLANE_2_HIGH", &threshold_plane_2_high_);
 		parameters_->GetValue("THRESHOLD_PLANE_3_LOW", &threshold_plane_3_low_);
 		parameters_->GetValue("THRESHOLD_PLANE_3_HIGH", &threshold_plane_3_high_);
+		parameters_->GetValue("THRESHOLD_KERNEL", &threshold_kernel_enabled_);
+		parameters_->GetValue("RECORD_FRAMES", &record_frames_);
+		parameters_->GetValue("THRESHOLD_TUNING", &threshold_tuning_);
+		parameters_->GetValue("THRESHOLD_TUNING_LIMIT", &threshold_tuning_limit_);
+		parameters_->GetValue("THRESHOLD_TUNING_STEP", &threshold_tuning_step_);
+		parameters_->GetValue("THRESHOLD_TUNING_MARGIN", &threshold_tuning_margin_);
+		parameters_->GetValue("THRESHOLD_TUNING_SAMPLES", &threshold_tuning_samples_);
+		parameters_->GetValue("PARTICLE_MINIMUM_AREA", &particle_minimum_area_);
+		parameters_->GetValue("TRACKING_FULL_SCAN_INTERVAL", &tracking_full_scan_interval_);
+		parameters_->GetValue("TRACKING_PADDING", &tracking_padding_);
 		parameters_->GetValue("PARTICLE_FILTER_FILLED_MINIMUM", &particle_filter_filled_minimum_);
 		parameters_->GetValue("PARTICLE_FILTER_FILLED_MAXIMUM", &particle_filter_filled_maximum_);
 		parameters_->GetValue("TARGET_RECTANGLE_RATIO_MINIMUM",&target_rectangle_ratio_minimum_);
@@ -221,6 +286,15 @@ bool Targeting::LoadParameters() {
 		parameters_->GetValue("TARGET_RECTANGLE_SCORE_THRESHOLD",&target_rectangle_score_threshold_);
 	}
 
+	// Tune the threshold starting from the configured one
+	if (threshold_tuner_ != NULL) {
+		int low[3] = {threshold_plane_1_low_, threshold_plane_2_low_, threshold_plane_3_low_};
+		int high[3] = {threshold_plane_1_high_, threshold_plane_2_high_, threshold_plane_3_high_};
+		threshold_tuner_->SetTuning(threshold_tuning_limit_, threshold_tuning_step_, threshold_tuning_margin_,
+				threshold_tuning_samples_);
+		threshold_tuner_->SetThreshold((ThresholdKernel::ColorSpace) threshold_type_, low, high);
+	}
+
 	// Check if the camera is enabled or not
 	if (camera_present)
 		camera_enabled_ = true;
@@ -236,7 +310,9 @@ bool Targeting::LoadParameters() {
 		}
 	}
 
+	// The angle and distance tables are built again with the new values by InitializeCamera()
 	camera_initialized_ = false;
+	geometry_table_width_ = 0;
 
 	return parameters_read;
 }
@@ -261,6 +337,17 @@ void Targeting::SetRobotState(ProgramState state) {
 	}	
 }
 
+/**
+ * \brief Set the current heading of the robot, used to predict where targets move between frames.
+ *
+ * \param heading the heading in degrees, increasing to the right.
+*/
+void Targeting::SetHeading(float heading) {
+	CRITICAL_REGION(find_targets_semaphore_)
+		robot_heading_ = heading;
+	END_REGION
+}
+
 /**
  * \brief Enable or disable logging for this object.
  *
@@ -280,8 +367,11 @@ void Targeting::SetLogState(bool state) {
  * \return the number of degrees off target.
 */
 double Targeting::GetHorizontalAngleOfTarget(ParticleAnalysisReport *target) {
-	double degrees_off_center = (-(camera_view_angle_ * ((target->imageWidth / 2.0) - target->center_mass_x)) / target->imageWidth) + angle_of_target_horiztonal_offset_;
-	return degrees_off_center;
+	if (target->imageWidth == geometry_table_width_ && target->center_mass_x >= 0 &&
+			target->center_mass_x < geometry_table_width_) {
+		return horizontal_angle_table_[target->center_mass_x];
+	}
+	return CalculateHorizontalAngle(target->center_mass_x, target->imageWidth);
 }
 
 /**
@@ -291,10 +381,11 @@ double Targeting::GetHorizontalAngleOfTarget(ParticleAnalysisReport *target) {
  * \return the angle in degrees of the target.
 */
 double Targeting::GetVerticalAngleOfTarget(ParticleAnalysisReport *target) {
-	double distance = GetCameraDistanceToTarget(target) + angle_of_target_distance_offset_;
-	double height = GetCameraHeightOfTarget(target);
-	double angle = (atan(height/distance) * 180.0 / PI) + angle_of_target_vertical_offset_;
-	return angle;
+	int observed_target_width = target->boundingRect.width;
+	if (observed_target_width > 0 && observed_target_width <= geometry_table_width_) {
+		return vertical_angle_table_[GetEnumHeightOfTarget(target)][observed_target_width];
+	}
+	return CalculateVerticalAngle(observed_target_width, GetCameraHeightOfTarget(target));
 }
 
 /**
@@ -305,9 +396,10 @@ double Targeting::GetVerticalAngleOfTarget(ParticleAnalysisReport *target) {
 */
 double Targeting::GetCameraDistanceToTarget(ParticleAnalysisReport *target) {
 	int observed_target_width = target->boundingRect.width;
-	double rectangle_width = 2.0 * camera_horizontal_width_in_pixels_ / observed_target_width;
-	double distance = (rectangle_width / 2.0) / tan(((camera_view_angle_ * PI / 180.0) / 2.0));	
-	return distance;
+	if (observed_target_width > 0 && observed_target_width <= geometry_table_width_) {
+		return distance_table_[observed_target_width];
+	}
+	return CalculateDistance(observed_target_width);
 }
 
 /**
@@ -398,23 +490,29 @@ Targeting::TargetHeight Targeting::GetEnumHeightOfTarget(double height) {
  *
  * \param target_height the height as an enumeration.
  * \param buffer the characeter array to contain the height as a character array.
+ * \param length the size of the buffer.
 */
-void Targeting::GetStringHeightOfTarget(TargetHeight target_height, char *buffer) {
+void Targeting::GetStringHeightOfTarget(TargetHeight target_height, char *buffer, int length) {
+	if (buffer == NULL || length <= 0) {
+		return;
+	}
+
 	// Convert a height enumeration to a string
 	switch(target_height) {
 	case Targeting::kHigh:
-		strncpy(buffer, "High", sizeof(buffer));
+		strncpy(buffer, "High", length - 1);
 		break;
 	case Targeting::kMedium:
-		strncpy(buffer, "Medium", sizeof(buffer));
+		strncpy(buffer, "Medium", length - 1);
 		break;
 	case Targeting::kLow:
-		strncpy(buffer, "Low", sizeof(buffer));
+		strncpy(buffer, "Low", length - 1);
 		break;
 	default:
-		strncpy(buffer, "Unknown", sizeof(buffer));
+		strncpy(buffer, "Unknown", length - 1);
 		break;			
 	}
+	buffer[length - 1] = 0;
 }
 
 /**
@@ -430,27 +528,105 @@ double Targeting::GetFOVPercentageOfTarget(ParticleAnalysisReport *target) {
 /**
  * \brief Gets the latest target report from the targeting system.
  *
+ * The report is shared with the search task without locking or copying.
+ * It stays unchanged until this, or GetTargets(), is called again, and
+ * both must only be called from one task.
+ *
+ * \return the report, or NULL if the camera is disabled or no report has been made yet.
+*/
+const target_report * Targeting::GetLatestTargets() {
+	// Abort if we don't have the camera
+	if (!camera_enabled_) {
+		return NULL;
+	}
+
+	const target_report * report = target_reports_.GetLatest();
+	if (report->version == 0) {
+		return NULL;
+	}
+	return report;
+}
+
+/**
+ * \brief Gets a copy of the latest targets from the targeting system.
+ *
  * \param report a reference to a vector of ParticleAnalysisReport that will contain the reports.
  * \return true if successful.
 */
 bool Targeting::GetTargets(vector<ParticleAnalysisReport> &report) {
-	// Abort if we don't have the camera
-	if (!camera_enabled_) {
+	const target_report * latest = GetLatestTargets();
+	if (latest == NULL) {
 		return false;
 	}
+	report.assign(latest->targets.begin(), latest->targets.end());
+	return true;
+}
 
-	// Block other threads from accessing the particle report while it's copied
-	CRITICAL_REGION(find_targets_semaphore_)
-	if (particle_report_ != NULL) {
-		// Copy the report to the referenced vector passed in
-		report.resize(particle_report_->size());
-		report.assign(particle_report_->begin(), particle_report_->end());
-		return true;
+/**
+ * \brief Calculate the number of degrees the robot is off a target.
+ *
+ * \param center_mass_x the column of the center of the target in pixels.
+ * \param image_width the width of the image in pixels.
+ * \return the number of degrees off target.
+*/
+double Targeting::CalculateHorizontalAngle(int center_mass_x, int image_width) {
+	double degrees_off_center = (-(camera_view_angle_ * ((image_width / 2.0) - center_mass_x)) / image_width) + angle_of_target_horiztonal_offset_;
+	return degrees_off_center;
+}
+
+/**
+ * \brief Calculate the vertical angle in degrees from the robot to a target.
+ *
+ * \param observed_target_width the width of the target in pixels.
+ * \param height the height in feet of the target.
+ * \return the angle in degrees of the target.
+*/
+double Targeting::CalculateVerticalAngle(int observed_target_width, double height) {
+	double distance = CalculateDistance(observed_target_width) + angle_of_target_distance_offset_;
+	double angle = (atan(height/distance) * 180.0 / PI) + angle_of_target_vertical_offset_;
+	return angle;
+}
+
+/**
+ * \brief Calculate the estimated distance in feet to a target.
+ *
+ * \param observed_target_width the width of the target in pixels.
+ * \return the number of feet away from the target.
+*/
+double Targeting::CalculateDistance(int observed_target_width) {
+	double rectangle_width = 2.0 * camera_horizontal_width_in_pixels_ / observed_target_width;
+	double distance = (rectangle_width / 2.0) / tan(((camera_view_angle_ * PI / 180.0) / 2.0));	
+	return distance;
+}
+
+/**
+ * \brief Builds the tables of target angles and distances for the camera's resolution.
+ *
+ * The horizontal angle is looked up by the column of the target's center,
+ * and the distance and vertical angle by the width of the target, so
+ * finding them for a target doesn't need tan() or atan().  The tables are
+ * built from the Calculate functions, so they give the same results.
+*/
+void Targeting::BuildGeometryTables() {
+	// The heights returned by GetCameraHeightOfTarget(), in TargetHeight order
+	static const double target_heights[4] = {9.177083, 8.2604167, 2.583, 0.0};
+
+	geometry_table_width_ = 0;
+	int width = camera_horizontal_width_in_pixels_;
+	if (width <= 0 || width > kMaxTableWidth) {
+		return;
 	}
-	else {
-		return false;
+
+	for (int x = 0; x < width; x++) {
+		horizontal_angle_table_[x] = CalculateHorizontalAngle(x, width);
 	}
-	END_REGION
+	for (int observed_width = 1; observed_width <= width; observed_width++) {
+		distance_table_[observed_width] = CalculateDistance(observed_width);
+		for (int i = 0; i < 4; i++) {
+			vertical_angle_table_[i][observed_width] = CalculateVerticalAngle(observed_width, target_heights[i]);
+		}
+	}
+	geometry_table_width_ = width;
 }
 
 /**
@@ -486,6 +662,9 @@ void Targeting::InitializeCamera() {
 				break;
 		}
 		
+		// Angles and distances are looked up for this resolution from now on
+		BuildGeometryTables();
+
 		// Set the camera settings
 		axis_camera.WriteBrightness(brightness_);
 		axis_camera.WriteColorLevel(color_level_);
@@ -494,15 +673,43 @@ void Targeting::InitializeCamera() {
 		axis_camera.WriteMaxFPS(frames_per_second_);
 		axis_camera.WriteResolution((AxisCameraParams::Resolution_t) camera_resolution_);
 		axis_camera.WriteWhiteBalance((AxisCameraParams::WhiteBalance_t) white_balance_);
+
+		// Create the images used by the search task at the camera's resolution
+		AllocateImages();
 		camera_initialized_ = true;
 	}
 }
 
+/**
+ * \brief Creates the images and report storage used by FindTargetsTask().
+ *
+ * Everything is allocated once at the camera's resolution, so processing a
+ * frame doesn't allocate any memory.  Must not be called while the task is
+ * running.
+*/
+void Targeting::AllocateImages() {
+	for (int i = 0; i < kFrameSlots; i++) {
+		if (frames_[i].image == NULL)
+			frames_[i].image = new ColorImage(IMAQ_IMAGE_RGB);
+		if (frames_[i].image != NULL)
+			imaqSetImageSize(frames_[i].image->GetImaqImage(), camera_horizontal_width_in_pixels_, camera_vertical_height_in_pixels_);
+	}
+
+	if (mask_image_ == NULL)
+		mask_image_ = new BinaryImage();
+	if (mask_image_ != NULL)
+		imaqSetImageSize(mask_image_->GetImaqImage(), camera_horizontal_width_in_pixels_, camera_vertical_height_in_pixels_);
+
+	for (int i = 0; i < 3; i++) {
+		target_reports_.GetBuffer(i)->targets.reserve(kMaxParticles);
+	}
+}
+
 /**
  * \brief Starts taking images searching for targets.
  *
- * Spawns a new task in the background so that the process won't interfere
- * with the main control loop.
+ * Spawns two tasks in the background so that the process won't interfere
+ * with the main control loop, one taking images and one searching them.
  *
  * \return true if successful.
 */
@@ -516,25 +723,40 @@ bool Targeting::StartSearching() {
 		InitializeCamera();
 	}
 	
-	// Start or restart the task
+	// Stop the tasks if they're running, so no frame is left half processed
+	if (acquire_frames_task_.Verify()) {
+		acquire_frames_task_.Stop();
+	}
 	if (find_targets_task_.Verify()) {
-		if (!find_targets_task_.Restart()) {
-			return false;
-		}
-		return true;
+		find_targets_task_.Stop();
 	}
-	else {
-		if (!find_targets_task_.Start((int)this)) {
-			return false;
-		}
-		return true;
+
+	// Start with every frame free, then start the search before the frames it searches
+	ResetFrames();
+	if (!find_targets_task_.Start((TaskArgument) this) || !acquire_frames_task_.Start((TaskArgument) this)) {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * \brief Gives every frame back to AcquireFramesTask().
+ *
+ * Must not be called while the tasks are running.
+*/
+void Targeting::ResetFrames() {
+	free_frames_.Clear();
+	ready_frame_ = -1;
+	acquire_frame_ = -1;
+	for (int i = 0; i < kFrameSlots; i++) {
+		free_frames_.Push(i);
 	}
 }
 
 /**
  * \brief Stops taking images and searching for targets.
  *
- * Stops the background task.
+ * Stops the background tasks.
  *
  * \return true if successful.
 */
@@ -542,13 +764,56 @@ bool Targeting::StopSearching() {
 	if (!camera_enabled_)
 			return false;
 	
-	// Stop the task
+	// Stop the tasks
+	bool stopped = false;
+	if (acquire_frames_task_.Verify()) {
+		acquire_frames_task_.Stop();
+	}
 	if (find_targets_task_.Verify()) {
-		return find_targets_task_.Stop();
+		stopped = find_targets_task_.Stop();
 	}
-	else {
-		return false;
+
+	// Write anything the tasks queued before they stopped
+	WriteLogMessages();
+	return stopped;
+}
+
+/**
+ * \brief Writes the log lines queued by the targeting tasks.
+ *
+ * The log only takes records from one task, so the targeting tasks queue
+ * their lines and the main task writes them here.  Main task only.
+*/
+void Targeting::WriteLogMessages() {
+	log_message message;
+	while (acquire_messages_.Pop(&message)) {
+		if (log_enabled_) {
+			log_->WriteLine(message.text, message.timestamp);
+		}
 	}
+	while (find_messages_.Pop(&message)) {
+		if (log_enabled_) {
+			log_->WriteLine(message.text, message.timestamp);
+		}
+	}
+}
+
+/**
+ * \brief Queues a line for WriteLogMessages() to write to the log.
+ *
+ * Never blocks.  If the main task has fallen behind and the queue is full,
+ * the line is dropped.
+ *
+ * \param queue the queue of the task the line is from.
+ * \param text the line, including the carriage return.  Longer lines are cut short.
+ * \param timestamp true if a timestamp should be prepended to the line.
+*/
+void Targeting::QueueLogMessage(SpscQueue<log_message, kMaxLogMessages> &queue, const char * text, bool timestamp) {
+	log_message message;
+	strncpy(message.text, text, kMaxLogMessage - 1);
+	message.text[kMaxLogMessage - 1] = 0;
+	message.timestamp = timestamp;
+	queue.Push(message);
 }
 
 /**
@@ -580,6 +845,91 @@ int Targeting::CompareTargets(ParticleAnalysisReport t1, ParticleAnalysisReport
 	return 0;
 }
 
+/**
+ * \brief Static interface for the AcquireFramesTask function.
+ *
+ * Static interface that will cause an instantiation if necessary.
+ * This function is used so that the actual task function doesn't need
+ * to be static.
+ *
+ * \param this_pointer a pointer to this object.
+ * \return the result of the spawned task.
+*/
+int Targeting::s_AcquireFramesTask(Targeting *this_pointer) {
+	return this_pointer->AcquireFramesTask();
+}
+
+/**
+ * \brief Takes images from the camera and passes them to FindTargetsTask().
+ *
+ * Each image is read into a free frame along with the time it was taken
+ * and the heading of the robot at the time, then handed to FindTargetsTask().
+ * This runs while the previous frame is being processed, so reading and
+ * decoding an image doesn't hold up the search.  A frame still waiting when
+ * the next one is taken is replaced and filled again, so the search always
+ * starts on the newest image rather than working through old ones.
+ *
+ * \return 0 on success (but the task should never finish on it's own).
+*/
+int Targeting::AcquireFramesTask() {
+	// Loop repeatedly
+	while (true) {
+		// Get a reference to the camera
+		AxisCamera &axis_camera = AxisCamera::GetInstance();
+		bool acquired = false;
+
+		try {
+			// Only get an image if it's one we haven't processed yet and there's a frame to put it in
+			// The frame is kept until it's handed on, so it isn't lost if getting the image fails
+			int slot = acquire_frame_;
+			if (axis_camera.IsFreshImage() && (slot >= 0 || free_frames_.Pop(&slot))) {
+				acquire_frame_ = slot;
+				camera_frame &frame = frames_[slot];
+				// Get an image from the camera
+				if (frame.image != NULL && axis_camera.GetImage(frame.image)) {
+					// When the image was taken, allowing for the time the camera takes to send it
+					UINT64 capture_timestamp = LoopTimer::GetTimestamp();
+					UINT64 latency = camera_latency_ > 0.0 ? (UINT64) (camera_latency_ * 1000000000.0) : 0;
+					frame.capture_timestamp = capture_timestamp > latency ? capture_timestamp - latency : 0;
+
+					// The heading the image was taken at
+					CRITICAL_REGION(find_targets_semaphore_)
+						frame.heading = robot_heading_;
+					END_REGION
+
+					// Store the very first image taken by the camera (unfiltered)
+					// This will be helpful during practice and competitions to diagnose issues
+					if (!sample_images_stored_) {
+						char filename[20] = {0};
+						Targeting::GenerateFilename("/1_", ".bmp", 4, filename);
+						frame.image->Write(filename);
+						sample_images_stored_ = true;
+					}
+
+					// Record the first RECORD_FRAMES frames for replaying with the visionreplay tool
+					if (frames_recorded_ < record_frames_) {
+						RecordFrame(frame.image, frame.capture_timestamp);
+					}
+
+					// Only the newest frame waits to be searched, so the search never falls behind the camera
+					// A frame that was still waiting is replaced, and filled next
+					acquire_frame_ = AtomicExchange(&ready_frame_, slot);
+					acquired = true;
+				}
+			}
+		}
+		catch (exception& e) {
+			printf("Exception in Acquire Frames Task: %s\n", e.what());
+		}
+
+		// Let other tasks run until the next image might be ready
+		if (!acquired) {
+			Wait(STAGE_WAIT);
+		}
+	}
+	return 0;
+}
+
 /**
  * \brief Static interface for the FindTargetsTask function.
  *
@@ -595,153 +945,273 @@ int Targeting::s_FindTargetsTask(Targeting *this_pointer) {
 }
 
 /**
- * \brief Takes images from the camera and searches for targets.
+ * \brief Searches the frames taken by AcquireFramesTask() for targets.
  *
  * Repeatedly finds, filters, and stores matching targets.
- * Images are taken repeatedly from the camera as fast as the loop can execute.
+ * Frames are processed in the order they were taken, as fast as the loop can execute.
  * The images are filtered for a specific color (green).
  * The images are then filtered to remove noise and false positives.
- * A particle report is generated from the images and the results are stored in 
- * a shared variable (which is protected from simultaneous access using a semaphore). 
+ * A particle report is generated from the images and the results are published
+ * through a triple buffer, so neither this task nor the reader ever waits for the other.
+ *
+ * Once targets have been found, the following frames are only searched
+ * around where they are expected to be.  If any of them are missing, or
+ * after TRACKING_FULL_SCAN_INTERVAL frames, the whole frame is searched.
  * 
  * \return 0 on success (but the task should never finish on it's own).
 */
 int Targeting::FindTargetsTask() {
+	// Number of reports published
+	UINT32 version = 0;
+
 	// Loop repeatedly
 	while (true) {
-		// Get a reference to the camera
-		AxisCamera &axis_camera = AxisCamera::GetInstance();
-		
+		// Wait for the next frame
+		// The mask is written into an image that is reused every frame
+		if (mask_image_ == NULL || vision_pipeline_ == NULL || ready_frame_ < 0) {
+			Wait(STAGE_WAIT);
+			continue;
+		}
+		int slot = AtomicExchange(&ready_frame_, -1);
+		camera_frame &frame = frames_[slot];
+
 		try {
-			// Only get an image if it's one we haven't processed yet
-			if (axis_camera.IsFreshImage()) {
-				// Create the image objects and image pointers used in the processing below
-				ColorImage *image = new ColorImage(IMAQ_IMAGE_RGB);
-				BinaryImage *color_filtered_image = NULL;
-				BinaryImage *large_objects_image = NULL;
-				BinaryImage *convex_hull_image = NULL;
-				//BinaryImage *particle_filtered_image = NULL;
+			// Search around the last targets if possible, otherwise the whole frame
+			// A particle cut off by the edge of a region may be a target that moved further than
+			// predicted, so it counts as a miss
+			// The report being filled isn't shared until it's published
+			target_report * next_report = target_reports_.GetBack();
+			std::vector<ParticleAnalysisReport> &report = next_report->targets;
+			Rect regions[kMaxRegions];
+			int region_count = PredictTargetRegions(frame.image, regions, frame.heading);
+			bool found = false;
+			if (region_count > 0) {
+				found = FindTargetsInRegions(frame.image, regions, region_count, report) &&
+						vision_pipeline_->GetClippedParticles() == 0 &&
+						report.size() >= target_reports_.GetPublished()->targets.size();
+				frames_since_full_scan_++;
+			}
+			if (!found) {
+				regions[0].left = 0;
+				regions[0].top = 0;
+				regions[0].width = frame.image->GetWidth();
+				regions[0].height = frame.image->GetHeight();
+				found = FindTargetsInRegions(frame.image, regions, 1, report);
+				frames_since_full_scan_ = 0;
+			}
 
-				// Get an image from the camera
-				if (axis_camera.GetImage(image)) {
-					
-					// Create the HSL/RGB threshold filter object
-					Threshold threshold_ = Threshold(threshold_plane_1_low_, threshold_plane_1_high_,
-														 threshold_plane_2_low_, threshold_plane_2_high_,
-													 threshold_plane_3_low_, threshold_plane_3_high_);
-					
-					// Create a particle filter criteria based on rectangle dimensions
-					//ParticleFilterCriteria2 criteria[] = {{IMAQ_MT_BOUNDING_RECT_WIDTH, particle_filter_width_minimum_, particle_filter_width_maximum_, false, false},
-					//									  {IMAQ_MT_BOUNDING_RECT_HEIGHT, particle_filter_height_minimum_, particle_filter_height_maximum_, false, false}};
-					//ParticleFilterCriteria2 criteria[] = {{IMAQ_MT_AREA_BY_PARTICLE_AND_HOLES_AREA, particle_filter_filled_minimum_, particle_filter_filled_maximum_, false, false}};
-
-					
-					// If an image was acquired, filter it based on HSL or RGB color values
-					if (image != NULL) {
-						// Store the very first image taken by the camera (unfiltered)
-						// This will be helpful during practice and competitions to diagnose issues
-						if (!sample_images_stored_) {
-							char filename[20] = {0};
-							Targeting::GenerateFilename("/1_", ".bmp", 4, filename);
-							image->Write(filename);
-							sample_images_stored_ = true;
-						}
-
-						// Perform an HSV filter
-						if ((Targeting::ThresholdType) threshold_type_ == kHSV)
-							color_filtered_image = image->ThresholdHSV(threshold_);
-						// Perform an HSL filter
-						else if ((Targeting::ThresholdType) threshold_type_ == kHSL)
-							color_filtered_image = image->ThresholdHSL(threshold_);
-						// Perform an RGB filter
-						else
-							color_filtered_image = image->ThresholdRGB(threshold_);
-					}
+			// Report when the mask had too many particles to label, so targets low in the frame were missed
+			unsigned int label_overflows = vision_pipeline_->GetLabelOverflows();
+			if (log_enabled_ && label_overflows != reported_label_overflows_ && (reported_label_overflows_ == 0 ||
+					label_overflows - reported_label_overflows_ >= LABEL_OVERFLOW_LOG_INTERVAL)) {
+				char line[80];
+				sprintf(line, "Too many particles to label, %u regions only searched in part\n", label_overflows);
+				QueueLogMessage(find_messages_, line, true);
+				reported_label_overflows_ = label_overflows;
+			}
 
-					// Remove small objects, leaving only the larger blobs
-					if (color_filtered_image != NULL) {
-						/*Targeting::GenerateFilename("/2_", ".bmp", 4, filename);
-						color_filtered_image->Write(filename);*/
-			
-						large_objects_image = color_filtered_image->RemoveSmallObjects(false, 2);
-						SafeDelete(color_filtered_image);
-					}
+			if (found) {
+				// sort the list of targets by height
+				sort(report.begin(), report.end(), Targeting::CompareTargets);
 
-					// Perform a convex hull to 'fill-in' the blobs
-					if (large_objects_image != NULL) {
-						/*Targeting::GenerateFilename("/3_", ".bmp", 4, filename);
-						large_objects_image->Write(filename);*/
-						
-						convex_hull_image = large_objects_image->ConvexHull(false);
-						SafeDelete(large_objects_image);
-					}
-					
-						/*Targeting::GenerateFilename("/4_", ".bmp", 4, filename);
-						large_objects_image->Write(filename);*/
-						
-						/*particle_filtered_image = large_objects_image->ParticleFilter(criteria, 2);
-						SafeDelete(large_objects_image);
-					}*/
-					
-					//if (particle_filtered_image != NULL) {
-						/*Targeting::GenerateFilename("/3_", ".bmp", 4, filename);
-						particle_filtered_image->Write(filename);*/
-						
-						/*convex_hull_image = particle_filtered_image->ConvexHull(false);
-						SafeDelete(particle_filtered_image);
-					}*/
-					
-					// Get a particle report from the image
-					if (convex_hull_image != NULL) {
-						/*Targeting::GenerateFilename("/5_", ".bmp", 4, filename);
-						convex_hull_image->Write(filename);*/
-			
-						// Delete the old report and create a new one
-						// Then filter out the bad targets based on user parameters
-						CRITICAL_REGION(find_targets_semaphore_)
-						SafeDelete(particle_report_);
-						particle_report_ = convex_hull_image->GetOrderedParticleAnalysisReports();
-						SafeDelete(convex_hull_image);
-						
-						// Filter out bad targets, and sort by height
-						if (particle_report_ != NULL && particle_report_->size() > 0) {
-							vector<ParticleAnalysisReport>::iterator target_iterator = particle_report_->begin();
-							while (target_iterator != particle_report_->end()) {
-								// Calculate rectangle ratio
-								float rectangle_ratio = (float) target_iterator->boundingRect.width / (float) target_iterator->boundingRect.height;
-								// Calculate rectangle score
-								float rectangle_area = 	(float) target_iterator->boundingRect.width * (float) target_iterator->boundingRect.height;
-								float rectangle_score = (target_iterator->particleArea / rectangle_area) * 100.0;
-								/*printf("particle location: %i, %i\n", target_iterator->center_mass_x, target_iterator->center_mass_y);
-								printf("particle ratio: %5.2f\n", rectangle_ratio);
-								printf("particle score: %5.2f\n", rectangle_score);*/
-								// Delete bad targets
-								if (rectangle_ratio < target_rectangle_ratio_minimum_ || rectangle_ratio > target_rectangle_ratio_maximum_ || rectangle_score < target_rectangle_score_threshold_) {
-									target_iterator = particle_report_->erase(target_iterator);
-									//printf("Deleting particle\n");
-								}
-								else {
-									target_iterator++;
-								}
-							}
-							// sort the list of targets by height
-							sort(particle_report_->begin(), particle_report_->end(), Targeting::CompareTargets);
-						}
-						END_REGION
-					}
+				// Stamp each target with the capture time, so it can be used on its own
+				for (unsigned int i = 0; i < report.size(); i++) {
+					report[i].imageTimestamp = frame.capture_timestamp / 1000000000.0;
+				}
+
+				// Share the new report
+				version++;
+				next_report->version = version;
+				next_report->capture_timestamp = frame.capture_timestamp;
+				next_report->processed_timestamp = LoopTimer::GetTimestamp();
+				target_reports_.Publish();
+				tracking_heading_ = frame.heading;
+
+				// Adjust the threshold for the next frames if the targets' colors are drifting
+				if (threshold_tuning_) {
+					TuneThreshold(frame.image);
 				}
-				
-				// Delete the first image pointer
-				SafeDelete(image);
 			}
 		}
 		catch (exception& e) {
 			printf("Exception in Find Targets Task: %s\n", e.what());			
-		}		
+		}
+
+		// Give the frame back for the next image
+		free_frames_.Push(slot);
 	}
 	return 0;
 }
 
+/**
+ * \brief Predicts where the targets of the last report are in the current frame.
+ *
+ * Each target's bounding rectangle is moved sideways by the number of
+ * pixels the robot has turned since the last report, then padded by
+ * TRACKING_PADDING pixels, by VisionPipeline::PredictRegions().  Only used with
+ * the built-in threshold kernel, since imaqColorThreshold() always processes
+ * the whole image.
+ *
+ * \param image the current frame.
+ * \param regions an array of kMaxRegions rectangles that will contain the regions.
+ * \param heading the heading of the robot when the current frame was taken.
+ * \return the number of regions, 0 if the whole frame should be searched.
+*/
+int Targeting::PredictTargetRegions(ColorImage * image, Rect * regions, float heading) {
+	// The last report published isn't changed until the next one is published
+	const target_report * last_report = target_reports_.GetPublished();
+	if (tracking_full_scan_interval_ <= 0 || frames_since_full_scan_ >= tracking_full_scan_interval_ ||
+			!threshold_kernel_enabled_ || last_report == NULL || last_report->targets.empty() ||
+			camera_view_angle_ <= 0.0) {
+		return 0;
+	}
+
+	// Turning right moves the targets left in the image
+	// A large change, like the gyro being reset, is treated as a miss
+	int width = image->GetWidth();
+	int height = image->GetHeight();
+	float heading_change = heading - tracking_heading_;
+	if (fabs(heading_change) > camera_view_angle_ / 2.0) {
+		return 0;
+	}
+	int shift = (int) (-heading_change * width / camera_view_angle_);
+	return VisionPipeline::PredictRegions(last_report->targets, shift, tracking_padding_, width, height, regions,
+			kMaxRegions);
+}
+
+/**
+ * \brief Thresholds a camera image and finds the targets in parts of it.
+ *
+ * \param camera_image the camera image.
+ * \param regions the parts of the image to search, which must not overlap.
+ * \param region_count the number of regions.
+ * \param report the report to fill with the targets that pass the filters.
+ * \return true if successful.
+*/
+bool Targeting::FindTargetsInRegions(ColorImage * camera_image, const Rect * regions, int region_count,
+		std::vector<ParticleAnalysisReport> &report) {
+	Image *image = camera_image->GetImaqImage();
+	Image *mask = mask_image_->GetImaqImage();
+	ImageInfo image_info;
+	ImageInfo mask_info;
+
+	report.clear();
+
+	// Filter the image based on HSV, HSL or RGB color values
+	if (threshold_kernel_enabled_) {
+		// Threshold the camera pixels directly into the mask, which must be the same size
+		if (!imaqGetImageInfo(image, &image_info))
+			return false;
+		if (!(imaqGetImageInfo(mask, &mask_info) && mask_info.xRes == image_info.xRes && mask_info.yRes == image_info.yRes)) {
+			if (!imaqSetImageSize(mask, image_info.xRes, image_info.yRes) || !imaqGetImageInfo(mask, &mask_info))
+				return false;
+		}
+		vision_pipeline_->SetThreshold((ThresholdKernel::ColorSpace) threshold_type_,
+				threshold_plane_1_low_, threshold_plane_1_high_, threshold_plane_2_low_,
+				threshold_plane_2_high_, threshold_plane_3_low_, threshold_plane_3_high_);
+		vision_pipeline_->Threshold((const unsigned char *) image_info.imageStart, image_info.pixelsPerLine,
+				(unsigned char *) mask_info.imageStart, mask_info.pixelsPerLine, regions, region_count);
+	}
+	else {
+		// Create the HSL/RGB threshold filter ranges
+		Range plane_1_range = {threshold_plane_1_low_, threshold_plane_1_high_};
+		Range plane_2_range = {threshold_plane_2_low_, threshold_plane_2_high_};
+		Range plane_3_range = {threshold_plane_3_low_, threshold_plane_3_high_};
+		ColorMode color_mode = IMAQ_RGB;
+		if ((Targeting::ThresholdType) threshold_type_ == kHSV)
+			color_mode = IMAQ_HSV;
+		else if ((Targeting::ThresholdType) threshold_type_ == kHSL)
+			color_mode = IMAQ_HSL;
+		if (!imaqColorThreshold(mask, image, 1, color_mode, &plane_1_range, &plane_2_range, &plane_3_range) ||
+				!imaqGetImageInfo(mask, &mask_info))
+			return false;
+	}
+
+	// Find the particles in each region in one pass and keep only the good targets
+	vision_pipeline_->SetParticleFilter(particle_minimum_area_, target_rectangle_ratio_minimum_,
+			target_rectangle_ratio_maximum_, target_rectangle_score_threshold_);
+	return vision_pipeline_->FindTargets((const unsigned char *) mask_info.imageStart, mask_info.xRes, mask_info.yRes,
+			mask_info.pixelsPerLine, regions, region_count, report, kMaxParticles);
+}
+
+/**
+ * \brief Adds a camera image to the frame recording.
+ *
+ * The recording file is created with the first frame and closed once
+ * RECORD_FRAMES frames have been written, or if writing fails.
+ *
+ * \param image the camera image.
+ * \param capture_timestamp the time in nanoseconds when the image was taken.
+*/
+void Targeting::RecordFrame(ColorImage * image, UINT64 capture_timestamp) {
+	if (frame_recording_ == NULL) {
+		char filename[20] = {0};
+		Targeting::GenerateFilename("/frames_", ".rec", 4, filename);
+		frame_recording_ = new FrameRecording();
+		if (frame_recording_ == NULL || !frame_recording_->OpenForWrite(filename)) {
+			SafeDelete(frame_recording_);
+			frames_recorded_ = record_frames_;
+			return;
+		}
+		if (log_enabled_) {
+			char line[64];
+			sprintf(line, "Recording %d frames to %s\n", record_frames_, filename);
+			QueueLogMessage(acquire_messages_, line);
+		}
+	}
+
+	ImageInfo image_info;
+	if (!imaqGetImageInfo(image->GetImaqImage(), &image_info) ||
+			!frame_recording_->WriteFrame((const unsigned char *) image_info.imageStart, image_info.xRes,
+			image_info.yRes, image_info.pixelsPerLine, capture_timestamp)) {
+		frames_recorded_ = record_frames_;
+	}
+	else {
+		frames_recorded_++;
+	}
+
+	if (frames_recorded_ >= record_frames_) {
+		frame_recording_->Close();
+		SafeDelete(frame_recording_);
+	}
+}
+
+/**
+ * \brief Counts the colors of the targets found and moves the threshold toward them.
+ *
+ * Only the pixels of the targets' particles in the last search are looked
+ * at, so this costs little compared to thresholding the frame.  The
+ * threshold is only changed every THRESHOLD_TUNING_SAMPLES target pixels,
+ * and never further than THRESHOLD_TUNING_LIMIT from the values in the
+ * parameter file.
+ *
+ * \param image the camera image the targets were found in.
+*/
+void Targeting::TuneThreshold(ColorImage * image) {
+	ImageInfo image_info;
+	if (threshold_tuner_ == NULL || !imaqGetImageInfo(image->GetImaqImage(), &image_info)) {
+		return;
+	}
+	threshold_tuner_->AddTargets((const unsigned char *) image_info.imageStart, image_info.pixelsPerLine,
+			vision_pipeline_->GetTargetRuns());
+
+	int low[3];
+	int high[3];
+	if (threshold_tuner_->Update(low, high)) {
+		threshold_plane_1_low_ = low[0];
+		threshold_plane_1_high_ = high[0];
+		threshold_plane_2_low_ = low[1];
+		threshold_plane_2_high_ = high[1];
+		threshold_plane_3_low_ = low[2];
+		threshold_plane_3_high_ = high[2];
+		if (log_enabled_) {
+			char line[80];
+			sprintf(line, "Threshold tuned to %d-%d %d-%d %d-%d\n", low[0], high[0], low[1], high[1], low[2], high[2]);
+			QueueLogMessage(find_messages_, line, true);
+		}
+	}
+}
+
 /**
  * \brief Generates a random filename.
  *
@@ -750,7 +1220,7 @@ int Targeting::FindTargetsTask() {
  * \param length the number of random characters in the filename.
  * \param filename an empty character array that will contain the result.
 */
-void Targeting::GenerateFilename(char * prefix, char * suffix, int length, char * filename) {
+void Targeting::GenerateFilename(const char * prefix, const char * suffix, int length, char * filename) {
 	// Acceptable characters for a filename
 	static const char alphanum[] = "0123456789abcdefghijklmnopqrstuvwxyz";
 	
@@ -3,10 +3,31 @@
 
 #include "Vision2009/VisionAPI.h" 
 #include "common.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
 
 // Forward class definitions
+class BinaryImage;
+class ColorImage;
 class Parameters;
 class DataLog;
+class FrameRecording;
+class ThresholdTuner;
+class VisionPipeline;
+
+/**
+ * \struct target_report
+ * \brief The targets found in one camera frame.
+ */
+struct target_report {
+	UINT32 version;									///< number of reports published up to and including this one, 0 before the first
+	UINT64 capture_timestamp;						///< time in nanoseconds from LoopTimer::GetTimestamp() when the camera image was taken
+	UINT64 processed_timestamp;						///< time in nanoseconds from LoopTimer::GetTimestamp() when the report was published
+	std::vector<ParticleAnalysisReport> targets;	///< the targets, sorted by height, with imageTimestamp set to the capture time in seconds
+
+	target_report():
+		version(0), capture_timestamp(0), processed_timestamp(0) {}
+};
 
 /**
  * \class Targeting
@@ -38,18 +59,21 @@ public:
 	bool LoadParameters();
 	void SetRobotState(ProgramState state);
 	void SetLogState(bool state);
+	void SetHeading(float heading);
 	double GetHorizontalAngleOfTarget(ParticleAnalysisReport *target);
 	double GetVerticalAngleOfTarget(ParticleAnalysisReport *target);
 	double GetCameraDistanceToTarget(ParticleAnalysisReport *target);
 	double GetCameraHeightOfTarget(ParticleAnalysisReport *target);
 	TargetHeight GetEnumHeightOfTarget(ParticleAnalysisReport *target);
 	TargetHeight GetEnumHeightOfTarget(double height);
-	void GetStringHeightOfTarget(TargetHeight target_height, char *buffer);
+	void GetStringHeightOfTarget(TargetHeight target_height, char *buffer, int length);
 	double GetFOVPercentageOfTarget(ParticleAnalysisReport *target);
+	const target_report * GetLatestTargets();
 	bool GetTargets(std::vector<ParticleAnalysisReport> &report);
 	void InitializeCamera();
 	bool StartSearching();
 	bool StopSearching();
+	void WriteLogMessages();
 
 	// Public member variables
 	bool camera_enabled_;		///< true if the camera is present
@@ -62,22 +86,82 @@ private:
 		kRGB
 	};
 	
+	// Private constants
+	static const int kMaxParticles = 32;	///< maximum number of targets kept from one image
+	static const int kMaxRegions = 4;		///< maximum number of targets tracked, more are found by searching the whole frame
+	static const int kMaxTableWidth = 640;	///< widest image the angle and distance tables are built for
+	static const int kFrameSlots = 3;		///< number of camera frames in the search at once: one being taken, the newest one waiting and one being searched
+	static const int kMaxLogMessages = 8;	///< number of log lines a task can queue before WriteLogMessages() writes them
+	static const int kMaxLogMessage = 80;	///< longest log line a task can queue, including the terminating null
+
+	/**
+	 * \struct camera_frame
+	 * \brief A camera image passed from AcquireFramesTask() to FindTargetsTask().
+	 */
+	struct camera_frame {
+		ColorImage *image;			///< image the camera frame is copied into, reused for every frame
+		UINT64 capture_timestamp;	///< time in nanoseconds from LoopTimer::GetTimestamp() when the image was taken
+		float heading;				///< heading of the robot in degrees when the image was taken
+
+		camera_frame():
+			image(NULL), capture_timestamp(0), heading(0.0) {}
+	};
+
+	/**
+	 * \struct log_message
+	 * \brief A line for the log, passed from one of the tasks to WriteLogMessages().
+	 *
+	 * Only the main task writes to the log, since the log's ring buffer
+	 * only takes records from one task.
+	 */
+	struct log_message {
+		char text[kMaxLogMessage];	///< the line, including the carriage return
+		bool timestamp;				///< true if a timestamp should be prepended to the line
+
+		log_message():
+			timestamp(false) { text[0] = 0; }
+	};
+
 	// Private methods
+	void AllocateImages();
+	static void QueueLogMessage(SpscQueue<log_message, kMaxLogMessages> &queue, const char * text, bool timestamp=false);
 	static int CompareTargets(ParticleAnalysisReport t1, ParticleAnalysisReport t2);
+	static int s_AcquireFramesTask(Targeting *this_pointer);
+	int AcquireFramesTask();
 	static int s_FindTargetsTask(Targeting *this_pointer);
 	int FindTargetsTask();
-	void GenerateFilename(char * prefix, char * suffix, int length, char * filename);
+	void ResetFrames();
+	double CalculateHorizontalAngle(int center_mass_x, int image_width);
+	double CalculateVerticalAngle(int observed_target_width, double height);
+	double CalculateDistance(int observed_target_width);
+	void BuildGeometryTables();
+	int PredictTargetRegions(ColorImage * image, Rect * regions, float heading);
+	bool FindTargetsInRegions(ColorImage * camera_image, const Rect * regions, int region_count,
+			std::vector<ParticleAnalysisReport> &report);
+	void RecordFrame(ColorImage * image, UINT64 capture_timestamp);
+	void TuneThreshold(ColorImage * image);
+	void GenerateFilename(const char * prefix, const char * suffix, int length, char * filename);
 	void Initialize(const char * parameters, bool logging_enabled);
 
 	// Private member objects
 	Task find_targets_task_;							///< task object used to spawn the FindTargetsTask() function in a separate thread
-	std::vector<ParticleAnalysisReport> *particle_report_;	///< vector of particle reports returned from the FindTargetsTask() function
+	Task acquire_frames_task_;							///< task object used to spawn the AcquireFramesTask() function in a separate thread
+	TripleBuffer<target_report> target_reports_;		///< reports passed from the FindTargetsTask() function to GetLatestTargets()
+	camera_frame frames_[kFrameSlots];					///< the camera frames, each owned by whichever task last took it from free_frames_ or ready_frame_
+	SpscQueue<int, kFrameSlots> free_frames_;			///< frames passed back from FindTargetsTask() to AcquireFramesTask() to be filled
+	SpscQueue<log_message, kMaxLogMessages> acquire_messages_;	///< log lines passed from AcquireFramesTask() to WriteLogMessages()
+	SpscQueue<log_message, kMaxLogMessages> find_messages_;		///< log lines passed from FindTargetsTask() to WriteLogMessages()
+	BinaryImage *mask_image_;							///< binary image the color threshold is written into, reused for every frame
+	VisionPipeline *vision_pipeline_;					///< thresholds the camera image when threshold_kernel_enabled_ is set, and finds the targets in the mask
+	FrameRecording *frame_recording_;					///< file the camera frames are recorded to, NULL if not recording
+	ThresholdTuner *threshold_tuner_;					///< moves the threshold toward the colors of the targets found when threshold_tuning_ is set
 	DataLog *log_;										///< log object used to log data or status comments to a file
 	Parameters *parameters_;							///< parameters object used to load targeting parameters from a file
 
 	// Private parameters
 	//char camera_ip_address_[16];					///< the IP address of the camera we are connecting to
 	float camera_view_angle_;						///< the viewing angle of the camera, used in various calculations
+	double camera_latency_;							///< the time in seconds from the camera taking an image to the image being read by the search task
 	int camera_resolution_;							///< the resolution of the images taken by the camera
 	int frames_per_second_;							///< the FPS of the camera
 	int color_level_;								///< the color level of the images taken by the camera
@@ -95,6 +179,16 @@ private:
 	int threshold_plane_2_high_;					///< upper boundary for the RGB/HSL filter on plane 2
 	int threshold_plane_3_low_;						///< lower boundary for the RGB/HSL filter on plane 3
 	int threshold_plane_3_high_;					///< upper boundary for the RGB/HSL filter on plane 3
+	int threshold_kernel_enabled_;					///< 1 to threshold images with vision_pipeline_, 0 to use imaqColorThreshold()
+	int record_frames_;								///< number of camera frames to record for the visionreplay tool, 0 to record none
+	int threshold_tuning_;							///< 1 to move the threshold toward the colors of the targets found, 0 to keep the configured threshold
+	int threshold_tuning_limit_;					///< the most a threshold boundary can move from its configured value
+	int threshold_tuning_step_;						///< the most a threshold boundary moves in one update
+	int threshold_tuning_margin_;					///< added to each side of the range of target colors when tuning
+	int threshold_tuning_samples_;					///< number of target pixels counted before each threshold update
+	int particle_minimum_area_;						///< particles with fewer pixels than this are ignored
+	int tracking_full_scan_interval_;				///< number of frames searched only around the last targets before the whole frame is searched again, 0 to always search the whole frame
+	int tracking_padding_;							///< number of pixels added to each side of a target's predicted position when tracking
 	int particle_filter_filled_minimum_;			///< lower boundary for the particle filter (rectangle) percentage of the particle Area in relation to its Particle and Holes Area
 	int particle_filter_filled_maximum_;			///< upper boundary for the particle filter (rectangle) percentage of the particle Area in relation to its Particle and Holes Area
 	float target_rectangle_ratio_minimum_;			///< the lower boundary for a rectangle ratio
@@ -108,12 +202,23 @@ private:
 	// Private member variables
 	int camera_horizontal_width_in_pixels_;	///< image width in pixels
 	int camera_vertical_height_in_pixels_;	///< image height in pixels
-	SEM_ID find_targets_semaphore_;			///< semaphore used to lock variables/objects that are shared between two threads
+	SEM_ID find_targets_semaphore_;			///< semaphore used to lock the robot heading, which is shared between two threads
 	bool sample_images_stored_;				///< true if 1 set of sample images have been stored
 	bool camera_initialized_;				///< true if the camera is initialized
 	bool log_enabled_;						///< true if logging is enabled
 	char parameters_file_[25];				///< path and filename of the parameter file to read
 	ProgramState robot_state_;				///< current state of the robot obtained from the field
+	float robot_heading_;					///< latest heading of the robot in degrees, shared with AcquireFramesTask()
+	float tracking_heading_;				///< heading of the robot when the frame of the last report was taken
+	int frames_since_full_scan_;			///< number of frames searched only around the last targets since the whole frame was searched
+	unsigned int reported_label_overflows_;	///< number of regions with too many particles to label that have been logged, only used by FindTargetsTask()
+	volatile int ready_frame_;				///< the newest frame taken and waiting to be searched, -1 if none, exchanged between AcquireFramesTask() and FindTargetsTask()
+	int acquire_frame_;						///< the frame AcquireFramesTask() fills next, -1 to take one from free_frames_, only used by AcquireFramesTask()
+	int frames_recorded_;					///< number of camera frames recorded so far
+	int geometry_table_width_;				///< image width the angle and distance tables were built for, 0 if they haven't been
+	double horizontal_angle_table_[kMaxTableWidth];				///< degrees off target for each column of the target's center
+	double distance_table_[kMaxTableWidth + 1];					///< distance in feet for each target width in pixels
+	double vertical_angle_table_[kUnknown + 1][kMaxTableWidth + 1];	///< vertical angle in degrees for each TargetHeight and target width in pixels
 };
 
 #endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "WPILib.h"
 
 #include "autoscript.h"
@@ -6,7 +7,10 @@
 #include "datalog.h"
 #include "drivetrain.h"
 #include "feeder.h"
+#include "looptimer.h"
 #include "parameters.h"
+#include "parameterwatcher.h"
+#include "sensorsampler.h"
 #include "shooter.h"
 #include "targeting.h"
 #include "technojays.h"
@@ -19,6 +23,12 @@
  */
 #define GetMsecTime()           (GetFPGATime()/1000)
 
+/**
+ * \def SYNC_LOOP_BUDGET
+ * \brief The time in seconds a loop synced with the DriverStation has before the next packet arrives.
+ */
+#define SYNC_LOOP_BUDGET 0.02
+
 /**
  * \brief Create and initialize the robot.
  *
@@ -32,6 +42,17 @@ TechnoJays::TechnoJays() {
  * \brief Delete and clear all objects and pointers.
 */
 TechnoJays::~TechnoJays() {
+	SafeDelete(parameter_watcher_);
+	if (climber_ != NULL)
+		climber_->SetSensorSampler(NULL);
+	if (drive_train_ != NULL)
+		drive_train_->SetSensorSampler(NULL);
+	if (shooter_ != NULL)
+		shooter_->SetSensorSampler(NULL);
+	SafeDelete(sensor_sampler_);
+	if (user_interface_ != NULL)
+		user_interface_->SetLoopTimer(NULL);
+	SafeDelete(loop_timer_);
 }
 
 /**
@@ -50,12 +71,16 @@ void TechnoJays::Initialize(const char * parameters, bool logging_enabled) {
 	climber_ = NULL;
 	feeder_ = NULL;
 	log_ = NULL;
+	loop_timer_ = NULL;
 	drive_train_ = NULL;
 	parameters_ = NULL;
+	parameter_watcher_ = NULL;
+	sensor_sampler_ = NULL;
 	shooter_ = NULL;
 	targeting_ = NULL;
 	timer_ = NULL;
 	auto_shoot_timer_ = NULL;
+	auto_spinup_timer_ = NULL;
 	user_interface_ = NULL;
 	current_target_ = ParticleAnalysisReport();
 	current_target_.imageHeight = 0;
@@ -72,20 +97,41 @@ void TechnoJays::Initialize(const char * parameters, bool logging_enabled) {
 	auto_climb_headstart_encoder_count_ = 3000;
 	auto_climb_winch_speed_ = 1.0;
 	auto_climb_winch_time_ = 2.5;
+	binary_logging_ = 0;
 	period_ = 0.0;
+	sensor_sample_rate_ = 500;
 
 	// Initialize private member variables
 	log_enabled_ = false;
+	driver_left_y_channel_ = -1;
+	driver_right_y_channel_ = -1;
+	driver_turbo_channel_ = -1;
+	scoring_left_y_channel_ = -1;
+	scoring_right_y_channel_ = -1;
+	scoring_turbo_channel_ = -1;
+	shooter_channel_ = -1;
+	disabled_loop_probe_ = -1;
+	autonomous_loop_probe_ = -1;
+	teleop_loop_probe_ = -1;
+	reload_parameters_probe_ = -1;
+	read_sensors_probe_ = -1;
+	log_state_probe_ = -1;
+	auto_shoot_probe_ = -1;
+	aim_probe_ = -1;
+	vision_latency_probe_ = -1;
+	user_controls_probe_ = -1;
 	detailed_logging_enabled_ = false;
 	driver_turbo_ = false;
 	scoring_turbo_ = false;
-	current_command_complete_ = false;
-	current_command_in_progress_ = false;
+	current_command_count_ = 0;
+	auto_spinup_power_ = 0;
+	auto_shoot_head_start_ = 0.0;
 	autoscript_files_counter_ = 0;
 	previous_scoring_dpad_y_ = 0.0;
 	target_report_heading_ = 0.0;
 	degrees_off_ = 0.0;
 	current_target_vector_location_ = 0;
+	targets_report_ = NULL;
 	auto_shoot_state_ = kFinished;
 	aim_state_ = kFinished;
 	auto_find_target_state_ = kFinished;
@@ -99,24 +145,42 @@ void TechnoJays::Initialize(const char * parameters, bool logging_enabled) {
 	// Set this right away before we do anything else
 	GetWatchdog().SetEnabled(false);
 
+	// Attempt to read the parameters file
+	// This is done before the logs are opened, so they use the format set in the parameters
+	strncpy(parameters_file_, parameters, sizeof(parameters_file_) - 1);
+	parameters_file_[sizeof(parameters_file_) - 1] = 0;
+
+	bool parameters_read = LoadParameters();
+
 	// Create a new data log object
 	log_ = new DataLog("technojays.log");
 
 	// Enable logging if specified
 	if (log_ != NULL && log_->file_opened_) {
 		log_enabled_ = logging_enabled;
+		// Register the controls logged every loop so they don't need string work
+		driver_left_y_channel_ = log_->RegisterChannel("DriverLeftY");
+		driver_right_y_channel_ = log_->RegisterChannel("DriverRightY");
+		driver_turbo_channel_ = log_->RegisterChannel("DriverTurbo");
+		scoring_left_y_channel_ = log_->RegisterChannel("ScoringLeftY");
+		scoring_right_y_channel_ = log_->RegisterChannel("ScoringRightY");
+		scoring_turbo_channel_ = log_->RegisterChannel("ScoringTurbo");
+		shooter_channel_ = log_->RegisterChannel("Shooter");
 	} else {
 		log_enabled_ = false;
 	}
 
+	if (log_enabled_) {
+		if (parameters_read)
+			log_->WriteLine("TechnoJays parameters loaded successfully\n");
+		else
+			log_->WriteLine("TechnoJays parameters failed to read\n");
+	}
+
 	// Create timer objects
 	timer_ = new Timer();
 	auto_shoot_timer_ = new Timer();
-
-	// Attempt to read the parameters file
-	strncpy(parameters_file_, parameters, sizeof(parameters_file_));
-
-	LoadParameters();
+	auto_spinup_timer_ = new Timer();
 
 	// Create the objects representing all the pieces of the robot
 	targeting_ = new Targeting("targeting.par", log_enabled_);
@@ -126,6 +190,55 @@ void TechnoJays::Initialize(const char * parameters, bool logging_enabled) {
 	feeder_ = new Feeder("feeder.par", log_enabled_);
 	shooter_ = new Shooter("shooter.par", log_enabled_);
 	user_interface_ = new UserInterface("userinterface.par", log_enabled_);
+
+	// Read the encoders and gyro in the background, so the periodic loops see more than one reading per loop
+	if (sensor_sample_rate_ > 0) {
+		sensor_sampler_ = new SensorSampler();
+		if (sensor_sampler_ != NULL && sensor_sampler_->Start(sensor_sample_rate_)) {
+			if (climber_ != NULL)
+				climber_->SetSensorSampler(sensor_sampler_);
+			if (drive_train_ != NULL)
+				drive_train_->SetSensorSampler(sensor_sampler_);
+			if (shooter_ != NULL)
+				shooter_->SetSensorSampler(sensor_sampler_);
+		}
+		else if (log_enabled_) {
+			log_->WriteLine("TechnoJays sensor sampler failed to start\n");
+		}
+	}
+
+	// Time the periodic loops and the calls inside them
+	// The loops should finish within the period, or before the next DriverStation packet if synced
+	loop_timer_ = new LoopTimer();
+	if (loop_timer_ != NULL) {
+		disabled_loop_probe_ = loop_timer_->RegisterProbe("DisabledPeriodic");
+		autonomous_loop_probe_ = loop_timer_->RegisterProbe("AutonomousPeriodic");
+		teleop_loop_probe_ = loop_timer_->RegisterProbe("TeleopPeriodic");
+		reload_parameters_probe_ = loop_timer_->RegisterProbe("ReloadParameters");
+		read_sensors_probe_ = loop_timer_->RegisterProbe("ReadSensors");
+		log_state_probe_ = loop_timer_->RegisterProbe("LogCurrentState");
+		auto_shoot_probe_ = loop_timer_->RegisterProbe("AutoShoot");
+		aim_probe_ = loop_timer_->RegisterProbe("AimAtTarget");
+		vision_latency_probe_ = loop_timer_->RegisterProbe("VisionLatency");
+		user_controls_probe_ = loop_timer_->RegisterProbe("UserControls");
+		loop_timer_->SetBudget(disabled_loop_probe_, SYNC_LOOP_BUDGET);
+		loop_timer_->SetBudget(autonomous_loop_probe_, period_ > 0.0 ? period_ : SYNC_LOOP_BUDGET);
+		loop_timer_->SetBudget(teleop_loop_probe_, period_ > 0.0 ? period_ : SYNC_LOOP_BUDGET);
+		if (user_interface_ != NULL)
+			user_interface_->SetLoopTimer(loop_timer_);
+	}
+
+	// Watch every parameter file so tuning changes are picked up without a restart
+	parameter_watcher_ = new ParameterWatcher(log_enabled_);
+	if (parameter_watcher_ != NULL) {
+		parameter_watcher_->WatchDirectory(".par");
+		climber_parameters_file_ = parameter_watcher_->Find("climber.par");
+		drive_train_parameters_file_ = parameter_watcher_->Find("drivetrain.par");
+		shooter_parameters_file_ = parameter_watcher_->Find("shooter.par");
+		if (!parameter_watcher_->Start() && log_enabled_) {
+			log_->WriteLine("TechnoJays parameter watcher failed to start\n");
+		}
+	}
 }
 
 /**
@@ -167,8 +280,13 @@ bool TechnoJays::LoadParameters() {
 		parameters_->GetValue("AUTO_CLIMB_HEADSTART_ENCODER_COUNT", &auto_climb_headstart_encoder_count_);
 		parameters_->GetValue("AUTO_CLIMB_WINCH_SPEED", &auto_climb_winch_speed_);
 		parameters_->GetValue("AUTO_CLIMB_WINCH_TIME", &auto_climb_winch_time_);
+		parameters_->GetValue("BINARY_LOGGING", &binary_logging_);
+		parameters_->GetValue("SENSOR_SAMPLE_RATE", &sensor_sample_rate_);
 	}
 
+	// Set the format of logs that are opened from now on
+	DataLog::SetDefaultFormat(binary_logging_ == 1 ? DataLog::kBinary : DataLog::kText);
+
 	// Set the rate for the periodic functions
 	// SetPeriod is part of the base class
 	IterativeRobot::SetPeriod(period_);
@@ -194,6 +312,10 @@ void TechnoJays::RobotInit() {
  * or starting/restarting timers.
 */
 void TechnoJays::DisabledInit() {
+	// Write the loop timing from the last mode and start over
+	if (loop_timer_ != NULL)
+		loop_timer_->WriteSummary(log_enabled_ ? log_ : NULL);
+
 	// Set the periodic rate for the DisabledPeriodic function to sync with the driver station input
 	IterativeRobot::SetPeriod(0);
 	
@@ -252,6 +374,12 @@ void TechnoJays::DisabledInit() {
  * match starts.  E.g., Changing the autonomous routine.
 */
 void TechnoJays::DisabledPeriodic() {
+	if (loop_timer_ != NULL)
+		loop_timer_->Start(disabled_loop_probe_);
+
+	// Pick up any parameter files that changed since the last loop
+	ReloadChangedParameters();
+
 	// Make sure that no motors are moving (to prevent motor safety errors)
 	if (drive_train_ != NULL) {
 		drive_train_->Drive(0.0, 0.0, false);
@@ -299,6 +427,9 @@ void TechnoJays::DisabledPeriodic() {
 		// Update/store the current button state for driver controller
 		user_interface_->StoreButtonStates(UserInterface::kDriver);
 	}
+
+	// Flag the loop if it took longer than it should have
+	FinishLoopTiming(disabled_loop_probe_);
 }
 
 /**
@@ -322,11 +453,16 @@ void TechnoJays::AutonomousInit() {
 	// Read the selected autonomous script file and get the first command
 	if (!autoscript_file_name_.empty() && autoscript_file_name_.size() > 0) {
 		autoscript_->Open(autoscript_file_name_.c_str());
-		autoscript_->ReadScript();
+		if (!autoscript_->ReadScript() && log_enabled_) {
+			// Log the lines that were left out of the script
+			const std::vector<std::string> &errors = autoscript_->GetErrors();
+			for (unsigned int i = 0; i < errors.size(); i++) {
+				log_->WriteValue("Autoscript error", errors[i].c_str(), true);
+			}
+		}
 		autoscript_->Close();
-		current_command_complete_ = false;
-		current_command_in_progress_ = false;
-		current_command_ = autoscript_->GetNextCommand(); 
+		auto_spinup_power_ = 0;
+		GetNextCommandGroup();
 	}
 
 	// Set the current state of the robot
@@ -356,208 +492,48 @@ void TechnoJays::AutonomousInit() {
  * but not too fast to burden the processor.
 */
 void TechnoJays::AutonomousPeriodic() {
+	if (loop_timer_ != NULL)
+		loop_timer_->Start(autonomous_loop_probe_);
+
+	// Pick up any parameter files that changed since the last loop
+	ReloadChangedParameters();
+
 	// Reset the autonomous state variables
 	bool autoscript_finished = false;
-	current_command_complete_ = false;
 	
 	// Read sensor values in all the objects
-	if (shooter_ != NULL)
-		shooter_->ReadSensors();
-	if (drive_train_ != NULL)
-		drive_train_->ReadSensors();
-	if (climber_ != NULL)
-		climber_->ReadSensors();
+	{
+		LoopTimerProbe probe(loop_timer_, read_sensors_probe_);
+		if (shooter_ != NULL)
+			shooter_->ReadSensors();
+		if (drive_train_ != NULL)
+			drive_train_->ReadSensors();
+		if (climber_ != NULL)
+			climber_->ReadSensors();
+		if (targeting_ != NULL && drive_train_ != NULL)
+			targeting_->SetHeading(drive_train_->GetHeading());
+		if (targeting_ != NULL)
+			targeting_->WriteLogMessages();
+	}
 	
 	// If autoscript is defined, execute the commands
 	if (autoscript_ != NULL && !autoscript_file_name_.empty() && autoscript_file_name_.size() > 0) {
 		// Verify that the current command is not invalid or the end
-		if ((strncmp(current_command_.command, "invalid", 255) != 0) && (strncmp(current_command_.command, "end", 255) != 0)) {
-			// Execute current autoscript command
-			// General utilities
-			// Time delay
-			if (strncmp(current_command_.command, "wait", 255) == 0) {
-				// Verify that 1 argument was provided - the time delay in seconds
-				if (current_command_.param1 == -9999)
-					current_command_complete_ = true;
-				else {
-					// If this is the first time through this function for this command, reset and start the timer
-					if (!current_command_in_progress_) {
-						timer_->Stop();
-						timer_->Reset();
-						timer_->Start();
-						current_command_in_progress_ = true;
-					}
-					double time_left = 0.0;
-					double elapsed_time = 999.0;
-					// Get the timer value since we started moving
-					elapsed_time = timer_->Get();
-					// Calculate time left
-					time_left = (double) current_command_.param1 - elapsed_time;
-					// If the time has elapsed, stop the timer and mark this command as complete
-					if (time_left < 0) {
-						timer_->Stop();
-						current_command_complete_ = true;
-					}
-				}
-			}
-			// DriveTrain
-			// AdjustHeading
-			else if (strncmp(current_command_.command, "adjustheading", 255) == 0) {
-				// Verify that 2 arguments were provided
-				if (current_command_.param1 == -9999 || current_command_.param2 == -9999)
-					current_command_complete_ = true;
-				// Call AdjustHeading with the adjustment and speed iteratively until the command is complete 
-				else {
-					if (drive_train_->AdjustHeading(current_command_.param1, current_command_.param2))
-						current_command_complete_ = true;
-				}
-			}
-			// DriveDistance
-			else if (strncmp(current_command_.command, "drivedistance", 255) == 0) {
-				// Verify that 2 arguments were provided
-				if (current_command_.param1 == -9999 || current_command_.param2 == -9999)
-					current_command_complete_ = true;
-				// Call Drive with the distance and speed iteratively until the command is complete
-				else {
-					if (drive_train_->Drive((double) current_command_.param1, current_command_.param2))
-						current_command_complete_ = true;
-				}
-			}
-			// DriveTime
-			else if (strncmp(current_command_.command, "drivetime", 255) == 0) {
-				// Verify that 3 arguments were provided
-				if (current_command_.param1 == -9999 || current_command_.param2 == -9999 || current_command_.param3 == -9999)
-					current_command_complete_ = true;
-				else {
-					// If this is the first time through this function for this command, reset and start the timer
-					if (!current_command_in_progress_) {
-						drive_train_->ResetAndStartTimer();
-						current_command_in_progress_ = true;
-					}
-					// Call Drive with the time, direction, and speed iteratively until the command is complete
-					if (drive_train_->Drive((double) current_command_.param1, (Direction) current_command_.param2, current_command_.param3))
-						current_command_complete_ = true;
-				}
-			}
-			// TurnHeading
-			else if (strncmp(current_command_.command, "turnheading", 255) == 0) {
-				// Verify that 2 arguments were provided
-				if (current_command_.param1 == -9999 || current_command_.param2 == -9999)
-					current_command_complete_ = true;
-				// Call Turn with the heading and speed iteratively until the command is complete
-				else {
-					if (drive_train_->Turn(current_command_.param1, current_command_.param2))
-						current_command_complete_ = true;
-				}
-			}
-			// TurnTime
-			else if (strncmp(current_command_.command, "turntime", 255) == 0) {
-				// Verify that 3 arguments were provided
-				if (current_command_.param1 == -9999 || current_command_.param2 == -9999 || current_command_.param3 == -9999)
-					current_command_complete_ = true;
-				else {
-					// If this is the first time through this function for this command, reset and start the timer
-					if (!current_command_in_progress_) {
-						drive_train_->ResetAndStartTimer();
-						current_command_in_progress_ = true;
-					}
-					// Call Turn with the time, direction, and speed iteratively until the command is complete
-					if (drive_train_->Turn((double) current_command_.param1, (Direction) current_command_.param2, current_command_.param3))
-						current_command_complete_ = true;
-				}
-			}
-			// Shooter
-			// PitchPosition
-			else if (strncmp(current_command_.command, "pitchposition", 255) == 0) {
-				// Verify that 2 arguments were provided
-				if (current_command_.param1 == -9999 || current_command_.param2 == -9999)
-					current_command_complete_ = true;
-				// Call SetPitch with the encoder position and speed iteratively until the command is complete
-				else {
-					if (shooter_->SetPitch((int) current_command_.param1, current_command_.param2))
-						current_command_complete_ = true;
-				}
-			}
-			// PitchTime
-			else if (strncmp(current_command_.command, "pitchtime", 255) == 0) {
-				// Verify that 3 arguments were provided
-				if (current_command_.param1 == -9999 || current_command_.param2 == -9999 || current_command_.param3 == -9999)
-					current_command_complete_ = true;
-				else {
-					// If this is the first time through this function for this command, reset and start the timer
-					if (!current_command_in_progress_) {
-						shooter_->ResetAndStartTimer();
-						current_command_in_progress_ = true;
-					}
-					// Call SetPitch with the time, direction, and speed iteratively until the command is complete
-					if (shooter_->SetPitch((double) current_command_.param1, (Direction) current_command_.param2, current_command_.param3))
-						current_command_complete_ = true;
-				}
-			}
-			// PitchAngle
-			else if (strncmp(current_command_.command, "pitchangle", 255) == 0) {
-				// Verify that 2 arguments were provided
-				if (current_command_.param1 == -9999 || current_command_.param2 == -9999)
-					current_command_complete_ = true;
-				// Call SetPitchAngle with the angle and speed iteratively until the command is complete
-				else {
-					if (shooter_->SetPitchAngle(current_command_.param1, current_command_.param2))
-						current_command_complete_ = true;
-				}
-			}
-			// Shoot
-			else if (strncmp(current_command_.command, "shoot", 255) == 0) {
-				// Verify that 1 argument was provided
-				if (current_command_.param1 == -9999)
-					current_command_complete_ = true;
-				else {
-					// If this is the first time through this function for this command, reset the state variable
-					if (!current_command_in_progress_) {
-						auto_shoot_state_ = kStep1;
-						current_command_in_progress_ = true;
-					}
-					// Call AutoShoot with the power iteratively until the command is complete
-					if (AutoShoot((int) current_command_.param1))
-						current_command_complete_ = true;
-				}
-			}
-			// RapidFire
-			else if (strncmp(current_command_.command, "rapidfire", 255) == 0) {
-				// If this is the first time through this function for this command, reset the state variable
-				if (!current_command_in_progress_) {
-					auto_rapid_fire_state_ = kStep1;
-					current_command_in_progress_ = true;
+		if (current_command_count_ > 0 && current_commands_[0].opcode != AutoScript::kInvalid &&
+				current_commands_[0].opcode != AutoScript::kEnd) {
+			// Execute each command in the current group that hasn't finished yet
+			bool group_complete = true;
+			for (int i = 0; i < current_command_count_; i++) {
+				if (!current_commands_complete_[i]) {
+					current_commands_complete_[i] = RunCommand(current_commands_[i], &current_commands_in_progress_[i]);
+					if (!current_commands_complete_[i])
+						group_complete = false;
 				}
-				// Call AutoRapidFire iteratively until the command is complete
-				if (AutoRapidFire())
-					current_command_complete_ = true;
-			}
-			// Targeting
-			// FindTarget
-			else if (strncmp(current_command_.command, "findtarget", 255) == 0) {
-				// Verify that 1 argument was provided
-				if (current_command_.param1 == -9999)
-					current_command_complete_ = true;
-				else {
-					// If this is the first time through this function for this command, reset the state variable
-					if (!current_command_in_progress_) {
-						auto_find_target_state_ = kStep1;
-						current_command_in_progress_ = true;
-					}
-					// Call AutoFindTarget iteratively until the command is complete
-					if (AutoFindTarget((Targeting::TargetHeight) current_command_.param1))
-						current_command_complete_ = true;
-				}
-			}
-			// Catchall - anything else just mark as complete
-			else {
-				current_command_complete_ = true;
 			}
 			
-			// Get next command if current is finished
-			if (current_command_complete_) {
-				current_command_in_progress_ = false;
-				current_command_ = autoscript_->GetNextCommand();
+			// Get the next group when every command in the current group is finished
+			if (group_complete) {
+				GetNextCommandGroup();
 			}
 		}
 		// No more commands, autoscript is finished
@@ -583,8 +559,12 @@ void TechnoJays::AutonomousPeriodic() {
 				shooter_->MovePitch(0.0, false);
 			if (shooter_->shooter_enabled_)
 				shooter_->Shoot(0);
+			auto_spinup_power_ = 0;
 		}
 	}
+
+	// Flag the loop if it took longer than it should have
+	FinishLoopTiming(autonomous_loop_probe_);
 }
 
 /**
@@ -607,6 +587,9 @@ void TechnoJays::TeleopInit() {
 	timer_->Stop();
 	timer_->Reset();
 
+	// Don't count a spinup from autonomous towards shots in teleop
+	auto_spinup_power_ = 0;
+
 	// Set the current state of the robot
 	if (climber_ != NULL)
 		climber_->SetRobotState(kTeleop);
@@ -634,16 +617,30 @@ void TechnoJays::TeleopInit() {
  * performing user requested semi-autonomous functions.
 */
 void TechnoJays::TeleopPeriodic() {
+	if (loop_timer_ != NULL)
+		loop_timer_->Start(teleop_loop_probe_);
+
+	// Pick up any parameter files that changed since the last loop
+	ReloadChangedParameters();
+
 	// Read sensor values in all the objects
-	if (shooter_ != NULL)
-		shooter_->ReadSensors();
-	if (drive_train_ != NULL)
-		drive_train_->ReadSensors();
-	if (climber_ != NULL)
-		climber_->ReadSensors();
+	{
+		LoopTimerProbe probe(loop_timer_, read_sensors_probe_);
+		if (shooter_ != NULL)
+			shooter_->ReadSensors();
+		if (drive_train_ != NULL)
+			drive_train_->ReadSensors();
+		if (climber_ != NULL)
+			climber_->ReadSensors();
+		if (targeting_ != NULL && drive_train_ != NULL)
+			targeting_->SetHeading(drive_train_->GetHeading());
+		if (targeting_ != NULL)
+			targeting_->WriteLogMessages();
+	}
 
 	// Log detailed data if enabled
 	if (detailed_logging_enabled_) {
+		LoopTimerProbe probe(loop_timer_, log_state_probe_);
 		if (shooter_ != NULL)
 			shooter_->LogCurrentState();
 		if (drive_train_ != NULL)
@@ -698,6 +695,7 @@ void TechnoJays::TeleopPeriodic() {
 	
 	// Perform user controlled actions if a UI is present
 	if (user_interface_ != NULL) {
+		LoopTimerProbe probe(loop_timer_, user_controls_probe_);
 		float driver_left_y = 0.0;
 		float driver_right_y = 0.0;
 		float scoring_left_y = 0.0;
@@ -713,15 +711,15 @@ void TechnoJays::TeleopPeriodic() {
 
 		// Log analog controls if detailed logging is enabled
 		if (detailed_logging_enabled_) {
-			log_->WriteValue("DriverLeftY", driver_left_y, true);
-			log_->WriteValue("DriverRightY", driver_right_y, true);
-			log_->WriteValue("DriverTurbo", user_interface_->GetButtonState(UserInterface::kDriver,
+			log_->WriteChannel(driver_left_y_channel_, driver_left_y, true);
+			log_->WriteChannel(driver_right_y_channel_, driver_right_y, true);
+			log_->WriteChannel(driver_turbo_channel_, user_interface_->GetButtonState(UserInterface::kDriver,
 				UserInterface::kRightBumper), true);
-			log_->WriteValue("ScoringLeftY", scoring_left_y, true);
-			log_->WriteValue("ScoringRightY", scoring_right_y, true);
-			log_->WriteValue("ScoringTurbo", user_interface_->GetButtonState(UserInterface::kScoring,
+			log_->WriteChannel(scoring_left_y_channel_, scoring_left_y, true);
+			log_->WriteChannel(scoring_right_y_channel_, scoring_right_y, true);
+			log_->WriteChannel(scoring_turbo_channel_, user_interface_->GetButtonState(UserInterface::kScoring,
 				UserInterface::kRightBumper), true);
-			log_->WriteValue("Shooter", user_interface_->GetButtonState(UserInterface::kScoring,
+			log_->WriteChannel(shooter_channel_, user_interface_->GetButtonState(UserInterface::kScoring,
 				UserInterface::kLeftTrigger), true);
 		}
 
@@ -958,6 +956,9 @@ void TechnoJays::TeleopPeriodic() {
 		user_interface_->StoreButtonStates(UserInterface::kDriver);
 		user_interface_->StoreButtonStates(UserInterface::kScoring);
 	}
+
+	// Flag the loop if it took longer than it should have
+	FinishLoopTiming(teleop_loop_probe_);
 }
 
 void TechnoJays::PrintTargetInfo() {
@@ -966,7 +967,7 @@ void TechnoJays::PrintTargetInfo() {
 		memset(output_buffer_, 0, sizeof(output_buffer_));
 		Targeting::TargetHeight target_height = targeting_->GetEnumHeightOfTarget(&current_target_);
 		sprintf(output_buffer_, "Height: ");
-		targeting_->GetStringHeightOfTarget(target_height, output_buffer_+8);
+		targeting_->GetStringHeightOfTarget(target_height, output_buffer_+8, sizeof(output_buffer_)-8);
 		user_interface_->OutputUserMessage(output_buffer_, true);
 		sprintf(output_buffer_, "Distance: %4.2f", (float) targeting_->GetCameraDistanceToTarget(&current_target_));			
 		user_interface_->OutputUserMessage(output_buffer_, false);
@@ -981,6 +982,8 @@ void TechnoJays::PrintTargetInfo() {
  * \brief Steers the robot to face a target.
 */
 bool TechnoJays::AimAtTarget() {
+	LoopTimerProbe probe(loop_timer_, aim_probe_);
+
 	// Abort if we don't have what we need
 	if ((current_target_.imageWidth == 0 && current_target_.imageHeight == 0) || drive_train_ == NULL 
 			|| shooter_ == NULL || targeting_ == NULL) {
@@ -995,7 +998,9 @@ bool TechnoJays::AimAtTarget() {
 	switch (aim_state_) {
 	// Calculate heading adjustment
 	case kStep1:
-		degrees_off_ = targeting_->GetHorizontalAngleOfTarget(&current_target_);
+		// The angle is from where the robot was pointing when the image was taken, so take off any turn since then
+		degrees_off_ = targeting_->GetHorizontalAngleOfTarget(&current_target_) + target_report_heading_ -
+				drive_train_->GetHeading();
 		// Fall through to step 2
 		aim_state_ = kStep2;
 	// Adjust heading until aimed at target
@@ -1031,6 +1036,207 @@ bool TechnoJays::AimAtTarget() {
 	return false;
 }
 
+/**
+ * \brief Get the next command, or group of parallel commands, from the autoscript.
+ *
+ * The commands between the parallel and join commands are run at the same
+ * time, and each keeps its own in progress state.  Any other command is run
+ * on its own.
+*/
+void TechnoJays::GetNextCommandGroup() {
+	current_command_count_ = 0;
+	autoscript_command command = autoscript_->GetNextCommand();
+	if (command.opcode == AutoScript::kParallel) {
+		// The script was checked for matching joins and the group size when it was read
+		for (command = autoscript_->GetNextCommand(); command.opcode != AutoScript::kJoin &&
+				command.opcode != AutoScript::kEnd && current_command_count_ < AutoScript::kMaxGroupCommands;
+				command = autoscript_->GetNextCommand()) {
+			current_commands_[current_command_count_++] = command;
+		}
+	}
+	else {
+		current_commands_[current_command_count_++] = command;
+	}
+
+	for (int i = 0; i < AutoScript::kMaxGroupCommands; i++) {
+		current_commands_complete_[i] = false;
+		current_commands_in_progress_[i] = false;
+	}
+}
+
+/**
+ * \brief Execute one autoscript command for one loop.
+ *
+ * \param command the command to execute.
+ * \param in_progress the command's in progress state, true once it has started.
+ * \return true when the command is complete.
+*/
+bool TechnoJays::RunCommand(const autoscript_command &command, bool * in_progress) {
+	bool complete = false;
+	
+	// The number of parameters was checked when the script was read
+	switch (command.opcode) {
+	// General utilities
+	// Time delay
+	case AutoScript::kWait: {
+		// If this is the first time through this function for this command, reset and start the timer
+		if (!*in_progress) {
+			timer_->Stop();
+			timer_->Reset();
+			timer_->Start();
+			*in_progress = true;
+		}
+		double time_left = 0.0;
+		double elapsed_time = 999.0;
+		// Get the timer value since we started moving
+		elapsed_time = timer_->Get();
+		// Calculate time left
+		time_left = (double) command.param1 - elapsed_time;
+		// If the time has elapsed, stop the timer and mark this command as complete
+		if (time_left < 0) {
+			timer_->Stop();
+			complete = true;
+		}
+		break;
+	}
+	// DriveTrain
+	// AdjustHeading
+	case AutoScript::kAdjustHeading:
+		// If this is the first time through this function for this command, plan the turn from here
+		if (!*in_progress) {
+			drive_train_->ResetProfile();
+			*in_progress = true;
+		}
+		// Call AdjustHeading with the adjustment and speed iteratively until the command is complete 
+		if (drive_train_->AdjustHeading(command.param1, command.param2))
+			complete = true;
+		break;
+	// DriveDistance
+	case AutoScript::kDriveDistance:
+		// If this is the first time through this function for this command, measure the distance from here
+		if (!*in_progress) {
+			drive_train_->ResetDistance();
+			drive_train_->ResetProfile();
+			*in_progress = true;
+		}
+		// Call Drive with the distance and speed iteratively until the command is complete
+		if (drive_train_->Drive((double) command.param1, command.param2))
+			complete = true;
+		break;
+	// DriveTime
+	case AutoScript::kDriveTime:
+		// If this is the first time through this function for this command, reset and start the timer
+		if (!*in_progress) {
+			drive_train_->ResetAndStartTimer();
+			*in_progress = true;
+		}
+		// Call Drive with the time, direction, and speed iteratively until the command is complete
+		if (drive_train_->Drive((double) command.param1, (Direction) command.param2, command.param3))
+			complete = true;
+		break;
+	// TurnHeading
+	case AutoScript::kTurnHeading:
+		// If this is the first time through this function for this command, plan the turn from here
+		if (!*in_progress) {
+			drive_train_->ResetProfile();
+			*in_progress = true;
+		}
+		// Call Turn with the heading and speed iteratively until the command is complete
+		if (drive_train_->Turn(command.param1, command.param2))
+			complete = true;
+		break;
+	// TurnTime
+	case AutoScript::kTurnTime:
+		// If this is the first time through this function for this command, reset and start the timer
+		if (!*in_progress) {
+			drive_train_->ResetAndStartTimer();
+			*in_progress = true;
+		}
+		// Call Turn with the time, direction, and speed iteratively until the command is complete
+		if (drive_train_->Turn((double) command.param1, (Direction) command.param2, command.param3))
+			complete = true;
+		break;
+	// Shooter
+	// PitchPosition
+	case AutoScript::kPitchPosition:
+		// Call SetPitch with the encoder position and speed iteratively until the command is complete
+		if (shooter_->SetPitch((int) command.param1, command.param2))
+			complete = true;
+		break;
+	// PitchTime
+	case AutoScript::kPitchTime:
+		// If this is the first time through this function for this command, reset and start the timer
+		if (!*in_progress) {
+			shooter_->ResetAndStartTimer();
+			*in_progress = true;
+		}
+		// Call SetPitch with the time, direction, and speed iteratively until the command is complete
+		if (shooter_->SetPitch((double) command.param1, (Direction) command.param2, command.param3))
+			complete = true;
+		break;
+	// PitchAngle
+	case AutoScript::kPitchAngle:
+		// Call SetPitchAngle with the angle and speed iteratively until the command is complete
+		if (shooter_->SetPitchAngle(command.param1, command.param2))
+			complete = true;
+		break;
+	// Shoot
+	case AutoScript::kShoot:
+		// If this is the first time through this function for this command, reset the state variable
+		if (!*in_progress) {
+			auto_shoot_state_ = kStep1;
+			*in_progress = true;
+		}
+		// Call AutoShoot with the power iteratively until the command is complete
+		if (AutoShoot((int) command.param1))
+			complete = true;
+		break;
+	// RapidFire
+	case AutoScript::kRapidFire:
+		// If this is the first time through this function for this command, reset the state variable
+		if (!*in_progress) {
+			auto_rapid_fire_state_ = kStep1;
+			*in_progress = true;
+		}
+		// Call AutoRapidFire iteratively until the command is complete
+		if (AutoRapidFire())
+			complete = true;
+		break;
+	// Targeting
+	// FindTarget
+	case AutoScript::kFindTarget:
+		// If this is the first time through this function for this command, reset the state variable
+		if (!*in_progress) {
+			auto_find_target_state_ = kStep1;
+			*in_progress = true;
+		}
+		// Call AutoFindTarget iteratively until the command is complete
+		if (AutoFindTarget((Targeting::TargetHeight) command.param1))
+			complete = true;
+		break;
+	// SpinUp
+	case AutoScript::kSpinUp:
+		// Start the shooter now, so a later shoot command doesn't need to wait as long for it to spin up
+		if (shooter_ != NULL && shooter_->shooter_enabled_) {
+			shooter_->Shoot((int) command.param1);
+			if (auto_spinup_power_ != (int) command.param1) {
+				auto_spinup_power_ = (int) command.param1;
+				auto_spinup_timer_->Stop();
+				auto_spinup_timer_->Reset();
+				auto_spinup_timer_->Start();
+			}
+		}
+		complete = true;
+		break;
+	// Catchall - anything else just mark as complete
+	default:
+		complete = true;
+		break;
+	}
+
+	return complete;
+}
+
 /**
  * \brief Get a list of targets from the targeting module.
  *
@@ -1043,8 +1249,7 @@ void TechnoJays::GetTargets() {
 		return;
 
 	// Erase old data
-	if (!targets_report_.empty())
-		targets_report_.clear();
+	targets_report_ = NULL;
 		
 	// Reset drive train sensors
 	if (drive_train_ != NULL)
@@ -1056,13 +1261,23 @@ void TechnoJays::GetTargets() {
 	current_target_.imageHeight = 0;
 	current_target_.imageWidth = 0;
 	
-	// Search for targets
-	if (!targeting_->GetTargets(targets_report_))
+	// Get the latest targets, which stay unchanged until the next time this is called
+	targets_report_ = targeting_->GetLatestTargets();
+	if (targets_report_ == NULL)
 		return;
 
-	// Store current robot heading
+	// Store the robot heading when the image was taken, relative to the reset heading
 	if (drive_train_ != NULL)
-		target_report_heading_ = drive_train_->GetHeading();
+		target_report_heading_ = drive_train_->GetHeadingAt(targets_report_->capture_timestamp);
+
+	// Record how long the image took to process, and how old the targets are now
+	UINT64 processing_time = targets_report_->processed_timestamp - targets_report_->capture_timestamp;
+	if (loop_timer_ != NULL)
+		loop_timer_->AddSample(vision_latency_probe_, (UINT32) std::min(processing_time, (UINT64) 0xFFFFFFFFULL));
+	if (log_enabled_) {
+		log_->WriteValue("Vision latency ms", (float) (processing_time / 1000000.0), true);
+		log_->WriteValue("Target age ms", (float) ((LoopTimer::GetTimestamp() - targets_report_->capture_timestamp) / 1000000.0), true);
+	}
 	
 }
 
@@ -1071,16 +1286,16 @@ void TechnoJays::GetTargets() {
 */
 void TechnoJays::NextTarget() {
 	// Only cycle if we have more than 1 target
-	if (targets_report_.size() > 1) {
+	if (targets_report_ != NULL && targets_report_->targets.size() > 1) {
 		// Increment/cycle the target counter
-		if ((current_target_vector_location_ + 1) >= targets_report_.size()) {
+		if ((current_target_vector_location_ + 1) >= targets_report_->targets.size()) {
 			current_target_vector_location_ = 0;
 		} else {
 			current_target_vector_location_++;
 		}
 
 		// Get the target report from the report of all targets
-		ParticleAnalysisReport target = (targets_report_.at(
+		ParticleAnalysisReport target = (targets_report_->targets.at(
 				current_target_vector_location_));
 
 		// Copy the pointer to our class variable
@@ -1090,6 +1305,62 @@ void TechnoJays::NextTarget() {
 	}
 }
 
+/**
+ * \brief Passes newly read parameters to the subsystems whose parameter files changed.
+ *
+ * The files are read by the parameter watcher in the background, and what
+ * changed is written to its log in the background, so this doesn't wait on
+ * the file system.  Only the climber, drive train and shooter tuning values
+ * can be changed while running, other files are reported and take effect
+ * after a restart.
+*/
+void TechnoJays::ReloadChangedParameters() {
+	LoopTimerProbe probe(loop_timer_, reload_parameters_probe_);
+
+	if (parameter_watcher_ == NULL)
+		return;
+
+	ParameterWatcher *reload_log = log_enabled_ ? parameter_watcher_ : NULL;
+	for (int i = 0; i < parameter_watcher_->GetFileCount(); i++) {
+		Parameters *changed_parameters = parameter_watcher_->GetChangedParameters(i);
+		if (changed_parameters == NULL)
+			continue;
+
+		if (i == climber_parameters_file_ && climber_ != NULL) {
+			climber_->ReloadParameters(changed_parameters, reload_log);
+		}
+		else if (i == drive_train_parameters_file_ && drive_train_ != NULL) {
+			drive_train_->ReloadParameters(changed_parameters, reload_log);
+		}
+		else if (i == shooter_parameters_file_ && shooter_ != NULL) {
+			shooter_->ReloadParameters(changed_parameters, reload_log);
+		}
+		else {
+			if (reload_log != NULL) {
+				char message[128] = {0};
+				sprintf(message, "%.64s changed, restart the robot to use it\n", parameter_watcher_->GetPath(i));
+				reload_log->WriteLine(message);
+			}
+			SafeDelete(changed_parameters);
+		}
+	}
+}
+
+/**
+ * \brief Stop timing a periodic loop.
+ *
+ * Overruns are kept by the loop timer and listed with the summary when the
+ * mode changes, so the loop doesn't write to the log for them.
+ *
+ * \param probe the loop timer probe of the loop.
+*/
+void TechnoJays::FinishLoopTiming(int probe) {
+	if (loop_timer_ == NULL)
+		return;
+
+	loop_timer_->Stop(probe);
+}
+
 /**
  * \brief Select a target from the target list that is nearest the specified height.
  *
@@ -1097,7 +1368,7 @@ void TechnoJays::NextTarget() {
 */
 void TechnoJays::SelectTarget(Targeting::TargetHeight height) {
 	// Abort if no targets found
-	if (targets_report_.size() == 0)
+	if (targets_report_ == NULL || targets_report_->targets.size() == 0)
 		return;
 	
 	// Local target variables during search
@@ -1105,9 +1376,9 @@ void TechnoJays::SelectTarget(Targeting::TargetHeight height) {
 	Targeting::TargetHeight current_height = Targeting::kUnknown;
 	
 	// Loop through all detected targets
-	for (unsigned i = 0; i < targets_report_.size(); i++) {
+	for (unsigned i = 0; i < targets_report_->targets.size(); i++) {
 		// Get the current target and height
-		target = (targets_report_.at(i));
+		target = (targets_report_->targets.at(i));
 		current_height = targeting_->GetEnumHeightOfTarget(&target);
 		// If it matches, store the current target and return
 		if (current_height == height) {
@@ -1119,13 +1390,13 @@ void TechnoJays::SelectTarget(Targeting::TargetHeight height) {
 	
 	// If the expected was the low height and nothing found, choose lowest target found
 	if (height == Targeting::kLow) {
-		current_target_ = (targets_report_.at(0));
+		current_target_ = (targets_report_->targets.at(0));
 		current_target_vector_location_ = 0;
 	}
 	// Otherwise choose the highest target found
 	else {
-		current_target_vector_location_ = targets_report_.size() - 1;
-		current_target_ = (targets_report_.at(current_target_vector_location_));
+		current_target_vector_location_ = targets_report_->targets.size() - 1;
+		current_target_ = (targets_report_->targets.at(current_target_vector_location_));
 	}
 }
 
@@ -1176,6 +1447,8 @@ bool TechnoJays::AutoFindTarget(Targeting::TargetHeight height) {
  * \return true when the operation is complete.
 */
 bool TechnoJays::AutoShoot(int power) {
+	LoopTimerProbe probe(loop_timer_, auto_shoot_probe_);
+
 	// Abort if we don't have what we need
 	if (feeder_ == NULL || shooter_ == NULL || !feeder_->feeder_enabled_ || !shooter_->shooter_enabled_) {
 		auto_shoot_state_ = kFinished;
@@ -1196,21 +1469,25 @@ bool TechnoJays::AutoShoot(int power) {
 		auto_shoot_timer_->Reset();
 		auto_shoot_timer_->Start();
 		elapsed_time = 0.0;
+		// Count the time the shooter already spun up at this power from a spinup command
+		auto_shoot_head_start_ = 0.0;
+		if (auto_spinup_power_ != 0 && auto_spinup_power_ == power)
+			auto_shoot_head_start_ = auto_spinup_timer_->Get();
 		auto_shoot_state_ = kStep2;
-		// Fall through into kStep2
 	// Pre-delay for the shooter to spinup
+	// Fall through
 	case kStep2:
 		// Calculate time left
-		time_left = auto_shooter_spinup_time_ - elapsed_time;
+		time_left = auto_shooter_spinup_time_ - auto_shoot_head_start_ - elapsed_time;
 		// If enough time has passed, feed a disc
 		if (time_left <= 0.0) {
 			auto_shoot_state_ = kStep3;
 			auto_shoot_timer_->Stop();
-			// Fall through to kStep3
 		} else {
 			break;
 		}
-	// Feed a disc into the shooter
+	// Feed a disc into the shooter, once the shooter has spun up
+	// Fall through
 	case kStep3:
 		feeder_->SetPiston(true);
 		auto_shoot_timer_->Reset();
@@ -1230,6 +1507,7 @@ bool TechnoJays::AutoShoot(int power) {
 			feeder_->SetPiston(false);
 			// Stop spinning the shooter motor
 			shooter_->Shoot(0);
+			auto_spinup_power_ = 0;
 			auto_shoot_state_ = kFinished;
 			if (user_interface_ != NULL) {
 				memset(output_buffer_, 0, sizeof(output_buffer_));
@@ -1242,6 +1520,7 @@ bool TechnoJays::AutoShoot(int power) {
 		}
 	default:
 		shooter_->Shoot(0);
+		auto_spinup_power_ = 0;
 		auto_shoot_state_ = kFinished;
 		if (user_interface_ != NULL) {
 			memset(output_buffer_, 0, sizeof(output_buffer_));
@@ -1497,6 +1776,7 @@ bool TechnoJays::AutoRapidFire() {
 		auto_shoot_timer_->Reset();
 		// Stop spinning the shooter motor
 		shooter_->Shoot(0);
+		auto_spinup_power_ = 0;
 		auto_rapid_fire_state_ = kFinished;
 		if (user_interface_ != NULL) {
 			memset(output_buffer_, 0, sizeof(output_buffer_));
@@ -1506,6 +1786,7 @@ bool TechnoJays::AutoRapidFire() {
 		return true;
 	default:
 		shooter_->Shoot(0);
+		auto_spinup_power_ = 0;
 		auto_rapid_fire_state_ = kFinished;
 		if (user_interface_ != NULL) {
 			memset(output_buffer_, 0, sizeof(output_buffer_));
@@ -15,7 +15,10 @@ class Climber;
 class DataLog;
 class DriveTrain;
 class Feeder;
+class LoopTimer;
 class Parameters;
+class ParameterWatcher;
+class SensorSampler;
 class Shooter;
 class Targeting;
 class UserInterface;
@@ -40,7 +43,7 @@ public:
 	void TeleopPeriodic();
 
 	// Public member variables
-	vector<ParticleAnalysisReport> targets_report_;	///< particle reports of matching hoop targets
+	const target_report *targets_report_;	///< particle reports of matching hoop targets, shared with the targeting module, NULL if there are none
 	
 private:
 	// Private enums
@@ -72,9 +75,13 @@ private:
 	bool AutoFindTarget(Targeting::TargetHeight height);
 	bool AutoRapidFire();
 	bool AutoShoot(int power);
+	void FinishLoopTiming(int probe);
+	void GetNextCommandGroup();
 	void GetTargets();
 	void Initialize(const char * parameters, bool logging_enabled);
 	void NextTarget();
+	void ReloadChangedParameters();
+	bool RunCommand(const autoscript_command &command, bool * in_progress);
 	void PrintTargetInfo();
 	void SelectTarget(Targeting::TargetHeight height);
 	
@@ -85,13 +92,17 @@ private:
 	DataLog *log_;							///< log object used to log data or status comments to a file
 	DriveTrain *drive_train_;				///< controls the robot drive train to drive and turn
 	Feeder *feeder_;						///< controls the feeder to feed discs to the shooter
+	LoopTimer *loop_timer_;					///< times the periodic loops and the calls inside them
 	Parameters *parameters_;				///< parameters object used to load robot parameters from a file
+	ParameterWatcher *parameter_watcher_;	///< reloads subsystem parameter files in the background when they change
+	SensorSampler *sensor_sampler_;			///< reads the encoders and gyro at a fixed rate in a separate task
 	Shooter *shooter_;						///< controls the robot to shoot discs
 	Targeting *targeting_;					///< finds and reports details about targets
 	UserInterface *user_interface_;			///< gets input from the controllers and sends messages back to the DriverStation
 	ParticleAnalysisReport current_target_;	///< contains information about the currently selected target from the camera
 	Timer *timer_;							///< timer object used for misc timed functions
 	Timer *auto_shoot_timer_;				///< timer object used for AutoShoot function
+	Timer *auto_spinup_timer_;				///< timer object used to measure how long the shooter has been spun up
 	
 	// Private parameters
 	double camera_boot_time_;				///< the amount of time required for the Axis camera to bootup
@@ -105,7 +116,9 @@ private:
 	int auto_climb_headstart_encoder_count_;///< the encoder count of the shooter to have a headstart for auto climbing
 	float auto_climb_winch_speed_;			///< the winch speed during auto climbing
 	float auto_climb_winch_time_;			///< the winch duration during auto climbing
+	int binary_logging_;					///< 1 if the logs should be written in the binary format
 	double period_;							///< the period in seconds for the periodic loops
+	int sensor_sample_rate_;				///< number of times per second the encoders and gyro are read, 0 to read them in the periodic loops
 	
 	// Private member variables
 	float previous_scoring_dpad_y_;				///< the last known value of the Y axis on the scoring directional pad
@@ -113,14 +126,37 @@ private:
 	bool scoring_turbo_;						///< true if the scoring controller is requesting turbo mode
 	bool detailed_logging_enabled_;				///< true if detailed robot and driver details should be logged
 	bool log_enabled_;							///< true if logging is enabled
+	int driver_left_y_channel_;					///< log channel for the driver left thumbstick
+	int driver_right_y_channel_;				///< log channel for the driver right thumbstick
+	int driver_turbo_channel_;					///< log channel for the driver turbo button
+	int scoring_left_y_channel_;				///< log channel for the scoring left thumbstick
+	int scoring_right_y_channel_;				///< log channel for the scoring right thumbstick
+	int scoring_turbo_channel_;					///< log channel for the scoring turbo button
+	int shooter_channel_;						///< log channel for the shooter trigger
+	int disabled_loop_probe_;					///< loop timer probe for DisabledPeriodic()
+	int autonomous_loop_probe_;					///< loop timer probe for AutonomousPeriodic()
+	int teleop_loop_probe_;						///< loop timer probe for TeleopPeriodic()
+	int reload_parameters_probe_;				///< loop timer probe for ReloadChangedParameters()
+	int read_sensors_probe_;					///< loop timer probe for reading the subsystem sensors
+	int log_state_probe_;						///< loop timer probe for logging the subsystem states
+	int auto_shoot_probe_;						///< loop timer probe for AutoShoot()
+	int aim_probe_;								///< loop timer probe for AimAtTarget()
+	int vision_latency_probe_;					///< loop timer probe for the time from a camera image being taken to its targets being reported
+	int user_controls_probe_;					///< loop timer probe for handling the user controls in teleop
+	int climber_parameters_file_;				///< parameter watcher index of the climber parameter file
+	int drive_train_parameters_file_;			///< parameter watcher index of the drive train parameter file
+	int shooter_parameters_file_;				///< parameter watcher index of the shooter parameter file
 	char parameters_file_[25];					///< path and filename of the parameter file to read
 	char output_buffer_[22];					///< character buffer for outputting messages to the driver station LCD
 	std::string autoscript_file_name_;			///< file name of the selected autoscript file for autonomous mode
 	unsigned int autoscript_files_counter_;		///< counter of the current file selected in the autoscript_files_ vector
 	std::vector<std::string> autoscript_files_;	///< vector of autoscript file names from the file system
-	bool current_command_complete_;				///< true when an autonomous command finishes and the next should be executed
-	bool current_command_in_progress_;			///< true when an autonomous command has already started
-	autoscript_command current_command_;		///< the current autonomous command being executed
+	bool current_commands_complete_[AutoScript::kMaxGroupCommands];		///< true when an autonomous command in the current group finishes
+	bool current_commands_in_progress_[AutoScript::kMaxGroupCommands];	///< true when an autonomous command in the current group has already started
+	autoscript_command current_commands_[AutoScript::kMaxGroupCommands];	///< the current group of autonomous commands being executed at the same time
+	int current_command_count_;					///< number of commands in the current group
+	int auto_spinup_power_;						///< the power the shooter was spun up to by a spinup command, 0 if it isn't spun up
+	double auto_shoot_head_start_;				///< the time the shooter already spent spinning up when AutoShoot started
 	float target_report_heading_;				///< the heading of the robot when the target report was generated
 	double degrees_off_;						///< the number of degrees the robot is off from facing the selected target
 	unsigned current_target_vector_location_;	///< the index in the particle report vector of the current target, used when cycling through targets
@@ -25,7 +25,7 @@ void TestParameters() {
         cout << "Error reading param1 file!\n";
     }
 	parameters_->Close();
-	if (!parameters_->GetValue("StringP", string_p)) {
+	if (!parameters_->GetValue("StringP", string_p, sizeof(string_p))) {
         cout << "Error reading StringP!\n";
     }
 	if (!parameters_->GetValue("IntP", &int_p)) {
@@ -50,7 +50,7 @@ void TestParameters() {
 	if (!parameters_->GetValue("DoubleP", &double_p)) {
         cout << "Error reading DoubleP!\n";
     } 
-	if (!parameters_->GetValue("XXX", string_p2)) {
+	if (!parameters_->GetValue("XXX", string_p2, sizeof(string_p2))) {
         cout << "Error reading XXX!\n";
     }
 	if (!parameters_->GetValue("XXX", &int_p2)) {
@@ -86,7 +86,7 @@ void TestAutoScript() {
 	
 	autoscript_command ac = autoscript_->GetNextCommand();
 	//autoscript_command ac = autoscript_->GetCommand(0);
-    cout << ac.command << "\n";
+    cout << AutoScript::GetCommandName(ac.opcode) << "\n";
 	cout << ac.param1 << "\n";
 	cout << ac.param2 << "\n";
 	cout << ac.param3 << "\n";
@@ -95,7 +95,7 @@ void TestAutoScript() {
 	
 	ac = autoscript_->GetNextCommand();
 	//ac = autoscript_->GetCommand(1);
-    cout << ac.command << "\n";
+    cout << AutoScript::GetCommandName(ac.opcode) << "\n";
 	cout << ac.param1 << "\n";
 	cout << ac.param2 << "\n";
 	cout << ac.param3 << "\n";
@@ -104,7 +104,7 @@ void TestAutoScript() {
 
 	ac = autoscript_->GetNextCommand();
 	//ac = autoscript_->GetCommand(2);
-    cout << ac.command << "\n";
+    cout << AutoScript::GetCommandName(ac.opcode) << "\n";
 	cout << ac.param1 << "\n";
 	cout << ac.param2 << "\n";
 	cout << ac.param3 << "\n";
@@ -113,7 +113,7 @@ void TestAutoScript() {
 
 	ac = autoscript_->GetNextCommand();
 	//ac = autoscript_->GetCommand(3);
-    cout << ac.command << "\n";
+    cout << AutoScript::GetCommandName(ac.opcode) << "\n";
 	cout << ac.param1 << "\n";
 	cout << ac.param2 << "\n";
 	cout << ac.param3 << "\n";
@@ -122,7 +122,7 @@ void TestAutoScript() {
 
 	ac = autoscript_->GetNextCommand();
 	//ac = autoscript_->GetCommand(4);
-    cout << ac.command << "\n";
+    cout << AutoScript::GetCommandName(ac.opcode) << "\n";
 	cout << ac.param1 << "\n";
 	cout << ac.param2 << "\n";
 	cout << ac.param3 << "\n";
@@ -131,7 +131,7 @@ void TestAutoScript() {
 
 	ac = autoscript_->GetNextCommand();
 	//ac = autoscript_->GetCommand(5);
-    cout << ac.command << "\n";
+    cout << AutoScript::GetCommandName(ac.opcode) << "\n";
 	cout << ac.param1 << "\n";
 	cout << ac.param2 << "\n";
 	cout << ac.param3 << "\n";
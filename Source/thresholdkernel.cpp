@@ -0,0 +1,370 @@
+#include <stdlib.h>
+#include <algorithm>
+#include "thresholdkernel.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * \def PIXEL_SIZE
+ * \brief The number of bytes in a pixel.
+ */
+#define PIXEL_SIZE 4
+
+/**
+ * \brief Create the kernel with a threshold that matches nothing.
+*/
+ThresholdKernel::ThresholdKernel() {
+	// Used to divide by the difference between the largest and smallest color when finding the hue
+	// 1 is handled separately since 2^32 doesn't fit
+	reciprocals_[0] = 0;
+	reciprocals_[1] = 0;
+	for (unsigned int i = 2; i < 256; i++) {
+		reciprocals_[i] = 0xFFFFFFFFU / i + 1;
+	}
+	SetThreshold(kRGB, 1, 0, 1, 0, 1, 0);
+}
+
+/**
+ * \brief Nothing to clean up.
+*/
+ThresholdKernel::~ThresholdKernel() {
+}
+
+/**
+ * \brief Set the color planes and the range of each plane that pixels must be inside.
+ *
+ * \param color_space the color planes to compare.
+ * \param plane_1_low lower boundary of the hue, or red for RGB.
+ * \param plane_1_high upper boundary of the hue, or red for RGB.
+ * \param plane_2_low lower boundary of the saturation, or green for RGB.
+ * \param plane_2_high upper boundary of the saturation, or green for RGB.
+ * \param plane_3_low lower boundary of the value or lightness, or blue for RGB.
+ * \param plane_3_high upper boundary of the value or lightness, or blue for RGB.
+*/
+void ThresholdKernel::SetThreshold(ColorSpace color_space, int plane_1_low, int plane_1_high, int plane_2_low,
+		int plane_2_high, int plane_3_low, int plane_3_high) {
+	color_space_ = color_space;
+	low_[0] = plane_1_low;
+	high_[0] = plane_1_high;
+	low_[1] = plane_2_low;
+	high_[1] = plane_2_high;
+	low_[2] = plane_3_low;
+	high_[2] = plane_3_high;
+
+	// Planes are 0-255, so clamping the boundaries doesn't change the result,
+	// but it keeps the products in the saturation test in 16 bits
+	for (int i = 0; i < 3; i++) {
+		low_[i] = std::max(0, std::min(256, low_[i]));
+		high_[i] = std::max(-1, std::min(255, high_[i]));
+	}
+}
+
+/**
+ * \brief Make a mask of the pixels inside the threshold.
+ *
+ * \param pixels the first pixel of the image.
+ * \param width the width of the image in pixels.
+ * \param height the height of the image in pixels.
+ * \param pixels_per_line the distance in pixels from the start of one line to the next.
+ * \param mask the first byte of the mask, with room for the whole image.
+ * \param mask_pixels_per_line the distance in bytes from the start of one mask line to the next.
+ * \param replace_value the mask value for pixels inside the threshold, others are 0.
+*/
+void ThresholdKernel::Apply(const unsigned char * pixels, int width, int height, int pixels_per_line,
+		unsigned char * mask, int mask_pixels_per_line, unsigned char replace_value) {
+	if (pixels == NULL || mask == NULL) {
+		return;
+	}
+	for (int y = 0; y < height; y++) {
+		ApplyRow(pixels + y * pixels_per_line * PIXEL_SIZE, width, mask + y * mask_pixels_per_line, replace_value);
+	}
+}
+
+/**
+ * \brief Make a mask of the pixels inside the threshold, converting every pixel the simple way.
+ *
+ * Used to check Apply().  The parameters are the same.
+ *
+ * \param pixels the first pixel of the image.
+ * \param width the width of the image in pixels.
+ * \param height the height of the image in pixels.
+ * \param pixels_per_line the distance in pixels from the start of one line to the next.
+ * \param mask the first byte of the mask, with room for the whole image.
+ * \param mask_pixels_per_line the distance in bytes from the start of one mask line to the next.
+ * \param replace_value the mask value for pixels inside the threshold, others are 0.
+*/
+void ThresholdKernel::ApplyReference(const unsigned char * pixels, int width, int height, int pixels_per_line,
+		unsigned char * mask, int mask_pixels_per_line, unsigned char replace_value) {
+	if (pixels == NULL || mask == NULL) {
+		return;
+	}
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			const unsigned char * pixel = pixels + (y * pixels_per_line + x) * PIXEL_SIZE;
+			int planes[3];
+			GetPlanes(color_space_, pixel[0], pixel[1], pixel[2], planes);
+
+			bool inside = true;
+			for (int i = 0; i < 3; i++) {
+				if (planes[i] < low_[i] || planes[i] > high_[i])
+					inside = false;
+			}
+			mask[y * mask_pixels_per_line + x] = inside ? replace_value : 0;
+		}
+	}
+}
+
+/**
+ * \brief Convert a pixel to the color planes compared by the threshold, the simple way.
+ *
+ * \param color_space the color planes to convert to.
+ * \param blue the blue value.
+ * \param green the green value.
+ * \param red the red value.
+ * \param planes set to the hue, saturation and value or lightness, or the red, green and blue for RGB.
+*/
+void ThresholdKernel::GetPlanes(ColorSpace color_space, int blue, int green, int red, int * planes) {
+	if (color_space == kRGB) {
+		planes[0] = red;
+		planes[1] = green;
+		planes[2] = blue;
+		return;
+	}
+
+	int maximum = std::max(red, std::max(green, blue));
+	int minimum = std::min(red, std::min(green, blue));
+	int delta = maximum - minimum;
+
+	// Hue
+	int hue = 0;
+	if (delta > 0) {
+		if (maximum == red)
+			hue = (43 * (green - blue)) / delta;
+		else if (maximum == green)
+			hue = 85 + (43 * (blue - red)) / delta;
+		else
+			hue = 171 + (43 * (red - green)) / delta;
+		if (hue < 0)
+			hue += 256;
+	}
+	planes[0] = hue;
+
+	// Saturation and value or lightness
+	if (color_space == kHSV) {
+		planes[1] = maximum == 0 ? 0 : (255 * delta) / maximum;
+		planes[2] = maximum;
+	}
+	else {
+		int sum = maximum + minimum;
+		planes[2] = sum / 2;
+		if (delta == 0)
+			planes[1] = 0;
+		else if (sum <= 255)
+			planes[1] = (255 * delta) / sum;
+		else
+			planes[1] = (255 * delta) / (510 - sum);
+	}
+}
+
+/**
+ * \brief Check if a pixel is inside the threshold.
+ *
+ * The saturation is floor(255 * delta / divisor), so it's at least the low
+ * boundary when 255 * delta >= low * divisor, and at most the high boundary
+ * when 255 * delta < (high + 1) * divisor.  This gives the same result as
+ * the division.
+ *
+ * \param blue the blue value.
+ * \param green the green value.
+ * \param red the red value.
+ * \return true if the pixel is inside every plane's range.
+*/
+bool ThresholdKernel::PixelMatches(int blue, int green, int red) {
+	if (color_space_ == kRGB) {
+		return red >= low_[0] && red <= high_[0] && green >= low_[1] && green <= high_[1] &&
+				blue >= low_[2] && blue <= high_[2];
+	}
+
+	int maximum = std::max(red, std::max(green, blue));
+	int minimum = std::min(red, std::min(green, blue));
+	int delta = maximum - minimum;
+	int divisor;
+
+	// Value or lightness
+	if (color_space_ == kHSV) {
+		if (maximum < low_[2] || maximum > high_[2])
+			return false;
+		divisor = maximum;
+	}
+	else {
+		int sum = maximum + minimum;
+		int lightness = sum >> 1;
+		if (lightness < low_[2] || lightness > high_[2])
+			return false;
+		divisor = sum <= 255 ? sum : 510 - sum;
+	}
+
+	// Saturation, which is 0 when there's no color
+	if (delta == 0) {
+		if (low_[1] > 0 || high_[1] < 0)
+			return false;
+	}
+	else if (255 * delta < low_[1] * divisor || 255 * delta >= (high_[1] + 1) * divisor) {
+		return false;
+	}
+
+	// Hue
+	int hue = GetHue(blue, green, red, maximum, delta);
+	return hue >= low_[0] && hue <= high_[0];
+}
+
+/**
+ * \brief Find the hue of a pixel without dividing.
+ *
+ * \param blue the blue value.
+ * \param green the green value.
+ * \param red the red value.
+ * \param maximum the largest of the three colors.
+ * \param delta the difference between the largest and smallest colors.
+ * \return the hue, 0-255.
+*/
+int ThresholdKernel::GetHue(int blue, int green, int red, int maximum, int delta) {
+	if (delta == 0) {
+		return 0;
+	}
+
+	int difference;
+	int offset;
+	if (maximum == red) {
+		difference = green - blue;
+		offset = 0;
+	}
+	else if (maximum == green) {
+		difference = blue - red;
+		offset = 85;
+	}
+	else {
+		difference = red - green;
+		offset = 171;
+	}
+
+	// 43 * |difference| / delta, rounded down, using the reciprocal of delta
+	unsigned int numerator = 43 * abs(difference);
+	int quotient;
+	if (delta == 1)
+		quotient = numerator;
+	else
+		quotient = (int) (((unsigned long long) numerator * reciprocals_[delta]) >> 32);
+
+	// Division in the reference rounds toward 0, so negative differences are negated after dividing
+	int hue = offset + (difference < 0 ? -quotient : quotient);
+	if (hue < 0)
+		hue += 256;
+	return hue;
+}
+
+/**
+ * \brief Make the mask for one line of the image.
+ *
+ * \param pixels the first pixel of the line.
+ * \param width the number of pixels in the line.
+ * \param mask the first byte of the mask line.
+ * \param replace_value the mask value for pixels inside the threshold.
+*/
+void ThresholdKernel::ApplyRow(const unsigned char * pixels, int width, unsigned char * mask,
+		unsigned char replace_value) {
+	int x = 0;
+
+#ifdef __SSE2__
+	// Test the value or lightness and the saturation of 8 pixels at a time in 16 bit lanes,
+	// then find the hue only for the pixels that pass
+	const __m128i byte_mask = _mm_set1_epi32(0xFF);
+	const __m128i sign_bit = _mm_set1_epi16((short) 0x8000);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i all_ones = _mm_set1_epi16(-1);
+	const __m128i lows[3] = {_mm_set1_epi16(low_[0] - 1), _mm_set1_epi16(low_[1] - 1), _mm_set1_epi16(low_[2] - 1)};
+	const __m128i highs[3] = {_mm_set1_epi16(high_[0] + 1), _mm_set1_epi16(high_[1] + 1), _mm_set1_epi16(high_[2] + 1)};
+	const __m128i saturation_low = _mm_set1_epi16(low_[1]);
+	const __m128i saturation_high = _mm_set1_epi16(high_[1] + 1);
+	const __m128i scale = _mm_set1_epi16(255);
+	const __m128i half_range = _mm_set1_epi16(255);
+	const __m128i full_range = _mm_set1_epi16(510);
+	const __m128i no_color_passes = (low_[1] <= 0 && high_[1] >= 0) ? all_ones : zero;
+
+	for (; x + 8 <= width; x += 8) {
+		__m128i first = _mm_loadu_si128((const __m128i *) (pixels + x * PIXEL_SIZE));
+		__m128i second = _mm_loadu_si128((const __m128i *) (pixels + (x + 4) * PIXEL_SIZE));
+		__m128i blue = _mm_packs_epi32(_mm_and_si128(first, byte_mask), _mm_and_si128(second, byte_mask));
+		__m128i green = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(first, 8), byte_mask),
+				_mm_and_si128(_mm_srli_epi32(second, 8), byte_mask));
+		__m128i red = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(first, 16), byte_mask),
+				_mm_and_si128(_mm_srli_epi32(second, 16), byte_mask));
+		__m128i candidates;
+
+		if (color_space_ == kRGB) {
+			candidates = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi16(red, lows[0]), _mm_cmplt_epi16(red, highs[0])),
+					_mm_and_si128(_mm_cmpgt_epi16(green, lows[1]), _mm_cmplt_epi16(green, highs[1])));
+			candidates = _mm_and_si128(candidates,
+					_mm_and_si128(_mm_cmpgt_epi16(blue, lows[2]), _mm_cmplt_epi16(blue, highs[2])));
+		}
+		else {
+			__m128i maximum = _mm_max_epi16(red, _mm_max_epi16(green, blue));
+			__m128i minimum = _mm_min_epi16(red, _mm_min_epi16(green, blue));
+			__m128i delta = _mm_sub_epi16(maximum, minimum);
+			__m128i brightness;
+			__m128i divisor;
+			if (color_space_ == kHSV) {
+				brightness = maximum;
+				divisor = maximum;
+			}
+			else {
+				__m128i sum = _mm_add_epi16(maximum, minimum);
+				__m128i over_half = _mm_cmpgt_epi16(sum, half_range);
+				brightness = _mm_srli_epi16(sum, 1);
+				divisor = _mm_or_si128(_mm_andnot_si128(over_half, sum),
+						_mm_and_si128(over_half, _mm_sub_epi16(full_range, sum)));
+			}
+			candidates = _mm_and_si128(_mm_cmpgt_epi16(brightness, lows[2]), _mm_cmplt_epi16(brightness, highs[2]));
+
+			// The products fit in 16 bits unsigned, so flip the sign bits to compare them as signed
+			__m128i scaled_delta = _mm_xor_si128(_mm_mullo_epi16(delta, scale), sign_bit);
+			__m128i low_limit = _mm_xor_si128(_mm_mullo_epi16(divisor, saturation_low), sign_bit);
+			__m128i high_limit = _mm_xor_si128(_mm_mullo_epi16(divisor, saturation_high), sign_bit);
+			__m128i saturation_passes = _mm_andnot_si128(_mm_cmplt_epi16(scaled_delta, low_limit),
+					_mm_cmplt_epi16(scaled_delta, high_limit));
+			__m128i no_color = _mm_cmpeq_epi16(delta, zero);
+			saturation_passes = _mm_or_si128(_mm_andnot_si128(no_color, saturation_passes),
+					_mm_and_si128(no_color, no_color_passes));
+			candidates = _mm_and_si128(candidates, saturation_passes);
+		}
+
+		int passed = _mm_movemask_epi8(_mm_packs_epi16(candidates, zero));
+		if (passed == 0) {
+			_mm_storel_epi64((__m128i *) (mask + x), zero);
+			continue;
+		}
+		for (int i = 0; i < 8; i++) {
+			bool inside = false;
+			if (passed & (1 << i)) {
+				if (color_space_ == kRGB) {
+					inside = true;
+				}
+				else {
+					const unsigned char * pixel = pixels + (x + i) * PIXEL_SIZE;
+					int maximum = std::max(pixel[2], std::max(pixel[1], pixel[0]));
+					int minimum = std::min(pixel[2], std::min(pixel[1], pixel[0]));
+					int hue = GetHue(pixel[0], pixel[1], pixel[2], maximum, maximum - minimum);
+					inside = hue >= low_[0] && hue <= high_[0];
+				}
+			}
+			mask[x + i] = inside ? replace_value : 0;
+		}
+	}
+#endif
+
+	for (; x < width; x++) {
+		const unsigned char * pixel = pixels + x * PIXEL_SIZE;
+		mask[x] = PixelMatches(pixel[0], pixel[1], pixel[2]) ? replace_value : 0;
+	}
+}
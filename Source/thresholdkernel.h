@@ -0,0 +1,52 @@
+#ifndef THRESHOLDKERNEL_H_
+#define THRESHOLDKERNEL_H_
+
+/**
+ * \class ThresholdKernel
+ * \brief Converts a packed color image into a mask of the pixels inside a color range.
+ *
+ * Pixels are 4 bytes in blue, green, red, alpha order, like an NI Vision RGB
+ * image.  For HSV and HSL each plane is scaled to 0-255.  The value or
+ * lightness and the saturation are tested first without any division, so
+ * the hue is only worked out for the few pixels that pass, using a table of
+ * reciprocals.  Host builds with SSE2 test 8 pixels at a time.  Apply()
+ * always gives exactly the same mask as ApplyReference().
+ */
+class ThresholdKernel {
+
+public:
+	/**
+	 * \enum ColorSpace
+	 * \brief The color planes compared, in the same order as THRESHOLD_TYPE.
+	 */
+	enum ColorSpace {
+		kHSV,
+		kHSL,
+		kRGB
+	};
+
+	// Public methods
+	ThresholdKernel();
+	~ThresholdKernel();
+	void SetThreshold(ColorSpace color_space, int plane_1_low, int plane_1_high, int plane_2_low, int plane_2_high,
+			int plane_3_low, int plane_3_high);
+	void Apply(const unsigned char * pixels, int width, int height, int pixels_per_line,
+			unsigned char * mask, int mask_pixels_per_line, unsigned char replace_value);
+	void ApplyReference(const unsigned char * pixels, int width, int height, int pixels_per_line,
+			unsigned char * mask, int mask_pixels_per_line, unsigned char replace_value);
+	static void GetPlanes(ColorSpace color_space, int blue, int green, int red, int * planes);
+
+private:
+	// Private methods
+	bool PixelMatches(int blue, int green, int red);
+	int GetHue(int blue, int green, int red, int maximum, int delta);
+	void ApplyRow(const unsigned char * pixels, int width, unsigned char * mask, unsigned char replace_value);
+
+	// Private member variables
+	ColorSpace color_space_;		///< the color planes being compared
+	int low_[3];					///< lower boundary of each plane
+	int high_[3];					///< upper boundary of each plane
+	unsigned int reciprocals_[256];	///< 2^32 divided by each possible difference between the largest and smallest color, rounded up
+};
+
+#endif
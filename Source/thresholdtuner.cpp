@@ -0,0 +1,146 @@
+#include <string.h>
+#include <algorithm>
+#include "thresholdtuner.h"
+
+/**
+ * \brief Create the tuner with a threshold that matches nothing.
+*/
+ThresholdTuner::ThresholdTuner() {
+	color_space_ = ThresholdKernel::kHSV;
+	for (int i = 0; i < 3; i++) {
+		low_[i] = 256;
+		high_[i] = -1;
+		limit_low_[i] = 256;
+		limit_high_[i] = -1;
+	}
+	limit_ = 20;
+	step_ = 2;
+	margin_ = 4;
+	sample_count_ = 5000;
+	Reset();
+}
+
+/**
+ * \brief Nothing to clean up.
+*/
+ThresholdTuner::~ThresholdTuner() {
+}
+
+/**
+ * \brief Set how far and how fast the threshold is moved.
+ *
+ * \param limit the most a boundary can move from its configured value.
+ * \param step the most a boundary moves in one update.
+ * \param margin added to each side of the range that holds most of the pixels.
+ * \param sample_count the number of pixels counted before each update.
+*/
+void ThresholdTuner::SetTuning(int limit, int step, int margin, int sample_count) {
+	limit_ = std::max(limit, 0);
+	step_ = std::max(step, 0);
+	margin_ = std::max(margin, 0);
+	sample_count_ = std::max(sample_count, 1);
+}
+
+/**
+ * \brief Set the configured threshold, which the limits are worked out from.
+ *
+ * Call SetTuning() first.  Anything counted so far is thrown away.
+ *
+ * \param color_space the color planes compared.
+ * \param low the lower boundary of each of the 3 planes.
+ * \param high the upper boundary of each of the 3 planes.
+*/
+void ThresholdTuner::SetThreshold(ThresholdKernel::ColorSpace color_space, const int * low, const int * high) {
+	color_space_ = color_space;
+	for (int i = 0; i < 3; i++) {
+		low_[i] = low[i];
+		high_[i] = high[i];
+		limit_low_[i] = std::max(low[i] - limit_, 0);
+		limit_high_[i] = std::min(high[i] + limit_, 255);
+	}
+	Reset();
+}
+
+/**
+ * \brief Count the pixels of the accepted targets that are within the limits.
+ *
+ * \param pixels the first pixel of the image, 4 bytes each in blue, green, red, alpha order.
+ * \param pixels_per_line the distance in pixels from the start of one line of the image to the next.
+ * \param runs the pixels of the targets' particles, each a rectangle one line high, from VisionPipeline::GetTargetRuns().
+*/
+void ThresholdTuner::AddTargets(const unsigned char * pixels, int pixels_per_line, const std::vector<Rect> &runs) {
+	if (pixels == NULL) {
+		return;
+	}
+	for (unsigned int i = 0; i < runs.size(); i++) {
+		const Rect &run = runs[i];
+		const unsigned char * pixel = pixels + (run.top * pixels_per_line + run.left) * 4;
+		for (int x = 0; x < run.width; x++, pixel += 4) {
+			int planes[3];
+			ThresholdKernel::GetPlanes(color_space_, pixel[0], pixel[1], pixel[2], planes);
+			if (planes[0] >= limit_low_[0] && planes[0] <= limit_high_[0] &&
+					planes[1] >= limit_low_[1] && planes[1] <= limit_high_[1] &&
+					planes[2] >= limit_low_[2] && planes[2] <= limit_high_[2]) {
+				histograms_[0][planes[0]]++;
+				histograms_[1][planes[1]]++;
+				histograms_[2][planes[2]]++;
+				samples_++;
+			}
+		}
+	}
+}
+
+/**
+ * \brief Move the threshold toward the pixels counted, once enough have been.
+ *
+ * \param low set to the lower boundary of each of the 3 planes.
+ * \param high set to the upper boundary of each of the 3 planes.
+ * \return true if the threshold changed.
+*/
+bool ThresholdTuner::Update(int * low, int * high) {
+	if (samples_ < sample_count_) {
+		return false;
+	}
+
+	bool changed = false;
+	int trim = (int) ((long long) samples_ * kTrimPerThousand / 1000);
+	for (int i = 0; i < 3; i++) {
+		// Find the range that holds most of the pixels
+		int lowest = 0;
+		int count = 0;
+		while (lowest < 255 && count + (int) histograms_[i][lowest] <= trim) {
+			count += histograms_[i][lowest];
+			lowest++;
+		}
+		int highest = 255;
+		count = 0;
+		while (highest > lowest && count + (int) histograms_[i][highest] <= trim) {
+			count += histograms_[i][highest];
+			highest--;
+		}
+
+		// Move each boundary one step toward it, staying inside the limits
+		int target_low = std::max(lowest - margin_, limit_low_[i]);
+		int target_high = std::min(highest + margin_, limit_high_[i]);
+		int new_low = low_[i] + std::max(-step_, std::min(step_, target_low - low_[i]));
+		int new_high = high_[i] + std::max(-step_, std::min(step_, target_high - high_[i]));
+		if (new_low != low_[i] || new_high != high_[i]) {
+			low_[i] = new_low;
+			high_[i] = new_high;
+			changed = true;
+		}
+		low[i] = low_[i];
+		high[i] = high_[i];
+	}
+
+	Reset();
+	return changed;
+}
+
+/**
+ * \brief Throw away the pixels counted.
+*/
+void ThresholdTuner::Reset() {
+	memset(histograms_, 0, sizeof(histograms_));
+	samples_ = 0;
+}
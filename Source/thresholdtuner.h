@@ -0,0 +1,55 @@
+#ifndef THRESHOLDTUNER_H_
+#define THRESHOLDTUNER_H_
+
+#include <vector>
+#include "Vision2009/VisionAPI.h"
+#include "thresholdkernel.h"
+
+/**
+ * \class ThresholdTuner
+ * \brief Moves the color threshold toward the colors of the targets being found.
+ *
+ * The pixels of each accepted target's particle are added to a histogram
+ * of each color plane.  The background inside a target's bounding
+ * rectangle, such as the middle of a hollow goal, isn't counted.  Once
+ * enough pixels have been counted, each boundary is moved a small step
+ * toward the range that holds most of them, plus a margin, and counting
+ * starts again.  The margin lets a boundary follow the targets as their
+ * colors drift toward it.  The limits are the configured threshold widened
+ * by a set amount, and the threshold can never move further than that.
+ */
+class ThresholdTuner {
+
+public:
+	// Public methods
+	ThresholdTuner();
+	~ThresholdTuner();
+	void SetTuning(int limit, int step, int margin, int sample_count);
+	void SetThreshold(ThresholdKernel::ColorSpace color_space, const int * low, const int * high);
+	void AddTargets(const unsigned char * pixels, int pixels_per_line, const std::vector<Rect> &runs);
+	bool Update(int * low, int * high);
+
+private:
+	// Private constants
+	static const int kTrimPerThousand = 20;	///< pixels per thousand left out at each end of a plane's range, so stray pixels don't widen it
+
+	// Private methods
+	void Reset();
+
+	// Private member variables
+	ThresholdKernel::ColorSpace color_space_;	///< the color planes being compared
+	int low_[3];				///< current lower boundary of each plane
+	int high_[3];				///< current upper boundary of each plane
+	int limit_low_[3];			///< lowest each lower boundary can go
+	int limit_high_[3];			///< highest each upper boundary can go
+	unsigned int histograms_[3][256];	///< number of pixels counted with each value of each plane
+	int samples_;				///< number of pixels counted since the last update
+
+	// Private parameters
+	int limit_;					///< the most a boundary can move from its configured value
+	int step_;					///< the most a boundary moves in one update
+	int margin_;				///< added to each side of the range that holds most of the pixels
+	int sample_count_;			///< number of pixels counted before each update
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef TRIPLEBUFFER_H_
+#define TRIPLEBUFFER_H_
+
+#include "common.h"
+
+/**
+ * \class TripleBuffer
+ * \brief Hands the latest value from one task to another without locking or copying.
+ *
+ * There are three buffers.  The writer owns one, fills it and publishes
+ * it.  The reader owns one, and swaps it for the latest published buffer
+ * when there is a new one.  The third buffer is exchanged between them in
+ * one atomic step, so neither task ever waits for the other.  A buffer the
+ * reader has taken isn't changed until the reader asks for the latest
+ * again, and the one the writer published last isn't changed until it
+ * publishes again.  Only one task may write and only one may read.
+ */
+template <class T> class TripleBuffer {
+
+public:
+	// Public methods
+	TripleBuffer();
+	~TripleBuffer();
+	T * GetBack();
+	void Publish();
+	const T * GetPublished();
+	const T * GetLatest();
+	T * GetBuffer(int index);
+
+private:
+	// Private constants
+	static const int kIndexMask = 3;	///< bits of middle_ holding the buffer index
+	static const int kFresh = 4;		///< bit of middle_ set when the middle buffer hasn't been read yet
+
+	// Private member variables
+	T buffers_[3];				///< the three buffers
+	int back_;					///< index of the buffer the writer is filling
+	int published_;				///< index of the buffer the writer published last, -1 if none
+	volatile int middle_;		///< index of the buffer between the tasks, with kFresh
+	int front_;					///< index of the buffer the reader is using
+};
+
+/**
+ * \brief Create the buffers, with nothing published.
+*/
+template <class T> TripleBuffer<T>::TripleBuffer() {
+	back_ = 0;
+	published_ = -1;
+	middle_ = 1;
+	front_ = 2;
+}
+
+/**
+ * \brief Nothing to clean up, the buffers are part of the object.
+*/
+template <class T> TripleBuffer<T>::~TripleBuffer() {
+}
+
+/**
+ * \brief Get the buffer to fill with the next value.  Writer only.
+ *
+ * \return the buffer, which may hold an old value.
+*/
+template <class T> T * TripleBuffer<T>::GetBack() {
+	return &buffers_[back_];
+}
+
+/**
+ * \brief Make the back buffer the latest value, and get a new back buffer.  Writer only.
+*/
+template <class T> void TripleBuffer<T>::Publish() {
+	published_ = back_;
+	back_ = AtomicExchange(&middle_, back_ | kFresh) & kIndexMask;
+}
+
+/**
+ * \brief Get the value published last by this writer.  Writer only.
+ *
+ * \return the buffer, or NULL if nothing has been published.
+*/
+template <class T> const T * TripleBuffer<T>::GetPublished() {
+	return published_ < 0 ? NULL : &buffers_[published_];
+}
+
+/**
+ * \brief Get the latest published value.  Reader only.
+ *
+ * \return the buffer, which stays unchanged until GetLatest() is called again.
+*/
+template <class T> const T * TripleBuffer<T>::GetLatest() {
+	if (middle_ & kFresh) {
+		front_ = AtomicExchange(&middle_, front_) & kIndexMask;
+	}
+	return &buffers_[front_];
+}
+
+/**
+ * \brief Get one of the buffers, to set it up before either task starts.
+ *
+ * \param index the buffer, 0-2.
+ * \return the buffer, or NULL if the index is out of range.
+*/
+template <class T> T * TripleBuffer<T>::GetBuffer(int index) {
+	if (index < 0 || index > 2) {
+		return NULL;
+	}
+	return &buffers_[index];
+}
+
+#endif
@@ -2,6 +2,7 @@
 #include "WPILib.h"
 #include "userinterface.h"
 #include "datalog.h"
+#include "looptimer.h"
 #include "parameters.h"
 
 /**
@@ -79,6 +80,7 @@ void UserInterface::Initialize(const char * parameters, bool logging_enabled) {
 	controller_1_ = NULL;
 	controller_2_ = NULL;
 	log_ = NULL;
+	loop_timer_ = NULL;
 	parameters_ = NULL;
 	controller_1_previous_button_state_ = NULL;
 	controller_2_previous_button_state_ = NULL;
@@ -92,6 +94,7 @@ void UserInterface::Initialize(const char * parameters, bool logging_enabled) {
 	// Initialize private member variables
 	display_line_ = 0;
 	log_enabled_ = false;
+	output_message_probe_ = -1;
 	robot_state_ = kDisabled;
 
 	// Create a new data log object
@@ -109,7 +112,8 @@ void UserInterface::Initialize(const char * parameters, bool logging_enabled) {
 	}
 	
 	// Attempt to read the parameters file
-	strncpy(parameters_file_, parameters, sizeof(parameters_file_));
+	strncpy(parameters_file_, parameters, sizeof(parameters_file_) - 1);
+	parameters_file_[sizeof(parameters_file_) - 1] = 0;
 	
 	LoadParameters();
 }
@@ -296,6 +300,8 @@ int UserInterface::GetButtonState(int controller, int button) {
  * \param clear true if the screen should be cleared prior to displaying the message.
 */
 void UserInterface::OutputUserMessage(const char * message, bool clear) {
+	LoopTimerProbe probe(loop_timer_, output_message_probe_);
+
 	if (driver_station_lcd_ == NULL) {
 		return;
 	}
@@ -345,6 +351,18 @@ void UserInterface::OutputUserMessage(const char * message, bool clear) {
 	}
 }
 
+/**
+ * \brief Time the user messages with the robot's loop timer.
+ *
+ * \param loop_timer the loop timer, NULL to stop timing.
+*/
+void UserInterface::SetLoopTimer(LoopTimer * loop_timer) {
+	loop_timer_ = loop_timer;
+	output_message_probe_ = -1;
+	if (loop_timer_ != NULL)
+		output_message_probe_ = loop_timer_->RegisterProbe("OutputUserMessage");
+}
+
 /**
  * \brief Store the current button states for the specified controller.
  *
@@ -7,6 +7,7 @@
 class DataLog;
 class DriverStationLCD;
 class Joystick;
+class LoopTimer;
 class Parameters;
 
 /**
@@ -72,6 +73,7 @@ public:
 	float GetAxisValue(int controller, int axis);
 	int GetButtonState(int controller, int button);
 	void OutputUserMessage(const char * message, bool clear);
+	void SetLoopTimer(LoopTimer * loop_timer);
 	void StoreButtonStates(int controller);
 
 private:
@@ -85,6 +87,7 @@ private:
 	int	 				*controller_2_previous_button_state_;	///< array of last known button states for controller 2
 	DriverStationLCD	*driver_station_lcd_;					///< driver station lcd object used to output text messages on the driver station screen
 	DataLog 			*log_;									///< log object used to log data or status comments to a file
+	LoopTimer			*loop_timer_;							///< loop timer used to time the user messages, owned by the robot
 	Parameters 			*parameters_;							///< parameters object used to load UI parameters from a file
 	
 	// Private parameters
@@ -96,6 +99,7 @@ private:
 	// Private member variables
 	int 	display_line_;		///< current text output line on the DriverStation
 	bool 	log_enabled_;		///< true if logging is enabled
+	int		output_message_probe_;	///< loop timer probe for OutputUserMessage()
 	char parameters_file_[25];	///< path and filename of the parameter file to read
 	ProgramState robot_state_;	///< current state of the robot obtained from the field
 };
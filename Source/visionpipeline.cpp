@@ -0,0 +1,252 @@
+#include <stdlib.h>
+#include <algorithm>
+#include "common.h"
+#include "particlelabeler.h"
+#include "visionpipeline.h"
+
+/**
+ * \brief Create the pipeline with a threshold that matches nothing.
+*/
+VisionPipeline::VisionPipeline() {
+	threshold_kernel_ = new ThresholdKernel();
+	particle_labeler_ = new ParticleLabeler();
+	ratio_minimum_ = 1.0;
+	ratio_maximum_ = 3.2;
+	score_minimum_ = 80.0;
+	clipped_particles_ = 0;
+	label_overflows_ = 0;
+	target_runs_.reserve(kInitialTargetRuns);
+}
+
+/**
+ * \brief Delete the threshold kernel and particle labeler.
+*/
+VisionPipeline::~VisionPipeline() {
+	SafeDelete(threshold_kernel_);
+	SafeDelete(particle_labeler_);
+}
+
+/**
+ * \brief Set the color planes and the range of each plane that target pixels are inside.
+ *
+ * \param color_space the color planes to compare.
+ * \param plane_1_low lower boundary of the hue, or red for RGB.
+ * \param plane_1_high upper boundary of the hue, or red for RGB.
+ * \param plane_2_low lower boundary of the saturation, or green for RGB.
+ * \param plane_2_high upper boundary of the saturation, or green for RGB.
+ * \param plane_3_low lower boundary of the value or lightness, or blue for RGB.
+ * \param plane_3_high upper boundary of the value or lightness, or blue for RGB.
+*/
+void VisionPipeline::SetThreshold(ThresholdKernel::ColorSpace color_space, int plane_1_low, int plane_1_high,
+		int plane_2_low, int plane_2_high, int plane_3_low, int plane_3_high) {
+	if (threshold_kernel_ != NULL) {
+		threshold_kernel_->SetThreshold(color_space, plane_1_low, plane_1_high, plane_2_low, plane_2_high,
+				plane_3_low, plane_3_high);
+	}
+}
+
+/**
+ * \brief Set the size and shape a particle must have to be reported as a target.
+ *
+ * \param minimum_area particles with fewer pixels are ignored.
+ * \param ratio_minimum the lower boundary for the width divided by the height.
+ * \param ratio_maximum the upper boundary for the width divided by the height.
+ * \param score_minimum the lower boundary for the percentage of the bounding rectangle that is filled.
+*/
+void VisionPipeline::SetParticleFilter(int minimum_area, float ratio_minimum, float ratio_maximum, float score_minimum) {
+	if (particle_labeler_ != NULL) {
+		particle_labeler_->SetMinimumArea(minimum_area);
+	}
+	ratio_minimum_ = ratio_minimum;
+	ratio_maximum_ = ratio_maximum;
+	score_minimum_ = score_minimum;
+}
+
+/**
+ * \brief Make the mask of the pixels inside the threshold, in parts of a frame.
+ *
+ * \param pixels the first pixel of the frame, 4 bytes each in blue, green, red, alpha order.
+ * \param pixels_per_line the distance in pixels from the start of one line of the frame to the next.
+ * \param mask the first byte of the mask, the same size as the frame.
+ * \param mask_pixels_per_line the distance in bytes from the start of one mask line to the next.
+ * \param regions the parts of the frame to threshold.
+ * \param region_count the number of regions.
+*/
+void VisionPipeline::Threshold(const unsigned char * pixels, int pixels_per_line, unsigned char * mask,
+		int mask_pixels_per_line, const Rect * regions, int region_count) {
+	if (threshold_kernel_ == NULL || pixels == NULL || mask == NULL || regions == NULL) {
+		return;
+	}
+	for (int i = 0; i < region_count; i++) {
+		const Rect &region = regions[i];
+		threshold_kernel_->Apply(pixels + (region.top * pixels_per_line + region.left) * 4, region.width,
+				region.height, pixels_per_line, mask + region.top * mask_pixels_per_line + region.left,
+				mask_pixels_per_line, 1);
+	}
+}
+
+/**
+ * \brief Find the targets in parts of a mask.
+ *
+ * The filled area of each particle stands in for its area after a convex
+ * hull when the rectangle score is worked out.
+ *
+ * \param mask the first byte of the mask.
+ * \param width the width of the mask in pixels.
+ * \param height the height of the mask in pixels.
+ * \param mask_pixels_per_line the distance in bytes from the start of one mask line to the next.
+ * \param regions the parts of the mask to search, which must not overlap.
+ * \param region_count the number of regions.
+ * \param report the report to add the targets to.
+ * \param maximum_targets the largest number of targets the report can hold.
+ * \return true if successful.  A region with too many particles to label
+ * still reports the targets in the lines that were labeled, and is counted
+ * by GetLabelOverflows().  Particles cut off by the edge of a region are
+ * counted by GetClippedParticles().
+*/
+bool VisionPipeline::FindTargets(const unsigned char * mask, int width, int height, int mask_pixels_per_line,
+		const Rect * regions, int region_count, std::vector<ParticleAnalysisReport> &report, int maximum_targets) {
+	clipped_particles_ = 0;
+	target_runs_.clear();
+	if (particle_labeler_ == NULL || regions == NULL) {
+		return false;
+	}
+
+	for (int region_index = 0; region_index < region_count; region_index++) {
+		if (!particle_labeler_->Label(mask, width, height, mask_pixels_per_line, regions[region_index])) {
+			return false;
+		}
+		if (particle_labeler_->Overflowed()) {
+			label_overflows_++;
+		}
+
+		// Keep only the good targets
+		// A particle that reaches an edge of the region, other than the edge
+		// of the mask, may be cut off, so it is counted whether it is kept or not
+		const Rect &region = regions[region_index];
+		int particle_count = particle_labeler_->GetNumberParticles();
+		for (int i = 0; i < particle_count && (int) report.size() < maximum_targets; i++) {
+			ParticleAnalysisReport particle;
+			particle_labeler_->GetParticleAnalysisReport(i, &particle);
+			const Rect &bounds = particle.boundingRect;
+			if ((region.left > 0 && bounds.left <= region.left) ||
+					(region.top > 0 && bounds.top <= region.top) ||
+					(region.left + region.width < width && bounds.left + bounds.width >= region.left + region.width) ||
+					(region.top + region.height < height && bounds.top + bounds.height >= region.top + region.height)) {
+				clipped_particles_++;
+			}
+			// Calculate rectangle ratio
+			float rectangle_ratio = (float) particle.boundingRect.width / (float) particle.boundingRect.height;
+			// Calculate rectangle score
+			float rectangle_area = (float) particle.boundingRect.width * (float) particle.boundingRect.height;
+			float rectangle_score = (particle_labeler_->GetFilledArea(i) / rectangle_area) * 100.0;
+			// Keep good targets
+			if (rectangle_ratio >= ratio_minimum_ && rectangle_ratio <= ratio_maximum_ &&
+					rectangle_score >= score_minimum_) {
+				report.push_back(particle);
+				particle_labeler_->GetRuns(i, target_runs_);
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * \brief Get the number of particles in the last FindTargets() that reached the edge of a region.
+ *
+ * Only edges inside the mask count.  Such a particle may be only part of
+ * a target that goes on past the region, so its size and shape can't be
+ * trusted, and the caller should search a larger part of the mask.
+ *
+ * \return the number of particles, 0 if every particle was inside its region.
+*/
+int VisionPipeline::GetClippedParticles() {
+	return clipped_particles_;
+}
+
+/**
+ * \brief Get the pixels of the targets found by the last FindTargets().
+ *
+ * Only the pixels of each target's particle are included, not the rest
+ * of its bounding rectangle.
+ *
+ * \return the runs of pixels, each a rectangle one line high.
+*/
+const std::vector<Rect> & VisionPipeline::GetTargetRuns() {
+	return target_runs_;
+}
+
+/**
+ * \brief Get the number of regions that had too many particles to label all of them.
+ *
+ * Those regions were only searched down to the last line that fit.  Only
+ * the task that calls FindTargets() should read it.
+ *
+ * \return the number of regions since the pipeline was created.
+*/
+unsigned int VisionPipeline::GetLabelOverflows() {
+	return label_overflows_;
+}
+
+/**
+ * \brief Predicts the regions of a frame to search for the targets found in an earlier frame.
+ *
+ * Each target's bounding rectangle is moved sideways, padded on every
+ * side and kept inside the frame.  Regions that overlap are merged, so no
+ * target is reported twice.
+ *
+ * \param targets the targets found in the earlier frame.
+ * \param shift the number of pixels to move the targets to the right, negative for left.
+ * \param padding the number of pixels added to each side of a target.
+ * \param width the width of the frame in pixels.
+ * \param height the height of the frame in pixels.
+ * \param regions an array of maximum_regions rectangles that will contain the regions.
+ * \param maximum_regions the largest number of regions.
+ * \return the number of regions, 0 if the whole frame should be searched.
+*/
+int VisionPipeline::PredictRegions(const std::vector<ParticleAnalysisReport> &targets, int shift, int padding,
+		int width, int height, Rect * regions, int maximum_regions) {
+	if (targets.empty() || (int) targets.size() > maximum_regions) {
+		return 0;
+	}
+
+	int region_count = 0;
+	for (unsigned int i = 0; i < targets.size(); i++) {
+		const Rect &target = targets[i].boundingRect;
+		int left = std::max(target.left + shift - padding, 0);
+		int top = std::max(target.top - padding, 0);
+		int right = std::min(target.left + target.width + shift + padding, width);
+		int bottom = std::min(target.top + target.height + padding, height);
+		if (right <= left || bottom <= top) {
+			return 0;
+		}
+		Rect &region = regions[region_count];
+		region.left = left;
+		region.top = top;
+		region.width = right - left;
+		region.height = bottom - top;
+		region_count++;
+	}
+
+	// Merge overlapping regions
+	for (int i = 0; i < region_count; i++) {
+		for (int j = i + 1; j < region_count; j++) {
+			Rect &first = regions[i];
+			Rect &second = regions[j];
+			if (first.left < second.left + second.width && second.left < first.left + first.width &&
+					first.top < second.top + second.height && second.top < first.top + first.height) {
+				int left = std::min(first.left, second.left);
+				int top = std::min(first.top, second.top);
+				first.width = std::max(first.left + first.width, second.left + second.width) - left;
+				first.height = std::max(first.top + first.height, second.top + second.height) - top;
+				first.left = left;
+				first.top = top;
+				regions[j] = regions[region_count - 1];
+				region_count--;
+				// Check the merged region against all the others again
+				j = i;
+			}
+		}
+	}
+	return region_count;
+}
@@ -0,0 +1,59 @@
+#ifndef VISIONPIPELINE_H_
+#define VISIONPIPELINE_H_
+
+#include <vector>
+#include "Vision2009/VisionAPI.h"
+#include "thresholdkernel.h"
+
+// Forward class definitions
+class ParticleLabeler;
+
+/**
+ * \class VisionPipeline
+ * \brief The image processing that turns a camera frame into a list of targets.
+ *
+ * The frame is thresholded into a mask, the particles in the mask are found
+ * and measured, and the ones that aren't the right shape for a target are
+ * dropped.  It works on plain pixel buffers and doesn't use the camera or
+ * any NI Vision functions, so Targeting and the offline tools in Tools/ run
+ * exactly the same code.
+ */
+class VisionPipeline {
+
+public:
+	// Public methods
+	VisionPipeline();
+	~VisionPipeline();
+	void SetThreshold(ThresholdKernel::ColorSpace color_space, int plane_1_low, int plane_1_high, int plane_2_low,
+			int plane_2_high, int plane_3_low, int plane_3_high);
+	void SetParticleFilter(int minimum_area, float ratio_minimum, float ratio_maximum, float score_minimum);
+	void Threshold(const unsigned char * pixels, int pixels_per_line, unsigned char * mask, int mask_pixels_per_line,
+			const Rect * regions, int region_count);
+	bool FindTargets(const unsigned char * mask, int width, int height, int mask_pixels_per_line, const Rect * regions,
+			int region_count, std::vector<ParticleAnalysisReport> &report, int maximum_targets);
+	int GetClippedParticles();
+	const std::vector<Rect> & GetTargetRuns();
+	unsigned int GetLabelOverflows();
+	static int PredictRegions(const std::vector<ParticleAnalysisReport> &targets, int shift, int padding, int width,
+			int height, Rect * regions, int maximum_regions);
+
+private:
+	// Private constants
+	static const int kInitialTargetRuns = 4096;	///< runs of target pixels there is room for before the list has to grow
+
+	// Private member objects
+	ThresholdKernel *threshold_kernel_;		///< color threshold that makes the mask
+	ParticleLabeler *particle_labeler_;		///< finds and measures the particles in the mask
+	std::vector<Rect> target_runs_;			///< runs of pixels of every target in the last FindTargets(), each a rectangle one line high
+
+	// Private parameters
+	float ratio_minimum_;					///< the lower boundary for a target's width divided by its height
+	float ratio_maximum_;					///< the upper boundary for a target's width divided by its height
+	float score_minimum_;					///< the lower boundary for the percentage of a target's bounding rectangle that is filled
+
+	// Private member variables
+	int clipped_particles_;					///< number of particles in the last FindTargets() that reached the edge of a region inside the mask
+	unsigned int label_overflows_;			///< number of regions that had too many particles to label all of them
+};
+
+#endif
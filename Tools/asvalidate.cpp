@@ -0,0 +1,58 @@
+/**
+ * \file asvalidate.cpp
+ * \brief Checks autoscript files before they are copied to the robot.
+ *
+ * Runs on the development computer, not the robot.  Each file is compiled
+ * with the same AutoScript reader the robot uses, and every line with an
+ * unknown command, the wrong number of parameters, or a parameter that
+ * isn't a number is printed.  Those lines would be skipped on the robot.
+ *
+ * Build: g++ -O2 -o asvalidate asvalidate.cpp ../Source/autoscript.cpp ../Source/readfile.cpp
+ * Usage: asvalidate ../AutoScriptFiles/auto_middle.as ...
+ */
+#include <stdio.h>
+#include "../Source/autoscript.h"
+
+int main(int argc, char ** argv) {
+	int failed_files = 0;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s file.as ...\n", argv[0]);
+		return 1;
+	}
+
+	for (int file_index = 1; file_index < argc; file_index++) {
+		AutoScript script(argv[file_index]);
+		if (!script.file_opened_) {
+			printf("%s: unable to open\n", argv[file_index]);
+			failed_files++;
+			continue;
+		}
+		bool compiled = script.ReadScript();
+		script.Close();
+
+		// Count the commands up to the end of the script
+		int command_count = 0;
+		bool end_found = false;
+		for (autoscript_command command = script.GetCommand(0); command.opcode != AutoScript::kInvalid;
+				command = script.GetCommand(++command_count)) {
+			if (command.opcode == AutoScript::kEnd) {
+				end_found = true;
+				break;
+			}
+		}
+
+		if (compiled) {
+			printf("%s: %d commands OK%s\n", argv[file_index], command_count,
+				end_found ? "" : " (no end command)");
+			continue;
+		}
+		const std::vector<std::string> &errors = script.GetErrors();
+		for (unsigned int i = 0; i < errors.size(); i++) {
+			printf("%s: %s\n", argv[file_index], errors[i].c_str());
+		}
+		failed_files++;
+	}
+
+	return failed_files > 0 ? 1 : 0;
+}
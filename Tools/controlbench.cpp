@@ -0,0 +1,225 @@
+/**
+ * \file controlbench.cpp
+ * \brief Compares the three speed band movement against the FeedbackController on simulated mechanisms.
+ *
+ * Runs on the development computer, not the robot.  Each mechanism is a
+ * motor that lags its output by a time constant, with friction that holds
+ * it still below a minimum output, driving a position: the shooter pitch
+ * and climber winch in encoder counts, and the drive train heading in
+ * degrees.  The plant is stepped every millisecond, and the controller is
+ * run once each periodic loop with the position at the start of the loop.
+ * Each mechanism is moved to a set point twice: first the way Shooter,
+ * Climber and DriveTrain move with the far, medium and near speed ratios,
+ * then with the FeedbackController and the default gains in the parameter
+ * files.  Once the movement says it is finished, the motor is stopped and
+ * the mechanism coasts for a second.
+ *
+ * For each movement the time until it finished, the overshoot past the set
+ * point, the number of times the motor reversed, and the error after
+ * coasting are printed.
+ *
+ * Build: g++ -O2 -o controlbench controlbench.cpp ../Source/feedbackcontroller.cpp
+ * Usage: controlbench [loop_period_seconds]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../Source/feedbackcontroller.h"
+
+/**
+ * \def PLANT_STEP
+ * \brief Time in seconds the plant is moved forward at a time.
+ */
+#define PLANT_STEP 0.001
+
+/**
+ * \def MAXIMUM_TIME
+ * \brief Longest time in seconds a movement is given to finish.
+ */
+#define MAXIMUM_TIME 5.0
+
+/**
+ * \def COAST_TIME
+ * \brief Time in seconds the mechanism is left to coast after the movement finishes.
+ */
+#define COAST_TIME 1.0
+
+/**
+ * \struct bench_mechanism
+ * \brief A simulated mechanism, the movement asked of it, and how both ways of moving it are set up.
+ */
+struct bench_mechanism {
+	const char * name;				///< name printed with the results
+	const char * units;				///< units of the position
+	double top_rate;				///< position units per second at full output
+	double time_constant;			///< seconds for the motor to reach 63% of a speed change
+	double friction;				///< smallest output that moves the mechanism
+	double setpoint;				///< position to move to from 0
+	double speed;					///< speed passed to the movement function
+	double tolerance;				///< ENCODER_THRESHOLD or HEADING_THRESHOLD
+	double medium_threshold;		///< AUTO_MEDIUM_..._THRESHOLD
+	double far_threshold;			///< AUTO_FAR_..._THRESHOLD
+	double near_ratio;				///< AUTO_NEAR_..._SPEED_RATIO
+	double medium_ratio;			///< AUTO_MEDIUM_..._SPEED_RATIO
+	double far_ratio;				///< AUTO_FAR_..._SPEED_RATIO
+	float gains[5];					///< proportional, integral, derivative, feedforward and static feedforward gains
+	float maximum_output_change;	///< ..._MAXIMUM_OUTPUT_CHANGE
+	float settle_rate;				///< ..._SETTLE_RATE
+	double settle_time;				///< ..._SETTLE_TIME
+};
+
+/**
+ * \struct bench_result
+ * \brief How a movement went.
+ */
+struct bench_result {
+	double finish_time;		///< time in seconds until the movement said it was finished, or MAXIMUM_TIME
+	bool finished;			///< true if the movement finished within MAXIMUM_TIME
+	double overshoot;		///< furthest the position went past the set point
+	int reversals;			///< number of times the output changed direction
+	double final_error;		///< set point less the position after coasting
+};
+
+/**
+ * \brief Move the three speed band way, as Shooter::SetPitch() does.
+ *
+ * \param mechanism the mechanism.
+ * \param position the position at the start of the loop.
+ * \param output set to the motor output.
+ * \return true when the movement is finished.
+*/
+static bool BandStep(const bench_mechanism &mechanism, double position, double * output) {
+	double error = mechanism.setpoint - position;
+	if (fabs(error) <= mechanism.tolerance) {
+		*output = 0.0;
+		return true;
+	}
+	double direction = error > 0.0 ? 1.0 : -1.0;
+	if (fabs(error) > mechanism.far_threshold) {
+		*output = direction * mechanism.speed * mechanism.far_ratio;
+	}
+	else if (fabs(error) > mechanism.medium_threshold) {
+		*output = direction * mechanism.speed * mechanism.medium_ratio;
+	}
+	else {
+		*output = direction * mechanism.speed * mechanism.near_ratio;
+	}
+	return false;
+}
+
+/**
+ * \brief Move a mechanism to its set point and measure how it went.
+ *
+ * \param mechanism the mechanism.
+ * \param loop_period time in seconds between periodic loops.
+ * \param controller the controller to move it with, or NULL to move it the three speed band way.
+ * \return the results.
+*/
+static bench_result Run(const bench_mechanism &mechanism, double loop_period, FeedbackController * controller) {
+	bench_result result;
+	result.finish_time = MAXIMUM_TIME;
+	result.finished = false;
+	result.overshoot = 0.0;
+	result.reversals = 0;
+
+	double position = 0.0;
+	double rate = 0.0;
+	double output = 0.0;
+	double previous_output = 0.0;
+	double time = 0.0;
+	double next_loop = 0.0;
+	double stop_time = MAXIMUM_TIME + COAST_TIME;
+	double lag = 1.0 - exp(-PLANT_STEP / mechanism.time_constant);
+	if (controller != NULL) {
+		controller->Reset();
+	}
+
+	while (time < stop_time) {
+		// Run the periodic loop
+		if (!result.finished && time >= next_loop - PLANT_STEP / 2.0) {
+			next_loop += loop_period;
+			bool finished = false;
+			if (controller == NULL) {
+				finished = BandStep(mechanism, position, &output);
+			}
+			else {
+				controller->SetOutputLimits(mechanism.speed, mechanism.maximum_output_change);
+				output = controller->Calculate(mechanism.setpoint, 0.0, position, time);
+				if (controller->IsSettled()) {
+					controller->Reset();
+					output = 0.0;
+					finished = true;
+				}
+			}
+			if (output * previous_output < 0.0) {
+				result.reversals++;
+			}
+			if (output != 0.0) {
+				previous_output = output;
+			}
+			if (finished) {
+				result.finished = true;
+				result.finish_time = time;
+				stop_time = time + COAST_TIME;
+			}
+		}
+
+		// Move the plant, which doesn't move at all below the friction
+		double target_rate = fabs(output) < mechanism.friction ? 0.0 : output * mechanism.top_rate;
+		rate += (target_rate - rate) * lag;
+		position += rate * PLANT_STEP;
+		time += PLANT_STEP;
+
+		double past = (position - mechanism.setpoint) * (mechanism.setpoint > 0.0 ? 1.0 : -1.0);
+		if (past > result.overshoot) {
+			result.overshoot = past;
+		}
+	}
+	result.final_error = mechanism.setpoint - position;
+	return result;
+}
+
+/**
+ * \brief Print the results of a movement.
+ *
+ * \param mechanism the mechanism.
+ * \param method how it was moved.
+ * \param result the results.
+*/
+static void PrintResult(const bench_mechanism &mechanism, const char * method, const bench_result &result) {
+	printf("%-6s %-10s %s %6.2f s  overshoot %7.1f %-7s reversals %3d  final error %7.1f %s\n", mechanism.name,
+			method, result.finished ? "finished" : "timed out", result.finish_time, result.overshoot, mechanism.units,
+			result.reversals, result.final_error, mechanism.units);
+}
+
+int main(int argc, char ** argv) {
+	double loop_period = argc >= 2 ? atof(argv[1]) : 0.02;
+	if (loop_period <= 0.0) {
+		printf("Usage: controlbench [loop_period_seconds]\n");
+		return 1;
+	}
+
+	// The band thresholds and ratios are from the parameter files, and the gains are the parameter defaults
+	const bench_mechanism mechanisms[] = {
+		{"pitch", "counts", 2500.0, 0.05, 0.1, 2000.0, 1.0, 10.0, 50.0, 100.0, 1.0, 1.0, 1.0,
+				{0.005, 0.0, 0.00025, 0.0, 0.1}, 8.0, 50.0, 0.1},
+		{"winch", "counts", 1000.0, 0.1, 0.15, 1500.0, 1.0, 10.0, 50.0, 100.0, 1.0, 1.0, 1.0,
+				{0.02, 0.005, 0.002, 0.0, 0.15}, 8.0, 50.0, 0.1},
+		{"turn", "degrees", 687.0, 0.15, 0.05, 90.0, 1.0, 1.0, 5.0, 10.0, 1.0, 1.0, 1.0,
+				{0.017, 0.0, 0.0026, 0.0, 0.05}, 8.0, 5.0, 0.1}
+	};
+	int mechanism_count = sizeof(mechanisms) / sizeof(mechanisms[0]);
+
+	printf("Loop period %.3f s\n", loop_period);
+	for (int i = 0; i < mechanism_count; i++) {
+		const bench_mechanism &mechanism = mechanisms[i];
+		PrintResult(mechanism, "bands", Run(mechanism, loop_period, NULL));
+
+		FeedbackController controller;
+		controller.SetGains(mechanism.gains[0], mechanism.gains[1], mechanism.gains[2], mechanism.gains[3],
+				mechanism.gains[4]);
+		controller.SetTolerance(mechanism.tolerance, mechanism.settle_rate, mechanism.settle_time);
+		PrintResult(mechanism, "controller", Run(mechanism, loop_period, &controller));
+	}
+	return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * \file logbench.cpp
+ * \brief Measures the per-loop cost of detailed logging.
+ *
+ * Compares writing the values logged every periodic loop in text mode, in
+ * binary mode by parameter name, and in binary mode by registered channel.
+ *
+ * Add this file to the robot project and call it from the VxWorks shell
+ * while the robot is disabled, e.g. "LogBench 1000".  Results are printed
+ * to the console.
+ *
+ * It also builds on the development computer with the simulator's WPILib,
+ * timed with the computer's clock since the simulator's FPGA time is
+ * simulated.  The writer task only runs in the loop's Wait(), as on the
+ * robot when it's busy, so this compares the cost the periodic loop sees.
+ *
+ * Host build: g++ -O2 -Wall -DSIMULATION -I../Simulator/include -I../Source -o logbench logbench.cpp
+ *   ../Source/datalog.cpp ../Simulator/simulatedclock.cpp ../Simulator/simulatedhardware.cpp -lpthread
+ * Host usage: logbench [loops]
+ */
+#ifdef SIMULATION
+#include <stdlib.h>
+#include <time.h>
+#endif
+#include "WPILib.h"
+#include "../Source/datalog.h"
+
+/**
+ * \def LOG_BENCH_VALUES
+ * \brief The number of values logged each loop with detailed logging on.
+ */
+#define LOG_BENCH_VALUES 12
+
+/**
+ * \brief Get the time used to measure the logging.
+ *
+ * \return the time in microseconds.
+*/
+static UINT32 GetMicroseconds() {
+#ifdef SIMULATION
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (UINT32) (now.tv_sec * 1000000 + now.tv_nsec / 1000);
+#else
+	return GetFPGATime();
+#endif
+}
+
+/**
+ * \brief Log one loop's worth of values by parameter name.
+ *
+ * \param log the log to write to.
+ * \param loop the loop number, used to vary the values.
+*/
+static void LogByName(DataLog *log, int loop) {
+	float value = (float) loop * 0.01;
+	log->WriteValue("Gyro angle", value, true);
+	log->WriteValue("Acceleration", (double) value, true);
+	log->WriteValue("Distance traveled", (double) value, true);
+	log->WriteValue("Encoder count", loop, true);
+	log->WriteValue("Winch encoder count", loop, true);
+	log->WriteValue("DriverLeftY", value, true);
+	log->WriteValue("DriverRightY", value, true);
+	log->WriteValue("DriverTurbo", loop & 1, true);
+	log->WriteValue("ScoringLeftY", value, true);
+	log->WriteValue("ScoringRightY", value, true);
+	log->WriteValue("ScoringTurbo", loop & 1, true);
+	log->WriteValue("Shooter", loop & 1, true);
+}
+
+/**
+ * \brief Log one loop's worth of values by registered channel.
+ *
+ * \param log the log to write to.
+ * \param channels the channel handles, in the same order as LogByName.
+ * \param loop the loop number, used to vary the values.
+*/
+static void LogByChannel(DataLog *log, const int *channels, int loop) {
+	float value = (float) loop * 0.01;
+	log->WriteChannel(channels[0], value, true);
+	log->WriteChannel(channels[1], (double) value, true);
+	log->WriteChannel(channels[2], (double) value, true);
+	log->WriteChannel(channels[3], loop, true);
+	log->WriteChannel(channels[4], loop, true);
+	log->WriteChannel(channels[5], value, true);
+	log->WriteChannel(channels[6], value, true);
+	log->WriteChannel(channels[7], loop & 1, true);
+	log->WriteChannel(channels[8], value, true);
+	log->WriteChannel(channels[9], value, true);
+	log->WriteChannel(channels[10], loop & 1, true);
+	log->WriteChannel(channels[11], loop & 1, true);
+}
+
+/**
+ * \brief Run one benchmark case and print the average cost of a loop.
+ *
+ * The loops are spaced out like the periodic loops, so the writer task has
+ * time to keep up in binary mode.
+ *
+ * \param label the name of the case.
+ * \param format the log format to use.
+ * \param by_channel true to log by registered channel instead of by name.
+ * \param loops the number of loops to log.
+*/
+static void RunCase(const char * label, DataLog::LogFormat format, bool by_channel, int loops) {
+	const char * names[LOG_BENCH_VALUES] = { "Gyro angle", "Acceleration", "Distance traveled",
+		"Encoder count", "Winch encoder count", "DriverLeftY", "DriverRightY", "DriverTurbo",
+		"ScoringLeftY", "ScoringRightY", "ScoringTurbo", "Shooter" };
+	int channels[LOG_BENCH_VALUES];
+
+	DataLog *log = new DataLog("logbench.log", format);
+	if (log == NULL || !log->file_opened_) {
+		printf("%-24s unable to open logbench.log\n", label);
+		SafeDelete(log);
+		return;
+	}
+	for (int i = 0; i < LOG_BENCH_VALUES; i++) {
+		channels[i] = log->RegisterChannel(names[i]);
+	}
+
+	UINT32 total = 0;
+	UINT32 worst = 0;
+	for (int loop = 0; loop < loops; loop++) {
+		UINT32 start = GetMicroseconds();
+		if (by_channel)
+			LogByChannel(log, channels, loop);
+		else
+			LogByName(log, loop);
+		UINT32 elapsed = GetMicroseconds() - start;
+		total += elapsed;
+		if (elapsed > worst)
+			worst = elapsed;
+		Wait(0.002);
+	}
+	unsigned int dropped = log->GetDroppedRecords();
+	log->Close();
+	SafeDelete(log);
+
+	printf("%-24s %8.2f us/loop avg %6u us worst %6u dropped\n", label,
+		(double) total / loops, worst, dropped);
+}
+
+/**
+ * \brief Compare the cost of logging a loop's worth of values in each mode.
+ *
+ * \param loops the number of loops to log, 1000 if 0.
+ * \return 0.
+*/
+extern "C" int LogBench(int loops) {
+	if (loops <= 0)
+		loops = 1000;
+	printf("Logging %d values per loop for %d loops\n", LOG_BENCH_VALUES, loops);
+	RunCase("text, by name", DataLog::kText, false, loops);
+	RunCase("binary, by name", DataLog::kBinary, false, loops);
+	RunCase("binary, by channel", DataLog::kBinary, true, loops);
+	RunCase("text, by channel", DataLog::kText, true, loops);
+	return 0;
+}
+
+#ifdef SIMULATION
+int main(int argc, char ** argv) {
+	return LogBench(argc > 1 ? atoi(argv[1]) : 0);
+}
+#endif
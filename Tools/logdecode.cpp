@@ -0,0 +1,168 @@
+/**
+ * \file logdecode.cpp
+ * \brief Converts a binary log written by DataLog back into the text log format.
+ *
+ * Runs on the development computer, not the robot.  The output matches what
+ * DataLog writes in text mode, so existing log tools keep working.
+ *
+ * Build: g++ -o logdecode logdecode.cpp
+ * Usage: logdecode drivetrain.log [drivetrain.txt]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../Source/datalog.h"
+
+/**
+ * \brief Reverse the byte order of a value in place.
+ *
+ * \param data pointer to the value.
+ * \param size size of the value in bytes.
+*/
+static void SwapBytes(void * data, unsigned int size) {
+	unsigned char * bytes = (unsigned char *) data;
+	for (unsigned int i = 0; i < size / 2; i++) {
+		unsigned char temp = bytes[i];
+		bytes[i] = bytes[size - 1 - i];
+		bytes[size - 1 - i] = temp;
+	}
+}
+
+/**
+ * \brief Check if a block is a file header, and read the byte order from it.
+ *
+ * \param block the block to check.
+ * \param swap set to true if the values in the file need their bytes swapped.
+ * \return true if the block is a valid header.
+*/
+static bool ReadHeader(const datalog_record &block, bool *swap) {
+	datalog_header header;
+	memcpy(&header, &block, sizeof(header));
+	if (strncmp(header.magic, "TJLOG", sizeof(header.magic)) != 0)
+		return false;
+	if (header.byte_order == 0x01020304) {
+		*swap = false;
+	}
+	else {
+		SwapBytes(&header.byte_order, sizeof(header.byte_order));
+		if (header.byte_order != 0x01020304)
+			return false;
+		*swap = true;
+		SwapBytes(&header.record_size, sizeof(header.record_size));
+	}
+	return (header.record_size == sizeof(datalog_record));
+}
+
+/**
+ * \brief Print the timestamp of a record if it was logged with one.
+ *
+ * \param output the file to write to.
+ * \param record the record.
+*/
+static void WriteTimestamp(FILE * output, const datalog_record &record) {
+	if (record.flags & DataLog::kTimestampFlag)
+		fprintf(output, "[%d] ", record.time);
+}
+
+int main(int argc, char ** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s binary_log [text_log]\n", argv[0]);
+		return 1;
+	}
+
+	FILE * input = fopen(argv[1], "rb");
+	if (input == NULL) {
+		fprintf(stderr, "Unable to open %s\n", argv[1]);
+		return 1;
+	}
+	FILE * output = stdout;
+	if (argc > 2) {
+		output = fopen(argv[2], "w");
+		if (output == NULL) {
+			fprintf(stderr, "Unable to open %s\n", argv[2]);
+			fclose(input);
+			return 1;
+		}
+	}
+
+	std::vector<std::string> channels;
+	std::string text;
+	bool swap = false;
+	bool header_found = false;
+	datalog_record record;
+
+	while (fread(&record, sizeof(record), 1, input) == 1) {
+		// A log that was appended to has a header at the start of each session
+		if (ReadHeader(record, &swap)) {
+			header_found = true;
+			channels.clear();
+			text.clear();
+			continue;
+		}
+		if (!header_found) {
+			fprintf(stderr, "%s is not a binary log\n", argv[1]);
+			break;
+		}
+
+		if (swap) {
+			SwapBytes(&record.time, sizeof(record.time));
+			SwapBytes(&record.channel, sizeof(record.channel));
+			if (record.type == DataLog::kIntRecord || record.type == DataLog::kFloatRecord)
+				SwapBytes(&record.value.int_value, sizeof(record.value.int_value));
+			else if (record.type == DataLog::kDoubleRecord)
+				SwapBytes(&record.value.double_value, sizeof(record.value.double_value));
+		}
+
+		// Collect text until the last record of it
+		if (record.type == DataLog::kLineRecord || record.type == DataLog::kChannelRecord ||
+				record.type == DataLog::kStringRecord) {
+			unsigned int length = 0;
+			while (length < sizeof(record.value.text) && record.value.text[length] != 0)
+				length++;
+			text.append(record.value.text, length);
+			if (record.flags & DataLog::kContinuedFlag)
+				continue;
+		}
+
+		const char * name = "unknown";
+		if (record.channel < channels.size())
+			name = channels[record.channel].c_str();
+
+		switch (record.type) {
+			case DataLog::kChannelRecord:
+				if (record.channel >= channels.size())
+					channels.resize(record.channel + 1);
+				channels[record.channel] = text;
+				break;
+			case DataLog::kLineRecord:
+				WriteTimestamp(output, record);
+				fputs(text.c_str(), output);
+				break;
+			case DataLog::kStringRecord:
+				WriteTimestamp(output, record);
+				fprintf(output, "%s = %s\n", name, text.c_str());
+				break;
+			case DataLog::kIntRecord:
+				WriteTimestamp(output, record);
+				fprintf(output, "%s = %d\n", name, record.value.int_value);
+				break;
+			case DataLog::kFloatRecord:
+				WriteTimestamp(output, record);
+				fprintf(output, "%s = %f\n", name, record.value.float_value);
+				break;
+			case DataLog::kDoubleRecord:
+				WriteTimestamp(output, record);
+				fprintf(output, "%s = %f\n", name, record.value.double_value);
+				break;
+			default:
+				break;
+		}
+		text.clear();
+	}
+
+	fclose(input);
+	if (output != stdout)
+		fclose(output);
+	return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * \file makeframes.cpp
+ * \brief Makes frame recordings of made up targets, with their truth files, for visionreplay.
+ *
+ * Runs on the development computer, not the robot.  The frames are drawn
+ * rather than taken with the camera, so the position of every target is
+ * known exactly and written to the truth file in the format visionreplay
+ * reads.  The recordings in Tools/replay were made with this tool:
+ *
+ *   tracking  A high goal moves 2 pixels right each frame.  A low goal
+ *             jumps 28 pixels down at frame 15 and back up at frame 30,
+ *             further than TRACKING_PADDING, so only part of it is left
+ *             in the region it is predicted in.  A middle goal stays still
+ *             against the right edge of the frame.
+ *   fade      A high goal and a low goal fade from green 200 to 120 over
+ *             80 frames, as when the venue lights are dimmed.  A dim green
+ *             glow, green 112, sits inside the high goal, apart from it.
+ *             It isn't a target.
+ *
+ * Build: g++ -O2 -o makeframes makeframes.cpp ../Source/framerecording.cpp
+ * Usage: makeframes tracking|fade frames.rec truth.txt
+ */
+#include <stdio.h>
+#include <string.h>
+#include "../Source/framerecording.h"
+
+/**
+ * \def FRAME_WIDTH
+ * \brief Width of the frames, the 320x240 camera resolution.
+ */
+#define FRAME_WIDTH 320
+
+/**
+ * \def FRAME_HEIGHT
+ * \brief Height of the frames.
+ */
+#define FRAME_HEIGHT 240
+
+/**
+ * \def FRAME_PERIOD
+ * \brief Time in nanoseconds between the frames, 30 frames per second.
+ */
+#define FRAME_PERIOD 33333333ULL
+
+/**
+ * \brief Fill a frame with the dark background.
+ *
+ * \param pixels the frame, 4 bytes each in blue, green, red, alpha order.
+*/
+static void DrawBackground(unsigned char * pixels) {
+	for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; i++) {
+		pixels[i * 4] = 20;
+		pixels[i * 4 + 1] = 20;
+		pixels[i * 4 + 2] = 20;
+		pixels[i * 4 + 3] = 0;
+	}
+}
+
+/**
+ * \brief Draw a hollow target 3 pixels thick, like the reflective tape around a goal.
+ *
+ * Only the part inside the frame is drawn, and only that part is added to
+ * the truth file.
+ *
+ * \param pixels the frame.
+ * \param left the left of the target, which may be outside the frame.
+ * \param top the top of the target.
+ * \param width the width of the target.
+ * \param height the height of the target.
+ * \param green the brightness of the green plane of the tape.
+ * \param frame the frame number, for the truth file.
+ * \param truth the truth file.
+*/
+static void DrawTarget(unsigned char * pixels, int left, int top, int width, int height, int green, int frame,
+		FILE * truth) {
+	int visible_left = FRAME_WIDTH;
+	int visible_top = FRAME_HEIGHT;
+	int visible_right = 0;
+	int visible_bottom = 0;
+	for (int y = top; y < top + height; y++) {
+		for (int x = left; x < left + width; x++) {
+			if (x < 0 || x >= FRAME_WIDTH || y < 0 || y >= FRAME_HEIGHT) {
+				continue;
+			}
+			if (y < top + 3 || y >= top + height - 3 || x < left + 3 || x >= left + width - 3) {
+				pixels[(y * FRAME_WIDTH + x) * 4 + 1] = green;
+			}
+			visible_left = x < visible_left ? x : visible_left;
+			visible_top = y < visible_top ? y : visible_top;
+			visible_right = x + 1 > visible_right ? x + 1 : visible_right;
+			visible_bottom = y + 1 > visible_bottom ? y + 1 : visible_bottom;
+		}
+	}
+	if (visible_right > visible_left && visible_bottom > visible_top) {
+		fprintf(truth, "%d %d %d %d %d\n", frame, visible_left, visible_top, visible_right - visible_left,
+				visible_bottom - visible_top);
+	}
+}
+
+/**
+ * \brief Draw a solid rectangle that isn't a target, so isn't added to the truth file.
+ *
+ * \param pixels the frame.
+ * \param left the left of the rectangle.
+ * \param top the top of the rectangle.
+ * \param width the width of the rectangle.
+ * \param height the height of the rectangle.
+ * \param green the brightness of the green plane.
+*/
+static void DrawGlow(unsigned char * pixels, int left, int top, int width, int height, int green) {
+	for (int y = top; y < top + height; y++) {
+		for (int x = left; x < left + width; x++) {
+			pixels[(y * FRAME_WIDTH + x) * 4 + 1] = green;
+		}
+	}
+}
+
+/**
+ * \brief Make the tracking recording.
+ *
+ * \param recording the recording to write the frames to.
+ * \param truth the truth file.
+ * \return true if successful.
+*/
+static bool MakeTracking(FrameRecording &recording, FILE * truth) {
+	unsigned char * pixels = new unsigned char[FRAME_WIDTH * FRAME_HEIGHT * 4];
+	bool written = true;
+	for (int frame = 0; frame < 40 && written; frame++) {
+		DrawBackground(pixels);
+		DrawTarget(pixels, 20 + frame * 2, 60, 62, 20, 200, frame, truth);
+		DrawTarget(pixels, 140, (frame >= 15 && frame < 30) ? 148 : 120, 37, 32, 200, frame, truth);
+		DrawTarget(pixels, FRAME_WIDTH - 54, 150, 54, 25, 200, frame, truth);
+		written = recording.WriteFrame(pixels, FRAME_WIDTH, FRAME_HEIGHT, FRAME_WIDTH, frame * FRAME_PERIOD);
+	}
+	delete [] pixels;
+	return written;
+}
+
+/**
+ * \brief Make the fade recording.
+ *
+ * \param recording the recording to write the frames to.
+ * \param truth the truth file.
+ * \return true if successful.
+*/
+static bool MakeFade(FrameRecording &recording, FILE * truth) {
+	unsigned char * pixels = new unsigned char[FRAME_WIDTH * FRAME_HEIGHT * 4];
+	bool written = true;
+	for (int frame = 0; frame < 90 && written; frame++) {
+		int green = frame < 10 ? 200 : 200 - (frame - 10);
+		DrawBackground(pixels);
+		DrawTarget(pixels, 60, 60, 62, 20, green, frame, truth);
+		DrawGlow(pixels, 79, 66, 24, 8, 112);
+		DrawTarget(pixels, 180, 120, 37, 32, green, frame, truth);
+		written = recording.WriteFrame(pixels, FRAME_WIDTH, FRAME_HEIGHT, FRAME_WIDTH, frame * FRAME_PERIOD);
+	}
+	delete [] pixels;
+	return written;
+}
+
+int main(int argc, char ** argv) {
+	if (argc < 4 || (strcmp(argv[1], "tracking") != 0 && strcmp(argv[1], "fade") != 0)) {
+		printf("Usage: makeframes tracking|fade frames.rec truth.txt\n");
+		return 1;
+	}
+
+	FrameRecording recording;
+	if (!recording.OpenForWrite(argv[2])) {
+		printf("Could not create %s\n", argv[2]);
+		return 1;
+	}
+	FILE * truth = fopen(argv[3], "w");
+	if (truth == NULL) {
+		printf("Could not create %s\n", argv[3]);
+		recording.Close();
+		return 1;
+	}
+	fprintf(truth, "# Made by makeframes %s: frame left top width height\n", argv[1]);
+
+	bool written = strcmp(argv[1], "fade") == 0 ? MakeFade(recording, truth) : MakeTracking(recording, truth);
+	fclose(truth);
+	recording.Close();
+	if (!written) {
+		printf("Could not write %s\n", argv[2]);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,192 @@
+/**
+ * \file parbench.cpp
+ * \brief Compares the Parameters store against the std::map store it replaced.
+ *
+ * Runs on the development computer, not the robot.  Each parameter file is
+ * loaded into both stores, every name is checked to give the same value from
+ * both, and then the time to load and to look up every name is measured.
+ *
+ * Build: g++ -O2 -o parbench parbench.cpp ../Source/parameters.cpp ../Source/readfile.cpp
+ * Usage: parbench ../ParameterFiles/technojays.par ../ParameterFiles/drivetrain.par ...
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../Source/parameters.h"
+
+/**
+ * \class MapParameters
+ * \brief The std::map parameter store that Parameters used to have, for comparison.
+ */
+class MapParameters {
+public:
+	bool ReadValues(FILE * file) {
+		char buffer[256] = {0};
+		char parameter[255] = {0};
+		char value_string[255] = {0};
+		char comment[255] = {0};
+		float value_float = 0.0;
+		number_parameters_.clear();
+		string_parameters_.clear();
+		while (fgets(buffer, 255, file) != NULL) {
+			comment[0] = 0;
+			value_string[0] = 0;
+			if (sscanf(buffer, "%s = %f %[^\n]", parameter, &value_float, comment) >= 2) {
+				number_parameters_[parameter] = value_float;
+				continue;
+			}
+			if (sscanf(buffer, "%s = %[^#\n] %[^\n]", parameter, value_string, comment) >= 2) {
+				if (strlen(value_string) > 0 && value_string[strlen(value_string)-1] == ' ') {
+					value_string[strlen(value_string)-1] = 0;
+				}
+				string_parameters_[parameter] = value_string;
+				continue;
+			}
+			return false;
+		}
+		return true;
+	}
+	bool GetValue(const char * parameter, char * value, int length) {
+		std::map<std::string, std::string>::iterator it = string_parameters_.find(parameter);
+		if (it == string_parameters_.end())
+			return false;
+		strncpy(value, it->second.c_str(), length - 1);
+		value[length - 1] = 0;
+		return it->second.size() < (unsigned int) length;
+	}
+	bool GetValue(const char * parameter, float * value) {
+		std::map<std::string, float>::iterator it = number_parameters_.find(parameter);
+		if (it == number_parameters_.end())
+			return false;
+		*value = it->second;
+		return true;
+	}
+	std::vector<std::string> Names() {
+		std::vector<std::string> names;
+		for (std::map<std::string, float>::iterator it = number_parameters_.begin(); it != number_parameters_.end(); ++it)
+			names.push_back(it->first);
+		for (std::map<std::string, std::string>::iterator it = string_parameters_.begin(); it != string_parameters_.end(); ++it)
+			names.push_back(it->first);
+		return names;
+	}
+private:
+	std::map<std::string, std::string> string_parameters_;
+	std::map<std::string, float> number_parameters_;
+};
+
+/**
+ * \brief Get the current time in microseconds.
+ *
+ * \return the time in microseconds.
+*/
+static double GetUsecTime() {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return now.tv_sec * 1000000.0 + now.tv_usec;
+}
+
+/**
+ * \brief Check that both stores give the same value for every name.
+ *
+ * \param flat the Parameters store.
+ * \param map the std::map store.
+ * \param names every name in the file, plus one that isn't.
+ * \return the number of mismatches.
+*/
+static int Compare(Parameters &flat, MapParameters &map, const std::vector<std::string> &names) {
+	int mismatches = 0;
+	for (unsigned int i = 0; i < names.size(); i++) {
+		const char * name = names[i].c_str();
+		char flat_text[256] = {0};
+		char map_text[256] = {0};
+		float flat_number = 0.0;
+		float map_number = 0.0;
+		bool flat_found = flat.GetValue(name, flat_text, sizeof(flat_text));
+		bool map_found = map.GetValue(name, map_text, sizeof(map_text));
+		if (flat_found != map_found || strcmp(flat_text, map_text) != 0) {
+			printf("  text mismatch for %s: \"%s\" vs \"%s\"\n", name, flat_text, map_text);
+			mismatches++;
+		}
+		flat_found = flat.GetValue(name, &flat_number);
+		map_found = map.GetValue(name, &map_number);
+		if (flat_found != map_found || flat_number != map_number) {
+			printf("  number mismatch for %s: %f vs %f\n", name, flat_number, map_number);
+			mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+int main(int argc, char ** argv) {
+	const int kLoads = 200;
+	const int kLookups = 2000;
+	int mismatches = 0;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s file.par ...\n", argv[0]);
+		return 1;
+	}
+
+	printf("%-24s %6s %12s %12s %12s %12s\n", "file", "names", "flat load", "map load",
+		"flat lookup", "map lookup");
+	for (int file_index = 1; file_index < argc; file_index++) {
+		Parameters flat(argv[file_index]);
+		if (!flat.file_opened_) {
+			printf("%-24s unable to open\n", argv[file_index]);
+			continue;
+		}
+		flat.Close();
+		MapParameters map;
+
+		// Time opening and loading the file into each store
+		double start = GetUsecTime();
+		for (int i = 0; i < kLoads; i++) {
+			flat.Open(argv[file_index]);
+			flat.ReadValues();
+			flat.Close();
+		}
+		double flat_load = (GetUsecTime() - start) / kLoads;
+		start = GetUsecTime();
+		for (int i = 0; i < kLoads; i++) {
+			FILE * file = fopen(argv[file_index], "r");
+			map.ReadValues(file);
+			fclose(file);
+		}
+		double map_load = (GetUsecTime() - start) / kLoads;
+
+		std::vector<std::string> names = map.Names();
+		names.push_back("NOT_A_PARAMETER");
+		mismatches += Compare(flat, map, names);
+
+		// Time looking up every name the way LoadParameters does
+		float number = 0.0;
+		start = GetUsecTime();
+		for (int i = 0; i < kLookups; i++) {
+			for (unsigned int j = 0; j < names.size(); j++) {
+				flat.GetValue(names[j].c_str(), &number);
+			}
+		}
+		double flat_lookup = (GetUsecTime() - start) * 1000.0 / (kLookups * names.size());
+		start = GetUsecTime();
+		for (int i = 0; i < kLookups; i++) {
+			for (unsigned int j = 0; j < names.size(); j++) {
+				map.GetValue(names[j].c_str(), &number);
+			}
+		}
+		double map_lookup = (GetUsecTime() - start) * 1000.0 / (kLookups * names.size());
+
+		const char * base = strrchr(argv[file_index], '/');
+		printf("%-24s %6u %9.1f us %9.1f us %9.1f ns %9.1f ns\n", base ? base + 1 : argv[file_index],
+			(unsigned int) names.size() - 1, flat_load, map_load, flat_lookup, map_lookup);
+	}
+
+	if (mismatches > 0) {
+		printf("%d mismatches\n", mismatches);
+		return 1;
+	}
+	printf("All values match\n");
+	return 0;
+}
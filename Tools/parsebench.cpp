@@ -0,0 +1,327 @@
+/**
+ * \file parsebench.cpp
+ * \brief Compares the in-place parameter and autoscript parsers against the sscanf parsers they replaced.
+ *
+ * Runs on the development computer, not the robot.  Large synthetic .par and
+ * .as files are written to the current directory, parsed by both versions,
+ * checked to give the same results, and timed.  Any .par or .as files given
+ * on the command line are checked the same way.
+ *
+ * Build: g++ -O2 -o parsebench parsebench.cpp ../Source/parameters.cpp ../Source/autoscript.cpp ../Source/readfile.cpp
+ * Usage: parsebench [lines] [file.par|file.as ...]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../Source/parameters.h"
+#include "../Source/autoscript.h"
+
+/**
+ * \brief Get the current time in microseconds.
+ *
+ * \return the time in microseconds.
+*/
+static double GetUsecTime() {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return now.tv_sec * 1000000.0 + now.tv_usec;
+}
+
+/**
+ * \brief The fgets/sscanf parameter reader that Parameters used to have.
+ *
+ * \param path the parameter file.
+ * \param numbers filled with the numerical parameters.
+ * \param strings filled with the string parameters.
+ * \return true if every line matched.
+*/
+static bool LegacyReadValues(const char * path, std::map<std::string, float> &numbers,
+		std::map<std::string, std::string> &strings) {
+	char buffer[256] = {0};
+	char parameter[255] = {0};
+	char value_string[255] = {0};
+	char comment[255] = {0};
+	float value_float = 0.0;
+	FILE * file = fopen(path, "r");
+	if (file == NULL)
+		return false;
+	numbers.clear();
+	strings.clear();
+	while (fgets(buffer, 255, file) != NULL) {
+		comment[0] = 0;
+		value_string[0] = 0;
+		if (sscanf(buffer, "%s = %f %[^\n]", parameter, &value_float, comment) >= 2) {
+			numbers[parameter] = value_float;
+			continue;
+		}
+		if (sscanf(buffer, "%s = %[^#\n] %[^\n]", parameter, value_string, comment) >= 2) {
+			if (strlen(value_string) > 0 && value_string[strlen(value_string)-1] == ' ') {
+				value_string[strlen(value_string)-1] = 0;
+			}
+			strings[parameter] = value_string;
+			continue;
+		}
+		fclose(file);
+		return false;
+	}
+	fclose(file);
+	return true;
+}
+
+/**
+ * Data structure for the autoscript commands that AutoScript used to store.
+ */
+struct legacy_command {
+	char command[255];	///< auto command
+	float param[5];		///< auto command parameters, -9999 if not given
+};
+
+/**
+ * \brief The fgets/strtok autoscript reader that AutoScript used to have.
+ *
+ * \param path the autoscript file.
+ * \param commands filled with the commands.
+ * \return true if the file was read.
+*/
+static bool LegacyReadScript(const char * path, std::vector<legacy_command> &commands) {
+	char buffer[256] = {0};
+	char c[255] = {0};
+	float p[5];
+	FILE * file = fopen(path, "r");
+	if (file == NULL)
+		return false;
+	commands.clear();
+	while (fgets(buffer, 255, file) != NULL) {
+		c[0] = 0;
+		for (int i = 0; i < 5; i++)
+			p[i] = -9999;
+		int param_index = 0;
+		for (char * token = strtok(buffer, " ,"); token != NULL; token = strtok(NULL, " ,")) {
+			if (param_index == 0)
+				sscanf(token, "%s", c);
+			else if (param_index <= 5)
+				sscanf(token, "%f", &p[param_index - 1]);
+			param_index++;
+		}
+		if (param_index > 0) {
+			legacy_command command;
+			strcpy(command.command, c);
+			memcpy(command.param, p, sizeof(p));
+			commands.push_back(command);
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+/**
+ * \brief Write a synthetic parameter file like the ones in ParameterFiles.
+ *
+ * \param path the file to write.
+ * \param lines the number of parameters to write.
+ * \param long_lines true to add comments that are longer than the old 255 character limit.
+*/
+static void WriteParameterFile(const char * path, int lines, bool long_lines) {
+	FILE * file = fopen(path, "w");
+	for (int i = 0; i < lines; i++) {
+		if (i % 4 == 3)
+			fprintf(file, "STRING_PARAMETER_%d = text value %d\t\t# a string parameter\n", i, i);
+		else if (i % 4 == 2)
+			fprintf(file, "INTEGER_PARAMETER_%d = %d\t\t\t\t# an integer parameter\n", i, i - 5000);
+		else
+			fprintf(file, "FLOAT_PARAMETER_%d = %f\t\t\t# a float parameter\n", i, i * 0.125);
+		if (long_lines && i % 100 == 0) {
+			fprintf(file, "LONG_PARAMETER_%d = %d\t# %0300d\n", i, i, 0);
+		}
+	}
+	fclose(file);
+}
+
+/**
+ * \brief Write a synthetic autoscript file like the ones in AutoScriptFiles.
+ *
+ * \param path the file to write.
+ * \param lines the number of commands to write.
+*/
+static void WriteScriptFile(const char * path, int lines) {
+	const char * commands[] = { "drivetime", "turnheading", "pitchposition", "shoot", "wait", "rapidfire" };
+	FILE * file = fopen(path, "w");
+	for (int i = 0; i < lines; i++) {
+		switch (i % 6) {
+			case 0:
+				fprintf(file, "%s,%f,%d,%f\n", commands[0], i * 0.01, i % 4, 1.0);
+				break;
+			case 1:
+				fprintf(file, "%s,%f,%f\n", commands[1], i * 0.5 - 90.0, 0.8);
+				break;
+			case 2:
+				fprintf(file, "%s,%d,%f\n", commands[2], i % 5000, 1.0);
+				break;
+			case 3:
+				fprintf(file, "%s,%d\n", commands[3], i % 100);
+				break;
+			case 4:
+				fprintf(file, "%s,%f\n", commands[4], 0.2);
+				break;
+			default:
+				fprintf(file, "%s\n", commands[5]);
+				break;
+		}
+	}
+	fclose(file);
+}
+
+/**
+ * \brief Check that both parameter readers give the same values, and time them.
+ *
+ * \param path the parameter file.
+ * \param repeat the number of times to read the file for timing, 0 to only check.
+ * \return the number of mismatches.
+*/
+static int CheckParameters(const char * path, int repeat) {
+	std::map<std::string, float> numbers;
+	std::map<std::string, std::string> strings;
+	Parameters parameters(path);
+	bool read = parameters.ReadValues();
+	parameters.Close();
+	bool legacy_read = LegacyReadValues(path, numbers, strings);
+	int mismatches = (read == legacy_read) ? 0 : 1;
+
+	for (std::map<std::string, float>::iterator it = numbers.begin(); it != numbers.end(); ++it) {
+		float value = 0.0;
+		if (!parameters.GetValue(it->first.c_str(), &value) || value != it->second) {
+			printf("  %s: %s = %f, was %f\n", path, it->first.c_str(), value, it->second);
+			mismatches++;
+		}
+	}
+	for (std::map<std::string, std::string>::iterator it = strings.begin(); it != strings.end(); ++it) {
+		char value[256] = {0};
+		// The old reader only removed one trailing space, the new one removes all trailing whitespace
+		std::string expected = it->second;
+		expected.erase(expected.find_last_not_of(" \t\r") + 1);
+		if (!parameters.GetValue(it->first.c_str(), value, sizeof(value)) || expected != value) {
+			printf("  %s: %s = \"%s\", was \"%s\"\n", path, it->first.c_str(), value, expected.c_str());
+			mismatches++;
+		}
+	}
+
+	if (repeat > 0) {
+		double start = GetUsecTime();
+		for (int i = 0; i < repeat; i++) {
+			parameters.Open(path);
+			parameters.ReadValues();
+			parameters.Close();
+		}
+		double in_place = (GetUsecTime() - start) / repeat;
+		start = GetUsecTime();
+		for (int i = 0; i < repeat; i++) {
+			LegacyReadValues(path, numbers, strings);
+		}
+		double legacy = (GetUsecTime() - start) / repeat;
+		printf("%-24s %7u values %10.0f us in place %10.0f us sscanf %5.1fx\n", path,
+			(unsigned int) (numbers.size() + strings.size()), in_place, legacy, legacy / in_place);
+	}
+	return mismatches;
+}
+
+/**
+ * \brief Check that both autoscript readers give the same commands, and time them.
+ *
+ * The commands are compared by name, and by the parameters the command uses.
+ *
+ * \param path the autoscript file.
+ * \param repeat the number of times to read the file for timing, 0 to only check.
+ * \return the number of mismatches.
+*/
+static int CheckScript(const char * path, int repeat) {
+	std::vector<legacy_command> commands;
+	AutoScript script(path);
+	script.ReadScript();
+	script.Close();
+	LegacyReadScript(path, commands);
+	int mismatches = 0;
+
+	for (unsigned int i = 0; i < commands.size(); i++) {
+		autoscript_command command = script.GetCommand(i);
+		const float params[5] = { command.param1, command.param2, command.param3, command.param4, command.param5 };
+		const char * name = AutoScript::GetCommandName(command.opcode);
+		bool match = strcmp(name, commands[i].command) == 0;
+		for (int j = 0; j < command.param_count && match; j++) {
+			match = params[j] == commands[i].param[j];
+		}
+		if (!match) {
+			printf("  %s: command %u is %s, was %s\n", path, i, name, commands[i].command);
+			mismatches++;
+		}
+	}
+	if (script.GetCommand(commands.size()).opcode != AutoScript::kInvalid) {
+		printf("  %s: more commands than before\n", path);
+		mismatches++;
+	}
+
+	if (repeat > 0) {
+		double start = GetUsecTime();
+		for (int i = 0; i < repeat; i++) {
+			script.Open(path);
+			script.ReadScript();
+			script.Close();
+		}
+		double in_place = (GetUsecTime() - start) / repeat;
+		start = GetUsecTime();
+		for (int i = 0; i < repeat; i++) {
+			LegacyReadScript(path, commands);
+		}
+		double legacy = (GetUsecTime() - start) / repeat;
+		printf("%-24s %7u commands %8.0f us in place %10.0f us sscanf %5.1fx\n", path,
+			(unsigned int) commands.size(), in_place, legacy, legacy / in_place);
+	}
+	return mismatches;
+}
+
+int main(int argc, char ** argv) {
+	int lines = 20000;
+	int mismatches = 0;
+
+	if (argc > 1 && atoi(argv[1]) > 0)
+		lines = atoi(argv[1]);
+
+	// Check and time the synthetic files
+	WriteParameterFile("synthetic.par", lines, false);
+	WriteScriptFile("synthetic.as", lines);
+	mismatches += CheckParameters("synthetic.par", 10);
+	mismatches += CheckScript("synthetic.as", 10);
+
+	// Lines longer than 255 characters used to fail, now they should be read
+	WriteParameterFile("synthetic_long.par", lines, true);
+	Parameters long_parameters("synthetic_long.par");
+	int long_value = 0;
+	if (!long_parameters.ReadValues() || !long_parameters.GetValue("LONG_PARAMETER_100", &long_value) ||
+			long_value != 100) {
+		printf("  synthetic_long.par: long lines were not read\n");
+		mismatches++;
+	}
+
+	// Check any real files
+	for (int i = 1; i < argc; i++) {
+		const char * extension = strrchr(argv[i], '.');
+		if (extension != NULL && strcmp(extension, ".par") == 0)
+			mismatches += CheckParameters(argv[i], 0);
+		else if (extension != NULL && strcmp(extension, ".as") == 0)
+			mismatches += CheckScript(argv[i], 0);
+	}
+
+	remove("synthetic.par");
+	remove("synthetic.as");
+	remove("synthetic_long.par");
+
+	if (mismatches > 0) {
+		printf("%d mismatches\n", mismatches);
+		return 1;
+	}
+	printf("All results match\n");
+	return 0;
+}
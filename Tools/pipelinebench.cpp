@@ -0,0 +1,513 @@
+/**
+ * \file pipelinebench.cpp
+ * \brief Compares searching camera frames in one thread with searching them in stages.
+ *
+ * Runs on a multi-core development computer, not the robot.  A stand-in
+ * frame source hands out frames from a recording made with RECORD_FRAMES,
+ * or made up frames of a target moving across a noisy background, and
+ * spends a set time on each to stand in for reading and decoding a camera
+ * image.  The frames are searched with the same VisionPipeline Targeting
+ * uses, first one after another in one thread, then in stages the way
+ * Targeting does with AcquireFramesTask() and FindTargetsTask():
+ *
+ *   take frame -> threshold, split into bands -> label and filter -> publish
+ *
+ * Each stage is a thread, the stages are joined by SpscQueues, and the
+ * thresholding is split across the given number of threads by horizontal
+ * bands.  Every frame must come out in order with the same targets as the
+ * single thread, and the published reports must never go back in time.
+ *
+ * Build: g++ -O2 -I../Simulator/include -o pipelinebench pipelinebench.cpp ../Source/visionpipeline.cpp
+ *        ../Source/thresholdkernel.cpp ../Source/particlelabeler.cpp ../Source/framerecording.cpp -lpthread
+ * Usage: pipelinebench [frames] [acquire_microseconds] [threads] [frames.rec]
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "../Source/framerecording.h"
+#include "../Source/spscqueue.h"
+#include "../Source/triplebuffer.h"
+#include "../Source/visionpipeline.h"
+
+/**
+ * \def MAXIMUM_PIXELS
+ * \brief The largest frame that can be used, 640x480.
+ */
+#define MAXIMUM_PIXELS (640 * 480)
+
+/**
+ * \def MAXIMUM_TARGETS
+ * \brief The largest number of targets kept for a frame, as in Targeting.
+ */
+#define MAXIMUM_TARGETS 32
+
+/**
+ * \def MAXIMUM_BANDS
+ * \brief The largest number of threads the thresholding can be split across.
+ */
+#define MAXIMUM_BANDS 16
+
+/**
+ * \def FRAME_SLOTS
+ * \brief The number of frames in the stages at once.
+ */
+#define FRAME_SLOTS 4
+
+/**
+ * \struct bench_frame
+ * \brief A frame passed between the stages.
+ */
+struct bench_frame {
+	int number;										///< the number of the frame from the frame source
+	int width;										///< the width of the frame in pixels
+	int height;										///< the height of the frame in pixels
+	unsigned char pixels[MAXIMUM_PIXELS * 4];		///< the frame, 4 bytes per pixel in blue, green, red, alpha order
+	unsigned char mask[MAXIMUM_PIXELS];				///< the threshold of the frame
+};
+
+/**
+ * \struct bench_report
+ * \brief The targets found in one frame.
+ */
+struct bench_report {
+	int number;										///< the number of the frame, -1 before the first
+	std::vector<ParticleAnalysisReport> targets;	///< the targets found
+
+	bench_report():
+		number(-1) {}
+};
+
+struct bench_state;
+
+/**
+ * \struct bench_band
+ * \brief A thread that thresholds one band of each frame.
+ */
+struct bench_band {
+	bench_state * state;							///< the state shared between the stages
+	pthread_t thread;								///< the thread
+	Rect band;										///< the part of the frame it thresholds
+	SpscQueue<int, FRAME_SLOTS> work;				///< frames to threshold
+	SpscQueue<int, FRAME_SLOTS> done;				///< frames thresholded
+};
+
+/**
+ * \class FrameSource
+ * \brief Stands in for the camera.
+ */
+class FrameSource {
+
+public:
+	FrameSource(int acquire_microseconds);
+	~FrameSource();
+	bool Load(const char * path);
+	void MakeUp(int frames);
+	int GetNumberFrames();
+	void Acquire(int number, bench_frame * frame);
+
+private:
+	std::vector<unsigned char *> frames_;			///< the frames
+	int width_;										///< the width of every frame in pixels
+	int height_;									///< the height of every frame in pixels
+	int acquire_microseconds_;						///< time spent handing out each frame
+};
+
+/**
+ * \struct bench_state
+ * \brief The state shared between the stages.
+ */
+struct bench_state {
+	FrameSource * source;							///< where the frames come from
+	VisionPipeline * pipeline;						///< the image processing
+	int frame_count;								///< the number of frames to search
+	int band_count;									///< the number of threads the thresholding is split across
+	bench_frame frames[FRAME_SLOTS];				///< the frames in the stages
+	SpscQueue<int, FRAME_SLOTS> free_frames;		///< frames passed back to be filled
+	SpscQueue<int, FRAME_SLOTS> acquired_frames;	///< frames to threshold
+	SpscQueue<int, FRAME_SLOTS> thresholded_frames;	///< frames to label
+	bench_band bands[MAXIMUM_BANDS];				///< the threads thresholding the bands after the first
+	TripleBuffer<bench_report> reports;				///< the latest report
+	std::vector<int> target_counts;					///< the number of targets found in each frame
+	volatile int out_of_order;						///< number of frames that came out of a stage out of order
+	volatile bool running;							///< true while the band threads should keep running
+};
+
+/**
+ * \brief Get the time in seconds.
+ *
+ * \return seconds since an arbitrary start.
+*/
+static double GetSeconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+/**
+ * \brief Create a frame source with no frames.
+ *
+ * \param acquire_microseconds time spent handing out each frame.
+*/
+FrameSource::FrameSource(int acquire_microseconds) {
+	width_ = 0;
+	height_ = 0;
+	acquire_microseconds_ = acquire_microseconds;
+}
+
+/**
+ * \brief Delete the frames.
+*/
+FrameSource::~FrameSource() {
+	for (unsigned int i = 0; i < frames_.size(); i++) {
+		delete [] frames_[i];
+	}
+}
+
+/**
+ * \brief Read the frames of a recording.
+ *
+ * \param path the path and filename of the recording.
+ * \return true if at least one frame was read.
+*/
+bool FrameSource::Load(const char * path) {
+	FrameRecording recording;
+	if (!recording.OpenForRead(path)) {
+		return false;
+	}
+	unsigned char * pixels = new unsigned char[MAXIMUM_PIXELS * 4];
+	unsigned long long capture_timestamp = 0;
+	while (recording.ReadFrame(pixels, MAXIMUM_PIXELS, &width_, &height_, &capture_timestamp)) {
+		frames_.push_back(pixels);
+		pixels = new unsigned char[MAXIMUM_PIXELS * 4];
+	}
+	delete [] pixels;
+	recording.Close();
+	return !frames_.empty();
+}
+
+/**
+ * \brief Make up 320x240 frames of a target moving across a noisy background.
+ *
+ * \param frames the number of frames.
+*/
+void FrameSource::MakeUp(int frames) {
+	width_ = 320;
+	height_ = 240;
+	srand(1);
+	for (int number = 0; number < frames; number++) {
+		unsigned char * pixels = new unsigned char[MAXIMUM_PIXELS * 4];
+		for (int i = 0; i < width_ * height_; i++) {
+			pixels[i * 4] = 10 + rand() % 16;
+			pixels[i * 4 + 1] = 10 + rand() % 16;
+			pixels[i * 4 + 2] = 10 + rand() % 16;
+			pixels[i * 4 + 3] = 0;
+		}
+		// A hollow target 62 by 20, the shape of the high goal
+		int left = 10 + number % (width_ - 80);
+		for (int y = 60; y < 80; y++) {
+			for (int x = left; x < left + 62; x++) {
+				if (y < 63 || y >= 77 || x < left + 3 || x >= left + 59) {
+					pixels[(y * width_ + x) * 4 + 1] = 200;
+				}
+			}
+		}
+		frames_.push_back(pixels);
+	}
+}
+
+/**
+ * \brief Get the number of frames.
+ *
+ * \return the number of frames.
+*/
+int FrameSource::GetNumberFrames() {
+	return frames_.size();
+}
+
+/**
+ * \brief Copy a frame, taking the time set for reading and decoding a camera image.
+ *
+ * \param number the frame, repeating the frames if there are fewer.
+ * \param frame the frame to fill.
+*/
+void FrameSource::Acquire(int number, bench_frame * frame) {
+	double end = GetSeconds() + acquire_microseconds_ / 1000000.0;
+	frame->number = number;
+	frame->width = width_;
+	frame->height = height_;
+	memcpy(frame->pixels, frames_[number % frames_.size()], width_ * height_ * 4);
+	while (GetSeconds() < end) {
+	}
+}
+
+/**
+ * \brief Search every frame one after another in one thread.
+ *
+ * \param state the shared state.
+ * \return the time taken in seconds.
+*/
+static double RunSerial(bench_state * state) {
+	bench_frame * frame = &state->frames[0];
+	std::vector<ParticleAnalysisReport> report;
+	report.reserve(MAXIMUM_TARGETS);
+	state->target_counts.assign(state->frame_count, -1);
+
+	double start = GetSeconds();
+	for (int number = 0; number < state->frame_count; number++) {
+		state->source->Acquire(number, frame);
+		Rect whole_frame = {0, 0, frame->height, frame->width};
+		state->pipeline->Threshold(frame->pixels, frame->width, frame->mask, frame->width, &whole_frame, 1);
+		report.clear();
+		state->pipeline->FindTargets(frame->mask, frame->width, frame->height, frame->width, &whole_frame, 1,
+				report, MAXIMUM_TARGETS);
+		state->target_counts[number] = report.size();
+	}
+	return GetSeconds() - start;
+}
+
+/**
+ * \brief Take frames from the frame source.
+ *
+ * \param argument the shared state.
+ * \return NULL.
+*/
+static void * AcquireStage(void * argument) {
+	bench_state * state = (bench_state *) argument;
+	for (int number = 0; number < state->frame_count; number++) {
+		int slot = 0;
+		while (!state->free_frames.Pop(&slot)) {
+			sched_yield();
+		}
+		state->source->Acquire(number, &state->frames[slot]);
+		state->acquired_frames.Push(slot);
+	}
+	return NULL;
+}
+
+/**
+ * \brief Threshold one band of each frame, until told to stop.
+ *
+ * \param argument the band.
+ * \return NULL.
+*/
+static void * BandThread(void * argument) {
+	bench_band * band = (bench_band *) argument;
+	bench_state * state = band->state;
+	while (state->running) {
+		int slot = 0;
+		if (!band->work.Pop(&slot)) {
+			sched_yield();
+			continue;
+		}
+		bench_frame * frame = &state->frames[slot];
+		state->pipeline->Threshold(frame->pixels, frame->width, frame->mask, frame->width, &band->band, 1);
+		band->done.Push(slot);
+	}
+	return NULL;
+}
+
+/**
+ * \brief Threshold each frame, splitting it into bands across the band threads.
+ *
+ * The first band is done in this thread while the others are done by the
+ * band threads.
+ *
+ * \param argument the shared state.
+ * \return NULL.
+*/
+static void * ThresholdStage(void * argument) {
+	bench_state * state = (bench_state *) argument;
+	for (int number = 0; number < state->frame_count; number++) {
+		int slot = 0;
+		while (!state->acquired_frames.Pop(&slot)) {
+			sched_yield();
+		}
+		bench_frame * frame = &state->frames[slot];
+		if (frame->number != number) {
+			state->out_of_order++;
+		}
+
+		// Split the frame into bands of whole lines
+		Rect bands[MAXIMUM_BANDS];
+		for (int i = 0; i < state->band_count; i++) {
+			bands[i].left = 0;
+			bands[i].width = frame->width;
+			bands[i].top = frame->height * i / state->band_count;
+			bands[i].height = frame->height * (i + 1) / state->band_count - bands[i].top;
+		}
+		for (int i = 1; i < state->band_count; i++) {
+			state->bands[i].band = bands[i];
+			state->bands[i].work.Push(slot);
+		}
+		state->pipeline->Threshold(frame->pixels, frame->width, frame->mask, frame->width, &bands[0], 1);
+		for (int i = 1; i < state->band_count; i++) {
+			int done = 0;
+			while (!state->bands[i].done.Pop(&done)) {
+				sched_yield();
+			}
+		}
+		state->thresholded_frames.Push(slot);
+	}
+	return NULL;
+}
+
+/**
+ * \brief Label and filter each frame and publish the targets.
+ *
+ * \param argument the shared state.
+ * \return NULL.
+*/
+static void * LabelStage(void * argument) {
+	bench_state * state = (bench_state *) argument;
+	for (int number = 0; number < state->frame_count; number++) {
+		int slot = 0;
+		while (!state->thresholded_frames.Pop(&slot)) {
+			sched_yield();
+		}
+		bench_frame * frame = &state->frames[slot];
+		if (frame->number != number) {
+			state->out_of_order++;
+		}
+		Rect whole_frame = {0, 0, frame->height, frame->width};
+		bench_report * report = state->reports.GetBack();
+		report->targets.clear();
+		state->pipeline->FindTargets(frame->mask, frame->width, frame->height, frame->width, &whole_frame, 1,
+				report->targets, MAXIMUM_TARGETS);
+		report->number = frame->number;
+		state->target_counts[number] = report->targets.size();
+		state->reports.Publish();
+		state->free_frames.Push(slot);
+	}
+	return NULL;
+}
+
+/**
+ * \brief Search every frame in stages.
+ *
+ * \param state the shared state.
+ * \param band_count the number of threads the thresholding is split across.
+ * \param went_back set to the number of times the latest report was older than the one before.
+ * \return the time taken in seconds.
+*/
+static double RunStaged(bench_state * state, int band_count, int * went_back) {
+	state->band_count = band_count;
+	state->target_counts.assign(state->frame_count, -1);
+	state->out_of_order = 0;
+	state->running = true;
+	state->free_frames.Clear();
+	state->acquired_frames.Clear();
+	state->thresholded_frames.Clear();
+	for (int i = 0; i < FRAME_SLOTS; i++) {
+		state->free_frames.Push(i);
+	}
+	for (int i = 0; i < 3; i++) {
+		state->reports.GetBuffer(i)->number = -1;
+	}
+	for (int i = 1; i < band_count; i++) {
+		state->bands[i].state = state;
+		state->bands[i].work.Clear();
+		state->bands[i].done.Clear();
+		pthread_create(&state->bands[i].thread, NULL, BandThread, &state->bands[i]);
+	}
+
+	double start = GetSeconds();
+	pthread_t acquire_thread;
+	pthread_t threshold_thread;
+	pthread_t label_thread;
+	pthread_create(&acquire_thread, NULL, AcquireStage, state);
+	pthread_create(&threshold_thread, NULL, ThresholdStage, state);
+	pthread_create(&label_thread, NULL, LabelStage, state);
+
+	// Read the latest report like the control loop, until the last frame is published
+	int last_number = -1;
+	*went_back = 0;
+	while (last_number < state->frame_count - 1) {
+		const bench_report * report = state->reports.GetLatest();
+		if (report->number < last_number) {
+			(*went_back)++;
+		}
+		if (report->number > last_number) {
+			last_number = report->number;
+		}
+		sched_yield();
+	}
+
+	pthread_join(acquire_thread, NULL);
+	pthread_join(threshold_thread, NULL);
+	pthread_join(label_thread, NULL);
+	double seconds = GetSeconds() - start;
+
+	state->running = false;
+	for (int i = 1; i < band_count; i++) {
+		pthread_join(state->bands[i].thread, NULL);
+	}
+	return seconds;
+}
+
+int main(int argc, char ** argv) {
+	int frame_count = argc >= 2 ? atoi(argv[1]) : 300;
+	int acquire_microseconds = argc >= 3 ? atoi(argv[2]) : 1000;
+	int thread_count = argc >= 4 ? atoi(argv[3]) : 4;
+	if (frame_count <= 0 || acquire_microseconds < 0 || thread_count <= 0 || thread_count > MAXIMUM_BANDS) {
+		fprintf(stderr, "Usage: %s [frames] [acquire_microseconds] [threads 1-%d] [frames.rec]\n", argv[0],
+				MAXIMUM_BANDS);
+		return 1;
+	}
+
+	FrameSource * source = new FrameSource(acquire_microseconds);
+	if (argc >= 5) {
+		if (!source->Load(argv[4])) {
+			fprintf(stderr, "%s is not a frame recording\n", argv[4]);
+			delete source;
+			return 1;
+		}
+	}
+	else {
+		source->MakeUp(100);
+	}
+
+	// The thresholds in targeting.par, and green for the made up frames
+	VisionPipeline * pipeline = new VisionPipeline();
+	if (argc >= 5)
+		pipeline->SetThreshold(ThresholdKernel::kHSV, 120, 170, 50, 120, 35, 90);
+	else
+		pipeline->SetThreshold(ThresholdKernel::kRGB, 0, 50, 150, 255, 0, 50);
+	pipeline->SetParticleFilter(30, 1.0, 3.2, 80.0);
+
+	bench_state * state = new bench_state();
+	state->source = source;
+	state->pipeline = pipeline;
+	state->frame_count = frame_count;
+	for (int i = 0; i < 3; i++) {
+		state->reports.GetBuffer(i)->targets.reserve(MAXIMUM_TARGETS);
+	}
+
+	printf("%d frames, %d us to take each frame\n", frame_count, acquire_microseconds);
+	double serial_seconds = RunSerial(state);
+	std::vector<int> serial_counts = state->target_counts;
+	printf("one thread                  %8.1f frames/s\n", frame_count / serial_seconds);
+
+	int failures = 0;
+	for (int band_count = 1; band_count <= thread_count; band_count *= 2) {
+		int went_back = 0;
+		double seconds = RunStaged(state, band_count, &went_back);
+		int different = 0;
+		for (int i = 0; i < frame_count; i++) {
+			if (state->target_counts[i] != serial_counts[i])
+				different++;
+		}
+		printf("stages, %2d threshold bands  %8.1f frames/s %5.2fx, %d out of order, %d different, %d older\n",
+				band_count, frame_count / seconds, serial_seconds / seconds, state->out_of_order, different, went_back);
+		if (state->out_of_order != 0 || different != 0 || went_back != 0)
+			failures++;
+	}
+
+	delete state;
+	delete pipeline;
+	delete source;
+	return failures == 0 ? 0 : 1;
+}
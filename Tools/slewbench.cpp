@@ -0,0 +1,300 @@
+/**
+ * \file slewbench.cpp
+ * \brief Checks the SlewRateLimiter and compares manual drive outputs at different loop rates.
+ *
+ * Runs on the development computer, not the robot.  First the limiter's
+ * contract is checked, and each check prints "ok" or "FAILED":
+ * no limits passes the value straight through, the first call after a
+ * reset doesn't move, the value ramps at exactly the maximum rate and
+ * stops at the target, a new target changes the value in the same call,
+ * a stalled loop only counts as MAXIMUM_STEP, and
+ * with a maximum rate change the rate builds up and dies away gradually
+ * without passing the target.
+ *
+ * Then a joystick trace (full forward, full reverse, part forward, stop)
+ * is passed through the speed change limit DriveTrain used to apply on
+ * each call, and through the limiter with and without a jerk limit, at
+ * 50, 100 and 200 Hz.  Every 20 ms the output is compared with the 200 Hz
+ * output, and the largest difference and the time from the joystick
+ * reaching full forward to the first loop at full speed are printed.  The
+ * limiter starts toward a new joystick position over the whole loop period
+ * before the call that sees it, so a slower loop can be ahead of the 200 Hz
+ * output by what the maximum rate allows in the extra time.  That much
+ * difference is allowed, and more is a failed check.  Finally the time of
+ * each Calculate() is measured.
+ *
+ * Build: g++ -O2 -o slewbench slewbench.cpp ../Source/slewratelimiter.cpp
+ * Usage: slewbench
+ */
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include "../Source/slewratelimiter.h"
+
+/**
+ * \def MAXIMUM_STEP
+ * \brief The longest step the limiter counts, as in slewratelimiter.cpp.
+ */
+#define MAXIMUM_STEP 0.1
+
+/**
+ * \def TRACE_TIME
+ * \brief Length in seconds of the joystick trace.
+ */
+#define TRACE_TIME 2.4
+
+/**
+ * \def COMPARE_PERIOD
+ * \brief Time in seconds between the outputs compared across loop rates, the slowest loop period.
+ */
+#define COMPARE_PERIOD 0.02
+
+/**
+ * \def SPEED_CHANGE
+ * \brief The MAXIMUM_LINEAR_SPEED_CHANGE DriveTrain used to allow on each call.
+ */
+#define SPEED_CHANGE 0.2
+
+/**
+ * \def SLEW_RATE
+ * \brief LINEAR_SLEW_RATE used for the comparison.
+ */
+#define SLEW_RATE 20.0
+
+/**
+ * \def SLEW_JERK
+ * \brief LINEAR_SLEW_JERK used for the comparison with a jerk limit.
+ */
+#define SLEW_JERK 200.0
+
+/**
+ * \brief Get the time in seconds.
+ *
+ * \return seconds since an arbitrary start.
+*/
+static double GetSeconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+/**
+ * \brief Print the result of a check.
+ *
+ * \param name what was checked.
+ * \param passed true if the check passed.
+ * \return 0 if the check passed, 1 if not, to count the failures.
+*/
+static int Check(const char * name, bool passed) {
+	printf("%-60s %s\n", name, passed ? "ok" : "FAILED");
+	return passed ? 0 : 1;
+}
+
+/**
+ * \brief Check the limiter does what its documentation says.
+ *
+ * \return the number of checks that failed.
+*/
+static int CheckContract() {
+	int failures = 0;
+	SlewRateLimiter limiter;
+
+	// No limits
+	limiter.Calculate(0.0, 0.0);
+	failures += Check("no limits passes the value straight through", limiter.Calculate(0.7, 0.01) == 0.7f);
+
+	// First call after a reset
+	limiter.SetLimits(2.0, 0.0);
+	limiter.Reset(0.25);
+	failures += Check("first call after a reset doesn't move", limiter.Calculate(1.0, 5.0) == 0.25f);
+
+	// Ramp at the maximum rate, checked every 10 ms
+	limiter.Reset(0.0);
+	limiter.Calculate(1.0, 0.0);
+	bool ramp_exact = true;
+	bool passed_target = false;
+	for (int i = 1; i <= 100; i++) {
+		double time = i * 0.01;
+		float value = limiter.Calculate(1.0, time);
+		double expected = time * 2.0 < 1.0 ? time * 2.0 : 1.0;
+		if (fabs(value - expected) > 1e-6) {
+			ramp_exact = false;
+		}
+		if (value > 1.0f) {
+			passed_target = true;
+		}
+	}
+	failures += Check("ramps at exactly the maximum rate", ramp_exact);
+	failures += Check("stops at the target", !passed_target && limiter.GetValue() == 1.0f);
+
+	// A new target counts over the time since the last call
+	float moved = limiter.Calculate(-1.0, 1.1);
+	failures += Check("a new target changes the value in the same call", fabs(moved - 0.8) < 1e-6);
+
+	// Ramp down
+	float down = limiter.Calculate(-1.0, 1.2);
+	failures += Check("ramps down at the maximum rate", fabs(down - 0.6) < 1e-6);
+
+	// Stalled loop
+	limiter.Reset(0.0);
+	limiter.Calculate(1.0, 0.0);
+	float stalled = limiter.Calculate(1.0, 2.0);
+	failures += Check("a stalled loop only counts as MAXIMUM_STEP", fabs(stalled - 2.0 * MAXIMUM_STEP) < 1e-6);
+
+	// Time going backward
+	float backward = limiter.Calculate(1.0, 1.0);
+	failures += Check("time going backward doesn't move", backward == stalled);
+
+	// Jerk limit, checked every 5 ms.  The rate is measured from the float
+	// value returned, so allow for its rounding.
+	limiter.SetLimits(4.0, 20.0);
+	limiter.Reset(0.0);
+	limiter.Calculate(1.0, 0.0);
+	double previous_value = 0.0;
+	double previous_rate = 0.0;
+	bool rate_within_limits = true;
+	bool passed = false;
+	double reached_time = -1.0;
+	for (int i = 1; i <= 400; i++) {
+		double time = i * 0.005;
+		double value = limiter.Calculate(1.0, time);
+		double rate = (value - previous_value) / 0.005;
+		if (fabs(rate) > 4.0 + 1e-4 || (value < 1.0 && fabs(rate - previous_rate) > 20.0 * 0.005 + 1e-4)) {
+			rate_within_limits = false;
+		}
+		if (value > 1.0) {
+			passed = true;
+		}
+		if (reached_time < 0.0 && value == 1.0) {
+			reached_time = time;
+		}
+		previous_value = value;
+		previous_rate = rate;
+	}
+	failures += Check("with a jerk limit the rate changes gradually", rate_within_limits);
+	failures += Check("with a jerk limit the target is reached without passing it", !passed && reached_time > 0.0);
+	return failures;
+}
+
+/**
+ * \brief Get the joystick position at a time in the trace.
+ *
+ * \param time time in seconds since the start of the trace.
+ * \return the joystick position, -1 to 1.
+*/
+static float GetJoystick(double time) {
+	if (time < 0.1) {
+		return 0.0;
+	}
+	else if (time < 0.7) {
+		return 1.0;
+	}
+	else if (time < 1.3) {
+		return -1.0;
+	}
+	else if (time < 1.9) {
+		return 0.3;
+	}
+	return 0.0;
+}
+
+/**
+ * \brief Run the joystick trace through a limit at a loop rate.
+ *
+ * \param rate loop rate in Hz.
+ * \param method 0 for the old speed change on each call, 1 for the limiter, 2 for the limiter with a jerk limit.
+ * \param outputs filled with the output at each COMPARE_PERIOD.
+ * \param full_speed_time set to the time the output first reached 1.
+ * \return the number of outputs.
+*/
+static int RunTrace(int rate, int method, float * outputs, double * full_speed_time) {
+	SlewRateLimiter limiter;
+	limiter.SetLimits(SLEW_RATE, method == 2 ? SLEW_JERK : 0.0);
+	float previous = 0.0;
+	int loops = (int) (TRACE_TIME * rate + 0.5);
+	int loops_per_output = rate / (int) (1.0 / COMPARE_PERIOD + 0.5);
+	int count = 0;
+	*full_speed_time = -1.0;
+	for (int i = 0; i <= loops; i++) {
+		double time = (double) i / rate;
+		float target = GetJoystick(time);
+		float output = 0.0;
+		if (method == 0) {
+			// As DriveTrain::Drive() limited the speed before
+			output = target;
+			if (fabs(output - previous) > SPEED_CHANGE) {
+				output = output < previous ? previous - SPEED_CHANGE : previous + SPEED_CHANGE;
+			}
+			previous = output;
+		}
+		else {
+			output = limiter.Calculate(target, time);
+		}
+		if (*full_speed_time < 0.0 && output >= 1.0f) {
+			*full_speed_time = time;
+		}
+		if (i % loops_per_output == 0) {
+			outputs[count++] = output;
+		}
+	}
+	return count;
+}
+
+int main() {
+	int failures = CheckContract();
+
+	const char * methods[] = {"speed change per call", "slew rate", "slew rate and jerk"};
+	const int rates[] = {50, 100, 200};
+	float outputs[3][200];
+	double differences[2][3];
+	printf("\n%-24s %6s %14s %22s\n", "", "rate", "full speed", "largest difference");
+	for (int method = 0; method < 3; method++) {
+		int counts[3];
+		double full_speed_times[3];
+		for (int i = 0; i < 3; i++) {
+			counts[i] = RunTrace(rates[i], method, outputs[i], &full_speed_times[i]);
+		}
+		for (int i = 0; i < 3; i++) {
+			double difference = 0.0;
+			for (int j = 0; j < counts[i] && j < counts[2]; j++) {
+				if (fabs(outputs[i][j] - outputs[2][j]) > difference) {
+					difference = fabs(outputs[i][j] - outputs[2][j]);
+				}
+			}
+			printf("%-24s %3d Hz %12.3f s %22.6f\n", methods[method], rates[i], full_speed_times[i] - 0.1,
+					difference);
+			if (method > 0) {
+				differences[method - 1][i] = difference;
+			}
+		}
+	}
+
+	// The limiter may only differ by what the maximum rate allows in the longer loop period
+	printf("\n");
+	for (int method = 1; method < 3; method++) {
+		for (int i = 0; i < 2; i++) {
+			char name[80];
+			sprintf(name, "%s at %d Hz within a loop period of 200 Hz", methods[method], rates[i]);
+			double allowed = SLEW_RATE * (1.0 / rates[i] - 1.0 / rates[2]) + 1e-4;
+			failures += Check(name, differences[method - 1][i] <= allowed);
+		}
+	}
+
+	// Time the limiter at 100 Hz, changing the target so it never settles
+	SlewRateLimiter limiter;
+	limiter.SetLimits(SLEW_RATE, SLEW_JERK);
+	const int calls = 10000000;
+	float total = 0.0;
+	double start = GetSeconds();
+	for (int i = 0; i < calls; i++) {
+		total += limiter.Calculate((i & 64) ? 1.0 : -1.0, i * 0.01);
+	}
+	double elapsed = GetSeconds() - start;
+	printf("\nCalculate() %.1f ns per call (%g)\n", elapsed * 1000000000.0 / calls, total);
+
+	if (failures > 0) {
+		printf("%d checks FAILED\n", failures);
+		return 1;
+	}
+	return 0;
+}
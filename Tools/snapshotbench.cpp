@@ -0,0 +1,181 @@
+/**
+ * \file snapshotbench.cpp
+ * \brief Measures how long the control loop waits to get the latest targets.
+ *
+ * A writer task stands in for the targeting task.  It builds a report of
+ * target sized particles, sorts it and spends a set time on each report to
+ * simulate processing a frame.  The calling task stands in for the control
+ * loop and gets the latest report every millisecond.  This is done twice:
+ * first with the report filled and copied under a semaphore, the way
+ * Targeting shared its report before, then through the TripleBuffer it uses
+ * now.
+ *
+ * Add this file to the robot project and call it from the VxWorks shell
+ * while the robot is disabled, e.g. "SnapshotBench 2000, 5000".  The second
+ * argument is the simulated processing time of each report in
+ * microseconds.  Results are printed to the console.
+ */
+#include <string.h>
+#include <algorithm>
+#include "WPILib.h"
+#include "../Source/common.h"
+#include "../Source/looptimer.h"
+#include "../Source/targeting.h"
+
+/**
+ * \struct snapshot_bench_state
+ * \brief The state shared between the writer task and the reader.
+ */
+struct snapshot_bench_state {
+	SEM_ID semaphore;							///< semaphore protecting locked_report
+	std::vector<ParticleAnalysisReport> locked_report;	///< report shared under the semaphore
+	TripleBuffer<target_report> reports;		///< report shared through the triple buffer
+	bool use_triple_buffer;						///< true to publish through the triple buffer
+	int load_microseconds;						///< time spent on each report while it's being built
+	volatile bool running;						///< true while the writer should keep running
+	volatile int reports_published;				///< number of reports published
+};
+
+/**
+ * \brief Compare particles by height, the way Targeting sorts them.
+ *
+ * \param first the first particle.
+ * \param second the second particle.
+ * \return true if the first particle is higher in the image.
+*/
+static bool CompareHeight(const ParticleAnalysisReport &first, const ParticleAnalysisReport &second) {
+	return first.center_mass_y < second.center_mass_y;
+}
+
+/**
+ * \brief Build a report of particles, taking the simulated processing time.
+ *
+ * \param report the report to fill.
+ * \param frame the frame number, used to vary the particles.
+ * \param load_microseconds the processing time to simulate.
+*/
+static void BuildReport(std::vector<ParticleAnalysisReport> &report, int frame, int load_microseconds) {
+	UINT64 end = LoopTimer::GetTimestamp() + (UINT64) load_microseconds * 1000;
+
+	report.clear();
+	for (int i = 0; i < 8; i++) {
+		ParticleAnalysisReport particle;
+		memset(&particle, 0, sizeof(particle));
+		particle.imageWidth = 320;
+		particle.imageHeight = 240;
+		particle.center_mass_x = (frame * 7 + i * 40) % 320;
+		particle.center_mass_y = (frame * 13 + i * 29) % 240;
+		particle.particleArea = 100 + i;
+		report.push_back(particle);
+	}
+	std::sort(report.begin(), report.end(), CompareHeight);
+
+	while (LoopTimer::GetTimestamp() < end) {
+	}
+}
+
+/**
+ * \brief Publish reports until told to stop.
+ *
+ * \param state the shared state.
+ * \return 0.
+*/
+static int WriterTask(snapshot_bench_state * state) {
+	int frame = 0;
+	while (state->running) {
+		if (state->use_triple_buffer) {
+			target_report * report = state->reports.GetBack();
+			BuildReport(report->targets, frame, state->load_microseconds);
+			report->version = frame + 1;
+			report->capture_timestamp = LoopTimer::GetTimestamp();
+			report->processed_timestamp = report->capture_timestamp;
+			state->reports.Publish();
+		}
+		else {
+			CRITICAL_REGION(state->semaphore)
+				BuildReport(state->locked_report, frame, state->load_microseconds);
+			END_REGION
+		}
+		state->reports_published++;
+		frame++;
+		Wait(0.001);
+	}
+	return 0;
+}
+
+/**
+ * \brief Run one case, getting the latest report repeatedly while the writer runs.
+ *
+ * \param label the name of the case.
+ * \param state the shared state.
+ * \param loops the number of times to get the latest report.
+*/
+static void RunCase(const char * label, snapshot_bench_state * state, int loops) {
+	LoopTimer * timer = new LoopTimer();
+	int probe = timer->RegisterProbe(label);
+	std::vector<ParticleAnalysisReport> copy;
+	copy.reserve(32);
+	unsigned int targets = 0;
+
+	state->running = true;
+	state->reports_published = 0;
+	Task writer("snapwriter", (FUNCPTR) WriterTask, Task::kDefaultPriority + 1);
+	writer.Start((TaskArgument) state);
+
+	for (int i = 0; i < loops; i++) {
+		timer->Start(probe);
+		if (state->use_triple_buffer) {
+			const target_report * report = state->reports.GetLatest();
+			targets += report->targets.size();
+		}
+		else {
+			CRITICAL_REGION(state->semaphore)
+				copy.assign(state->locked_report.begin(), state->locked_report.end());
+			END_REGION
+			targets += copy.size();
+		}
+		timer->Stop(probe);
+		Wait(0.001);
+	}
+
+	state->running = false;
+	Wait(0.05);
+	writer.Stop();
+
+	printf("%-24s p50 %8.1f us p99 %8.1f us max %8.1f us %6d reports %8u targets read\n", label,
+			timer->GetPercentile(probe, 0.5) / 1000.0, timer->GetPercentile(probe, 0.99) / 1000.0,
+			timer->GetPercentile(probe, 1.0) / 1000.0, state->reports_published, targets);
+	SafeDelete(timer);
+}
+
+/**
+ * \brief Compare how long the reader waits for the latest report with each method.
+ *
+ * \param loops the number of times to get the latest report, 2000 if 0.
+ * \param load_microseconds the time spent building each report, 5000 if 0.
+ * \return 0.
+*/
+extern "C" int SnapshotBench(int loops, int load_microseconds) {
+	if (loops <= 0)
+		loops = 2000;
+	if (load_microseconds <= 0)
+		load_microseconds = 5000;
+
+	snapshot_bench_state * state = new snapshot_bench_state();
+	state->semaphore = semMCreate(SEM_Q_PRIORITY | SEM_INVERSION_SAFE | SEM_DELETE_SAFE);
+	state->load_microseconds = load_microseconds;
+	state->locked_report.reserve(32);
+	for (int i = 0; i < 3; i++) {
+		state->reports.GetBuffer(i)->targets.reserve(32);
+	}
+
+	printf("Getting the latest report %d times, %d us to build each report\n", loops, load_microseconds);
+	state->use_triple_buffer = false;
+	RunCase("semaphore and copy", state, loops);
+	state->use_triple_buffer = true;
+	RunCase("triple buffer", state, loops);
+
+	semDelete(state->semaphore);
+	SafeDelete(state);
+	return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * \file thresholdcheck.cpp
+ * \brief Checks the fast color threshold against the simple one and times both.
+ *
+ * Runs on the development computer, not the robot.  An image holding every
+ * possible color once (4096x4096) is thresholded with ThresholdKernel's
+ * Apply() and ApplyReference() for several thresholds in each color space,
+ * and any pixel where the masks differ is printed.  Then a 640x480 frame is
+ * thresholded repeatedly with both to compare their speed.  Build once more
+ * with -U__SSE2__ to check the scalar path the robot uses.
+ *
+ * Build: g++ -O2 -o thresholdcheck thresholdcheck.cpp ../Source/thresholdkernel.cpp
+ * Usage: thresholdcheck
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../Source/thresholdkernel.h"
+
+/**
+ * \struct check_threshold
+ * \brief A threshold to check.
+ */
+struct check_threshold {
+	ThresholdKernel::ColorSpace color_space;
+	int low[3];
+	int high[3];
+};
+
+/**
+ * \brief Get the time in seconds.
+ *
+ * \return seconds since an arbitrary start.
+*/
+static double GetSeconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+int main() {
+	static const check_threshold kThresholds[] = {
+		// The values in targeting.par
+		{ThresholdKernel::kHSV, {120, 50, 35}, {170, 120, 90}},
+		{ThresholdKernel::kHSL, {120, 50, 35}, {170, 120, 90}},
+		{ThresholdKernel::kRGB, {120, 50, 35}, {170, 120, 90}},
+		// Every pixel
+		{ThresholdKernel::kHSV, {0, 0, 0}, {255, 255, 255}},
+		{ThresholdKernel::kHSL, {0, 0, 0}, {255, 255, 255}},
+		// Greys only, and the edges of every plane
+		{ThresholdKernel::kHSV, {0, 0, 0}, {0, 0, 255}},
+		{ThresholdKernel::kHSL, {0, 0, 1}, {255, 1, 254}},
+		{ThresholdKernel::kHSV, {255, 255, 255}, {255, 255, 255}},
+		{ThresholdKernel::kHSL, {213, 128, 127}, {255, 255, 128}},
+		{ThresholdKernel::kHSV, {40, 200, 1}, {90, 254, 200}},
+		// Reds that wrap around 0
+		{ThresholdKernel::kHSV, {0, 100, 100}, {10, 255, 255}},
+		{ThresholdKernel::kHSV, {240, 100, 100}, {255, 255, 255}},
+		// Out of range boundaries
+		{ThresholdKernel::kHSL, {-5, -5, -5}, {300, 300, 300}},
+		{ThresholdKernel::kHSV, {10, 20, 30}, {5, 10, 20}}
+	};
+	static const int kThresholdCount = sizeof(kThresholds) / sizeof(kThresholds[0]);
+	static const int kSize = 4096;
+	int failures = 0;
+
+	// Every color once, with a garbage alpha byte
+	unsigned char * pixels = (unsigned char *) malloc(kSize * kSize * 4);
+	unsigned char * mask = (unsigned char *) malloc(kSize * kSize);
+	unsigned char * reference_mask = (unsigned char *) malloc(kSize * kSize);
+	if (pixels == NULL || mask == NULL || reference_mask == NULL) {
+		fprintf(stderr, "Unable to allocate the images\n");
+		return 1;
+	}
+	for (int i = 0; i < kSize * kSize; i++) {
+		pixels[i * 4] = i & 0xFF;
+		pixels[i * 4 + 1] = (i >> 8) & 0xFF;
+		pixels[i * 4 + 2] = (i >> 16) & 0xFF;
+		pixels[i * 4 + 3] = (i * 7) & 0xFF;
+	}
+
+	ThresholdKernel * kernel = new ThresholdKernel();
+	for (int t = 0; t < kThresholdCount; t++) {
+		const check_threshold &threshold = kThresholds[t];
+		kernel->SetThreshold(threshold.color_space, threshold.low[0], threshold.high[0], threshold.low[1],
+				threshold.high[1], threshold.low[2], threshold.high[2]);
+		memset(mask, 0xAA, kSize * kSize);
+		kernel->Apply(pixels, kSize, kSize, kSize, mask, kSize, 1);
+		kernel->ApplyReference(pixels, kSize, kSize, kSize, reference_mask, kSize, 1);
+
+		int differences = 0;
+		int matches = 0;
+		for (int i = 0; i < kSize * kSize; i++) {
+			if (reference_mask[i] != 0)
+				matches++;
+			if (mask[i] != reference_mask[i]) {
+				if (differences < 5) {
+					printf("  threshold %d: r %d g %d b %d gives %d, expected %d\n", t, pixels[i * 4 + 2],
+							pixels[i * 4 + 1], pixels[i * 4], mask[i], reference_mask[i]);
+				}
+				differences++;
+			}
+		}
+		printf("threshold %2d: %8d colors inside, %s\n", t, matches, differences == 0 ? "ok" : "FAILED");
+		if (differences != 0)
+			failures++;
+	}
+
+	// Time a camera sized frame, made of the middle of the color image
+	static const int kWidth = 640;
+	static const int kHeight = 480;
+	static const int kFrames = 50;
+	const unsigned char * frame = pixels + (kSize * (kSize / 2)) * 4;
+	kernel->SetThreshold(ThresholdKernel::kHSV, 120, 170, 50, 120, 35, 90);
+
+	double start = GetSeconds();
+	for (int i = 0; i < kFrames; i++) {
+		kernel->ApplyReference(frame, kWidth, kHeight, kSize, mask, kWidth, 1);
+	}
+	double reference_time = (GetSeconds() - start) / kFrames;
+	start = GetSeconds();
+	for (int i = 0; i < kFrames; i++) {
+		kernel->Apply(frame, kWidth, kHeight, kSize, mask, kWidth, 1);
+	}
+	double fast_time = (GetSeconds() - start) / kFrames;
+	printf("%dx%d: reference %.3f ms/frame, kernel %.3f ms/frame\n", kWidth, kHeight, reference_time * 1000.0,
+			fast_time * 1000.0);
+
+	delete kernel;
+	free(pixels);
+	free(mask);
+	free(reference_mask);
+	return failures == 0 ? 0 : 1;
+}
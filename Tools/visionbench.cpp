@@ -0,0 +1,223 @@
+/**
+ * \file visionbench.cpp
+ * \brief Measures the frame rate of the targeting image pipeline.
+ *
+ * Compares the pipeline that creates a new image for the camera frame and
+ * for each filter stage, the same NI Vision stages written into images that
+ * are created once and reused, and the one Targeting uses now, which finds
+ * and measures the particles in the threshold mask in one pass with
+ * ParticleLabeler.  A synthetic frame with three target sized rectangles
+ * stands in for the camera.
+ *
+ * Add this file to the robot project and call it from the VxWorks shell
+ * while the robot is disabled, e.g. "VisionBench 100, 2".  The second
+ * argument is the camera resolution as in targeting.par.  Results are
+ * printed to the console.
+ */
+#include "WPILib.h"
+#include "Vision/RGBImage.h"
+#include "../Source/common.h"
+#include "../Source/looptimer.h"
+#include "../Source/particlelabeler.h"
+
+/**
+ * \brief Fill an image with a dark background and three bright green rectangles.
+ *
+ * \param image the image to fill, already sized.
+*/
+static void DrawFrame(Image * image) {
+	ImageInfo info;
+	if (!imaqGetImageInfo(image, &info))
+		return;
+
+	RGBValue * pixels = (RGBValue *) info.imageStart;
+	for (int y = 0; y < info.yRes; y++) {
+		for (int x = 0; x < info.xRes; x++) {
+			RGBValue &pixel = pixels[y * info.pixelsPerLine + x];
+			pixel.R = 20;
+			pixel.G = 30;
+			pixel.B = 25;
+			pixel.alpha = 0;
+
+			// Three rectangle outlines, like the goals seen through the retro-reflective tape
+			int column = (x * 4) / info.xRes;
+			int left = (column * info.xRes) / 4 + info.xRes / 16;
+			int right = left + info.xRes / 6;
+			int top = info.yRes / 4 + column * (info.yRes / 16);
+			int bottom = top + info.yRes / 6;
+			bool inside = column < 3 && x >= left && x < right && y >= top && y < bottom;
+			bool border = inside && (x < left + 4 || x >= right - 4 || y < top + 4 || y >= bottom - 4);
+			if (border) {
+				pixel.R = 40;
+				pixel.G = 220;
+				pixel.B = 90;
+			}
+		}
+	}
+}
+
+/**
+ * \brief Process frames the old way, creating a new image for the frame and each stage.
+ *
+ * \param frame the synthetic camera frame.
+ * \param threshold the HSV threshold from targeting.par.
+ * \return the number of targets in the last frame.
+*/
+static int ProcessAllocating(Image * frame, Threshold &threshold) {
+	int targets = 0;
+	ColorImage * image = new ColorImage(IMAQ_IMAGE_RGB);
+	imaqDuplicate(image->GetImaqImage(), frame);
+	BinaryImage * color_filtered_image = image->ThresholdHSV(threshold);
+	BinaryImage * large_objects_image = color_filtered_image->RemoveSmallObjects(false, 2);
+	SafeDelete(color_filtered_image);
+	BinaryImage * convex_hull_image = large_objects_image->ConvexHull(false);
+	SafeDelete(large_objects_image);
+	vector<ParticleAnalysisReport> * report = convex_hull_image->GetOrderedParticleAnalysisReports();
+	SafeDelete(convex_hull_image);
+	if (report != NULL)
+		targets = report->size();
+	SafeDelete(report);
+	SafeDelete(image);
+	return targets;
+}
+
+/**
+ * \brief Process frames with the NI Vision stages, writing every stage into reused images.
+ *
+ * \param frame the synthetic camera frame.
+ * \param threshold the HSV threshold from targeting.par.
+ * \param image the reused camera image.
+ * \param masks the two reused binary images.
+ * \param report the reused report storage.
+ * \return the number of targets in the last frame.
+*/
+static int ProcessReusing(Image * frame, Threshold &threshold, ColorImage * image, BinaryImage ** masks,
+		vector<ParticleAnalysisReport> &report) {
+	Range plane_1_range = {threshold.plane1Low, threshold.plane1High};
+	Range plane_2_range = {threshold.plane2Low, threshold.plane2High};
+	Range plane_3_range = {threshold.plane3Low, threshold.plane3High};
+
+	imaqDuplicate(image->GetImaqImage(), frame);
+	imaqColorThreshold(masks[0]->GetImaqImage(), image->GetImaqImage(), 1, IMAQ_HSV,
+			&plane_1_range, &plane_2_range, &plane_3_range);
+	imaqSizeFilter(masks[1]->GetImaqImage(), masks[0]->GetImaqImage(), false, 2, IMAQ_KEEP_LARGE, NULL);
+	imaqConvexHull(masks[0]->GetImaqImage(), masks[1]->GetImaqImage(), false);
+
+	report.clear();
+	int particle_count = masks[0]->GetNumberParticles();
+	for (int i = 0; i < particle_count && report.size() < report.capacity(); i++) {
+		ParticleAnalysisReport particle;
+		masks[0]->GetParticleAnalysisReport(i, &particle);
+		report.push_back(particle);
+	}
+	return report.size();
+}
+
+/**
+ * \brief Process frames the way Targeting does, labeling the threshold mask in one pass.
+ *
+ * \param frame the synthetic camera frame.
+ * \param threshold the HSV threshold from targeting.par.
+ * \param image the reused camera image.
+ * \param mask the reused binary image.
+ * \param labeler the particle labeler.
+ * \param report the reused report storage.
+ * \return the number of targets in the last frame.
+*/
+static int ProcessLabeling(Image * frame, Threshold &threshold, ColorImage * image, BinaryImage * mask,
+		ParticleLabeler * labeler, vector<ParticleAnalysisReport> &report) {
+	Range plane_1_range = {threshold.plane1Low, threshold.plane1High};
+	Range plane_2_range = {threshold.plane2Low, threshold.plane2High};
+	Range plane_3_range = {threshold.plane3Low, threshold.plane3High};
+	ImageInfo mask_info;
+
+	imaqDuplicate(image->GetImaqImage(), frame);
+	imaqColorThreshold(mask->GetImaqImage(), image->GetImaqImage(), 1, IMAQ_HSV,
+			&plane_1_range, &plane_2_range, &plane_3_range);
+	report.clear();
+	if (!imaqGetImageInfo(mask->GetImaqImage(), &mask_info) ||
+			!labeler->Label((const unsigned char *) mask_info.imageStart, mask_info.xRes, mask_info.yRes,
+			mask_info.pixelsPerLine)) {
+		return 0;
+	}
+
+	int particle_count = labeler->GetNumberParticles();
+	for (int i = 0; i < particle_count && report.size() < report.capacity(); i++) {
+		ParticleAnalysisReport particle;
+		labeler->GetParticleAnalysisReport(i, &particle);
+		report.push_back(particle);
+	}
+	return report.size();
+}
+
+/**
+ * \brief Compare the frame rate of the three pipelines.
+ *
+ * \param frames the number of frames to process with each pipeline, 100 if 0.
+ * \param resolution the camera resolution, 0=640x480, 1=640x360, 2=320x240, 3=160x120.
+ * \return 0.
+*/
+extern "C" int VisionBench(int frames, int resolution) {
+	static const int kWidths[4] = {640, 640, 320, 160};
+	static const int kHeights[4] = {480, 360, 240, 120};
+	if (frames <= 0)
+		frames = 100;
+	if (resolution < 0 || resolution > 3)
+		resolution = 2;
+	int width = kWidths[resolution];
+	int height = kHeights[resolution];
+
+	// The values in targeting.par
+	Threshold threshold(120, 170, 50, 120, 35, 90);
+	Image * frame = imaqCreateImage(IMAQ_IMAGE_RGB, 0);
+	imaqSetImageSize(frame, width, height);
+	DrawFrame(frame);
+
+	// Images and storage reused by the new pipeline, created once like Targeting::AllocateImages()
+	ColorImage * image = new ColorImage(IMAQ_IMAGE_RGB);
+	BinaryImage * masks[2] = {new BinaryImage(), new BinaryImage()};
+	imaqSetImageSize(image->GetImaqImage(), width, height);
+	imaqSetImageSize(masks[0]->GetImaqImage(), width, height);
+	imaqSetImageSize(masks[1]->GetImaqImage(), width, height);
+	vector<ParticleAnalysisReport> report;
+	report.reserve(32);
+	ParticleLabeler * labeler = new ParticleLabeler();
+	labeler->SetMinimumArea(30);
+
+	printf("Processing %d frames at %dx%d\n", frames, width, height);
+
+	int allocating_targets = 0;
+	UINT64 start = LoopTimer::GetTimestamp();
+	for (int i = 0; i < frames; i++) {
+		allocating_targets = ProcessAllocating(frame, threshold);
+	}
+	double allocating_time = (LoopTimer::GetTimestamp() - start) / 1000000000.0;
+
+	int reusing_targets = 0;
+	start = LoopTimer::GetTimestamp();
+	for (int i = 0; i < frames; i++) {
+		reusing_targets = ProcessReusing(frame, threshold, image, masks, report);
+	}
+	double reusing_time = (LoopTimer::GetTimestamp() - start) / 1000000000.0;
+
+	int labeling_targets = 0;
+	start = LoopTimer::GetTimestamp();
+	for (int i = 0; i < frames; i++) {
+		labeling_targets = ProcessLabeling(frame, threshold, image, masks[0], labeler, report);
+	}
+	double labeling_time = (LoopTimer::GetTimestamp() - start) / 1000000000.0;
+
+	printf("%-28s %8.2f ms/frame %8.1f frames/s %3d targets\n", "new images every frame",
+			allocating_time * 1000.0 / frames, frames / allocating_time, allocating_targets);
+	printf("%-28s %8.2f ms/frame %8.1f frames/s %3d targets\n", "reused images",
+			reusing_time * 1000.0 / frames, frames / reusing_time, reusing_targets);
+	printf("%-28s %8.2f ms/frame %8.1f frames/s %3d targets\n", "single pass labeling",
+			labeling_time * 1000.0 / frames, frames / labeling_time, labeling_targets);
+
+	SafeDelete(labeler);
+	SafeDelete(masks[0]);
+	SafeDelete(masks[1]);
+	SafeDelete(image);
+	imaqDispose(frame);
+	return 0;
+}
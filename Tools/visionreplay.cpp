@@ -0,0 +1,436 @@
+/**
+ * \file visionreplay.cpp
+ * \brief Runs recorded camera frames through the targeting image processing.
+ *
+ * Runs on the development computer, not the robot.  Frames recorded by
+ * Targeting (RECORD_FRAMES in targeting.par) are read back and passed
+ * through the same VisionPipeline the robot uses, with the threshold and
+ * particle filter values from a targeting.par file.  The frames per second
+ * and the average time of each stage are printed.  THRESHOLD_KERNEL picks
+ * the threshold as in Targeting: 0 runs imaqColorThreshold() over the whole
+ * frame, here the simulator's copy of it, and 1 runs the built-in kernel.
+ * With the kernel and TRACKING_FULL_SCAN_INTERVAL set, only the regions
+ * around the last targets are searched between full frame searches, the way
+ * Targeting does with the heading held still, and the number of frames
+ * searched again is printed.  Otherwise each whole frame is searched.  The
+ * number of regions with too many particles to label them all is printed.
+ * With THRESHOLD_TUNING set, the threshold is tuned between frames the way
+ * Targeting does, and the final threshold is printed.
+ *
+ * If a truth file is given, the targets found are compared with it and the
+ * precision and recall are printed.  Each line of the truth file is a
+ * target: "frame left top width height", with frames numbered from 0.  A
+ * target found counts as correct if its bounding rectangle overlaps a
+ * target in the truth file by at least half of the area of the two
+ * together.  Lines starting with '#' are ignored.
+ *
+ * Build: g++ -O2 -DSIMULATION -I../Simulator/include -o visionreplay visionreplay.cpp
+ *        ../Source/visionpipeline.cpp ../Source/thresholdkernel.cpp ../Source/particlelabeler.cpp
+ *        ../Source/framerecording.cpp ../Source/thresholdtuner.cpp ../Source/parameters.cpp
+ *        ../Source/readfile.cpp ../Simulator/simulatedvision.cpp ../Simulator/simulatedclock.cpp -lpthread
+ * Usage: visionreplay frames.rec [targeting.par] [truth.txt]
+ *
+ * The made up recordings in Tools/replay have their own targeting.par and
+ * truth file, e.g. "visionreplay replay/tracking.rec replay/tracking.par
+ * replay/tracking.txt".  replay/colorthreshold.par searches the same
+ * recording with imaqColorThreshold() and an HSV threshold, and
+ * replay/fade.par tunes the threshold on replay/fade.rec.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "WPILib.h"
+#include "../Source/framerecording.h"
+#include "../Source/parameters.h"
+#include "../Source/thresholdtuner.h"
+#include "../Source/visionpipeline.h"
+
+/**
+ * \def MAXIMUM_PIXELS
+ * \brief The largest frame that can be replayed, 640x480.
+ */
+#define MAXIMUM_PIXELS (640 * 480)
+
+/**
+ * \def MAXIMUM_TARGETS
+ * \brief The largest number of targets kept for a frame, as in Targeting.
+ */
+#define MAXIMUM_TARGETS 32
+
+/**
+ * \def MAXIMUM_REGIONS
+ * \brief The largest number of targets tracked, as in Targeting.
+ */
+#define MAXIMUM_REGIONS 4
+
+/**
+ * \struct truth_target
+ * \brief A target in the truth file.
+ */
+struct truth_target {
+	int frame;
+	Rect rectangle;
+};
+
+/**
+ * \brief Get the time in seconds.
+ *
+ * \return seconds since an arbitrary start.
+*/
+static double GetSeconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+/**
+ * \brief Read the targets in a truth file.
+ *
+ * \param path the path and filename of the truth file.
+ * \param truth the list to add the targets to.
+ * \return true if successful.
+*/
+static bool ReadTruth(const char * path, std::vector<truth_target> &truth) {
+	FILE * file = fopen(path, "r");
+	if (file == NULL) {
+		return false;
+	}
+	char line[128];
+	int line_number = 0;
+	while (fgets(line, sizeof(line), file) != NULL) {
+		line_number++;
+		truth_target target;
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+			continue;
+		}
+		if (sscanf(line, "%d %d %d %d %d", &target.frame, &target.rectangle.left, &target.rectangle.top,
+				&target.rectangle.width, &target.rectangle.height) != 5) {
+			printf("%s line %d: expected \"frame left top width height\"\n", path, line_number);
+			fclose(file);
+			return false;
+		}
+		truth.push_back(target);
+	}
+	fclose(file);
+	return true;
+}
+
+/**
+ * \brief Get how much two rectangles overlap.
+ *
+ * \param first the first rectangle.
+ * \param second the second rectangle.
+ * \return the area of the overlap divided by the area of the two together, 0 to 1.
+*/
+static double GetOverlap(const Rect &first, const Rect &second) {
+	int left = first.left > second.left ? first.left : second.left;
+	int top = first.top > second.top ? first.top : second.top;
+	int right = first.left + first.width < second.left + second.width ? first.left + first.width :
+			second.left + second.width;
+	int bottom = first.top + first.height < second.top + second.height ? first.top + first.height :
+			second.top + second.height;
+	if (right <= left || bottom <= top) {
+		return 0.0;
+	}
+	double overlap = (double) (right - left) * (bottom - top);
+	return overlap / ((double) first.width * first.height + (double) second.width * second.height - overlap);
+}
+
+/**
+ * \brief Count the targets found that match a target in the truth file.
+ *
+ * Each truth target can only be matched once.
+ *
+ * \param frame the frame number.
+ * \param report the targets found in the frame.
+ * \param truth the targets in the truth file.
+ * \return the number of targets found that match.
+*/
+static int CountMatches(int frame, const std::vector<ParticleAnalysisReport> &report,
+		const std::vector<truth_target> &truth) {
+	std::vector<bool> matched(truth.size(), false);
+	int matches = 0;
+	for (unsigned int i = 0; i < report.size(); i++) {
+		for (unsigned int j = 0; j < truth.size(); j++) {
+			if (!matched[j] && truth[j].frame == frame &&
+					GetOverlap(report[i].boundingRect, truth[j].rectangle) >= 0.5) {
+				matched[j] = true;
+				matches++;
+				break;
+			}
+		}
+	}
+	return matches;
+}
+
+/**
+ * \brief Threshold and label parts of a frame, timing each.
+ *
+ * \param pipeline the image processing.
+ * \param pixels the frame.
+ * \param mask the mask, the same size as the frame.
+ * \param width the width of the frame in pixels.
+ * \param height the height of the frame in pixels.
+ * \param regions the parts of the frame to search.
+ * \param region_count the number of regions.
+ * \param report cleared and filled with the targets found.
+ * \param threshold_seconds the time spent thresholding is added to it.
+ * \param labeling_seconds the time spent labeling and filtering is added to it.
+ * \return true if successful.
+*/
+static bool SearchRegions(VisionPipeline &pipeline, const unsigned char * pixels, unsigned char * mask, int width,
+		int height, const Rect * regions, int region_count, std::vector<ParticleAnalysisReport> &report,
+		double * threshold_seconds, double * labeling_seconds) {
+	report.clear();
+	double start = GetSeconds();
+	pipeline.Threshold(pixels, width, mask, width, regions, region_count);
+	double thresholded = GetSeconds();
+	bool found = pipeline.FindTargets(mask, width, height, width, regions, region_count, report, MAXIMUM_TARGETS);
+	*threshold_seconds += thresholded - start;
+	*labeling_seconds += GetSeconds() - thresholded;
+	return found;
+}
+
+/**
+ * \brief Threshold a whole frame with imaqColorThreshold() and label it, timing each.
+ *
+ * \param pipeline the image processing.
+ * \param color_image the frame.
+ * \param mask_image the mask, sized to the frame by imaqColorThreshold().
+ * \param color_mode the color planes to compare.
+ * \param threshold_low the lower boundary of each plane.
+ * \param threshold_high the upper boundary of each plane.
+ * \param report cleared and filled with the targets found.
+ * \param threshold_seconds the time spent thresholding is added to it.
+ * \param labeling_seconds the time spent labeling and filtering is added to it.
+ * \return true if successful.
+*/
+static bool SearchColorThreshold(VisionPipeline &pipeline, Image * color_image, Image * mask_image,
+		ColorMode color_mode, const int * threshold_low, const int * threshold_high,
+		std::vector<ParticleAnalysisReport> &report, double * threshold_seconds, double * labeling_seconds) {
+	report.clear();
+	Range plane_1_range = {threshold_low[0], threshold_high[0]};
+	Range plane_2_range = {threshold_low[1], threshold_high[1]};
+	Range plane_3_range = {threshold_low[2], threshold_high[2]};
+	ImageInfo mask_info;
+	double start = GetSeconds();
+	if (!imaqColorThreshold(mask_image, color_image, 1, color_mode, &plane_1_range, &plane_2_range, &plane_3_range) ||
+			!imaqGetImageInfo(mask_image, &mask_info)) {
+		return false;
+	}
+	double thresholded = GetSeconds();
+	Rect whole_frame = {0, 0, mask_info.yRes, mask_info.xRes};
+	bool found = pipeline.FindTargets((const unsigned char *) mask_info.imageStart, mask_info.xRes, mask_info.yRes,
+			mask_info.pixelsPerLine, &whole_frame, 1, report, MAXIMUM_TARGETS);
+	*threshold_seconds += thresholded - start;
+	*labeling_seconds += GetSeconds() - thresholded;
+	return found;
+}
+
+int main(int argc, char ** argv) {
+	if (argc < 2) {
+		printf("Usage: visionreplay frames.rec [targeting.par] [truth.txt]\n");
+		return 1;
+	}
+
+	// The same defaults as Targeting
+	int threshold_type = 0;
+	int threshold_low[3] = {0, 50, 0};
+	int threshold_high[3] = {50, 255, 50};
+	int particle_minimum_area = 30;
+	float ratio_minimum = 1.0;
+	float ratio_maximum = 3.2;
+	float score_minimum = 80.0;
+	int tuning = 0;
+	int tuning_limit = 20;
+	int tuning_step = 2;
+	int tuning_margin = 4;
+	int tuning_samples = 5000;
+	int tracking_full_scan_interval = 0;
+	int tracking_padding = 10;
+	int threshold_kernel = 0;
+	if (argc >= 3) {
+		Parameters parameters(argv[2]);
+		if (!parameters.file_opened_ || !parameters.ReadValues()) {
+			printf("Could not read %s\n", argv[2]);
+			return 1;
+		}
+		parameters.GetValue("THRESHOLD_TYPE", &threshold_type);
+		parameters.GetValue("THRESHOLD_KERNEL", &threshold_kernel);
+		parameters.GetValue("THRESHOLD_PLANE_1_LOW", &threshold_low[0]);
+		parameters.GetValue("THRESHOLD_PLANE_1_HIGH", &threshold_high[0]);
+		parameters.GetValue("THRESHOLD_PLANE_2_LOW", &threshold_low[1]);
+		parameters.GetValue("THRESHOLD_PLANE_2_HIGH", &threshold_high[1]);
+		parameters.GetValue("THRESHOLD_PLANE_3_LOW", &threshold_low[2]);
+		parameters.GetValue("THRESHOLD_PLANE_3_HIGH", &threshold_high[2]);
+		parameters.GetValue("PARTICLE_MINIMUM_AREA", &particle_minimum_area);
+		parameters.GetValue("TARGET_RECTANGLE_RATIO_MINIMUM", &ratio_minimum);
+		parameters.GetValue("TARGET_RECTANGLE_RATIO_MAXIMUM", &ratio_maximum);
+		parameters.GetValue("TARGET_RECTANGLE_SCORE_THRESHOLD", &score_minimum);
+		parameters.GetValue("THRESHOLD_TUNING", &tuning);
+		parameters.GetValue("THRESHOLD_TUNING_LIMIT", &tuning_limit);
+		parameters.GetValue("THRESHOLD_TUNING_STEP", &tuning_step);
+		parameters.GetValue("THRESHOLD_TUNING_MARGIN", &tuning_margin);
+		parameters.GetValue("THRESHOLD_TUNING_SAMPLES", &tuning_samples);
+		parameters.GetValue("TRACKING_FULL_SCAN_INTERVAL", &tracking_full_scan_interval);
+		parameters.GetValue("TRACKING_PADDING", &tracking_padding);
+		parameters.Close();
+	}
+
+	std::vector<truth_target> truth;
+	if (argc >= 4 && !ReadTruth(argv[3], truth)) {
+		printf("Could not read %s\n", argv[3]);
+		return 1;
+	}
+
+	FrameRecording recording;
+	if (!recording.OpenForRead(argv[1])) {
+		printf("%s is not a frame recording\n", argv[1]);
+		return 1;
+	}
+
+	VisionPipeline pipeline;
+	pipeline.SetThreshold((ThresholdKernel::ColorSpace) threshold_type, threshold_low[0], threshold_high[0],
+			threshold_low[1], threshold_high[1], threshold_low[2], threshold_high[2]);
+	pipeline.SetParticleFilter(particle_minimum_area, ratio_minimum, ratio_maximum, score_minimum);
+	ThresholdTuner tuner;
+	tuner.SetTuning(tuning_limit, tuning_step, tuning_margin, tuning_samples);
+	tuner.SetThreshold((ThresholdKernel::ColorSpace) threshold_type, threshold_low, threshold_high);
+	int tuning_updates = 0;
+
+	unsigned char * pixels = new unsigned char[MAXIMUM_PIXELS * 4];
+	unsigned char * mask = new unsigned char[MAXIMUM_PIXELS];
+	Image * color_image = imaqCreateImage(IMAQ_IMAGE_RGB, 0);
+	Image * mask_image = imaqCreateImage(IMAQ_IMAGE_U8, 0);
+	ColorMode color_mode = IMAQ_RGB;
+	if ((ThresholdKernel::ColorSpace) threshold_type == ThresholdKernel::kHSV)
+		color_mode = IMAQ_HSV;
+	else if ((ThresholdKernel::ColorSpace) threshold_type == ThresholdKernel::kHSL)
+		color_mode = IMAQ_HSL;
+	std::vector<ParticleAnalysisReport> report;
+	report.reserve(MAXIMUM_TARGETS);
+	std::vector<ParticleAnalysisReport> last_report;
+	last_report.reserve(MAXIMUM_TARGETS);
+	int frames_since_full_scan = 0;
+	int tracked_frames = 0;
+	int missed_frames = 0;
+	int clipped_frames = 0;
+
+	int frames = 0;
+	int targets_found = 0;
+	int targets_matched = 0;
+	double threshold_seconds = 0.0;
+	double labeling_seconds = 0.0;
+	int width = 0;
+	int height = 0;
+	unsigned long long capture_timestamp = 0;
+	unsigned long long first_timestamp = 0;
+	while (recording.ReadFrame(pixels, MAXIMUM_PIXELS, &width, &height, &capture_timestamp)) {
+		if (frames == 0) {
+			first_timestamp = capture_timestamp;
+		}
+		Rect whole_frame = {0, 0, height, width};
+
+		// Copy the frame into an image for imaqColorThreshold(), as the camera does
+		if (!threshold_kernel) {
+			ImageInfo color_info;
+			if (!imaqSetImageSize(color_image, width, height) || !imaqGetImageInfo(color_image, &color_info)) {
+				printf("Could not make a %dx%d image\n", width, height);
+				break;
+			}
+			memcpy(color_info.imageStart, pixels, width * height * 4);
+		}
+
+		// Search around the last targets if possible, otherwise the whole frame, as Targeting does
+		Rect regions[MAXIMUM_REGIONS];
+		int region_count = 0;
+		if (threshold_kernel && tracking_full_scan_interval > 0 && frames_since_full_scan < tracking_full_scan_interval) {
+			region_count = VisionPipeline::PredictRegions(last_report, 0, tracking_padding, width, height, regions,
+					MAXIMUM_REGIONS);
+		}
+		bool found = false;
+		if (region_count > 0) {
+			found = SearchRegions(pipeline, pixels, mask, width, height, regions, region_count, report,
+					&threshold_seconds, &labeling_seconds);
+			if (found && pipeline.GetClippedParticles() > 0) {
+				found = false;
+				clipped_frames++;
+			}
+			else if (found && report.size() < last_report.size()) {
+				found = false;
+				missed_frames++;
+			}
+			frames_since_full_scan++;
+			tracked_frames++;
+		}
+		if (!found && !threshold_kernel) {
+			found = SearchColorThreshold(pipeline, color_image, mask_image, color_mode, threshold_low, threshold_high,
+					report, &threshold_seconds, &labeling_seconds);
+		}
+		else if (!found) {
+			found = SearchRegions(pipeline, pixels, mask, width, height, &whole_frame, 1, report,
+					&threshold_seconds, &labeling_seconds);
+			frames_since_full_scan = 0;
+		}
+		if (found) {
+			last_report = report;
+		}
+		else {
+			printf("Frame %d: could not search\n", frames);
+		}
+
+		targets_found += report.size();
+		targets_matched += CountMatches(frames, report, truth);
+		frames++;
+
+		// Tune the threshold for the next frame, as Targeting does
+		if (tuning) {
+			tuner.AddTargets(pixels, width, pipeline.GetTargetRuns());
+			if (tuner.Update(threshold_low, threshold_high)) {
+				pipeline.SetThreshold((ThresholdKernel::ColorSpace) threshold_type, threshold_low[0], threshold_high[0],
+						threshold_low[1], threshold_high[1], threshold_low[2], threshold_high[2]);
+				tuning_updates++;
+			}
+		}
+	}
+	recording.Close();
+
+	if (frames == 0) {
+		printf("No frames in %s\n", argv[1]);
+	}
+	else {
+		double total_seconds = threshold_seconds + labeling_seconds;
+		printf("%d frames %dx%d, recorded over %.1f s, thresholded with %s\n", frames, width, height,
+				(capture_timestamp - first_timestamp) / 1000000000.0,
+				threshold_kernel ? "the built-in kernel" : "imaqColorThreshold()");
+		printf("threshold           %8.3f ms/frame\n", threshold_seconds * 1000.0 / frames);
+		printf("label and filter    %8.3f ms/frame\n", labeling_seconds * 1000.0 / frames);
+		printf("total               %8.3f ms/frame %8.1f frames/s\n", total_seconds * 1000.0 / frames,
+				total_seconds > 0.0 ? frames / total_seconds : 0.0);
+		printf("targets found       %8d\n", targets_found);
+		printf("label overflows     %8u regions only searched in part\n", pipeline.GetLabelOverflows());
+		if (threshold_kernel && tracking_full_scan_interval > 0) {
+			printf("tracked frames      %8d, %d searched again for a missing target, %d for one cut off\n",
+					tracked_frames, missed_frames, clipped_frames);
+		}
+		if (tuning) {
+			printf("threshold tuned     %8d times, to %d-%d %d-%d %d-%d\n", tuning_updates, threshold_low[0],
+					threshold_high[0], threshold_low[1], threshold_high[1], threshold_low[2], threshold_high[2]);
+		}
+		if (argc >= 4) {
+			printf("precision           %8.3f (%d of %d found are in the truth file)\n",
+					targets_found > 0 ? (double) targets_matched / targets_found : 0.0, targets_matched, targets_found);
+			printf("recall              %8.3f (%d of %d in the truth file were found)\n",
+					truth.size() > 0 ? (double) targets_matched / truth.size() : 0.0, targets_matched,
+					(int) truth.size());
+		}
+	}
+
+	delete [] pixels;
+	delete [] mask;
+	imaqDispose(color_image);
+	imaqDispose(mask_image);
+	return 0;
+}